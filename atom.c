@@ -277,7 +277,14 @@ static void internal_add_atom(section *sec,atom *a)
   sec->last = a;
 
   sec->pc = pcalign(a,sec->pc);
-  a->lastsize = atom_size(a,sec,sec->pc);
+  if (relax_grow) {
+    /* start with the minimum size, the resolver may only grow it */
+    sec->flags |= RESOLVE_MINSIZE;
+    a->lastsize = atom_size(a,sec,sec->pc);
+    sec->flags &= ~RESOLVE_MINSIZE;
+  }
+  else
+    a->lastsize = atom_size(a,sec,sec->pc);
   sec->pc += a->lastsize;
   if (a->align > sec->align)
     sec->align = a->align;
@@ -0,0 +1,280 @@
+/* compress.c  data compression codecs for vasm */
+/* (c) in 2026 by agent@local */
+
+#include "vasm.h"
+#include "compress.h"
+
+/* Kosinski */
+#define KOS_WINDOW 0x2000
+#define KOS_MAXLEN 256
+#define KOS_MAXCHAIN 256
+#define KOS_HASHSIZE 0x10000
+
+/* PackBits */
+#define PB_MAXRUN 128
+
+/* cache of compressed data, indexed by a hash of codec and input */
+#define CACHEHASHSIZE 0x100
+
+struct cacheent {
+  struct cacheent *next;
+  uint32_t hash;
+  int codec;
+  uint8_t *in;
+  size_t inlen;
+  uint8_t *out;
+  size_t outlen;
+};
+
+static struct cacheent *cache[CACHEHASHSIZE];
+
+
+struct kos {
+  uint8_t *out;
+  size_t pos;       /* next output byte */
+  size_t descpos;   /* position of the current description field */
+  unsigned desc;
+  int nbits;
+};
+
+static void kos_bit(struct kos *k,int b)
+{
+  if (b)
+    k->desc |= 1 << k->nbits;
+  if (++k->nbits == 16) {
+    /* The decompressor fetches the next description field immediately
+       after consuming the last bit, so it precedes the command's data. */
+    k->out[k->descpos] = (uint8_t)k->desc;
+    k->out[k->descpos+1] = (uint8_t)(k->desc >> 8);
+    k->descpos = k->pos;
+    k->pos += 2;
+    k->desc = 0;
+    k->nbits = 0;
+  }
+}
+
+static int kos_cost(size_t len,size_t dist)
+/* number of bits to encode a match, or 0 when not encodable */
+{
+  if (len>=2 && len<=5 && dist<=256)
+    return 2+2+8;   /* inline */
+  if (len>=3 && len<=9)
+    return 2+16;    /* separate */
+  if (len>=10)
+    return 2+24;    /* separate, extended count */
+  return 0;
+}
+
+static size_t kos_match(const uint8_t *src,size_t len,size_t i,
+                        int32_t *head,int32_t *prev,size_t *bestdist)
+/* find the match with the best savings compared to literals (9 bits) */
+{
+  size_t maxlen = len-i<KOS_MAXLEN ? len-i : KOS_MAXLEN;
+  size_t bestlen = 0;
+  long bestgain = 0;
+  int32_t j;
+  int chain;
+
+  if (maxlen < 2)
+    return 0;
+  j = head[(src[i]<<8)|src[i+1]];
+  for (chain=0; j>=0 && i-j<=KOS_WINDOW && chain<KOS_MAXCHAIN; chain++) {
+    size_t n,dist=i-j;
+    long gain;
+    int c;
+
+    for (n=0; n<maxlen && src[j+n]==src[i+n]; n++);
+    if ((c = kos_cost(n,dist)) != 0) {
+      gain = (long)n*9 - c;
+      if (gain > bestgain) {
+        bestgain = gain;
+        bestlen = n;
+        *bestdist = dist;
+      }
+    }
+    if (n == maxlen)
+      break;
+    j = prev[j];
+  }
+  return bestlen;
+}
+
+static size_t kosinski(uint8_t *dst,const uint8_t *src,size_t len)
+{
+  int32_t *head = mymalloc(KOS_HASHSIZE*sizeof(int32_t));
+  int32_t *prev = mymalloc((len?len:1)*sizeof(int32_t));
+  struct kos k;
+  size_t i,h,n,dist,ndist;
+
+  for (h=0; h<KOS_HASHSIZE; h++)
+    head[h] = -1;
+  k.out = dst;
+  k.descpos = 0;
+  k.pos = 2;
+  k.desc = 0;
+  k.nbits = 0;
+
+  for (i=0; i<len; ) {
+    n = kos_match(src,len,i,head,prev,&dist);
+    if (n && i+1<len) {
+      /* lazy evaluation: prefer a literal, when the next match is better */
+      size_t n2;
+
+      if (i+1 < len-1) {
+        h = (src[i]<<8) | src[i+1];
+        prev[i] = head[h];
+        head[h] = (int32_t)i;
+        n2 = kos_match(src,len,i+1,head,prev,&ndist);
+        head[h] = prev[i];
+        if ((long)n2*9-kos_cost(n2,ndist) > (long)n*9-kos_cost(n,dist)+9)
+          n = 0;
+      }
+    }
+
+    if (n == 0) {
+      kos_bit(&k,1);
+      dst[k.pos++] = src[i];
+      n = 1;
+    }
+    else if (n<=5 && dist<=256) {
+      kos_bit(&k,0);
+      kos_bit(&k,0);
+      kos_bit(&k,((n-2)>>1)&1);
+      kos_bit(&k,(n-2)&1);
+      dst[k.pos++] = (uint8_t)(0x100-dist);
+    }
+    else {
+      unsigned v = (0x10000-dist) & 0xffff;
+
+      kos_bit(&k,0);
+      kos_bit(&k,1);
+      dst[k.pos++] = (uint8_t)v;
+      if (n <= 9)
+        dst[k.pos++] = (uint8_t)(((v>>5)&0xf8) | (n-2));
+      else {
+        dst[k.pos++] = (uint8_t)((v>>5)&0xf8);
+        dst[k.pos++] = (uint8_t)(n-1);
+      }
+    }
+
+    /* insert all covered positions into the hash chains */
+    for (; n>0; n--,i++) {
+      if (i+1 < len) {
+        h = (src[i]<<8) | src[i+1];
+        prev[i] = head[h];
+        head[h] = (int32_t)i;
+      }
+    }
+  }
+
+  /* end of stream marker */
+  kos_bit(&k,0);
+  kos_bit(&k,1);
+  dst[k.pos++] = 0x00;
+  dst[k.pos++] = 0xf0;
+  dst[k.pos++] = 0x00;
+  dst[k.descpos] = (uint8_t)k.desc;
+  dst[k.descpos+1] = (uint8_t)(k.desc >> 8);
+
+  myfree(prev);
+  myfree(head);
+  return k.pos;
+}
+
+static size_t kosinski_max(size_t len)
+{
+  /* literals need 9 bits, plus description fields and end marker */
+  return len + len/8 + 16;
+}
+
+
+static size_t packbits(uint8_t *dst,const uint8_t *src,size_t len)
+{
+  size_t i=0,pos=0,lit,run;
+
+  while (i < len) {
+    for (run=1; i+run<len && run<PB_MAXRUN && src[i+run]==src[i]; run++);
+    if (run >= 2) {
+      dst[pos++] = (uint8_t)(257-run);  /* -(run-1) */
+      dst[pos++] = src[i];
+      i += run;
+      continue;
+    }
+    /* collect literals up to the next run of at least three bytes */
+    for (lit=1; i+lit<len && lit<PB_MAXRUN; lit++) {
+      if (i+lit+2<len && src[i+lit]==src[i+lit+1] &&
+          src[i+lit]==src[i+lit+2])
+        break;
+    }
+    dst[pos++] = (uint8_t)(lit-1);
+    memcpy(dst+pos,src+i,lit);
+    pos += lit;
+    i += lit;
+  }
+  return pos;
+}
+
+static size_t packbits_max(size_t len)
+{
+  return len + (len+PB_MAXRUN-1)/PB_MAXRUN;
+}
+
+
+static struct {
+  const char *name;
+  size_t (*compress)(uint8_t *,const uint8_t *,size_t);
+  size_t (*maxsize)(size_t);
+} codecs[] = {
+  { "kosinski",kosinski,kosinski_max },
+  { "packbits",packbits,packbits_max }
+};
+
+
+int find_codec(const char *name)
+{
+  int i;
+
+  for (i=0; i<sizeof(codecs)/sizeof(codecs[0]); i++) {
+    if (!stricmp(name,codecs[i].name))
+      return i;
+  }
+  return CODEC_NONE;
+}
+
+
+uint8_t *compress_data(int codec,const uint8_t *src,size_t len,size_t *outlen)
+/* Compress the data with the given codec and return it in a new buffer.
+   Identical input is only compressed once. */
+{
+  struct cacheent *ce;
+  uint32_t hash = 2166136261U ^ (uint32_t)codec;
+  uint8_t *out;
+  size_t i;
+
+  for (i=0; i<len; i++)
+    hash = (hash ^ src[i]) * 16777619U;  /* FNV-1a */
+
+  for (ce=cache[hash%CACHEHASHSIZE]; ce; ce=ce->next) {
+    if (ce->hash==hash && ce->codec==codec && ce->inlen==len &&
+        !memcmp(ce->in,src,len))
+      break;
+  }
+
+  if (ce == NULL) {
+    ce = mymalloc(sizeof(struct cacheent));
+    ce->hash = hash;
+    ce->codec = codec;
+    ce->in = mymalloc(len?len:1);
+    memcpy(ce->in,src,len);
+    ce->inlen = len;
+    ce->out = mymalloc(codecs[codec].maxsize(len));
+    ce->outlen = codecs[codec].compress(ce->out,src,len);
+    ce->next = cache[hash%CACHEHASHSIZE];
+    cache[hash%CACHEHASHSIZE] = ce;
+  }
+
+  out = mymalloc(ce->outlen?ce->outlen:1);
+  memcpy(out,ce->out,ce->outlen);
+  *outlen = ce->outlen;
+  return out;
+}
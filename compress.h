@@ -0,0 +1,12 @@
+/* compress.h  data compression codecs for vasm */
+/* (c) in 2026 by agent@local */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#define CODEC_NONE -1
+
+int find_codec(const char *);
+uint8_t *compress_data(int,const uint8_t *,size_t,size_t *);
+
+#endif
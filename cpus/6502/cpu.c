@@ -30,6 +30,27 @@ const uint8_t opsize[NUM_OPTYPES] = {
   0,0,2,2,2,2,3,3,1,1,1,1,1,2,1,1,1,1,1,2,2,1,2,1,4,1,2,0,0,1,2,0,1,0
 };
 
+/* zero/direct-page variables for the allocator (ZPVAR) */
+struct zpvar {
+  struct zpvar *next;
+  symbol *sym;
+  const char *scope;        /* liveness scope, NULL for always live */
+  taddr size;
+  taddr weight;             /* negative: use number of accesses */
+  unsigned long accesses;   /* instructions which may use zero page */
+  int zponly;               /* used with a zero/direct-page only mode */
+  int idx;
+};
+static struct zpvar *first_zpvar,*last_zpvar;
+static int zpvar_cnt;
+static hashtable *zpvarhash;
+static uint8_t zpfree[256];  /* bytes available for ZPVARs (ZPALLOC) */
+static int zpfree_cnt;
+static utaddr zpbase;
+static utaddr zpspill;
+static int zpspill_set;
+static symbol zpvar_unknown;  /* placeholder value until zpvar_solve() */
+
 /* table for cpu specific extra directives */
 struct ExtraDirectives {
   char *name;
@@ -324,6 +345,40 @@ static char *handle_zpage(char *s)
   return s;
 }
 
+static char *handle_zpalloc(char *s)
+{
+  utaddr start,end;
+
+  start = (utaddr)parse_constexpr(&s);
+  s = skip(s);
+  if (*s == ',') {
+    s = skip(s+1);
+    end = (utaddr)parse_constexpr(&s);
+  }
+  else
+    end = start;
+  if (zpfree_cnt == 0)
+    zpbase = start & ~0xff;
+  if (end < start || (start & ~0xff) != zpbase || (end & ~0xff) != zpbase)
+    cpu_error(11);  /* operand not in zero/direct-page range */
+  else {
+    for (; start<=end; start++) {
+      if (!zpfree[start & 0xff]) {
+        zpfree[start & 0xff] = 1;
+        zpfree_cnt++;
+      }
+    }
+  }
+  return s;
+}
+
+static char *handle_zpspill(char *s)
+{
+  zpspill = (utaddr)parse_constexpr(&s);
+  zpspill_set = 1;
+  return s;
+}
+
 static char *handle_zero(char *s)
 {
   static const char zeroname[] = ".zero";
@@ -386,6 +441,8 @@ static struct ExtraDirectives cpudirs[] = {
   "cpu",~0,handle_cpu,
   "setdp",~0,handle_setdp,
   "zpage",~0,handle_zpage,
+  "zpalloc",~0,handle_zpalloc,
+  "zpspill",~0,handle_zpspill,
   "zero",~0,handle_zero,
   "a8",WDC65816,handle_asize8,
   "a16",WDC65816,handle_asize16,
@@ -449,11 +506,224 @@ int parse_cpu_label(char *labname,char **start)
       *start = skip_line(s);
       return 1;
     }
+
+    if (s-dir==5 && !strnicmp(dir,"zpvar",5)) {
+      /* label ZPVAR <size>[,<weight>[,<scope>]] */
+      struct zpvar *v = mymalloc(sizeof(struct zpvar));
+      strbuf *buf;
+      hashdata data;
+
+      /* value is assigned by zpvar_solve(), before resolving sections,
+         so it must not be folded into any expression until then */
+      if (zpvar_unknown.name == NULL) {
+        zpvar_unknown.type = IMPORT;
+        zpvar_unknown.name = "zpvar";
+      }
+      v->sym = new_equate(labname,new_sym_expr(&zpvar_unknown));
+      v->sym->flags |= ZPVARSYM;
+      s = skip(s);
+      v->next = NULL;
+      v->size = parse_constexpr(&s);
+      v->weight = -1;
+      v->scope = NULL;
+      v->accesses = 0;
+      v->zponly = 0;
+      v->idx = zpvar_cnt++;
+      s = skip(s);
+      if (*s == ',') {
+        s = skip(s+1);
+        if (*s != ',') {
+          v->weight = parse_constexpr(&s);
+          s = skip(s);
+        }
+        if (*s == ',') {
+          s = skip(s+1);
+          if (buf = parse_identifier(0,&s))
+            v->scope = mystrdup(buf->str);
+          else
+            cpu_error(8);  /* identifier expected */
+        }
+      }
+      if (v->size<1 || v->size>0x100) {
+        cpu_error(9);  /* bad operand */
+        v->size = 1;
+      }
+
+      if (zpvarhash == NULL)
+        zpvarhash = new_hashtable(0x400);
+      data.ptr = v;
+      add_hashentry(zpvarhash,v->sym->name,data);
+      if (last_zpvar)
+        last_zpvar->next = v;
+      else
+        first_zpvar = v;
+      last_zpvar = v;
+
+      eol(s);
+      *start = skip_line(s);
+      return 1;
+    }
   }
   return 0;
 }
 
 
+static struct zpvar *zpvar_ref(expr *tree)
+/* find a ZPVAR symbol referenced in an expression */
+{
+  struct zpvar *v;
+  hashdata data;
+
+  if (tree == NULL)
+    return NULL;
+  if (tree->type == SYM) {
+    if ((tree->c.sym->flags & ZPVARSYM) &&
+        find_name(zpvarhash,tree->c.sym->name,&data))
+      return (struct zpvar *)data.ptr;
+    return NULL;
+  }
+  if ((v = zpvar_ref(tree->left)) != NULL)
+    return v;
+  return zpvar_ref(tree->right);
+}
+
+
+static int zpvar_cmp(const void *p1,const void *p2)
+/* variables required in zero page first, then by weight per byte */
+{
+  const struct zpvar *v1 = *(const struct zpvar **)p1;
+  const struct zpvar *v2 = *(const struct zpvar **)p2;
+  unsigned long long d1,d2;
+
+  if (v1->zponly != v2->zponly)
+    return v2->zponly - v1->zponly;
+  d1 = (unsigned long long)v1->weight * v2->size;
+  d2 = (unsigned long long)v2->weight * v1->size;
+  if (d1 != d2)
+    return d1 > d2 ? -1 : 1;
+  return v1->idx - v2->idx;  /* keep definition order */
+}
+
+
+void zpvar_solve(section *first_sec)
+/* Count zero-page capable accesses of all ZPVARs, then pack the variables
+   with the highest weight per byte into the ZPALLOC area. Variables in
+   different liveness scopes may share the same bytes. Remaining variables
+   are placed at ZPSPILL and will use absolute addressing. */
+{
+  struct zpvar *v,**vtab;
+  const char **scopes;
+  uint8_t (*used)[256];
+  unsigned long bytes_saved=0,cycles_saved=0;
+  utaddr spilladdr = zpspill;
+  int i,j,k,nscopes=0,nzp=0;
+  section *sec;
+  atom *a;
+
+  if (zpvar_cnt == 0)
+    return;
+
+  /* count accesses by instructions which may use zero-page addressing */
+  for (sec=first_sec; sec; sec=sec->next) {
+    for (a=sec->first; a; a=a->next) {
+      instruction *ip;
+
+      if (a->type!=INSTRUCTION || (ip=a->content.inst)->code<0)
+        continue;
+      for (i=0; i<MAX_OPERANDS && ip->op[i]!=NULL; i++) {
+        operand *op = ip->op[i];
+
+        if (op->value==NULL || (v = zpvar_ref(op->value))==NULL)
+          continue;
+        if ((op->flags & OF_LO) || (op->type>=DPAGE && op->type<=DPAGEZ) ||
+            (op->type>=DPINDX && op->type<=DPIND) ||
+            (op->type>=LDPINDY && op->type<=LDPIND)) {
+          v->zponly = 1;
+          v->accesses++;
+        }
+        else if (IS_ABS(op->type) && mnemonics[ip->code].ext.zp_opcode &&
+                 !(op->flags & (OF_HI|OF_WA)))
+          v->accesses++;
+      }
+    }
+  }
+
+  /* sort by priority and assign scope numbers (0 is global) */
+  vtab = mymalloc(zpvar_cnt * sizeof(struct zpvar *));
+  scopes = mymalloc((zpvar_cnt+1) * sizeof(const char *));
+  for (v=first_zpvar,i=0; v; v=v->next,i++) {
+    vtab[i] = v;
+    if (v->weight < 0)
+      v->weight = v->accesses;
+  }
+  qsort(vtab,zpvar_cnt,sizeof(struct zpvar *),zpvar_cmp);
+  for (v=first_zpvar; v; v=v->next) {
+    if (v->scope) {
+      for (j=1; j<=nscopes; j++) {
+        if (!strcmp(scopes[j],v->scope))
+          break;
+      }
+      if (j > nscopes)
+        scopes[++nscopes] = v->scope;
+    }
+  }
+  used = mycalloc((nscopes+1) * sizeof(*used));
+
+  for (i=0; i<zpvar_cnt; i++) {
+    int sc = 0;
+    taddr addr = -1;
+
+    v = vtab[i];
+    if (v->scope) {
+      for (sc=1; strcmp(scopes[sc],v->scope); sc++);
+    }
+
+    /* first fit into bytes which are free in the variable's scope */
+    for (j=0; j+v->size<=256 && addr<0; j++) {
+      for (k=j; k<j+v->size; k++) {
+        if (!zpfree[k] || used[0][k] || (sc && used[sc][k]))
+          break;
+        if (!sc) {
+          int s;
+
+          for (s=1; s<=nscopes && !used[s][k]; s++);
+          if (s <= nscopes)
+            break;
+        }
+      }
+      if (k == j+v->size)
+        addr = j;
+    }
+
+    if (addr >= 0) {
+      for (k=addr; k<addr+v->size; k++)
+        used[sc][k] = 1;
+      addr += zpbase;
+      nzp++;
+      bytes_saved += v->accesses;
+      cycles_saved += v->weight;
+    }
+    else {
+      if (v->zponly)
+        cpu_error(16,v->sym->name);  /* requires zero page, doesn't fit */
+      if (!zpspill_set) {
+        cpu_error(17,v->sym->name);  /* no ZPSPILL address */
+        zpspill_set = 1;
+      }
+      addr = spilladdr;
+      spilladdr += v->size;
+    }
+    free_expr(v->sym->expr);
+    v->sym->expr = number_expr(addr);
+  }
+  cpu_error(15,nzp,zpvar_cnt,bytes_saved,cycles_saved);
+
+  myfree(used);
+  myfree(scopes);
+  myfree(vtab);
+}
+
+
 static void optimize_instruction(instruction *ip,section *sec,
                                  taddr pc,int final)
 {
@@ -480,10 +750,14 @@ static void optimize_instruction(instruction *ip,section *sec,
                 && !mnemo->ext.al_opcode)
               cpu_error(12);  /* abslong not available */
           }
+          /* The grow-only resolver starts with zero page addressing and
+             an oscillating address keeps absolute addressing. */
           if (mnemo->ext.zp_opcode && ((op->flags & OF_LO) ||
                                        (!(op->flags & (OF_HI|OF_WA)) &&
-              ((base==NULL && (((utaddr)val>=(utaddr)dpage &&
-                                (utaddr)val<=(utaddr)dpage+0xff))) ||
+              ((sec->flags & RESOLVE_MINSIZE) ||
+               (base==NULL && !(sec->flags & RESOLVE_WARN) &&
+                (((utaddr)val>=(utaddr)dpage &&
+                  (utaddr)val<=(utaddr)dpage+0xff))) ||
                (base!=NULL && ((base->flags & ZPAGESYM) || (LOCREF(base) &&
                                (base->sec->flags & NEAR_ADDRESSING)))))
              ))) {
@@ -503,6 +777,15 @@ static void optimize_instruction(instruction *ip,section *sec,
         else if (branchopt) {
           taddr bd = val - (pc + 2);
 
+          if (sec->flags & RESOLVE_MINSIZE) {
+            /* grow-only resolver mode starts with the short branch */
+            bd = 0;
+          }
+          else if (sec->flags & RESOLVE_WARN) {
+            /* keep the long form of an oscillating branch */
+            bd = 0x100;
+          }
+
           if (op->type==REL8 && (base==NULL || !is_pc_reloc(base,sec)) &&
               (bd<-0x80 || bd>0x7f)) {
             if (mnemo->ext.opcode==0x80 || mnemo->ext.opcode==0x12) {
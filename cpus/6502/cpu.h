@@ -136,9 +136,14 @@ enum {
 
 /* cpu-specific symbol-flags */
 #define ZPAGESYM (RSRVD_C<<0)   /* symbol will reside in the zero/direct-page */
+#define ZPVARSYM (RSRVD_C<<1)   /* symbol is allocated by zpvar_solve() */
+
+/* allocate ZPVAR symbols before the resolver runs */
+#define CPU_PRE_RESOLVE(s) zpvar_solve(s)
 
 
 /* exported by cpu.c */
 extern uint16_t cpu_type;
 int cpu_available(int);
 int parse_cpu_label(char *,char **);
+void zpvar_solve(section *);
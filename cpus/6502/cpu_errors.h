@@ -13,3 +13,7 @@
   "absolute-long addressing not available",ERROR,
   "cpu must be defined before any code is generated",ERROR,
   "unknown cpu model: %s",ERROR,
+  "zpvar: %d of %d variables in zero/direct-page, saving %lu bytes and "
+    "%lu weighted cycles",NOLINE|MESSAGE,                           /* 15 */
+  "zpvar <%s> requires zero/direct-page addressing, but doesn't fit",NOLINE|ERROR,
+  "no zpspill address defined for zpvar <%s>",NOLINE|ERROR,
@@ -42,7 +42,7 @@ static const char *shift_strings[NUM_SHIFTTYPES] = {
   "LSL","LSR","ASR","ROR","RRX","ASL"
 };
 
-static int OC_SWP,OC_NOP;
+static int OC_B,OC_SWP,OC_NOP;
 static int elfoutput = 0;       /* output will be an ELF object file */
 
 static section *last_section = 0;
@@ -54,6 +54,37 @@ static int last_data_type = -1; /* for mapping symbol generation */
 #define THB_PREFETCH 4          /* prefetch-correction for Thumb-branches */
 #define ARM_PREFETCH 8          /* prefetch-correction for ARM-branches */
 
+/* literal pools for LDR Rd,=<expr> */
+#define LITPOOL_RANGE 0x1000    /* PC-relative range of LDR */
+
+struct litentry {
+  struct litentry *next;
+  expr *value;
+  symbol *label;
+};
+
+struct litmark {                /* position of an LTORG directive */
+  struct litmark *next;
+  atom *a;
+};
+
+struct litpool {
+  struct litpool *next;
+  section *sec;
+  struct litentry *first,*last;
+  struct litmark *marks,*lastmark;
+  taddr firstref;               /* worst-case offset of the oldest LDR */
+  int cnt;
+};
+static struct litpool *first_litpool;
+
+/* mnemonic classes for literal pool placement, indexed by mnemonic */
+static unsigned char *mnemo_class;
+#define MC_NONE 0
+#define MC_B    1               /* B, BX: always a barrier */
+#define MC_MOV  2               /* MOV PC,..: barrier */
+#define MC_LDR  3               /* LDR PC,..: barrier, LDR Rd,=<expr> */
+#define MC_LDM  4               /* LDM ..,{..,PC}: barrier */
 
 
 operand *new_operand(void)
@@ -68,6 +99,25 @@ int cpu_available(int idx)
 }
 
 
+static struct litpool *find_litpool(section *sec,int create)
+/* return the literal pool of a section, create a new one if requested */
+{
+  struct litpool *lp;
+
+  for (lp=first_litpool; lp; lp=lp->next) {
+    if (lp->sec == sec)
+      return lp;
+  }
+  if (create) {
+    lp = mycalloc(sizeof(struct litpool));
+    lp->sec = sec;
+    lp->next = first_litpool;
+    first_litpool = lp;
+  }
+  return lp;
+}
+
+
 char *parse_cpu_special(char *start)
 /* parse cpu-specific directives; return pointer to end of
    cpu-specific text */
@@ -80,7 +130,31 @@ char *parse_cpu_special(char *start)
       s++;
     if (dotdirs && *name=='.')
       name++;
-    if (s-name==5 && !strncmp(name,"thumb",5)) {
+    if ((s-name==5 && !strncmp(name,"ltorg",5)) ||
+        (s-name==4 && !strncmp(name,"pool",4))) {
+      /* remember the position, the pool is placed after parsing */
+      section *sec = default_section();
+
+      if (sec) {
+        struct litpool *lp = find_litpool(sec,1);
+        struct litmark *m = mymalloc(sizeof(struct litmark));
+        symbol *lab = new_tmplabel(sec);
+
+        lab->flags |= VASMINTERN|PROTECTED;
+        m->next = NULL;
+        m->a = new_label_atom(lab);
+        add_atom(sec,m->a);
+        if (lp->lastmark)
+          lp->lastmark->next = m;
+        else
+          lp->marks = m;
+        lp->lastmark = m;
+      }
+      else
+        general_error(3);  /* no current section */
+      return s;
+    }
+    else if (s-name==5 && !strncmp(name,"thumb",5)) {
       thumb_mode = 1;
       if (inst_alignment > 1)
         inst_alignment = 2;
@@ -373,6 +447,14 @@ int parse_operand(char *p,int len,operand *op,int optype)
       return PO_NOMATCH;
     }
 
+    else if (optype==PCL12 && *p=='=') {
+      /* LDR Rd,=<expr>: MOV/MVN or load from the literal pool, which
+         is decided by place_litpools() */
+      p = skip(p+1);
+      op->value = parse_expr(&p);
+      op->flags |= OFL_LITERAL;
+    }
+
     else if (STDOPER(optype)) {
       /* parse an expression (register, label, imm.) and assign to 'value' */
       if (IMMEDOPER(optype)) {
@@ -1024,6 +1106,7 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
   int am = get_addrmode(ip);
   int aa4ldst = 0;
   int opcnt = 0;
+  int ldrpc;
   size_t isize = 4;
   taddr chkreg = -1;
 
@@ -1096,6 +1179,23 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
     if (!eval_expr(op.value,&val,sec,pc))
       btype = find_base(op.value,&base,sec,pc);
 
+    if (op.flags & (OFL_LITERAL|OFL_LITIMM)) {
+      if (insn && (mnemo_class[ip->code]!=MC_LDR || am!=AM_NONE))
+        cpu_error(31);  /* literal only allowed with LDR */
+      if (op.flags & OFL_LITIMM) {
+        /* LDR Rd,=<const> is replaced by MOV/MVN Rd,#<const> */
+        op.type = NOOP;
+        if (insn) {
+          if ((rotval = rotated_immediate(val)) != ROTFAIL)
+            *insn = (*insn & 0xf000f000) | 0x03a00000 | rotval;
+          else if ((rotval = rotated_immediate(~val)) != ROTFAIL)
+            *insn = (*insn & 0xf000f000) | 0x03e00000 | rotval;
+          else
+            ierror(0);
+        }
+      }
+    }
+
     /* do optimizations first */
 
     if (op.type==PCL12 || op.type==PCLRT ||
@@ -1116,8 +1216,12 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
               break;
 
           case PCL12:
-            if ((!aa4ldst && val<0x1000 && val>-0x1000) ||
-                (aa4ldst && val<0x100 && val>-0x100)) {
+            /* a literal load is never expanded, its pool is in range */
+            ldrpc = opt_ldrpc && !(op.flags & OFL_LITERAL);
+            if ((ldrpc && (sec->flags&RESOLVE_MINSIZE)) ||
+                (!(ldrpc && (sec->flags&RESOLVE_WARN)) &&
+                 ((!aa4ldst && val<0x1000 && val>-0x1000) ||
+                  (aa4ldst && val<0x100 && val>-0x100)))) {
               op.type = IMUD2;  /* handle as normal #+/-Imm12 */
               if (val < 0)
                 val = -val;
@@ -1126,7 +1230,7 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
               base = NULL;  /* no more checks */
             }
             else {
-              if (opt_ldrpc &&
+              if (ldrpc &&
                   ((!aa4ldst && val<0x100000 && val>-0x100000) ||
                    (aa4ldst && val<0x10000 && val>-0x10000))) {
                 /* ADD/SUB Rd,PC,#offset&0xff000 */
@@ -1165,8 +1269,12 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
               }
               else {
                 op.type = NOOP;
-                if (insn)
-                  cpu_error(4,val);  /* PC-relative ldr/str out of range */
+                if (insn) {
+                  if (op.flags & OFL_LITERAL)
+                    cpu_error(32,(long)val);  /* literal pool out of range */
+                  else
+                    cpu_error(4,val);  /* PC-relative ldr/str out of range */
+                }
               }
             }
             break;
@@ -1196,9 +1304,13 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
                 *insn ^= 0x00c00000;
               val = -val;
             }
-            if (am!=AM_L && (rotval = rotated_immediate(val))!=ROTFAIL &&
-                !(opt_adr && (sec->flags&RESOLVE_WARN))) {
-              if (insn)
+            if (am!=AM_L &&
+                (((rotval = rotated_immediate(val))!=ROTFAIL &&
+                  !(opt_adr && (sec->flags&RESOLVE_WARN))) ||
+                 (opt_adr && (sec->flags&RESOLVE_MINSIZE)))) {
+              /* single ADD/SUB, also the initial size of an optimized ADR
+                 in grow-only resolver mode */
+              if (insn && rotval!=ROTFAIL)
                 *insn |= rotval;
             }
             else if (opt_adr || am==AM_L) {
@@ -1658,12 +1770,305 @@ dblock *eval_data(operand *op,size_t bitsize,section *sec,taddr pc)
 }
 
 
+static int is_code_barrier(instruction *ip)
+/* true for an unconditional ARM instruction which never continues
+   execution with the following instruction */
+{
+  taddr val;
+
+  switch (mnemo_class[ip->code]) {
+    case MC_B:
+      return get_condcode(ip) == 0xe0000000;
+    case MC_MOV:
+    case MC_LDR:
+      return get_condcode(ip) == 0xe0000000 &&
+             eval_expr(ip->op[0]->value,&val,NULL,0) && val==15;
+    case MC_LDM:
+      return get_condcode(ip) == 0xe0000000 &&
+             eval_expr(ip->op[1]->value,&val,NULL,0) && (val & 0x8000)!=0;
+  }
+  return 0;
+}
+
+
+static int is_arm_inst(atom *a)
+{
+  return a->type==INSTRUCTION && a->content.inst->code>=0 &&
+         !(mnemonics[a->content.inst->code].ext.flags & THUMB);
+}
+
+
+static taddr max_atom_size(atom *a,section *sec,taddr pos)
+/* largest size an atom may reach while resolving */
+{
+  if (a->type==INSTRUCTION && a->content.inst->code>=0) {
+    instruction *ip = a->content.inst;
+    int i;
+
+    if (mnemonics[ip->code].ext.flags & THUMB)
+      return 4;
+    for (i=0; i<MAX_OPERANDS && ip->op[i]!=NULL; i++) {
+      if (ip->op[i]->flags & OFL_LITERAL)
+        return 4;  /* never expanded, the pool is placed within range */
+      if ((ip->op[i]->type==PCL12 && opt_ldrpc) ||
+          (ip->op[i]->type==PCLRT && opt_adr))
+        return 8;  /* may become ADD/LDR or ADRL */
+    }
+  }
+  return atom_size(a,sec,pos);
+}
+
+
+static taddr worst_align(taddr pos,taddr align)
+/* Align a worst-case offset. Offsets are relative to a 4-byte aligned
+   LDR, so smaller alignments can be rounded up, larger ones may insert
+   up to align-1 bytes. */
+{
+  if (align <= 1)
+    return pos;
+  if (align <= 4)
+    return (pos + align - 1) & ~(align - 1);
+  return pos + align - 1;
+}
+
+
+static atom *insert_atom(section *sec,atom *prev,atom *a,size_t size)
+/* link a new atom behind prev and return it */
+{
+  a->next = prev->next;
+  prev->next = a;
+  if (sec->last == prev)
+    sec->last = a;
+  a->src = prev->src;
+  a->line = prev->line;
+  a->list = NULL;
+  a->changes = 0;
+  a->lastsize = size;
+  return a;
+}
+
+
+static atom *flush_litpool(struct litpool *lp,atom *prev,int branch)
+/* insert all pending literals behind prev, optionally preceded by
+   a branch around the pool, and return the last inserted atom */
+{
+  section *sec = lp->sec;
+  struct litentry *e,*next;
+  symbol *skiplab = NULL;
+  atom *a;
+
+  if (branch) {
+    instruction *ip = mycalloc(sizeof(instruction));
+
+    skiplab = new_tmplabel(sec);
+    skiplab->flags |= VASMINTERN|PROTECTED;
+    ip->code = OC_B;
+    ip->op[0] = new_operand();
+    ip->op[0]->type = BRA24;
+    ip->op[0]->value = new_sym_expr(skiplab);
+    prev = insert_atom(sec,prev,new_inst_atom(ip),4);
+    prev->align = 4;
+  }
+
+  for (e=lp->first; e; e=next) {
+    operand *op = new_operand();
+
+    next = e->next;
+    op->type = DATA_OP;
+    op->value = e->value;
+    a = new_label_atom(e->label);
+    a->align = 4;
+    prev = insert_atom(sec,prev,a,0);
+    prev = insert_atom(sec,prev,new_datadef_atom(32,op),4);
+    myfree(e);
+  }
+
+  if (skiplab)
+    prev = insert_atom(sec,prev,new_label_atom(skiplab),0);
+  lp->first = lp->last = NULL;
+  lp->cnt = 0;
+  return prev;
+}
+
+
+static int same_literal(expr *a,expr *b)
+/* check whether two literal expressions will always have the same value */
+{
+  if (a==NULL || b==NULL)
+    return a == b;
+  if (a->type != b->type)
+    return 0;
+  switch (a->type) {
+    case NUM:
+      return a->c.val == b->c.val;
+    case SYM:
+      /* the current-pc symbol has a different value in every line */
+      return a->c.sym==b->c.sym && !(a->c.sym->flags & VASMINTERN);
+    case HUG:
+    case FLT:
+      return 0;
+  }
+  return same_literal(a->left,b->left) && same_literal(a->right,b->right);
+}
+
+
+static int refers_label(expr *tree)
+/* check whether an expression depends on a label, whose value may still
+   change while resolving */
+{
+  symbol *sym;
+  int rc;
+
+  if (tree == NULL)
+    return 0;
+  if (tree->type == SYM) {
+    sym = tree->c.sym;
+    if (sym->type == LABSYM)
+      return 1;
+    if (sym->type!=EXPRESSION || (sym->flags & INEVAL))
+      return 0;
+    sym->flags |= INEVAL;
+    rc = refers_label(sym->expr);
+    sym->flags &= ~INEVAL;
+    return rc;
+  }
+  return refers_label(tree->left) || refers_label(tree->right);
+}
+
+
+static void make_literal(struct litpool *lp,operand *op,taddr ref)
+/* LDR Rd,=<expr> becomes MOV/MVN for a suitable constant, otherwise
+   <expr> is put into the pending pool, reusing an identical entry */
+{
+  struct litentry *e;
+  taddr val;
+
+  if (!refers_label(op->value) && eval_expr(op->value,&val,NULL,0) &&
+      (rotated_immediate(val)!=ROTFAIL || rotated_immediate(~val)!=ROTFAIL)) {
+    op->flags = (op->flags & ~OFL_LITERAL) | OFL_LITIMM;
+    return;
+  }
+
+  for (e=lp->first; e; e=e->next) {
+    if (same_literal(e->value,op->value)) {
+      free_expr(op->value);
+      op->value = new_sym_expr(e->label);
+      return;
+    }
+  }
+
+  e = mymalloc(sizeof(struct litentry));
+  e->next = NULL;
+  e->value = op->value;
+  e->label = new_tmplabel(lp->sec);
+  e->label->flags |= VASMINTERN|PROTECTED;
+  op->value = new_sym_expr(e->label);
+  if (lp->last)
+    lp->last->next = e;
+  else {
+    lp->first = e;
+    lp->firstref = ref;
+  }
+  lp->last = e;
+  lp->cnt++;
+}
+
+
+void place_litpools(section *first)
+/* Allocate the literals of LDR Rd,=<expr> and place the literal pools
+   after the source has been parsed. Offsets are computed with the
+   largest size each atom may reach while resolving, so the resolver
+   can never move a literal out of range. A pool goes to an LTORG,
+   behind an unconditional branch once half of the LDR range is used,
+   or behind a branch around it, before the oldest LDR would get out
+   of range. Remaining literals are placed at the end of the section. */
+{
+  section *sec;
+
+  for (sec=first; sec; sec=sec->next) {
+    struct litpool *lp = find_litpool(sec,1);
+    struct litmark *m = lp->marks;
+    atom *a,*prev = NULL;
+    taddr pos = 0;
+
+    for (a=sec->first; a; a=a->next) {
+      taddr start,size;
+      int i;
+
+      if (m!=NULL && a==m->a) {
+        /* LTORG */
+        m = m->next;
+        if (lp->first) {
+          pos = worst_align(pos,4) + lp->cnt * 4;
+          a = flush_litpool(lp,a,0);
+        }
+        prev = a;
+        continue;
+      }
+      if (a->type == LABEL)
+        continue;  /* a pool is inserted in front of the labels */
+
+      start = worst_align(pos,a->align);
+      size = max_atom_size(a,sec,start);
+
+      /* Would the pool, including a new entry for this atom, be out of
+         range behind it? Then insert it now, behind the last instruction. */
+      if (lp->first && prev!=NULL && is_arm_inst(prev) &&
+          worst_align(start+size,4) + 4 + lp->cnt * 4 -
+          (lp->firstref + ARM_PREFETCH) >= LITPOOL_RANGE) {
+        int branch = !is_code_barrier(prev->content.inst);
+
+        pos = worst_align(pos,4) + (branch ? 4 : 0) + lp->cnt * 4;
+        prev = flush_litpool(lp,prev,branch);
+        start = worst_align(pos,a->align);
+      }
+
+      if (is_arm_inst(a)) {
+        instruction *ip = a->content.inst;
+
+        for (i=0; i<MAX_OPERANDS && ip->op[i]!=NULL; i++) {
+          if (ip->op[i]->flags & OFL_LITERAL)
+            make_literal(lp,ip->op[i],start);
+        }
+        if (lp->first && is_code_barrier(ip) &&
+            start + size + lp->cnt * 4 -
+            (lp->firstref + ARM_PREFETCH) > LITPOOL_RANGE / 2) {
+          pos = worst_align(start+size,4) + lp->cnt * 4;
+          prev = a = flush_litpool(lp,a,0);
+          continue;
+        }
+      }
+      pos = start + size;
+      prev = a;
+    }
+
+    if (lp->first)
+      flush_litpool(lp,sec->last,0);
+  }
+}
+
+
 int init_cpu(void)
 {
   char r[4];
   int i;
 
+  mnemo_class = mycalloc(mnemonic_cnt);
   for (i=0; i<mnemonic_cnt; i++) {
+    if (!(mnemonics[i].ext.flags & THUMB)) {
+      if (!strcmp(mnemonics[i].name,"b")) {
+        OC_B = i;
+        mnemo_class[i] = MC_B;
+      }
+      else if (!strcmp(mnemonics[i].name,"bx"))
+        mnemo_class[i] = MC_B;
+      else if (!strcmp(mnemonics[i].name,"mov"))
+        mnemo_class[i] = MC_MOV;
+      else if (!strcmp(mnemonics[i].name,"ldr"))
+        mnemo_class[i] = MC_LDR;
+      else if (!strcmp(mnemonics[i].name,"ldm"))
+        mnemo_class[i] = MC_LDM;
+    }
     if (!strcmp(mnemonics[i].name,"swp"))
       OC_SWP = i;
     else if (!strcmp(mnemonics[i].name,"nop"))
@@ -34,6 +34,9 @@ typedef uint32_t utaddr;
 /* returns true when instruction is valid for selected cpu */
 #define MNEMONIC_VALID(i) cpu_available(i)
 
+/* allocate literals and place the literal pools before resolving */
+#define CPU_PRE_RESOLVE(s) place_litpools(s)
+
 
 /* type to store each operand */
 typedef struct {
@@ -49,6 +52,8 @@ typedef struct {
 #define OFL_UP          (0x0010)  /* set up-flag, add offset to base */
 #define OFL_SPSR        (0x0020)  /* 1:SPSR, 0:CPSR */
 #define OFL_FORCE       (0x0040)  /* LDM/STM PSR & force user bit */
+#define OFL_LITERAL     (0x0080)  /* LDR Rd,=<expr> from literal pool */
+#define OFL_LITIMM      (0x0100)  /* LDR Rd,=<expr> replaced by MOV/MVN */
 
 
 /* operand types - WARNING: the order is important! See defines below. */
@@ -213,3 +218,4 @@ typedef struct {
 extern int arm_be_mode;
 
 int cpu_available(int);
+void place_litpools(section *);
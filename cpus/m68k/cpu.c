@@ -4106,8 +4106,8 @@ dontswap:
             ip->qualifiers[0] = l_str;
           break;
         default:
-          if (ext == '\0')
-            ip->qualifiers[0] = w_str;
+          if (ext == '\0')  /* first guess, byte-size when growing only */
+            ip->qualifiers[0] = (sec->flags&RESOLVE_MINSIZE) ? b_str : w_str;
           break;
       }
       if (final && warn_opts>1) {
@@ -720,6 +720,14 @@ static int z80asm_compat = 0;
 static int cpu_type = CPU_Z80;
 static int swapixiy = 0;
 static int rcmemu = 0;
+static int branchopt = 0;
+
+/* Branch relaxation forms, see branch_relax() */
+#define BRX_NONE  0   /* assemble as written */
+#define BRX_JR    1   /* jp [cc,]label -> jr [cc,]label */
+#define BRX_JP    2   /* jr [cc,]label -> jp [cc,]label */
+#define BRX_DJNZ  3   /* djnz label -> dec b / jp nz,label */
+static const size_t brx_size[] = { 0, 2, 3, 4 };
 
 /* Variables set by special parsing */
 static int altd_enabled = 0;
@@ -1289,6 +1297,7 @@ void init_instruction_ext(instruction_ext *ext)
     ext->altd = altd_enabled;
     ext->ioi = ioi_enabled;
     ext->ioe = ioe_enabled;
+    ext->size = 0;
 }
 
 static int parse_rcm_identifier(char **sptr)
@@ -1385,7 +1394,117 @@ char *parse_cpu_special(char *start)
     return start;
 }
 
-size_t instruction_size(instruction *ip, section *sec, taddr pc)
+/* Decide whether a jp, jr or djnz instruction should be assembled in a
+   different form (-opt-branch). Only destinations in the current section
+   (or absolute addresses in an absolute section) are considered, so the
+   decision depends on nothing but the current pc and the label values of
+   this pass. The resolver sets RESOLVE_WARN only while sizing an atom which
+   kept changing its size, so just such an oscillating branch is pinned to
+   its long form. An explicit jr or djnz which is in range is never
+   changed. */
+static int branch_relax(instruction *ip, section *sec, taddr pc)
+{
+    int      class = mnemonics[ip->code].ext.class;
+    operand *op;
+    symbol  *base;
+    taddr    val, diff;
+    int      far;
+
+    if ( !branchopt || (cpu_type & (CPU_8080|CPU_80OS)) ||
+         ip->ext.altd || ip->ext.ioi || ip->ext.ioe ) {
+        return BRX_NONE;
+    }
+    if ( class == MCLASS_JP || class == MCLASS_JR || class == MCLASS_DJNZ ) {
+        op = ip->op[0];
+    } else if ( (class == MCLASS_JPCC || class == MCLASS_JRCC) &&
+                ip->op[0]->flags <= FLAGS_C ) {
+        op = ip->op[1];  /* jr only knows about nz, z, nc and c */
+    } else {
+        return BRX_NONE;
+    }
+
+    if ( sec->flags & RESOLVE_MINSIZE ) {
+        /* grow-only resolver mode (-relax=grow) starts with the short form */
+        return ( class == MCLASS_JP || class == MCLASS_JPCC ) ? BRX_JR : BRX_NONE;
+    }
+
+    if ( eval_expr(op->value, &val, sec, pc) ) {
+        /* constant destination is only pc-relative in an absolute section */
+        if ( (sec->flags & ABSOLUTE) == 0 &&
+             (class == MCLASS_JP || class == MCLASS_JPCC) ) {
+            return BRX_NONE;
+        }
+    } else if ( find_base(op->value, &base, sec, pc) != BASE_OK ||
+                is_pc_reloc(base, sec) ) {
+        return BRX_NONE;
+    }
+
+    diff = val - (pc + 2);
+    far = diff < -0x80 || diff > 0x7f;
+
+    if ( class == MCLASS_JP || class == MCLASS_JPCC ) {
+        return far || (sec->flags & RESOLVE_WARN) ? BRX_NONE : BRX_JR;
+    }
+    if ( far || (sec->flags & RESOLVE_WARN) ) {
+        return class == MCLASS_DJNZ ? BRX_DJNZ : BRX_JP;
+    }
+    return BRX_NONE;
+}
+
+/* Write a branch in the form selected by branch_relax() */
+static dblock *eval_relaxed_branch(instruction *ip, int form, section *sec, taddr pc)
+{
+    dblock *db = new_dblock();
+    operand *op = ip->op[1] ? ip->op[1] : ip->op[0];
+    int      cc = ip->op[1] ? ip->op[0]->flags : -1;
+    unsigned char *d;
+    symbol  *base;
+    taddr    val;
+
+    db->size = brx_size[form];
+    db->data = mymalloc(db->size);
+    d = (unsigned char *)db->data;
+
+    if ( form == BRX_DJNZ ) {
+        cpu_error(26, "djnz", "dec b ; jp nz");
+        *d++ = 0x05;  /* dec b */
+        cc = FLAGS_NZ;
+    } else if ( form == BRX_JP ) {
+        cpu_error(26, "jr", "jp");
+    }
+    if ( form == BRX_JR ) {
+        *d++ = cc < 0 ? 0x18 : 0x20 + cc * 8;
+    } else {
+        *d++ = cc < 0 ? 0xc3 : 0xc2 + cc * 8;
+    }
+
+    if ( eval_expr(op->value, &val, sec, pc) == 0 ) {
+        modifier = 0;
+        if ( find_base(op->value, &base, sec, pc) == BASE_OK ) {
+            if ( form != BRX_JR ) {
+                add_extnreloc(&db->relocs, base, val, REL_ABS,
+                              0, 16, (d - (unsigned char *)db->data));
+            }
+        } else {
+            general_error(38);  /* illegal relocation */
+        }
+    }
+
+    if ( form == BRX_JR ) {
+        val -= pc + db->size;
+        if ( val < -128 || val > 127 ) {
+            cpu_error(3, val);
+        }
+        *d = val;
+    } else {
+        setval(0, d, 2, val);
+    }
+    return db;
+}
+
+/* Determine the size of an instruction from its opcode and operand types.
+   It doesn't depend on the pc, so it is only called once per instruction. */
+static size_t static_instruction_size(instruction *ip)
 {
     mnemonic *opcode = &mnemonics[ip->code];
     size_t    size;
@@ -1434,15 +1553,7 @@ size_t instruction_size(instruction *ip, section *sec, taddr pc)
 
 
     /* Get the basic size of the opcode */
-    if ( opcode->ext.opcode & 0xff000000 ) {
-        size = 4;
-    } else if ( opcode->ext.opcode & 0x00ff0000 ) {
-        size = 3;
-    } else if ( opcode->ext.opcode & 0x0000ff00 ) {
-        size = 2;
-    } else {
-        size = 1;
-    }
+    size = opcode->ext.opsize;
 
     /* Increase the size for any modifiers */
     if ( (( ip->op[0] && ip->op[0]->type & (OP_INDEX ) )  ||
@@ -1498,6 +1609,81 @@ size_t instruction_size(instruction *ip, section *sec, taddr pc)
     return size;
 }
 
+/* Work out once where the bytes of an unrelaxed instruction come from:
+   the prefix byte, the number of opcode bytes, and which operands supply
+   the index offset and the immediate value. write_opcode() only follows
+   this layout. */
+static void encoding_layout(instruction *ip)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+    instruction_ext *ext = &ip->ext;
+    int size = ext->size - ext->altd - ext->ioi - ext->ioe;
+    int i, n;
+
+    ext->prefix = 0;
+    ext->exprop = -1;
+    ext->exprsize = 0;
+    ext->idxop = -1;
+
+    for ( i = 0; i < MAX_OPERANDS; i++ ) {
+        operand *op = ip->op[i];
+
+        if ( op == NULL ) {
+            continue;
+        }
+        if ( op->type & OP_OFFSET ) {
+            ext->idxop = i;
+        }
+        /* swapixiy only applies to the first operand */
+        if ( op->reg & REG_IX ) {
+            ext->prefix = i == 0 && swapixiy ? 0xfd : 0xdd;
+        } else if ( op->reg & REG_IY ) {
+            ext->prefix = i == 0 && swapixiy ? 0xdd : 0xfd;
+        }
+        switch ( BASIC_TYPE(op->type) ) {
+        case OP_ABS:   n = 1; break;
+        case OP_ABS16: n = 2; break;
+        case OP_ABS24: n = 3; break;
+        case OP_ABS32: n = 4; break;
+        default:       n = 0; break;
+        }
+        if ( n ) {
+            ext->exprop = i;
+            ext->exprsize = n;
+            size -= n;
+        }
+    }
+
+    if ( opcode->ext.mode == TYPE_EDPREF ) {
+        if ( ext->prefix == 0 ) {
+            ext->prefix = 0xed;
+        }
+    } else if ( opcode->ext.mode == TYPE_NOPREFIX || opcode->ext.mode == TYPE_IDX32 ) {
+        ext->prefix = 0;
+    }
+    if ( ext->prefix ) {
+        size--;
+    }
+    if ( ext->idxop >= 0 ) {
+        size--;
+    }
+    ext->opbytes = size;
+}
+
+size_t instruction_size(instruction *ip, section *sec, taddr pc)
+{
+    int form;
+
+    if ( (form = branch_relax(ip, sec, pc)) != BRX_NONE ) {
+        return brx_size[form];
+    }
+    if ( ip->ext.size == 0 ) {
+        ip->ext.size = static_instruction_size(ip);
+        encoding_layout(ip);
+    }
+    return ip->ext.size;
+}
+
 
 
 static taddr apply_modifier(rlist *rl, taddr val)
@@ -1519,111 +1705,30 @@ static taddr apply_modifier(rlist *rl, taddr val)
 
 
 
-static void write_opcode(mnemonic *opcode, dblock *db, int size, section *sec, taddr pc, operand *op1, operand *op2, int add, instruction_ext *ext)
+static void write_opcode(instruction *ip, dblock *db, section *sec, taddr pc, int add)
 {
-    int   reg1 = 0 , reg2 = 0;
-    operand *indexit = NULL;
-    int   indexcode = 0;
-    expr *expr = NULL;
-    int   exprsize;
+    mnemonic *opcode = &mnemonics[ip->code];
+    instruction_ext *ext = &ip->ext;
+    operand *indexit = ext->idxop >= 0 ? ip->op[ext->idxop] : NULL;
+    expr *expr = ext->exprop >= 0 ? ip->op[ext->exprop]->value : NULL;
+    int   exprsize = ext->exprsize;
     unsigned char *d = (unsigned char *)db->data;
     unsigned char *start = (unsigned char *)db->data;
 
     if  (ext->altd ) {
         *d++ = 0x76;
-        size--;
     }
     if ( ext->ioi ) {
         *d++ = 0xd3;
-        size--;
     }
     if ( ext->ioe ) {
         *d++ = 0xdb;
-        size--;
     }
-
-    if ( op1 ) {
-        reg1 = op1->reg;
-        if ( op1->type & OP_OFFSET ) {
-            indexit = op1;
-        }
-        if ( reg1 & REG_IX ) {
-            indexcode = swapixiy == 0 ? 0xdd : 0xfd;
-        } else if ( reg1 & REG_IY ) {
-            indexcode = swapixiy == 0 ? 0xfd : 0xdd;
-        }
-        if ( BASIC_TYPE(op1->type) == OP_ABS ) {
-            expr = op1->value;
-            exprsize = 1;
-            --size;
-        }
-        if ( BASIC_TYPE(op1->type) == OP_ABS16 ) {
-            expr = op1->value;
-            exprsize = 2;
-            size -= 2;
-        }
-        if ( BASIC_TYPE(op1->type) == OP_ABS24 ) {
-            expr = op1->value;
-            exprsize = 3;
-            size -= 3;
-        }
-        if ( BASIC_TYPE(op1->type) == OP_ABS32 ) {
-            expr = op1->value;
-            exprsize = 4;
-            size -= 4;
-        }
+    if ( ext->prefix ) {
+        *d++ = ext->prefix;
     }
-    if ( op2 ) {
-        reg2 = op2->reg;
 
-        if ( op2->type & OP_OFFSET ) {
-            indexit = op2;
-        }
-        if ( reg2 & REG_IX ) {
-            indexcode = 0xdd;
-        } else if ( reg2 & REG_IY ) {
-            indexcode = 0xfd;
-        }
-        if ( BASIC_TYPE(op2->type) == OP_ABS ) {
-            expr = op2->value;
-            exprsize = 1;
-            --size;
-        }
-        if ( BASIC_TYPE(op2->type) == OP_ABS16 ) {
-            expr = op2->value;
-            exprsize = 2;
-            size -= 2;
-        }
-        if ( BASIC_TYPE(op2->type) == OP_ABS24 ) {
-            expr = op2->value;
-            exprsize = 3;
-            size -= 3;
-        }
-        if ( BASIC_TYPE(op2->type) == OP_ABS32 ) {
-            expr = op2->value;
-            exprsize = 4;
-            size -= 4;
-        }
-    }
-
-    if ( opcode->ext.mode == TYPE_EDPREF ) {
-        if ( indexcode == 0 ) {
-            indexcode = 0xed;
-        }
-    } else if ( opcode->ext.mode == TYPE_NOPREFIX || opcode->ext.mode == TYPE_IDX32 ) {
-        indexcode = 0;
-    }
-
-    if ( indexcode ) {
-        *d++ = indexcode;
-        --size;
-    }
-
-    if ( indexit ) {
-        size--;
-    }
-
-    switch ( size ) {
+    switch ( ext->opbytes ) {
     case 4:
         *d++ = ( opcode->ext.opcode & 0xff000000 ) >> 24;
         /* Fall through */
@@ -1829,17 +1934,318 @@ dblock *eval_data(operand *op,size_t bitsize,section *sec,taddr pc)
     return db;
 }
 
+/* Operand packers: check the operands of an instruction and compute the
+   value which is added to its last opcode byte. There is one packer for
+   each opcode mode (TYPE_xxx). */
+#define PACK_OK     0
+#define PACK_ERROR  1
+#define PACK_DONE   2   /* the packer has already written the instruction */
+
+typedef int (*operand_packer)(instruction *, dblock *, section *, taddr, int *);
+
+static int pack_arith8(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    *offs = ip->op[0]->reg & REG_PLAIN;
+    if ( ip->op[1] && ip->op[0]->reg != OP_A ) {
+        *offs = ip->op[1]->reg & REG_PLAIN;
+    }
+    return PACK_OK;
+}
+
+static int pack_misc8(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+
+    if ( BASIC_TYPE(opcode->operand_type[0]) == OP_REG8 ) {
+        *offs = (ip->op[0]->reg & REG_PLAIN) * 8;
+    } else if ( BASIC_TYPE(opcode->operand_type[1]) == OP_REG8 ) {
+        *offs = (ip->op[1]->reg & REG_PLAIN) * 8; 
+    }
+    return PACK_OK;
+}
+
+static int pack_ld8(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+
+    /* ix/iy couples forbidden */
+    if ( (ip->op[0]->reg & (REG_IX |REG_IY)) &&
+         (ip->op[1]->reg & (REG_IX|REG_IY)) &&
+         (((ip->op[0]->reg & REG_IX) && (ip->op[1]->reg & REG_IY)) ||
+          ((ip->op[1]->reg & REG_IX) && (ip->op[0]->reg & REG_IY)) )){
+        cpu_error(23,opcode->name);
+    }
+    /* forbid ld ixl, (ix+0) */
+    if ( (ip->op[0]->reg & (REG_IX |REG_IY)) &&
+         (ip->op[1]->reg & (REG_IX|REG_IY)) &&
+         (ip->op[1]->type & OP_OFFSET)
+       ){
+        cpu_error(23,opcode->name);
+    }
+    /* forbid ld ixl,(hl) or similar expressions */
+    if ( (ip->op[0]->reg & (REG_IX|REG_IY)) &&
+         (ip->op[1]->reg & REG_PLAIN) == REG_HLREF) {
+        cpu_error(24,opcode->name);
+    }
+    /* forbid ld ixh/l,h/l and ld iyh/l,h/l */
+    if ( ( (ip->op[0]->reg & (REG_IX|REG_IY)) &&
+           !(ip->op[0]->reg & REG_INDEX) ) &&
+         ( !(ip->op[1]->reg & (REG_IX|REG_IY)) &&
+           ( ((ip->op[1]->reg & REG_PLAIN) == REG_H) ||
+             ((ip->op[1]->reg & REG_PLAIN) == REG_L) ) )
+       ) {
+        cpu_error(24,opcode->name);
+    }
+    /* forbid ld h/l,ixh/l and ld h/l,iyh/l */
+    if ( ( (ip->op[1]->reg & (REG_IX|REG_IY)) &&
+           !(ip->op[1]->reg & REG_INDEX) ) &&
+         ( !(ip->op[0]->reg & (REG_IX|REG_IY)) &&
+           ( ((ip->op[0]->reg & REG_PLAIN) == REG_H) ||
+             ((ip->op[0]->reg & REG_PLAIN) == REG_L) ) )
+       ) {
+        cpu_error(24,opcode->name);
+    }               
+    *offs =  ((ip->op[0]->reg & REG_PLAIN) * 8) + ( ip->op[1]->reg & REG_PLAIN);
+    return PACK_OK;
+}
+
+static int pack_arith16(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+
+    /* Forbid instructions of type ld (hl), (memory) */
+    if ( opcode->operand_type[1] && (opcode->operand_type[1] & (OP_ADDR)) &&
+         opcode->operand_type[0] && (OP_INDIR) &&
+         (ip->op[0]->reg & REG_PLAIN) == REG_HL) {
+        cpu_error(25);
+    }
+    /* Forbid instructions of type ld (memory), (hl) */
+    if (BASIC_TYPE(ip->op[0]->type) == OP_ABS16 && 
+         BASIC_TYPE(ip->op[1]->type) == OP_HL) {
+        cpu_error(25);
+    }
+    if ( opcode->operand_type[1] && (opcode->operand_type[1] & ( OP_ARITH16)) ) {
+        *offs = (ip->op[1]->reg & REG_PLAIN) * 16;
+        if ( (ip->op[0]->reg & REG_PLAIN) == REG_HL && (ip->op[1]->reg & REG_PLAIN) == REG_HL &&
+            (ip->op[0]->reg & (REG_IX|REG_IY)) != (ip->op[1]->reg & (REG_IX|REG_IY)) ) {
+            cpu_error(21,opcode->name);
+        }
+    } else {
+        if ( (ip->op[0]->reg & REG_PLAIN) == REG_AF ) {
+            *offs = 3 * 16;
+        } else {
+            *offs = (ip->op[0]->reg & REG_PLAIN) * 16;
+        }
+    }
+    /* reg = ip->op[0]->reg & (REG_IX | REG_IY); not needed? */
+    return PACK_OK;
+}
+
+static int pack_idx32(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+
+    if ( BASIC_TYPE(opcode->operand_type[1]) == OP_IDX32 ) {
+        *offs = 16 * ( ip->op[1]->reg - REG_PW );
+    } else {
+        *offs = 16 * ( ip->op[0]->reg - REG_PW );
+    }
+    return PACK_OK;
+}
+
+static int pack_idx32r(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+
+    if ( BASIC_TYPE(opcode->operand_type[1]) == OP_IDX32 ) {
+        *offs = 16 * ( ip->op[1]->reg - REG_PW );
+    }
+    if ( BASIC_TYPE(opcode->operand_type[0]) == OP_IDX32 ) {
+        *offs += 64 * ( ip->op[0]->reg - REG_PW );
+    }
+    return PACK_OK;
+}
+
+static int pack_flags(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+
+    if ( opcode->operand_type[0] == OP_FLAGS || opcode->operand_type[0] == OP_FLAGS_RCM ) {
+       
+        *offs = ip->op[0]->flags * 8;
+
+        if ( ( cpu_type & CPU_GB80 ) && ip->op[0]->flags >= FLAGS_PO ) {
+            /* GB80 doesn't support flags po, p, m, pe */
+            cpu_error(8, opcode->name);
+            return PACK_ERROR;
+        } else if (  opcode->ext.opcode == 0xc4 && (cpu_type & CPU_RABBIT ) ) {
+            /* If this is a call then we need to do special stuff for the rabbit */
+            if ( rcmemu ) {
+                rabbit_emu_call(ip,db,sec,pc);
+                return PACK_DONE;
+            } else {
+                cpu_error(13, cpuname, opcode->name);
+                return PACK_ERROR;
+            }
+        } else if ( opcode->ext.class == MCLASS_JRCC || opcode->ext.class == MCLASS_JRE ) {
+            if ( ip->op[0]->flags >= FLAGS_PO ) {
+                cpu_error(8, opcode->name);
+                return PACK_ERROR;
+            }
+        }
+    }
+    return PACK_OK;
+}
+
+static int pack_none(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    return PACK_OK;
+}
+
+static int pack_ipset(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+    taddr val = 0;
+
+    if ( eval_expr(ip->op[0]->value, &val, sec, pc) == 0 ) {
+        cpu_error(19, opcode->name);
+        return PACK_ERROR;
+    } else  if ( val >= 0 && val <= 3) {  /* ipset has to be between 0 and 3 */
+        if ( val <= 1 ) {
+            *offs = val * 16;
+        } else {
+            *offs = (val - 2) * 16 + 8;
+        }
+    } else {
+        cpu_error(6,opcode->name,val);  /* ipset out of range */
+        return PACK_ERROR;
+    }
+    return PACK_OK;
+}
+
+static int pack_bit(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+    taddr val = 0;
+
+    if ( eval_expr(ip->op[0]->value, &val, sec, pc) == 0 ) {
+        cpu_error(19, opcode->name);
+        return PACK_ERROR;
+    } else  if ( val >= 0 && val <= 7) {  /* Bit has to be between 0 and 7 */
+        *offs = val * 8 +  (ip->op[1]->reg & REG_PLAIN);
+    } else {
+        cpu_error(4,val);  /* Bit count out of range */
+        return PACK_ERROR;
+    }
+    return PACK_OK;
+}
+
+static int pack_im(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+    taddr val = 0;
+
+    if ( eval_expr(ip->op[0]->value, &val, sec, pc) == 0 ) {
+        cpu_error(19, opcode->name);
+        return PACK_ERROR;
+    } else  if ( val >=0 && val <= 2) {
+        *offs = val * 16;
+        if ( val == 2 ) { /* More opcode placement oddness */
+            *offs = 24;
+        }
+    } else {
+        cpu_error(6,opcode->name,val);  /* im out of range */
+        return PACK_ERROR;
+    }
+    return PACK_OK;
+}
+
+static int pack_out_c_0(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+    taddr val = 0;
+
+    if ( eval_expr(ip->op[1]->value, &val, sec, pc) == 0 ) {
+        cpu_error(19, opcode->name);
+        return PACK_ERROR;
+    } else if (val != 0){
+        cpu_error(22,opcode->name);
+        return PACK_ERROR;
+    }
+    return PACK_OK;
+}
+
+static int pack_rst(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    mnemonic *opcode = &mnemonics[ip->code];
+    taddr val = 0;
+
+    if ( eval_expr(ip->op[0]->value, &val, sec, pc) == 0 ) {
+        cpu_error(19, opcode->name);
+        return PACK_ERROR;
+    } else if ( (val & ~0x38) == 0 && cpu_type != CPU_80OS) {
+        if ( cpu_type == CPU_RCM2000 ) {
+            /* Check for valid rst on Rabbit */
+            if ( val == 0 ||  val == 8 || val == 0x30 ) {
+                cpu_error(9, val); /* Invalid restart */
+                return PACK_ERROR;
+            }
+        }
+        *offs = val;
+    } else if ( (val & 0xf8) == 0 && cpu_type == CPU_80OS) {
+        *offs = val << 3;
+    } else {
+        cpu_error(5, val, val);  /* rst out of range */
+        return PACK_ERROR;
+    }
+    return PACK_OK;
+}
+
+static int pack_rp(instruction *ip, dblock *db, section *sec, taddr pc, int *offs)
+{
+    if (ip->op[0]->reg == REG_SP)
+        ip->op[0]->reg = REG_A;
+    *offs = ((ip->op[0]->reg & REG_PLAIN) / 2) * 16;
+    return PACK_OK;
+}
+
+static const operand_packer packers[] = {
+    pack_none,      /* TYPE_NONE */
+    pack_arith8,    /* TYPE_ARITH8 */
+    pack_misc8,     /* TYPE_MISC8 */
+    pack_ld8,       /* TYPE_LD8 */
+    pack_arith16,   /* TYPE_ARITH16 */
+    pack_flags,     /* TYPE_FLAGS */
+    pack_flags,     /* TYPE_RELJUMP */
+    pack_bit,       /* TYPE_BIT */
+    pack_rst,       /* TYPE_RST */
+    pack_im,        /* TYPE_IM */
+    pack_none,      /* TYPE_EDPREF */
+    pack_ipset,     /* TYPE_IPSET */
+    pack_idx32,     /* TYPE_IDX32 */
+    pack_none,      /* TYPE_NOPREFIX */
+    pack_idx32r,    /* TYPE_IDX32R */
+    pack_out_c_0,   /* TYPE_OUT_C_0 */
+    pack_rp         /* TYPE_RP */
+};
+
+
+
 dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
 {
     dblock *db;
     mnemonic *opcode = &mnemonics[ip->code];
     symbol *base;
     unsigned char *d;
-    taddr val = 0;
     int size = 0, offs = 0; 
     int error = 0;
+    int form;
 
 
+    if ( (form = branch_relax(ip, sec, pc)) != BRX_NONE ) {
+        return eval_relaxed_branch(ip, form, sec, pc);
+    }
+
     size = instruction_size(ip, sec, pc);
 
     if ( (opcode->ext.cpus & cpu_type) == 0 ) {
@@ -2010,213 +2416,16 @@ dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
     db->data = mymalloc(db->size); /* Ed prefix ones are larger in anycase */
     d = (unsigned char *)db->data;
 
-    offs = 0;
-    switch ( opcode->ext.mode ) {
-    case TYPE_ARITH8:
-        offs = ip->op[0]->reg & REG_PLAIN;
-        if ( ip->op[1] && ip->op[0]->reg != OP_A ) {
-            offs = ip->op[1]->reg & REG_PLAIN;
-        }
-        break;
-    case TYPE_MISC8:
-        if ( BASIC_TYPE(opcode->operand_type[0]) == OP_REG8 ) {
-            offs = (ip->op[0]->reg & REG_PLAIN) * 8;
-        } else if ( BASIC_TYPE(opcode->operand_type[1]) == OP_REG8 ) {
-            offs = (ip->op[1]->reg & REG_PLAIN) * 8; 
-        }
-        break;
-    case TYPE_LD8:
-        /* ix/iy couples forbidden */
-        if ( (ip->op[0]->reg & (REG_IX |REG_IY)) &&
-             (ip->op[1]->reg & (REG_IX|REG_IY)) &&
-             (((ip->op[0]->reg & REG_IX) && (ip->op[1]->reg & REG_IY)) ||
-              ((ip->op[1]->reg & REG_IX) && (ip->op[0]->reg & REG_IY)) )){
-            cpu_error(23,opcode->name);
-        }
-        /* forbid ld ixl, (ix+0) */
-        if ( (ip->op[0]->reg & (REG_IX |REG_IY)) &&
-             (ip->op[1]->reg & (REG_IX|REG_IY)) &&
-             (ip->op[1]->type & OP_OFFSET)
-           ){
-            cpu_error(23,opcode->name);
-        }
-        /* forbid ld ixl,(hl) or similar expressions */
-        if ( (ip->op[0]->reg & (REG_IX|REG_IY)) &&
-             (ip->op[1]->reg & REG_PLAIN) == REG_HLREF) {
-            cpu_error(24,opcode->name);
-        }
-        /* forbid ld ixh/l,h/l and ld iyh/l,h/l */
-        if ( ( (ip->op[0]->reg & (REG_IX|REG_IY)) &&
-               !(ip->op[0]->reg & REG_INDEX) ) &&
-             ( !(ip->op[1]->reg & (REG_IX|REG_IY)) &&
-               ( ((ip->op[1]->reg & REG_PLAIN) == REG_H) ||
-                 ((ip->op[1]->reg & REG_PLAIN) == REG_L) ) )
-           ) {
-            cpu_error(24,opcode->name);
-        }
-        /* forbid ld h/l,ixh/l and ld h/l,iyh/l */
-        if ( ( (ip->op[1]->reg & (REG_IX|REG_IY)) &&
-               !(ip->op[1]->reg & REG_INDEX) ) &&
-             ( !(ip->op[0]->reg & (REG_IX|REG_IY)) &&
-               ( ((ip->op[0]->reg & REG_PLAIN) == REG_H) ||
-                 ((ip->op[0]->reg & REG_PLAIN) == REG_L) ) )
-           ) {
-            cpu_error(24,opcode->name);
-        }               
-        offs =  ((ip->op[0]->reg & REG_PLAIN) * 8) + ( ip->op[1]->reg & REG_PLAIN);
-        break;
-    case TYPE_ARITH16:
-        /* Forbid instructions of type ld (hl), (memory) */
-        if ( opcode->operand_type[1] && (opcode->operand_type[1] & (OP_ADDR)) &&
-             opcode->operand_type[0] && (OP_INDIR) &&
-             (ip->op[0]->reg & REG_PLAIN) == REG_HL) {
-            cpu_error(25);
-        }
-        /* Forbid instructions of type ld (memory), (hl) */
-        if (BASIC_TYPE(ip->op[0]->type) == OP_ABS16 && 
-             BASIC_TYPE(ip->op[1]->type) == OP_HL) {
-            cpu_error(25);
-        }
-        if ( opcode->operand_type[1] && (opcode->operand_type[1] & ( OP_ARITH16)) ) {
-            offs = (ip->op[1]->reg & REG_PLAIN) * 16;
-            if ( (ip->op[0]->reg & REG_PLAIN) == REG_HL && (ip->op[1]->reg & REG_PLAIN) == REG_HL &&
-                (ip->op[0]->reg & (REG_IX|REG_IY)) != (ip->op[1]->reg & (REG_IX|REG_IY)) ) {
-                cpu_error(21,opcode->name);
-            }
-        } else {
-            if ( (ip->op[0]->reg & REG_PLAIN) == REG_AF ) {
-                offs = 3 * 16;
-            } else {
-                offs = (ip->op[0]->reg & REG_PLAIN) * 16;
-            }
-        }
-        /* reg = ip->op[0]->reg & (REG_IX | REG_IY); not needed? */
-        break;
-    case TYPE_IDX32:
-        offs = 0;
-        if ( BASIC_TYPE(opcode->operand_type[1]) == OP_IDX32 ) {
-            offs = 16 * ( ip->op[1]->reg - REG_PW );
-        } else {
-            offs = 16 * ( ip->op[0]->reg - REG_PW );
-        }
-        break;
-    case TYPE_IDX32R:
-        if ( BASIC_TYPE(opcode->operand_type[1]) == OP_IDX32 ) {
-            offs = 16 * ( ip->op[1]->reg - REG_PW );
-        }
-        if ( BASIC_TYPE(opcode->operand_type[0]) == OP_IDX32 ) {
-            offs += 64 * ( ip->op[0]->reg - REG_PW );
-        }
-        break;
-    case TYPE_FLAGS:
-    case TYPE_RELJUMP:
-        if ( opcode->operand_type[0] == OP_FLAGS || opcode->operand_type[0] == OP_FLAGS_RCM ) {
-           
-            offs = ip->op[0]->flags * 8;
-
-            if ( ( cpu_type & CPU_GB80 ) && ip->op[0]->flags >= FLAGS_PO ) {
-                /* GB80 doesn't support flags po, p, m, pe */
-                cpu_error(8, opcode->name);
-                error = 1;
-            } else if (  opcode->ext.opcode == 0xc4 && (cpu_type & CPU_RABBIT ) ) {
-                /* If this is a call then we need to do special stuff for the rabbit */
-                if ( rcmemu ) {
-                    rabbit_emu_call(ip,db,sec,pc);
-                    return db;
-                } else {
-                    cpu_error(13, cpuname, opcode->name);
-                    error = 1;
-                }
-            } else if ( strcmp(opcode->name,"jr") == 0 || strcmp(opcode->name,"jre") == 0 ) {
-                if ( ip->op[0]->flags >= FLAGS_PO ) {
-                    cpu_error(8, opcode->name);
-                    error = 1;
-                }
-            }
-        }
-        break;
-    case TYPE_NONE:
-    case TYPE_EDPREF:
-    case TYPE_NOPREFIX:
-        break;
-    case TYPE_IPSET:
-        if ( eval_expr(ip->op[0]->value, &val, sec, pc) == 0 ) {
-            cpu_error(19, opcode->name);
-            error = 1;
-        } else  if ( val >= 0 && val <= 3) {  /* ipset has to be between 0 and 3 */
-            if ( val <= 1 ) {
-                offs = val * 16;
-            } else {
-                offs = (val - 2) * 16 + 8;
-            }
-        } else {
-            cpu_error(6,opcode->name,val);  /* ipset out of range */
-            error = 1 ;
-        }
-        break;
-    case TYPE_BIT:
-        if ( eval_expr(ip->op[0]->value, &val, sec, pc) == 0 ) {
-            cpu_error(19, opcode->name);
-            error = 1;
-        } else  if ( val >= 0 && val <= 7) {  /* Bit has to be between 0 and 7 */
-            offs = val * 8 +  (ip->op[1]->reg & REG_PLAIN);
-        } else {
-            cpu_error(4,val);  /* Bit count out of range */
-            error = 1;
-        }
-        break;
-    case TYPE_IM:
-        if ( eval_expr(ip->op[0]->value, &val, sec, pc) == 0 ) {
-            cpu_error(19, opcode->name);
-            error = 1;
-        } else  if ( val >=0 && val <= 2) {
-            offs = val * 16;
-            if ( val == 2 ) { /* More opcode placement oddness */
-                offs = 24;
-            }
-        } else {
-            cpu_error(6,opcode->name,val);  /* im out of range */
-            error = 1;
-        }
-        break;
-    case TYPE_OUT_C_0:
-        if ( eval_expr(ip->op[1]->value, &val, sec, pc) == 0 ) {
-            cpu_error(19, opcode->name);
-            error = 1;
-        } else if (val != 0){
-            cpu_error(22,opcode->name);
-            error = 1;
-        }
-        break;
-    case TYPE_RST:
-        if ( eval_expr(ip->op[0]->value, &val, sec, pc) == 0 ) {
-            cpu_error(19, opcode->name);
-            error = 1;
-        } else if ( (val & ~0x38) == 0 && cpu_type != CPU_80OS) {
-            if ( cpu_type == CPU_RCM2000 ) {
-                /* Check for valid rst on Rabbit */
-                if ( val == 0 ||  val == 8 || val == 0x30 ) {
-                    cpu_error(9, val); /* Invalid restart */
-                    error = 1;
-                }
-            }
-            offs = val;
-        } else if ( (val & 0xf8) == 0 && cpu_type == CPU_80OS) {
-            offs = val << 3;
-        } else {
-            cpu_error(5, val, val);  /* rst out of range */
-            error = 1;
-        }
-        break;
-    case TYPE_RP:
-        if (ip->op[0]->reg == REG_SP)
-            ip->op[0]->reg = REG_A;
-        offs = ((ip->op[0]->reg & REG_PLAIN) / 2) * 16;
+    switch ( packers[opcode->ext.mode](ip, db, sec, pc, &offs) ) {
+    case PACK_DONE:
+        return db;
+    case PACK_ERROR:
+        error = 1;
         break;
     }
 
     if ( error == 0 ) {
-        write_opcode(opcode, db, size, sec, pc, ip->op[0], ip->op[1], offs, &ip->ext);
+        write_opcode(ip, db, sec, pc, offs);
     }
 
 
@@ -2235,6 +2444,42 @@ operand *new_operand(void)
 
 int init_cpu(void)
 {
+  int i;
+
+  /* pre-classify the mnemonics, so the encoder needs no name compares */
+  for ( i = 0; i < mnemonic_cnt; i++ ) {
+    mnemonic_extension *ext = &mnemonics[i].ext;
+    int op0 = mnemonics[i].operand_type[0];
+
+    if ( ext->mode < 0 || ext->mode >= sizeof(packers)/sizeof(packers[0]) )
+      ierror(0);  /* no operand packer for this opcode mode */
+    if ( ext->opcode & 0xff000000 )
+      ext->opsize = 4;
+    else if ( ext->opcode & 0x00ff0000 )
+      ext->opsize = 3;
+    else if ( ext->opcode & 0x0000ff00 )
+      ext->opsize = 2;
+    else
+      ext->opsize = 1;
+
+    ext->class = MCLASS_NONE;
+    if ( !strcmp(mnemonics[i].name, "jp") ) {
+      if ( op0 == OP_ABS16 && ext->opcode == 0xc3 )
+        ext->class = MCLASS_JP;
+      else if ( op0 == OP_FLAGS )
+        ext->class = MCLASS_JPCC;
+    } else if ( !strcmp(mnemonics[i].name, "jr") ) {
+      if ( op0 == OP_ABS )
+        ext->class = MCLASS_JR;
+      else if ( op0 == OP_FLAGS )
+        ext->class = MCLASS_JRCC;
+    } else if ( !strcmp(mnemonics[i].name, "jre") ) {
+      ext->class = MCLASS_JRE;
+    } else if ( !strcmp(mnemonics[i].name, "djnz") ) {
+      ext->class = MCLASS_DJNZ;
+    }
+  }
+
   current_pc_char = '$';
   return 1;
 }
@@ -2281,6 +2526,9 @@ int cpu_args(char *p)
     } else if ( strcmp(p, "-z80asm" ) == 0 ) {
         z80asm_compat = 1;
         return 1;
+    } else if ( strcmp(p, "-opt-branch" ) == 0 ) {
+        branchopt = 1;
+        return 1;
     }
     return 0;
 }
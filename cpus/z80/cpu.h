@@ -47,6 +47,13 @@ typedef struct {
     int  altd;
     int  ioi;
     int  ioe;
+    int  size;   /* cached size of the unrelaxed instruction, 0 = unknown */
+    /* encoding layout, valid when size is known */
+    unsigned char prefix;    /* index or 0xed prefix byte, 0 = none */
+    signed char   opbytes;   /* number of opcode bytes */
+    signed char   idxop;     /* operand with the index offset, -1 = none */
+    signed char   exprop;    /* operand with the immediate value, -1 = none */
+    unsigned char exprsize;  /* size of the immediate value in bytes */
 } instruction_ext;
 
 /* minimum instruction alignment */
@@ -120,8 +127,19 @@ typedef struct {
     int           rabbit3000_action; /* Action to take on a rabbit */
     int           rabbit4000_action; /* Action to take on a rabbit */
     int           gb80_action;    /* Action to take for a GBz80 */
+    unsigned char opsize;      /* Number of opcode bytes, set by init_cpu() */
+    unsigned char class;       /* MCLASS_xxx, set by init_cpu() */
 } mnemonic_extension;
 
+/* Mnemonic classes, so encoding doesn't have to compare names */
+#define MCLASS_NONE   0
+#define MCLASS_JP     1    /* jp label */
+#define MCLASS_JPCC   2    /* jp cc,label */
+#define MCLASS_JR     3    /* jr label */
+#define MCLASS_JRCC   4    /* jr cc,label */
+#define MCLASS_JRE    5    /* jre [cc,]label (RCM4000) */
+#define MCLASS_DJNZ   6    /* djnz label */
+
 /* These values are significant - opcodes derived using them */
 #define FLAGS_NZ 0
 #define FLAGS_Z  1
@@ -298,6 +298,8 @@ void dwarf_init(struct dwarf_info *dinfo,
   /* start of statement program */
   setval(BIGENDIAN,lengthptr,4,dsec->pc-10);
   dinfo->end_sequence = 1;  /* we have to start a new sequence */
+  dinfo->lprog = NULL;
+  dinfo->lprog_len = dinfo->lprog_size = 0;
 }
 
 
@@ -316,20 +318,72 @@ void dwarf_finish(struct dwarf_info *dinfo)
 
   /* set .debug_line compilation unit size */
   setval(BIGENDIAN,dinfo->line_length,4,dinfo->lsec->pc-4);
+  myfree(dinfo->lprog);
 }
 
 
-static void dwarf_set_address(struct dwarf_info *dinfo,symbol *sym)
+/* The line program of a sequence is collected in a buffer and emitted
+   as a single DATA atom by dwarf_end_sequence(). */
+
+static uint8_t *lprog_reserve(struct dwarf_info *dinfo,size_t n)
+{
+  if (dinfo->lprog_len+n > dinfo->lprog_size) {
+    dinfo->lprog_size = dinfo->lprog_size ? dinfo->lprog_size<<1 : 0x400;
+    if (dinfo->lprog_len+n > dinfo->lprog_size)
+      dinfo->lprog_size = dinfo->lprog_len + n;
+    dinfo->lprog = myrealloc(dinfo->lprog,dinfo->lprog_size);
+  }
+  dinfo->lprog_len += n;
+  return dinfo->lprog + dinfo->lprog_len - n;
+}
+
+
+static void lprog_byte(struct dwarf_info *dinfo,int b)
+{
+  *lprog_reserve(dinfo,1) = (uint8_t)b;
+}
+
+
+static void lprog_leb128(struct dwarf_info *dinfo,utaddr c)
+{
+  int b;
+
+  do {
+    b = c & 0x7f;
+    if ((c >>= 7) != 0)
+      b |= 0x80;
+    lprog_byte(dinfo,b);
+  } while (c != 0);
+}
+
+
+static void lprog_sleb128(struct dwarf_info *dinfo,taddr c)
 {
-  static unsigned char opcode[3] = { 0,0,DW_LNE_set_address };
-  atom *a;
-
-  /* extended opcode to set address for current cpu including relocation */
-  opcode[1] = dinfo->addr_len + 1;
-  add_char_atom(dinfo->lsec,opcode,3);
-  a = add_data_atom(dinfo->lsec,dinfo->addr_len,1,sym->pc);
-  add_extnreloc(&a->content.db->relocs,sym,sym->pc,REL_ABS,
-                0,dinfo->addr_len*BITSPERBYTE,0);
+  int done = 0;
+  int b;
+
+  do {
+    b = c & 0x7f;
+    c >>= 7;  /* assumes arithmetic shifts! */
+    if ((c==0 && !(b&0x40)) || (c==-1 && (b&0x40)))
+      done = 1;
+    else
+      b |= 0x80;
+    lprog_byte(dinfo,b);
+  } while (!done);
+}
+
+
+static size_t dwarf_set_address(struct dwarf_info *dinfo,symbol *sym)
+/* extended opcode to set the address, returns offset of the address,
+   which needs a relocation */
+{
+  lprog_byte(dinfo,0);
+  lprog_byte(dinfo,dinfo->addr_len+1);
+  lprog_byte(dinfo,DW_LNE_set_address);
+  setval(BIGENDIAN,lprog_reserve(dinfo,dinfo->addr_len),dinfo->addr_len,
+         sym->pc);
+  return dinfo->lprog_len - dinfo->addr_len;
 }
 
 
@@ -351,14 +405,25 @@ static void set_atom_val(atom *a,size_t len,taddr val)
 void dwarf_end_sequence(struct dwarf_info *dinfo,section *sec)
 {
   if (!dinfo->end_sequence) {
-    static unsigned char opcode[3] = { 0,1,DW_LNE_end_sequence };
     symbol *sym = new_tmplabel(sec);  /* label at end of section */
+    size_t endoffs;
     atom *a;
 
-    dwarf_set_address(dinfo,sym);
-    add_char_atom(dinfo->lsec,opcode,3);
+    endoffs = dwarf_set_address(dinfo,sym);
+    lprog_byte(dinfo,0);
+    lprog_byte(dinfo,1);
+    lprog_byte(dinfo,DW_LNE_end_sequence);
     dinfo->end_sequence = 1;
 
+    /* write the sequence's line program with relocated start/end address */
+    a = add_char_atom(dinfo->lsec,dinfo->lprog,dinfo->lprog_len);
+    add_extnreloc(&a->content.db->relocs,sym,sym->pc,REL_ABS,
+                  0,dinfo->addr_len*BITSPERBYTE,endoffs);
+    add_extnreloc(&a->content.db->relocs,dinfo->seq_start,
+                  dinfo->seq_start->pc,REL_ABS,
+                  0,dinfo->addr_len*BITSPERBYTE,dinfo->seq_startoffs);
+    dinfo->lprog_len = 0;
+
     /* enter section size for this sequence into the address-range table */
     add_data_atom(dinfo->asec,dinfo->addr_len,dinfo->addr_len,sec->pc);
 
@@ -429,40 +494,42 @@ void dwarf_line(struct dwarf_info *dinfo,section *sec,int file,int line)
 
     /* set relocatable address of first instruction, then advance line, etc.*/
     dinfo->address = sec->pc;
-    dwarf_set_address(dinfo,new_tmplabel(sec));
+    dinfo->lprog_len = 0;
+    dinfo->seq_start = new_tmplabel(sec);
+    dinfo->seq_startoffs = dwarf_set_address(dinfo,dinfo->seq_start);
 
     if (file != dinfo->file) {
-      add_data_atom(dinfo->lsec,1,1,DW_LNS_set_file);
-      add_leb128_atom(dinfo->lsec,file);
+      lprog_byte(dinfo,DW_LNS_set_file);
+      lprog_leb128(dinfo,file);
       dinfo->file = file;
     }
     if (line != dinfo->line) {
-      add_data_atom(dinfo->lsec,1,1,DW_LNS_advance_line);
-      add_sleb128_atom(dinfo->lsec,line-dinfo->line);
+      lprog_byte(dinfo,DW_LNS_advance_line);
+      lprog_sleb128(dinfo,line-dinfo->line);
       dinfo->line = line;
     }
-    add_data_atom(dinfo->lsec,1,1,DW_LNS_copy);
+    lprog_byte(dinfo,DW_LNS_copy);
   }
-  else {
+  else if (file!=dinfo->file || line!=dinfo->line) {
     int lineoffs = line - dinfo->line;
     int instoffs = (sec->pc - dinfo->address) / dinfo->min_inst_len;
 
     if (file != dinfo->file) {
-      add_data_atom(dinfo->lsec,1,1,DW_LNS_set_file);
-      add_leb128_atom(dinfo->lsec,file);
+      lprog_byte(dinfo,DW_LNS_set_file);
+      lprog_leb128(dinfo,file);
       dinfo->file = file;
     }
 
     if (instoffs > dinfo->max_pcadvance) {
       if (instoffs - dinfo->max_pcadvance <= dinfo->max_pcadvance) {
         /* const_add_pc for up to twice the maximum special opcode advance */
-        add_data_atom(dinfo->lsec,1,1,DW_LNS_const_add_pc);
+        lprog_byte(dinfo,DW_LNS_const_add_pc);
         instoffs -= dinfo->max_pcadvance;
       }
       else {
         /* advance address by standard opcode */
-        add_data_atom(dinfo->lsec,1,1,DW_LNS_advance_pc);
-        add_leb128_atom(dinfo->lsec,instoffs);
+        lprog_byte(dinfo,DW_LNS_advance_pc);
+        lprog_leb128(dinfo,instoffs);
         instoffs = 0;
       }
     }
@@ -472,16 +539,15 @@ void dwarf_line(struct dwarf_info *dinfo,section *sec,int file,int line)
         (instoffs == dinfo->max_pcadvance &&
          lineoffs > dinfo->line_base + dinfo->max_lnadvance_hipc)) {
       /* we have to advance line by standard opcode */
-      add_data_atom(dinfo->lsec,1,1,DW_LNS_advance_line);
-      add_sleb128_atom(dinfo->lsec,lineoffs);
+      lprog_byte(dinfo,DW_LNS_advance_line);
+      lprog_sleb128(dinfo,lineoffs);
       lineoffs = 0;
     }
 
     /* construct special opcode for simultaneous inst./pc-advancement */
-    add_data_atom(dinfo->lsec,1,1,
-                  dinfo->opcode_base +
-                  instoffs*dinfo->line_range +
-                  (lineoffs-dinfo->line_base));
+    lprog_byte(dinfo,dinfo->opcode_base +
+                     instoffs*dinfo->line_range +
+                     (lineoffs-dinfo->line_base));
     /* update line/address */
     dinfo->address = sec->pc;
     dinfo->line = line;
@@ -22,6 +22,11 @@ struct dwarf_info {
   int max_lnadvance_hipc;
   taddr address;
   int file,line,column,is_stmt,basic_block,end_sequence;
+  /* line program of the current sequence, written as a single atom */
+  uint8_t *lprog;
+  size_t lprog_len,lprog_size;
+  symbol *seq_start;
+  size_t seq_startoffs;
 };
 
 /* debug information tags and attributes */
@@ -34,38 +34,12 @@ int no_warn;
 
 static void print_source_line(FILE *f,source *src,int l)
 {
-  static char *buf = NULL;
-  static size_t bufsz = 0;
-  char c,*e,*p,*q;
-
-  /* allocate a sufficiently dimensioned line buffer */
-  if (src->bufsize > bufsz) {
-    bufsz = src->bufsize;
-    buf = myrealloc(buf,bufsz);
-  }
+  size_t len;
+  char *p;
 
-  p = src->text;
-  q = buf;
-  e = buf + bufsz - 1;
-
-  do {
-    c = *p++;
-    if (c=='\n' || c=='\r') {
-      if (*p == ((c=='\n') ? '\r' : '\n'))
-        p++;
-      if (--l == 0) {
-        /* terminate error line in buffer and print it */
-        *q = '\0';
-        fprintf(f,"%s\n",buf);
-        return;
-      }
-      q = buf;  /* next line, start to fill buffer from the beginning */
-    }
-    else if (q < e)
-      *q++ = c;
-  }
-  while (*p);
-  ierror(0);  /* line doesn't exist */
+  if ((p = source_line(src,l,&len)) == NULL)
+    ierror(0);  /* line doesn't exist */
+  fprintf(f,"%.*s\n",(int)len,p);
 }
 
 
@@ -93,4 +93,5 @@
   "maximum number of loop iterations (%d) reached",ERROR,
   "missing loop condition",ERROR,
   "symbol <%s> cannot be redefined as a function",ERROR,
+  "unknown compression codec <%s>",ERROR,                      /* 95 */
 
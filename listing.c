@@ -16,6 +16,14 @@ int listformfeed=1,listlinesperpage=40;
 listing *first_listing,*last_listing,*cur_listing;
 
 static listing *prev_listing;
+
+/* Modified lines (e.g. from macro expansions) are spooled to a temporary
+   file, so the listing doesn't keep their text in memory. */
+static FILE *listspool;
+static int spoolfailed,spoolrdmode;
+static size_t spoolwr,spoolrd;
+static char *spoolbuf;
+static size_t spoolbufsz;
 static int listbpl,listnoinc,listformat,listtitlecnt,listall,listlabelsonly;
 static char **listtitles;
 static int *listtitlelines;
@@ -72,9 +80,36 @@ int listing_option(char *arg)
   return 0;
 }
 
-listing *new_listing(source *src,int line)
+static void spool_text(listing *l)
+/* Move the text of a listing line to the spool file. The last line
+   stays in memory until the next one is created, because it may still
+   be deleted. */
+{
+  size_t len;
+
+  if (l==NULL || l->txt==NULL || spoolfailed)
+    return;
+  if (listspool==NULL && (listspool = tmpfile())==NULL) {
+    spoolfailed = 1;  /* keep the text in memory */
+    return;
+  }
+  len = strlen(l->txt);
+  if (fwrite(l->txt,1,len,listspool) != len) {
+    spoolfailed = 1;
+    return;
+  }
+  l->txtoffs = spoolwr;
+  l->txtlen = (int)len;
+  spoolwr += len;
+  myfree(l->txt);
+  l->txt = NULL;
+}
+
+listing *new_listing(source *src,int line,const char *txt,size_t len)
 {
   listing *new = mymalloc(sizeof(*new));
+  const char *p;
+  size_t n;
 
   new->next = NULL;
   new->line = line;
@@ -83,8 +118,22 @@ listing *new_listing(source *src,int line)
   new->sec = 0;
   new->pc = 0;
   new->src = src;
+  new->txtoffs = 0;
+  new->txtlen = -1;
+
+  /* Lines from a source file are referenced by their line number and
+     only copied when they were modified (e.g. by expansions). */
+  if (src!=NULL && src->srcfile!=NULL && src->text==src->srcfile->text &&
+      (p = source_line(src,line,&n))!=NULL && n==len && !memcmp(p,txt,n))
+    new->txt = NULL;
+  else {
+    new->txt = mymalloc(len+1);
+    memcpy(new->txt,txt,len);
+    new->txt[len] = '\0';
+  }
 
   if (first_listing) {
+    spool_text(last_listing);
     last_listing->next = new;
     prev_listing = last_listing;
     last_listing = new;
@@ -99,6 +148,7 @@ listing *new_listing(source *src,int line)
 void del_last_listing(void)
 {
   if (listena && prev_listing!=NULL) {
+    myfree(last_listing->txt);
     myfree(last_listing);
     last_listing = prev_listing;
     prev_listing = NULL;
@@ -121,6 +171,52 @@ void set_list_title(char *p,int len)
   listtitlelines[listtitlecnt-1]=cur_src->line;
 }
 
+static const char *list_text(listing *l,int *len)
+/* return the source text of a listing line and its length */
+{
+  const char *p;
+  size_t n;
+
+  if (l->txt != NULL) {
+    *len = (int)strlen(l->txt);
+    return l->txt;
+  }
+  if (l->txtlen >= 0) {
+    /* Spooled line. Lines are read in ascending order, so we only have
+       to skip forward. */
+    if (!spoolrdmode) {
+      if (fflush(listspool)!=0 || fseek(listspool,0,SEEK_SET)!=0)
+        general_error(29,"listing spool");  /* read error */
+      spoolrdmode = 1;
+    }
+    if (l->txtoffs < spoolrd)
+      ierror(0);
+    if ((size_t)l->txtlen >= spoolbufsz) {
+      spoolbufsz = l->txtlen < 0x100 ? 0x100 : l->txtlen + 1;
+      spoolbuf = myrealloc(spoolbuf,spoolbufsz);
+    }
+    while (spoolrd < l->txtoffs) {
+      n = l->txtoffs - spoolrd;
+      if (n > spoolbufsz)
+        n = spoolbufsz;
+      if (fread(spoolbuf,1,n,listspool) != n)
+        general_error(29,"listing spool");
+      spoolrd += n;
+    }
+    if (fread(spoolbuf,1,l->txtlen,listspool) != (size_t)l->txtlen)
+      general_error(29,"listing spool");
+    spoolrd += l->txtlen;
+    *len = l->txtlen;
+    return spoolbuf;
+  }
+  if ((p = source_line(l->src,l->line,&n)) == NULL) {
+    p = "";
+    n = 0;
+  }
+  *len = (int)n;
+  return p;
+}
+
 static size_t get_symbols(symbol **symlist,uint32_t flags)
 {
   size_t cnt;
@@ -183,6 +279,8 @@ static void write_listing_old(char *listname,section *first_section)
   symbol *sym;
   taddr pc;
   char rel;
+  const char *txt;
+  int tlen;
 
   if(!(f=fopen(listname,"w"))){
     general_error(13,listname);
@@ -235,7 +333,8 @@ static void write_listing_old(char *listname,section *first_section)
     }else
       fprintf(f,"                           ");
 
-    fprintf(f," %-.77s",p->txt);
+    txt=list_text(p,&tlen);
+    fprintf(f," %-.*s",tlen<77?tlen:77,txt);
 
     /* bei laengeren Daten den Rest ueberspringen */
     /* Block entfernen, wenn alles ausgegeben werden soll */
@@ -322,6 +421,7 @@ static void write_listing_old(char *listname,section *first_section)
   fclose(f);
   for(p=first_listing;p;){
     listing *m=p->next;
+    myfree(p->txt);
     myfree(p);
     p=m;
   }
@@ -338,6 +438,8 @@ static void write_listing_old(char *listname,section *first_section)
   atom *a;
   symbol *sym;
   taddr pc;
+  const char *txt;
+  int tlen;
 
   if(!(f=fopen(listname,"w"))){
     general_error(13,listname);
@@ -353,7 +455,8 @@ static void write_listing_old(char *listname,section *first_section)
       sprintf(err,"     ");
     if(p->src&&p->src->id>maxsrc)
       maxsrc=p->src->id;
-    fprintf(f,"F%02d:%04d %s %s",(int)(p->src?p->src->id:0),p->line,err,p->txt);
+    txt=list_text(p,&tlen);
+    fprintf(f,"F%02d:%04d %s %.*s",(int)(p->src?p->src->id:0),p->line,err,tlen,txt);
     a=p->atom;
     pc=p->pc;
     while(a){
@@ -401,6 +504,7 @@ static void write_listing_old(char *listname,section *first_section)
   fclose(f);
   for(p=first_listing;p;){
     listing *m=p->next;
+    myfree(p->txt);
     myfree(p);
     p=m;
   }
@@ -435,6 +539,8 @@ static void write_listing_wide(char *listname,section *first_section)
     taddr pc = l->pc;
     int flag = 0;
     char stype = ':';
+    const char *txt;
+    int tlen;
     size_t spc;
 
     if (l->src) {
@@ -451,6 +557,7 @@ static void write_listing_wide(char *listname,section *first_section)
         }
       }
     }
+    txt = list_text(l,&tlen);
     i = 0;
 
     while (a) {
@@ -463,7 +570,7 @@ static void write_listing_wide(char *listname,section *first_section)
           if (!(i % listbpl)) {
             if (i) {
               if (!flag) {
-                fprintf(f,"\t%6d%c %s\n",l->line,stype,l->txt);
+                fprintf(f,"\t%6d%c %.*s\n",l->line,stype,tlen,txt);
                 flag = 1;
               }
               else
@@ -484,7 +591,7 @@ static void write_listing_wide(char *listname,section *first_section)
             if (!(i % listbpl)) {
               if (i) {
                 if (!flag) {
-                  fprintf(f,"\t%6d%c %s\n",l->line,stype,l->txt);
+                  fprintf(f,"\t%6d%c %.*s\n",l->line,stype,tlen,txt);
                   flag = 1;
                 }
                 else
@@ -502,8 +609,8 @@ static void write_listing_wide(char *listname,section *first_section)
       }
       if (i) {
         if (!flag) {
-          fprintf(f,"%*c%6d%c %s",
-                  bytew*(listbpl-i)+1,'\t',l->line,stype,l->txt);
+          fprintf(f,"%*c%6d%c %.*s",
+                  bytew*(listbpl-i)+1,'\t',l->line,stype,tlen,txt);
           if (spc) {
             fprintf(f,"\n%02X:%0*llX *",
                     (unsigned)(l->sec?l->sec->idx:0),
@@ -524,8 +631,8 @@ static void write_listing_wide(char *listname,section *first_section)
         a = NULL;
     }
     if (!flag)  /* no data generated for this source line */
-      fprintf(f,"%*c%6d%c %s\n",
-              4+addrw+bytew*listbpl+1,'\t',l->line,stype,l->txt);
+      fprintf(f,"%*c%6d%c %.*s\n",
+              4+addrw+bytew*listbpl+1,'\t',l->line,stype,tlen,txt);
     if (l->error)
       fprintf(f,"%*c     ^-ERROR:%04d\n",4+addrw+bytew*listbpl+1,'\t',l->error);
   }
@@ -621,4 +728,8 @@ void set_listformat(const char *fmtname)
 void write_listing(char *listname,section *first_section)
 {
   list_format_table[listformat].fmtfunction(listname,first_section);
+  if (listspool != NULL) {
+    fclose(listspool);
+    listspool = NULL;
+  }
 }
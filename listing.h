@@ -5,8 +5,6 @@
 #define LISTING_H
 
 /* listing table */
-#define MAXLISTSRC 120
-
 struct listing {
   listing *next;
   source *src;
@@ -15,7 +13,9 @@ struct listing {
   atom *atom;
   section *sec;
   taddr pc;
-  char txt[MAXLISTSRC];
+  char *txt;      /* modified line in memory, or NULL */
+  size_t txtoffs; /* offset of a modified line in the spool file */
+  int txtlen;     /* length of a spooled line, -1: unmodified file line */
 };
 
 extern int produce_listing,listena;
@@ -24,7 +24,7 @@ extern listing *first_listing,*last_listing,*cur_listing;
 
 int init_listing(void);
 int listing_option(char *);
-listing *new_listing(source *,int);
+listing *new_listing(source *,int,const char *,size_t);
 void del_last_listing(void);
 void set_listing(int);
 void set_list_title(char *,int);
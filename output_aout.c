@@ -13,7 +13,7 @@ static const int sectype[] = { N_TEXT, N_DATA, N_BSS };
 static const int secweak[] = { N_WEAKT, N_WEAKD, N_WEAKB };
 
 static struct SymTabList aoutsymlist; 
-static struct StrTabList aoutstrlist; 
+static strpool *aoutstrpool;
 static struct list treloclist;
 static struct list dreloclist;
 
@@ -135,9 +135,8 @@ static void aout_initwrite(section *firstsec)
   if (mid == -1)
     mid = MID;
 
-  initlist(&aoutstrlist.l);
-  aoutstrlist.hashtab = mycalloc(ASTRTABSIZE*sizeof(struct StrTabNode *));
-  aoutstrlist.nextoffset = 4;  /* first string is always at offset 4 */
+  /* first string is always at offset 4, behind the table size */
+  aoutstrpool = new_strpool(ASTRTABSIZE,4,1);
   initlist(&aoutsymlist.l);
   aoutsymlist.hashtab = mycalloc(ASYMTABSIZE*sizeof(struct SymbolNode *));
   aoutsymlist.nextindex = 0;
@@ -182,36 +181,6 @@ static void aout_initwrite(section *firstsec)
 }
 
 
-static uint32_t aout_addstr(const char *s)
-/* add a new symbol name to the string table and return its offset */
-{
-  struct StrTabNode **chain;
-  struct StrTabNode *sn;
-
-  if (s == NULL)
-    return 0;
-  if (*s == '\0')
-    return 0;
-
-  /* search string in hash table */
-  chain = &aoutstrlist.hashtab[hashcode(s)%ASTRTABSIZE];
-  while (sn = *chain) {
-    if (!strcmp(s,sn->str))
-      return (sn->offset);  /* it's already in, return offset */
-    chain = &sn->hashchain;
-  }
-
-  /* new string table entry */
-  *chain = sn = mymalloc(sizeof(struct StrTabNode));
-  sn->hashchain = NULL;
-  sn->str = s;
-  sn->offset = aoutstrlist.nextoffset;
-  addtail(&aoutstrlist.l,&sn->n);
-  aoutstrlist.nextoffset += strlen(s) + 1;
-  return sn->offset;
-}
-
-
 static struct SymbolNode *aout_addsym(const char *name,uint8_t type,int8_t other,
                                       int16_t desc,uint32_t value,int be)
 /* append a new symbol to the symbol list */
@@ -220,7 +189,7 @@ static struct SymbolNode *aout_addsym(const char *name,uint8_t type,int8_t other
 
   sym->name = name!=NULL ? name : emptystr;
   sym->index = aoutsymlist.nextindex++;
-  setval(be,&sym->s.n_strx,4,aout_addstr(name));
+  setval(be,&sym->s.n_strx,4,strpool_add(aoutstrpool,name));  /* index */
   sym->s.n_type = type;
   sym->s.n_other = other;
   setval(be,&sym->s.n_desc,2,desc);
@@ -550,23 +519,25 @@ void aout_writerelocs(FILE *f,struct list *l)
 }
 
 
-void aout_writesymbols(FILE *f)
+void aout_writesymbols(FILE *f,int be)
 {
   struct SymbolNode *sym;
 
-  while (sym = (struct SymbolNode *)remhead(&aoutsymlist.l))
+  strpool_finish(aoutstrpool);
+  while (sym = (struct SymbolNode *)remhead(&aoutsymlist.l)) {
+    /* replace string pool index by the final string table offset */
+    setval(be,&sym->s.n_strx,4,
+           strpool_offset(aoutstrpool,readval(be,&sym->s.n_strx,4)));
     fwdata(f,&sym->s,sizeof(struct nlist32));
+  }
 }
 
 
 void aout_writestrings(FILE *f,int be)
 {
-  if (aoutstrlist.nextoffset > 4) {
-    struct StrTabNode *stn;
-
-    fw32(f,aoutstrlist.nextoffset,be);
-    while (stn = (struct StrTabNode *)remhead(&aoutstrlist.l))
-      fwdata(f,stn->str,strlen(stn->str)+1);
+  if (aoutstrpool->size > 4) {
+    fw32(f,aoutstrpool->size,be);
+    strpool_write(f,aoutstrpool);
   }
 }
 
@@ -597,7 +568,7 @@ static void write_output(FILE *f,section *sec,symbol *sym)
   aout_writesection(f,sections[S_DATA],SECT_ALIGN);
   aout_writerelocs(f,&treloclist);
   aout_writerelocs(f,&dreloclist);
-  aout_writesymbols(f);
+  aout_writesymbols(f,be);
   aout_writestrings(f,be);
 }
 
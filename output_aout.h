@@ -87,19 +87,6 @@ struct relocation_info {
 #define ASTRTABSIZE 0x10000
 #define ASYMTABSIZE 0x10000
 
-struct StrTabNode {
-  struct node n;
-  struct StrTabNode *hashchain;
-  const char *str;
-  uint32_t offset;
-};
-
-struct StrTabList {
-  struct list l;
-  struct StrTabNode **hashtab;
-  uint32_t nextoffset;
-};
-
 struct SymbolNode {
   struct node n;
   struct SymbolNode *hashchain;
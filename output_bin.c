@@ -4,7 +4,7 @@
 #include "vasm.h"
 
 #ifdef OUTBIN
-static char *copyright="vasm binary output module 2.3c (c) 2002-2024 Volker Barthelmann and Frank Wille";
+static char *copyright="vasm binary output module 2.4 (c) 2002-2024 Volker Barthelmann and Frank Wille";
 
 enum {
   BINFMT_RAW,           /* no header */
@@ -24,6 +24,25 @@ static char *exec_symname;
 static taddr exec_addr;
 static int addrbits,coalesce;
 
+/* post-processing of the memory image before it is written */
+enum {
+  PP_SUM16,             /* 16-bit sum of all 16-bit words */
+  PP_CRC32              /* CRC-32 (IEEE 802.3) */
+};
+struct postproc {
+  struct postproc *next;
+  int type;
+  char *arg[3];         /* start, end, destination: number or symbol */
+  int be;               /* endianness of words and result, -1 for cpu */
+  const char *opt;
+};
+static struct postproc *first_pp,*last_pp;
+static char *padto;     /* image size or "pow2" */
+static uint8_t fillbyte;
+
+static uint8_t *image;  /* memory image, when post-processing is needed */
+static size_t imagesize,imagepos;
+
 
 static int orgcmp(const void *sec1,const void *sec2)
 {
@@ -35,6 +54,225 @@ static int orgcmp(const void *sec1,const void *sec2)
 }
 
 
+static uint8_t *img_reserve(size_t n)
+/* n is in octets */
+{
+  if (imagepos+n > imagesize) {
+    do
+      imagesize = imagesize ? imagesize<<1 : 0x10000;
+    while (imagepos+n > imagesize);
+    image = myrealloc(image,imagesize);
+  }
+  imagepos += n;
+  return image + imagepos - n;
+}
+
+
+static void img_bytes(void *buf,size_t n)
+/* copy target-bytes into the image, like fwbytes(); n is in target-bytes */
+{
+  uint8_t *d = img_reserve(OCTETS(n));
+
+  if (output_bytes_le) {
+    uint8_t *p = buf;
+    int i;
+
+    while (n--) {
+      for (i=octetsperbyte; i>0; *d++=p[--i]);
+      p += octetsperbyte;
+    }
+  }
+  else
+    memcpy(d,buf,OCTETS(n));
+}
+
+
+static void img_pattern(taddr n,uint8_t *pat,int patlen)
+/* n and patlen are in target-bytes, like fwpattern() */
+{
+  while (n % patlen) {
+    memset(img_reserve(OCTETS(1)),0,OCTETS(1));
+    n--;
+  }
+  while (n >= patlen) {
+    img_bytes(pat,patlen);
+    n -= patlen;
+  }
+}
+
+
+static taddr img_pcalign(atom *a,section *sec,taddr pc)
+{
+  taddr n = balign(pc,a->align);
+
+  if (n == 0)
+    return pc;
+
+  if (a->type==SPACE && a->content.sb->space==0) {  /* space align atom */
+    if (a->content.sb->maxalignbytes!=0 && n>a->content.sb->maxalignbytes)
+      return pc;
+    img_pattern(n,a->content.sb->fill,a->content.sb->size);
+  }
+  else
+    img_pattern(n,sec->pad,sec->padbytes);
+
+  return pc+n;
+}
+
+
+static int pp_value(const char *arg,unsigned long long *val)
+/* a post-processing argument is a number or the name of a symbol */
+{
+  symbol *sym;
+  long long v;
+
+  if (isdigit((unsigned char)*arg)) {
+    sscanf(arg,"%lli",&v);
+    *val = (unsigned long long)v;
+    return 1;
+  }
+  if ((sym = find_symbol(arg)) != NULL && sym->type != IMPORT) {
+    *val = (utaddr)get_sym_value(sym);
+    return 1;
+  }
+  output_error(6,arg);  /* undefined symbol */
+  return 0;
+}
+
+
+static uint32_t crc32(uint8_t *p,size_t n)
+{
+  static uint32_t crctab[256];
+  uint32_t crc;
+
+  if (crctab[1] == 0) {
+    uint32_t i,j;
+
+    for (i=0; i<256; i++) {
+      for (crc=i,j=0; j<8; j++)
+        crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+      crctab[i] = crc;
+    }
+  }
+  for (crc=0xffffffff; n; n--)
+    crc = crctab[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  return crc ^ 0xffffffff;
+}
+
+
+static void postprocess(unsigned long long org)
+/* pad the image and patch the checksums into it */
+{
+  struct postproc *pp;
+
+  if (padto != NULL) {
+    size_t newsize = imagepos;
+
+    if (!strcmp(padto,"pow2")) {
+      for (newsize=1; newsize<imagepos; newsize<<=1);
+    }
+    else {
+      unsigned long long v;
+
+      if (pp_value(padto,&v))
+        newsize = OCTETS(v);
+    }
+    if (newsize > imagepos)
+      memset(img_reserve(newsize-imagepos),fillbyte,newsize-imagepos);
+  }
+
+  for (pp=first_pp; pp; pp=pp->next) {
+    unsigned long long start,end,dest;
+    uint32_t sum;
+    int i,len;
+
+    if (!pp_value(pp->arg[0],&start) || !pp_value(pp->arg[1],&end) ||
+        !pp_value(pp->arg[2],&dest))
+      continue;
+    len = pp->type==PP_CRC32 ? 4 : 2;
+    if (start<org || end<start || OCTETS(end-org)>imagepos) {
+      output_error(24,pp->opt,start,end);
+      continue;
+    }
+    if (dest<org || OCTETS(dest-org)+len>imagepos) {
+      output_error(24,pp->opt,dest,dest+len);
+      continue;
+    }
+    if (pp->be < 0)
+      pp->be = BIGENDIAN;
+    if (pp->type==PP_SUM16 && (OCTETS(end-start)&1)) {
+      output_error(25,pp->opt,start,end);
+      continue;
+    }
+
+    if (pp->type == PP_CRC32) {
+      sum = crc32(image+OCTETS(start-org),OCTETS(end-start));
+    }
+    else {
+      uint8_t *p = image + OCTETS(start-org);
+      size_t n;
+
+      for (sum=0,n=OCTETS(end-start); n; n-=2,p+=2)
+        sum += pp->be ? (p[0]<<8)|p[1] : (p[1]<<8)|p[0];
+      sum &= 0xffff;
+    }
+
+    /* patch the result in the requested endianness */
+    if (pp->be) {
+      for (i=len-1; i>=0; i--,sum>>=8)
+        image[OCTETS(dest-org)+i] = (uint8_t)sum;
+    }
+    else {
+      for (i=0; i<len; i++,sum>>=8)
+        image[OCTETS(dest-org)+i] = (uint8_t)sum;
+    }
+  }
+}
+
+
+static unsigned long long write_image(FILE *f,section **seclist,size_t nsecs)
+/* Build a memory image of all sections, post-process it and write it
+   with a single call. Returns the address following the image. */
+{
+  unsigned long long org=(unsigned long long)seclist[0]->org;
+  unsigned long long pc=org,npc;
+  section *s;
+  atom *p;
+
+  imagepos = 0;
+  for (; nsecs>0; nsecs--) {
+    s = *seclist++;
+
+    /* fill gap between sections with pad-bytes */
+    if (((unsigned long long)s->org) > pc)
+      img_pattern(((unsigned long long)s->org)-pc,s->pad,s->padbytes);
+
+    for (p=s->first,pc=(unsigned long long)s->org; p; p=p->next) {
+      npc = img_pcalign(p,s,pc);
+
+      if (p->type == DATA)
+        img_bytes(p->content.db->data,p->content.db->size);
+      else if (p->type == SPACE) {
+        sblock *sb = p->content.sb;
+        size_t i;
+
+        for (i=0; i<sb->space; i++)
+          img_bytes(sb->fill,sb->size);
+      }
+
+      pc = npc + atom_size(p,s,npc);
+    }
+  }
+
+  postprocess(org);
+  fwdata(f,image,imagepos);
+  myfree(image);
+  image = NULL;
+  imagesize = 0;
+  return org + imagepos/OCTETS(1);
+}
+
+
 static void write_output(FILE *f,section *sec,symbol *sym)
 {
   section *s,**seclist,**slp;
@@ -169,6 +407,33 @@ static void write_output(FILE *f,section *sec,symbol *sym)
       break;
   }
 
+  if (first_pp!=NULL || padto!=NULL) {
+    for (slp=seclist; slp<seclist+nsecs; slp++) {
+      /* strip uninitialized space atoms from section */
+      s = *slp;
+      if (s->last)
+        s->last->next = NULL;
+      else
+        s->first = NULL;
+    }
+    switch (binfmt) {
+      case BINFMT_ATARICOM:
+      case BINFMT_COCOML:
+      case BINFMT_FOENIXPGZ:
+        /* segmented formats have no contiguous image */
+        output_error(23);
+        break;
+      default:
+        if (coalesce)
+          output_error(23);
+        else {
+          pc = write_image(f,seclist,nsecs);
+          nsecs = 0;
+        }
+        break;
+    }
+  }
+
   for (slp=seclist; nsecs>0; nsecs--) {
     s = *slp++;
 
@@ -297,6 +562,46 @@ static int output_args(char *p)
     defsectorg = val;  /* set start of default section */
     return 1;
   }
+  else if (!strncmp(p,"-pad-to=",8)) {
+    padto = p + 8;
+    return 1;
+  }
+  else if (!strncmp(p,"-fill=",6)) {
+    sscanf(p+6,"%lli",&val);
+    fillbyte = (uint8_t)val;
+    return 1;
+  }
+  else if (!strncmp(p,"-sum16=",7) || !strncmp(p,"-crc32=",7)) {
+    struct postproc *pp = mycalloc(sizeof(struct postproc));
+    char *a = mystrdup(p+7);
+    int i;
+
+    pp->type = p[1]=='s' ? PP_SUM16 : PP_CRC32;
+    pp->opt = p;
+    pp->be = -1;
+    for (i=0; i<3; i++) {
+      pp->arg[i] = a;
+      if ((a = strchr(a,',')) == NULL)
+        break;
+      *a++ = '\0';
+    }
+    if (i < 2)
+      return 0;  /* need start, end and destination */
+    if (a != NULL) {
+      if (!stricmp(a,"be"))
+        pp->be = 1;
+      else if (!stricmp(a,"le"))
+        pp->be = 0;
+      else
+        return 0;
+    }
+    if (last_pp)
+      last_pp->next = pp;
+    else
+      first_pp = pp;
+    last_pp = pp;
+    return 1;
+  }
   else if (!strcmp(p,"-apple-bin")) {
     binfmt = BINFMT_APPLEBIN;
     return 1;
@@ -14,7 +14,7 @@ static unsigned elfrelsize,shtreloc;
 
 static hashtable *elfsymhash;
 static struct list shdrlist,symlist,relalist;
-static struct StrTabList shstrlist,strlist,stabstrlist;
+static strpool *shstrpool,*symstrpool,*stabstrpool;
 
 static unsigned symtabidx,strtabidx,shstrtabidx;
 static unsigned symindex,shdrindex;
@@ -23,36 +23,23 @@ static utaddr stablen;
 static char stabname[] = ".stab";
 
 
-static unsigned addString(struct StrTabList *sl,const char *s)
-{
-  struct StrTabNode *sn = mymalloc(sizeof(struct StrTabNode));
-  unsigned idx = sl->index;
-
-  sn->str = s;
-  addtail(&(sl->l),&(sn->n));
-  sl->index += (unsigned)strlen(s) + 1;
-  return idx;
-}
-
-
 static void init_lists(void)
 {
   elfsymhash = new_hashtable(ELFSYMHTABSIZE);
   initlist(&shdrlist);
   initlist(&symlist);
   initlist(&relalist);
-  shstrlist.index = strlist.index = 0;
-  initlist(&shstrlist.l);
-  initlist(&strlist.l);
+  /* String table fields hold pool indexes until the tables are finished.
+     The first string is always "" at offset 0. */
+  shstrpool = new_strpool(ELFSTRHTABSIZE,1,1);
+  symstrpool = new_strpool(ELFSTRHTABSIZE,1,1);
   symindex = shdrindex = stabidx = 0;
-  addString(&shstrlist,emptystr);  /* first string is always "" */
-  symtabidx = addString(&shstrlist,".symtab");
-  strtabidx = addString(&shstrlist,".strtab");
-  shstrtabidx = addString(&shstrlist,".shstrtab");
-  addString(&strlist,emptystr);
+  symtabidx = strpool_add(shstrpool,".symtab");
+  strtabidx = strpool_add(shstrpool,".strtab");
+  shstrtabidx = strpool_add(shstrpool,".shstrtab");
   if (!no_symbols && first_nlist) {
-    initlist(&stabstrlist.l);
-    addString(&stabstrlist,emptystr);
+    /* no tail-merging in .stabstr, the cu name must stay at offset 1 */
+    stabstrpool = new_strpool(ELFSTRHTABSIZE,1,0);
   }
 }
 
@@ -85,7 +72,7 @@ static struct Symbol32Node *addSymbol32(const char *name)
   addtail(&symlist,&(sn->n));
   if (name) {
     sn->name = name;
-    setval(be,sn->s.st_name,4,addString(&strlist,name));
+    setval(be,sn->s.st_name,4,strpool_add(symstrpool,name));
   }
   data.ptr = sn;
   sn->idx = symindex++;
@@ -102,7 +89,7 @@ static struct Symbol64Node *addSymbol64(const char *name)
   addtail(&symlist,&(sn->n));
   if (name) {
     sn->name = name;
-    setval(be,sn->s.st_name,4,addString(&strlist,name));
+    setval(be,sn->s.st_name,4,strpool_add(symstrpool,name));
   }
   data.ptr = sn;
   sn->idx = symindex++;
@@ -435,7 +422,7 @@ static void make_relsechdr(const char *sname,utaddr roffs,utaddr len,unsigned id
   else
     sprintf(rname,".rel%s",sname);
 
-  makeshdr(addString(&shstrlist,rname),shtreloc,0,
+  makeshdr(strpool_add(shstrpool,rname),shtreloc,0,
            roffs, /* relative offset - will be fixed later! */
            len,idx,bytespertaddr,elfrelsize);
 }
@@ -461,7 +448,7 @@ static utaddr prog_sec_hdrs(section *sec,utaddr soffset,
       newsym(NULL,0,0,STB_LOCAL,STT_SECTION,shdrindex);
 
       secp->idx = shdrindex;
-      makeshdr(addString(&shstrlist,secp->name),
+      makeshdr(strpool_add(shstrpool,secp->name),
                type,get_sec_flags(secp->attr),soffset,
                get_sec_size(secp),0,secp->align,0);
 
@@ -485,24 +472,24 @@ static utaddr prog_sec_hdrs(section *sec,utaddr soffset,
       nlist = nlist->next;
     }
     /* add all symbol strings to .stabstr, cu name should be first(?) */
-    addString(&stabstrlist,cuname!=NULL?cuname:filename);
+    strpool_add(stabstrpool,cuname!=NULL?cuname:filename);
     nlist = first_nlist;
     while (nlist != NULL) {
-      nlist->name.idx = nlist->name.ptr != NULL ?
-                        addString(&stabstrlist,nlist->name.ptr) : 0;
+      nlist->name.idx = strpool_add(stabstrpool,nlist->name.ptr);
       nlist = nlist->next;
     }
+    strpool_finish(stabstrpool);
     /* make .stab section, preceded by a compilation unit header (stablen+1) */
     stabidx = shdrindex;
-    shn = makeshdr(addString(&shstrlist,stabname),SHT_PROGBITS,0,soffset,
+    shn = makeshdr(strpool_add(shstrpool,stabname),SHT_PROGBITS,0,soffset,
                    (stablen+1)*sizeof(struct nlist32),0,4,
                    sizeof(struct nlist32));
     soffset += (stablen+1) * sizeof(struct nlist32);
     setval(be,shn->s.sh_link,4,shdrindex);  /* associated .stabstr section */
     /* make .stabstr section */
-    makeshdr(addString(&shstrlist,".stabstr"),SHT_STRTAB,0,soffset,
-             stabstrlist.index,0,1,0);
-    soffset += stabstrlist.index;
+    makeshdr(strpool_add(shstrpool,".stabstr"),SHT_STRTAB,0,soffset,
+             stabstrpool->size,0,1,0);
+    soffset += stabstrpool->size;
     stabstralign = balign(soffset,4);
     soffset += stabstralign;
   }
@@ -594,12 +581,10 @@ static void make_reloc_sections(section *sec,
 }
 
 
-static void write_strtab(FILE *f,struct StrTabList *strl)
+static void write_strtab(FILE *f,strpool *sp)
 {
-  struct StrTabNode *stn;
-
-  while (stn = (struct StrTabNode *)remhead(&(strl->l)))
-    fwdata(f,stn->str,strlen(stn->str)+1);
+  fw8(f,0);  /* "" */
+  strpool_write(f,sp);
 }
 
 
@@ -632,12 +617,13 @@ static void write_section_data(FILE *f,section *sec)
     /* write compilation unit header - precedes nlist entries */
     fw32(f,1,be);  /* source name is first entry in .stabstr */
     fw32(f,stablen,be);
-    fw32(f,stabstrlist.index,be);
+    fw32(f,stabstrpool->size,be);
     /* write .stab */
     while (nlist != NULL) {
       struct nlist32 n;
 
-      setval(be,&n.n_strx,4,nlist->name.idx);
+      setval(be,&n.n_strx,4,
+             strpool_offset(stabstrpool,nlist->name.idx));
       n.n_type = nlist->type;
       n.n_other = nlist->other;
       setval(be,&n.n_desc,2,nlist->desc);
@@ -646,7 +632,7 @@ static void write_section_data(FILE *f,section *sec)
       nlist = nlist->next;
     }
     /* write .stabstr and align */
-    write_strtab(f,&stabstrlist);
+    write_strtab(f,stabstrpool);
     fwspace(f,stabstralign);
   }
 }
@@ -682,8 +668,8 @@ static void write_ELF64(FILE *f,section *sec,symbol *sym)
 
   /* ".shstrtab" section header string table */
   makeShdr64(shstrtabidx,SHT_STRTAB,0,
-             soffset,shstrlist.index,0,1,0);
-  soffset += shstrlist.index;
+             soffset,strpool_finish(shstrpool),0,1,0);
+  soffset += shstrpool->size;
   align1 = balign(soffset,4);
   soffset += align1;
 
@@ -701,8 +687,9 @@ static void write_ELF64(FILE *f,section *sec,symbol *sym)
   soffset += symindex * sizeof(struct Elf64_Sym);
 
   /* ".strtab" string table */
-  makeShdr64(strtabidx,SHT_STRTAB,0,soffset,strlist.index,0,1,0);
-  soffset += strlist.index;
+  makeShdr64(strtabidx,SHT_STRTAB,0,
+             soffset,strpool_finish(symstrpool),0,1,0);
+  soffset += symstrpool->size;
   align2 = balign(soffset,4);
   soffset += align2;  /* offset for first Reloc-entry */
 
@@ -713,7 +700,7 @@ static void write_ELF64(FILE *f,section *sec,symbol *sym)
   write_section_data(f,sec);
 
   /* write .shstrtab string table */
-  write_strtab(f,&shstrlist);
+  write_strtab(f,shstrpool);
 
   /* write section headers */
   fwspace(f,align1);
@@ -724,16 +711,21 @@ static void write_ELF64(FILE *f,section *sec,symbol *sym)
       setval(be,shn->s.sh_offset,8,readval(be,shn->s.sh_offset,8)+soffset);
       setval(be,shn->s.sh_link,4,shdrindex-2); /* index of associated symtab */
     }
+    setval(be,shn->s.sh_name,4,
+           strpool_offset(shstrpool,readval(be,shn->s.sh_name,4)));
     fwdata(f,&(shn->s),sizeof(struct Elf64_Shdr));
     i++;
   }
 
   /* write symbol table */
-  while (elfsym = (struct Symbol64Node *)remhead(&symlist))
+  while (elfsym = (struct Symbol64Node *)remhead(&symlist)) {
+    setval(be,elfsym->s.st_name,4,
+           strpool_offset(symstrpool,readval(be,elfsym->s.st_name,4)));
     fwdata(f,&(elfsym->s),sizeof(struct Elf64_Sym));
+  }
 
   /* write .strtab string table */
-  write_strtab(f,&strlist);
+  write_strtab(f,symstrpool);
 
   /* write relocations */
   fwspace(f,align2);
@@ -785,8 +777,8 @@ static void write_ELF32(FILE *f,section *sec,symbol *sym)
 
   /* ".shstrtab" section header string table */
   makeShdr32(shstrtabidx,SHT_STRTAB,0,
-             soffset,shstrlist.index,0,1,0);
-  soffset += shstrlist.index;
+             soffset,strpool_finish(shstrpool),0,1,0);
+  soffset += shstrpool->size;
   align1 = balign(soffset,4);
   soffset += align1;
 
@@ -804,8 +796,9 @@ static void write_ELF32(FILE *f,section *sec,symbol *sym)
   soffset += symindex * sizeof(struct Elf32_Sym);
 
   /* ".strtab" string table */
-  makeShdr32(strtabidx,SHT_STRTAB,0,soffset,strlist.index,0,1,0);
-  soffset += strlist.index;
+  makeShdr32(strtabidx,SHT_STRTAB,0,
+             soffset,strpool_finish(symstrpool),0,1,0);
+  soffset += symstrpool->size;
   align2 = balign(soffset,4);
   soffset += align2;  /* offset for first Reloc-entry */
 
@@ -816,7 +809,7 @@ static void write_ELF32(FILE *f,section *sec,symbol *sym)
   write_section_data(f,sec);
 
   /* write .shstrtab string table */
-  write_strtab(f,&shstrlist);
+  write_strtab(f,shstrpool);
 
   /* write section headers */
   fwspace(f,align1);
@@ -827,16 +820,21 @@ static void write_ELF32(FILE *f,section *sec,symbol *sym)
       setval(be,shn->s.sh_offset,4,readval(be,shn->s.sh_offset,4)+soffset);
       setval(be,shn->s.sh_link,4,shdrindex-2); /* index of associated symtab */
     }
+    setval(be,shn->s.sh_name,4,
+           strpool_offset(shstrpool,readval(be,shn->s.sh_name,4)));
     fwdata(f,&(shn->s),sizeof(struct Elf32_Shdr));
     i++;
   }
 
   /* write symbol table */
-  while (elfsym = (struct Symbol32Node *)remhead(&symlist))
+  while (elfsym = (struct Symbol32Node *)remhead(&symlist)) {
+    setval(be,elfsym->s.st_name,4,
+           strpool_offset(symstrpool,readval(be,elfsym->s.st_name,4)));
     fwdata(f,&(elfsym->s),sizeof(struct Elf32_Sym));
+  }
 
   /* write .strtab string table */
-  write_strtab(f,&strlist);
+  write_strtab(f,symstrpool);
 
   /* write relocations */
   fwspace(f,align2);
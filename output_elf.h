@@ -242,16 +242,6 @@ struct Elf64_Rela {
 
 typedef uint64_t elfull;
 
-struct StrTabList {
-  struct list l;
-  unsigned index;
-};
-
-struct StrTabNode {
-  struct node n;
-  const char *str;
-};
-
 struct Shdr32Node {
   struct node n;
   struct Elf32_Shdr s;
@@ -318,3 +308,4 @@ struct Rel64Node {
 #endif
 
 #define ELFSYMHTABSIZE 0x10000
+#define ELFSTRHTABSIZE 0x4000
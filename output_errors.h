@@ -22,3 +22,6 @@
   "all sections are absolute, nothing to relocate",WARNING|NOLINE,  /* 20 */
   "expression type of symbol %s not supported",ERROR|NOLINE,
   "unaligned relocation offset at %s+%#lx",WARNING,
+  "post-processing not supported with a segmented or coalesced output",ERROR|NOLINE,
+  "%s: range %#llx-%#llx outside of output image",ERROR|NOLINE, /* 24 */
+  "%s: range %#llx-%#llx has an odd number of bytes",ERROR|NOLINE,
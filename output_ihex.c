@@ -18,7 +18,7 @@
 #define REC_ELA 4 /* extended linear address */
 #define REC_SLA 5 /* start linear address */
 
-static char *copyright = "vasm Intel HEX output module 0.3 (c) 2020 Rida Dzhaafar";
+static char *copyright = "vasm Intel HEX output module 0.4 (c) 2020 Rida Dzhaafar";
 
 static int ihex_fmt = I8HEX; /* default ihex format */
 
@@ -29,22 +29,50 @@ static uint8_t buffer_i = 0;  /* current index in buffer */
 static uint32_t addr = 0;     /* current output address */
 static uint16_t ext_addr = 0; /* last written extended segment/linear address */
 
-static void write_newline(FILE *f) /* gbm 06'21 */
+/* a complete record is formatted here: colon, count, address, type,
+   up to 255 data bytes, checksum, CR/LF */
+static char line[1+2*(1+2+1+255+1)+2];
+
+static const char hexdigits[16] = "0123456789ABCDEF";
+
+static void write_record(FILE *f, uint8_t type, uint16_t start,
+                         uint8_t *data, int len)
 {
-  if (!asciiout)
-    fw8(f, '\r');
-  fw8(f, '\n');
+  uint8_t csum = len + (start >> 8) + start + type;
+  char *p = line;
+  int i;
+
+  *p++ = ':';
+  *p++ = hexdigits[len >> 4];
+  *p++ = hexdigits[len & 0xf];
+  *p++ = hexdigits[start >> 12];
+  *p++ = hexdigits[(start >> 8) & 0xf];
+  *p++ = hexdigits[(start >> 4) & 0xf];
+  *p++ = hexdigits[start & 0xf];
+  *p++ = hexdigits[type >> 4];
+  *p++ = hexdigits[type & 0xf];
+  for (i = 0; i < len; i++) {
+    csum += data[i];
+    *p++ = hexdigits[data[i] >> 4];
+    *p++ = hexdigits[data[i] & 0xf];
+  }
+  csum = (~csum) + 1;
+  *p++ = hexdigits[csum >> 4];
+  *p++ = hexdigits[csum & 0xf];
+  if (!asciiout)  /* gbm 06'21 */
+    *p++ = '\r';
+  *p++ = '\n';
+  fwdata(f, line, p - line);
 }
 
 static void write_eof_record(FILE *f)
 {
-  fprintf(f, ":00000001FF");
-  write_newline(f);
+  write_record(f, REC_EOF, 0, NULL, 0);
 }
 
 static void write_extended_record(FILE *f)
 {
-  uint8_t csum;
+  uint8_t extdata[2];
   uint16_t ext;
   uint8_t type;
 
@@ -57,17 +85,13 @@ static void write_extended_record(FILE *f)
     type = REC_ELA;
   }
 
-  csum = type + 2 + (ext >> 8) + ext;
-  csum = (~csum) + 1;
-
-  fprintf(f, ":020000%02X%04X%02X", type, ext, csum);
-  write_newline(f);
+  extdata[0] = ext >> 8;
+  extdata[1] = ext;
+  write_record(f, type, 0, extdata, 2);
 }
 
 static void write_data_record(FILE *f)
 {
-  uint8_t csum;
-  uint8_t i;
   uint16_t ext;
   uint32_t start;
 
@@ -91,17 +115,7 @@ static void write_data_record(FILE *f)
   }
 
   /* write data record */
-  fprintf(f, ":%02X%04X00", buffer_i, start);
-  csum = start;
-  csum += start >> 8;
-  csum += buffer_i;
-  for (i = 0; i < buffer_i; i++) {
-    csum += buffer[i];
-    fprintf(f, "%02X", buffer[i]);
-  }
-  csum = (~csum) + 1;
-  fprintf(f, "%02X", csum);
-  write_newline(f);
+  write_record(f, REC_DAT, start, buffer, buffer_i);
 
   /* reset the buffer index */
   buffer_i = 0;
@@ -117,15 +131,63 @@ static void buffer_data(FILE *f, uint8_t b)
     write_data_record(f);
 }
 
-static void buffer_byte(FILE *f, void *byte)
+static void buffer_span(FILE *f, const uint8_t *p, size_t n)
+{
+  size_t len;
+
+  while (n > 0) {
+    len = buffer_s - buffer_i;
+    if (len > n)
+      len = n;
+    memcpy(buffer + buffer_i, p, len);
+    buffer_i += len;
+    addr += len;
+    p += len;
+    n -= len;
+    if (buffer_i == buffer_s)
+      write_data_record(f);
+  }
+}
+
+static void buffer_fill(FILE *f, uint8_t b, size_t n)
+{
+  size_t len;
+
+  while (n > 0) {
+    len = buffer_s - buffer_i;
+    if (len > n)
+      len = n;
+    memset(buffer + buffer_i, b, len);
+    buffer_i += len;
+    addr += len;
+    n -= len;
+    if (buffer_i == buffer_s)
+      write_data_record(f);
+  }
+}
+
+static void buffer_bytes(FILE *f, uint8_t *p, size_t n)
 {
-  uint8_t *p = byte;
   int i;
 
-  if (output_bytes_le)
-    for (i = octetsperbyte; i > 0; buffer_data(f, p[--i]));
+  if (output_bytes_le && octetsperbyte > 1) {
+    for (; n > 0; n--, p += octetsperbyte)
+      for (i = octetsperbyte; i > 0; buffer_data(f, p[--i]));
+  }
   else
-    for (i = 0; i < octetsperbyte; buffer_data(f, p[i++]));
+    buffer_span(f, p, OCTETS(n));
+}
+
+static void buffer_pattern(FILE *f, uint8_t *pat, size_t len, size_t cnt)
+{
+  size_t i, n = OCTETS(len);
+
+  for (i = 1; i < n && pat[i] == pat[0]; i++);
+  if (i >= n)  /* uniform pattern, e.g. zero-fill */
+    buffer_fill(f, pat[0], n * cnt);
+  else
+    while (cnt--)
+      buffer_bytes(f, pat, len);
 }
 
 /* align the atom if necessary
@@ -133,7 +195,6 @@ static void buffer_byte(FILE *f, void *byte)
 static taddr mypcalign(FILE *f, section *sec, atom *a, taddr pc)
 {
   size_t align = balign(pc, a->align);
-  int i;
   size_t len;
   uint8_t *fill;
 
@@ -153,29 +214,13 @@ static taddr mypcalign(FILE *f, section *sec, atom *a, taddr pc)
 
   pc += align;
 
-  while (align % len) {
-    for (i = 0; i < octetsperbyte; i++)
-      buffer_data(f, 0);
-    align--;
-  }
-
-  while (align >= len) {
-    for (i = 0; i < len; i++) {
-      buffer_byte(f, fill+OCTETS(i));
-      align--;
-    }
-  }
-
-  while (align--) {
-    for (i = 0; i < octetsperbyte; i++)
-      buffer_data(f, 0);
-  }
+  buffer_fill(f, 0, OCTETS(align % len));
+  buffer_pattern(f, fill, len, align / len);
   return pc;
 }
 
 static void write_output(FILE *f, section *sec, symbol *sym)
 {
-  int i, j;
   taddr pc;
   atom *a;
   section *s;
@@ -197,15 +242,12 @@ static void write_output(FILE *f, section *sec, symbol *sym)
     for (a = s->first; a; a = a->next) {
       pc = mypcalign(f, s, a, pc);
       if (a->type == DATA) {
-        for (i = 0; i < a->content.db->size; i++,pc++) {
-          buffer_byte(f, a->content.db->data+OCTETS(i));
-        }
+        buffer_bytes(f, a->content.db->data, a->content.db->size);
+        pc += a->content.db->size;
       } else if (a->type == SPACE) {
-        for (i = 0; i < a->content.sb->space; i++) {
-          for (j = 0; j < a->content.sb->size; j++,pc++) {
-            buffer_byte(f, a->content.sb->fill+OCTETS(j));
-          }
-        }
+        buffer_pattern(f, a->content.sb->fill, a->content.sb->size,
+                       a->content.sb->space);
+        pc += a->content.sb->space * a->content.sb->size;
       }
     }
     /* flush buffer before moving on to next section */
@@ -16,11 +16,17 @@ likely need to be converted to ASCII to use it elsewhere.
 #include "vasm.h"
 
 #ifdef OUTSREC
-static char *copyright="vasm motorola srecord output module 2.0 (c) 2015 Joseph Zatarski";
+static char *copyright="vasm motorola srecord output module 2.1 (c) 2015 Joseph Zatarski";
 
-static uint8_t data[32];  /* acts as a buffer for data portion of a record */
+#define RECSIZE 32  /* maximum size of the data portion of a record */
+
+static uint8_t data[RECSIZE];  /* acts as a buffer for data portion of a record */
 static size_t data_size;  /* indicates current size of data[] */
 
+/* a complete record is formatted here: S, type, count, up to 4 address bytes,
+   data, checksum, CR/LF */
+static char line[2+2*(1+4+RECSIZE+1)+2];
+
 /*
  * holds address for the current record
  * should only be changed after writing the current record by calling
@@ -51,26 +57,25 @@ static char *start_sym; /* points to name of the start symbol, or NULL if not
 static char *default_start="start"; /* name of default execution address symbol
                                        for termination record */
 
-/* gbm modifications 06'21 */
-static void write_newline(FILE *f)
-{
-  if (!asciiout)
-    fw8(f, '\r');
-  fw8(f, '\n');
-}
+static const char hexdigits[16] = "0123456789ABCDEF";
 
-static char tohex(uint8_t v)
+static char *hex_byte(char *p, uint8_t byte)
+/* put a pair of ASCII characters to represent the byte in hex */
 {
-  return "0123456789ABCDEF"[v & 0xf];
+  *p++ = hexdigits[byte >> 4];
+  *p++ = hexdigits[byte & 0xf];
+  return p;
 }
 
-static void write_hex_byte(FILE *f, uint8_t byte)
-/* write a pair of ASCII characters to represent the byte in hex */
+static void write_line(FILE *f, char *p)
+/* terminate the record in line[] up to p and write it */
 {
-  fw8(f, tohex(byte >> 4));
-  fw8(f, tohex(byte));
+  /* gbm modifications 06'21 */
+  if (!asciiout)
+    *p++ = '\r';
+  *p++ = '\n';
+  fwdata(f, line, p - line);
 }
-/* end of gbm mods */
 
 
 static void write_data_buffer(FILE *f, uint8_t type)
@@ -82,6 +87,7 @@ static void write_data_buffer(FILE *f, uint8_t type)
  */
 {
   uint8_t checksum;
+  char *p = line;
   int i;
   
   if(data_size == 0 && type != 0) /* allow S0 record to have data size of 0 */
@@ -94,48 +100,48 @@ static void write_data_buffer(FILE *f, uint8_t type)
   if(type > 3)
     return; /* ignore types we don't handle, but this shouldn't ever happen */
 
-  fw8(f, 'S');
-  fw8(f, type + '0');
+  *p++ = 'S';
+  *p++ = type + '0';
   
   checksum = data_size + 2 + (type ? type : 1);  /* at least 2 byte address */
 
-  write_hex_byte(f, checksum); /* count: 4 bytes for address + checksum */
+  p = hex_byte(p, checksum); /* count: 4 bytes for address + checksum */
 
   if(type > 2)
   {
     uint8_t b = srec_pc >> 24;
-    write_hex_byte(f, b);
+    p = hex_byte(p, b);
     checksum += b;
   }
   if(type > 1)
   {
     uint8_t b = srec_pc >> 16;
-    write_hex_byte(f, b);
+    p = hex_byte(p, b);
     checksum += b;
   }
   if(type > 0)
   {
     uint8_t b = srec_pc >> 8;
-    write_hex_byte(f, b);
+    p = hex_byte(p, b);
     checksum += b;
-    write_hex_byte(f, srec_pc & 0xff);
+    p = hex_byte(p, srec_pc & 0xff);
     checksum += srec_pc & 0xff;
   }  
   else /* type must be 0 */
   {
-    write_hex_byte(f, 0);
-    write_hex_byte(f, 0);
+    p = hex_byte(p, 0);
+    p = hex_byte(p, 0);
   }
   
   for(i = 0; i < data_size; i++)
   {
-    write_hex_byte(f, data[i]);
+    p = hex_byte(p, data[i]);
     checksum += data[i];
   }
   
-  write_hex_byte(f, checksum ^ 0xff);
+  p = hex_byte(p, checksum ^ 0xff);
 
-  write_newline(f);
+  write_line(f, p);
   
   srec_pc += data_size;
   data_size = 0;
@@ -146,49 +152,50 @@ static void write_termination_record(FILE *f)
  * mode */
 {
   uint8_t checksum = 0;
+  char *p = line;
   
   /* check if address is out of range for this record type and error */
   if(srecfmt > 0 && ((start_addr >> ((srecfmt + 1) * 8)) != 0))
     output_error(11, start_addr);
   
-  fw8(f, 'S');
-  fw8(f, (10 - srecfmt) + '0'); /* writes S header depending on S19/S28/S37 */
+  *p++ = 'S';
+  *p++ = (10 - srecfmt) + '0'; /* writes S header depending on S19/S28/S37 */
   
   if(srecfmt == S37)
   {
-    write_hex_byte(f, 5); /* count: 4 bytes for address + checksum */
+    p = hex_byte(p, 5); /* count: 4 bytes for address + checksum */
     checksum += 5;
   
   }
   else if(srecfmt == S28)
   {
-    write_hex_byte(f, 4); /* count: 3 bytes for address + checksum */
+    p = hex_byte(p, 4); /* count: 3 bytes for address + checksum */
     checksum += 4;
   }
   else if(srecfmt == S19)
   {
-    write_hex_byte(f, 3); /* count: 2 bytes for address + checksum */
+    p = hex_byte(p, 3); /* count: 2 bytes for address + checksum */
     checksum += 3;
   }
 
   if(srecfmt >= S37)
   {
-    write_hex_byte(f, (start_addr & 0xff000000) >> 24);
+    p = hex_byte(p, (start_addr & 0xff000000) >> 24);
     checksum += (start_addr & 0xff000000) >> 24;
   }  
   if(srecfmt >= S28)
   {
-    write_hex_byte(f, (start_addr & 0xff0000) >> 16);
+    p = hex_byte(p, (start_addr & 0xff0000) >> 16);
     checksum += (start_addr & 0xff0000) >> 16;
   }  
-  write_hex_byte(f, (start_addr & 0xff00) >> 8);
+  p = hex_byte(p, (start_addr & 0xff00) >> 8);
   checksum += (start_addr & 0xff00) >> 8;
-  write_hex_byte(f, start_addr & 0xff);
+  p = hex_byte(p, start_addr & 0xff);
   checksum += start_addr & 0xff;
 
-  write_hex_byte(f, checksum ^ 0xff);
+  p = hex_byte(p, checksum ^ 0xff);
 
-  write_newline(f);
+  write_line(f, p);
 }
 
 static void put_byte_in_buffer(FILE *f, uint8_t byte)
@@ -198,30 +205,84 @@ static void put_byte_in_buffer(FILE *f, uint8_t byte)
   data[data_size] = byte;
   data_size++;
   
-  if(data_size >= 32)
+  if(data_size >= RECSIZE)
     write_data_buffer(f, srecfmt);
 }
 
-static void put_tbyte_in_buffer(FILE *f, void *tbyte)
-/* puts a target byte into the data buffer (not necessarily 8-bit bytes) */
+static void put_bytes_in_buffer(FILE *f, const uint8_t *p, size_t n)
+/* copies a span of bytes into the data buffer, writing full records */
+{
+  size_t len;
+
+  while (n > 0) {
+    len = RECSIZE - data_size;
+    if (len > n)
+      len = n;
+    memcpy(data + data_size, p, len);
+    data_size += len;
+    p += len;
+    n -= len;
+    if(data_size >= RECSIZE)
+      write_data_buffer(f, srecfmt);
+  }
+}
+
+static void fill_buffer(FILE *f, uint8_t byte, size_t n)
+/* puts n copies of a byte into the data buffer, writing full records */
+{
+  size_t len;
+
+  while (n > 0) {
+    len = RECSIZE - data_size;
+    if (len > n)
+      len = n;
+    memset(data + data_size, byte, len);
+    data_size += len;
+    n -= len;
+    if(data_size >= RECSIZE)
+      write_data_buffer(f, srecfmt);
+  }
+}
+
+static void put_tbytes_in_buffer(FILE *f, uint8_t *p, size_t n)
+/* puts n target bytes into the data buffer (not necessarily 8-bit bytes) */
 {
-  uint8_t *p = tbyte;
   int i;
 
-  if (output_bytes_le)
-    for (i = octetsperbyte; i > 0; put_byte_in_buffer(f, p[--i]));
-  else
-    for (i = 0; i < octetsperbyte; put_byte_in_buffer(f, p[i++]));
-  pc++;
+  if (output_bytes_le && octetsperbyte > 1) {
+    for (; n > 0; n--, p += octetsperbyte, pc++)
+      for (i = octetsperbyte; i > 0; put_byte_in_buffer(f, p[--i]));
+  }
+  else {
+    put_bytes_in_buffer(f, p, OCTETS(n));
+    pc += n;
+  }
+}
+
+static void put_pattern_in_buffer(FILE *f, uint8_t *pat, size_t patlen,
+                                  size_t cnt)
+/* puts cnt copies of a pattern of patlen target bytes into the buffer */
+{
+  size_t i, n = OCTETS(patlen);
+
+  for (i = 1; i < n && pat[i] == pat[0]; i++);
+  if (i >= n) {
+    /* all bytes of the pattern are equal, which includes zero-fill */
+    fill_buffer(f, pat[0], n * cnt);
+    pc += patlen * cnt;
+  }
+  else {
+    while (cnt--)
+      put_tbytes_in_buffer(f, pat, patlen);
+  }
 }
 
 static void addralign(FILE *f,atom *a,section *sec)
 /* modified from fwpcalign() in supp.c */
 {
   taddr n = balign(pc,a->align);
-  taddr patlen;
+  taddr patlen,k;
   uint8_t *pat;
-  int i;
 
   if (n == 0)
     return;
@@ -237,31 +298,19 @@ static void addralign(FILE *f,atom *a,section *sec)
     patlen = sec->padbytes;
   }
 
-  while (n % patlen) {
-    for (i = 0; i < octetsperbyte; i++)
-      put_byte_in_buffer(f, 0);
-    n--;
-    pc++;
+  if ((k = n % patlen) != 0) {
+    fill_buffer(f, 0, OCTETS(k));
+    pc += k;
+    n -= k;
   }
 
-  while (n >= patlen) {
-    for(i = 0; i < patlen; i++)
-      put_tbyte_in_buffer(f, pat + OCTETS(i));
-    n -= patlen;
-  }
-
-  while (n--) {
-    for (i = 0; i < octetsperbyte; i++)
-      put_byte_in_buffer(f, 0);
-    pc++;
-  }
+  put_pattern_in_buffer(f, pat, patlen, n / patlen);
 }
 
 static void write_output(FILE *f,section *sec,symbol *sym)
 {
   section *s;
   atom *p;
-  unsigned long long i, j;
 
   if (!sec)
     return;
@@ -282,7 +331,7 @@ static void write_output(FILE *f,section *sec,symbol *sym)
 
   for (s=sec; s!=NULL; s=s->next)	/* iterate through sections */
   {
-    for (data_size = 0; (*(s->name + data_size) != '\0') && (data_size < 32); data_size++)
+    for (data_size = 0; (*(s->name + data_size) != '\0') && (data_size < RECSIZE); data_size++)
     /* loop loads name of section into data and sets data_size properly */
     {
       data[data_size] = *(s->name + data_size);
@@ -295,18 +344,10 @@ static void write_output(FILE *f,section *sec,symbol *sym)
     {
       addralign(f,p,s);
       if(p->type == DATA)
-        for (i = 0; i < p->content.db->size; i++)
-          put_tbyte_in_buffer(f,p->content.db->data+OCTETS(i));
+        put_tbytes_in_buffer(f,p->content.db->data,p->content.db->size);
       else if (p->type == SPACE)
-      {
-        for (i = 0; i < p->content.sb->space; i++)
-        {
-          for (j = 0; j < p->content.sb->size; j++)
-          {
-            put_tbyte_in_buffer(f,p->content.sb->fill+OCTETS(j));
-          }
-        }
-      } 
+        put_pattern_in_buffer(f,p->content.sb->fill,p->content.sb->size,
+                              p->content.sb->space);
     }
     
     write_data_buffer(f, srecfmt); /* now that we're done iterating through atoms */
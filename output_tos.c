@@ -4,18 +4,16 @@
 #include "vasm.h"
 #include "output_tos.h"
 #if defined(OUTTOS) && defined(VASM_CPU_M68K)
-static char *copyright="vasm tos output module 2.4 (c) 2009-2016,2020-2024 Frank Wille";
+static char *copyright="vasm tos output module 2.5 (c) 2009-2016,2020-2024 Frank Wille";
 int tos_hisoft_dri = 1;
 int sozobonx_dri;
 
 static int tosflags,textbasedsyms;
-static int max_relocs_per_atom;
 static utaddr zfile_org;
 static section *sections[3];
 static utaddr secsize[3];
 static utaddr secoffs[3];
 static utaddr sdabase;
-static rlist **sorted_rlist;
 
 #define SECT_ALIGN 2  /* TOS sections have to be aligned to 16 bits */
 
@@ -50,7 +48,6 @@ static int tos_initwrite(section *sec,symbol *sym)
     }
   }
 
-  max_relocs_per_atom = 1;
   secoffs[S_TEXT] = zfile_org;
   secoffs[S_DATA] = secoffs[S_TEXT] + secsize[S_TEXT] +
                     balign(secsize[S_TEXT],SECT_ALIGN);
@@ -138,7 +135,6 @@ static void do_relocs(section *asec,taddr pc,atom *a)
    Very simple implementation which can only handle basic 68k relocs. */
 {
   rlist *rl = get_relocs(a);
-  int rcnt = 0;
   section *sec;
 
   while (rl) {
@@ -169,14 +165,10 @@ static void do_relocs(section *asec,taddr pc,atom *a)
         unsupp_reloc_error(a,rl);
         break;
     }
-    rcnt++;
     if (a->type == SPACE)
       break;  /* all SPACE relocs are identical, one is enough */
     rl = rl->next;
   }
-
-  if (rcnt > max_relocs_per_atom)
-    max_relocs_per_atom = rcnt;
 }
 
 
@@ -288,84 +280,43 @@ static void dri_symboltable(FILE *f,symbol *sym)
 }
 
 
-static int offscmp(const void *left,const void *right)
-{
-  rlist *rl1 = *(rlist **)left;
-  rlist *rl2 = *(rlist **)right;
-
-  return (int)((nreloc *)rl1->reloc)->byteoffset
-         - (int)((nreloc *)rl2->reloc)->byteoffset;
-}
-
-
-static int get_sorted_rlist(atom *a)
-{
-  rlist *rl = get_relocs(a);
-  int nrel = 0;
-
-  while (rl) {
-    if (nrel >= max_relocs_per_atom) {
-      max_relocs_per_atom++;
-      sorted_rlist = myrealloc(sorted_rlist,
-                               max_relocs_per_atom * sizeof(rlist **));
-    }
-    sorted_rlist[nrel++] = rl;
-    rl = rl->next;
-  }
-
-  if (nrel > 1)
-    qsort(sorted_rlist,nrel,sizeof(rlist *),offscmp);
-  return nrel;
-}
-
-
 static int tos_writerelocs(FILE *f,section *sec)
 {
   static utaddr lastoffs = ~0;
   int n = 0;
 
   if (sec) {
-    utaddr pc = secoffs[sec->idx];
-    atom *a;
-
-    for (a=sec->first; a; a=a->next) {
-      int nrel;
-
-      pc = pcalign(a,pc);
-
-      if (nrel = get_sorted_rlist(a)) {
-        utaddr newoffs;
-        int i;
-
-        /* write differences between reloc offsets */
-        for (i=0; i<nrel; i++) {
-          /* make sure to process 32-bit absolute relocations only! */
-          if (std_reloc(sorted_rlist[i])==REL_ABS
-              && ((nreloc *)sorted_rlist[i]->reloc)->size==32) {
-            newoffs = pc + ((nreloc *)sorted_rlist[i]->reloc)->byteoffset;
-
-            if (lastoffs != ~0) {
-              /* determine 8bit difference to next relocation */
-              taddr diff = newoffs - lastoffs;
-
-              if (diff < 0)
-                ierror(0);
-              while (diff > 254) {
-                fw8(f,1);
-                diff -= 254;
-              }
-              fw8(f,(uint8_t)diff);
-            }
-            else  /* initial entry is a 32-bit offset */
-              fw32(f,newoffs,1);
-
-            lastoffs = newoffs;
-            n++;
+    secreloc *rel;
+    size_t nrel,i;
+
+    /* write differences between reloc offsets, relative to text */
+    nrel = get_sec_relocs(sec,secoffs[sec->idx],&rel);
+    for (i=0; i<nrel; i++) {
+      /* make sure to process 32-bit absolute relocations only! */
+      if (std_reloc(rel[i].rl)==REL_ABS
+          && ((nreloc *)rel[i].rl->reloc)->size==32) {
+        utaddr newoffs = rel[i].offset;
+
+        if (lastoffs != ~0) {
+          /* determine 8bit difference to next relocation */
+          taddr diff = newoffs - lastoffs;
+
+          if (diff < 0)
+            ierror(0);
+          while (diff > 254) {
+            fw8(f,1);
+            diff -= 254;
           }
+          fw8(f,(uint8_t)diff);
         }
+        else  /* initial entry is a 32-bit offset */
+          fw32(f,newoffs,1);
+
+        lastoffs = newoffs;
+        n++;
       }
-      pc += atom_size(a,sec,pc);
     }
+    myfree(rel);
   }
 
   return n;
@@ -378,6 +329,8 @@ static void dri_writerelocs(FILE *f,section *sec,taddr sec_align)
 
   if (sec) {
     utaddr pc,npc;
+    secreloc *rel;
+    size_t nrel,i;
     atom *a;
 
     /* The DRI reloc table has the same size as the section itself,
@@ -385,18 +338,18 @@ static void dri_writerelocs(FILE *f,section *sec,taddr sec_align)
        are indicated by a reloc-type in the least significant three
        bits (0-7). The remaining 13 bits are used as an optional index
        into the symbol table. */
-    for (npc=0,a=sec->first; a; a=a->next) {
+    nrel = get_sec_relocs(sec,0,&rel);
+    for (i=0,npc=0,a=sec->first; a; a=a->next) {
       size_t offs = 0;
-      int nrel,i,rtype;
+      int rtype;
 
       pc = fwpcalign(f,a,sec,npc);
       npc = pc + atom_size(a,sec,pc);
-      nrel = get_sorted_rlist(a);
 
-      for (i=0; i<nrel; i++) {
-        if ((rtype = std_reloc(sorted_rlist[i])) >= 0) {
-          nreloc *r = (nreloc *)sorted_rlist[i]->reloc;
-          size_t roffs = r->byteoffset;
+      for (; i<nrel && rel[i].a==a; i++) {
+        if ((rtype = std_reloc(rel[i].rl)) >= 0) {
+          nreloc *r = (nreloc *)rel[i].rl->reloc;
+          size_t roffs = rel[i].offset - pc;
           symbol *sym = r->sym;
           uint16_t t = 0;
 
@@ -440,14 +393,15 @@ static void dri_writerelocs(FILE *f,section *sec,taddr sec_align)
             offs += 2;
           }
           else
-            unsupp_reloc_error(a,sorted_rlist[i]);
+            unsupp_reloc_error(a,rel[i].rl);
         }
         else
-          unsupp_reloc_error(a,sorted_rlist[i]);
+          unsupp_reloc_error(a,rel[i].rl);
       }
       fwspace(f,(size_t)(npc-pc)-offs);
     }
     fwalign(f,npc,sec_align);
+    myfree(rel);
   }
 }
 
@@ -476,8 +430,6 @@ static void write_output(FILE *f,section *sec,symbol *sym)
       dri_symboltable(f,sym);
   }
 
-  sorted_rlist = mymalloc(max_relocs_per_atom*sizeof(rlist **));
-
   if (exec_out) {
     if (!zfile_org) {
       int nrelocs = tos_writerelocs(f,sections[S_TEXT]);
@@ -492,8 +444,6 @@ static void write_output(FILE *f,section *sec,symbol *sym)
     dri_writerelocs(f,sections[S_TEXT],SECT_ALIGN);
     dri_writerelocs(f,sections[S_DATA],SECT_ALIGN);
   }
-
-  myfree(sorted_rlist);
 }
 
 
@@ -4,12 +4,11 @@
 #include "vasm.h"
 #include "output_xfile.h"
 #if defined(OUTXFIL) && defined(VASM_CPU_M68K)
-static char *copyright="vasm xfile output module 0.4 (c) 2018,2020,2021,2024 Frank Wille";
+static char *copyright="vasm xfile output module 0.5 (c) 2018,2020,2021,2024 Frank Wille";
 
 static char *exec_symname;
 static uint32_t exec_offs;
 static uint8_t loadmode;
-static int max_relocs_per_atom;
 static section *sections[3];
 static utaddr secsize[3];
 static utaddr secoffs[3];
@@ -112,7 +111,6 @@ static void do_relocs(section *asec,taddr pc,atom *a)
    Very simple implementation which can only handle basic 68k relocs. */
 {
   rlist *rl = get_relocs(a);
-  int rcnt = 0;
   section *sec;
 
   while (rl) {
@@ -131,7 +129,6 @@ static void do_relocs(section *asec,taddr pc,atom *a)
                      (pc + ((nreloc *)rl->reloc)->byteoffset),1);
         break;
       case REL_ABS:
-        rcnt++;
         checkdefined(rl,asec,pc,a);
         sec = ((nreloc *)rl->reloc)->sym->sec;
         if (!patch_nreloc(a,rl,
@@ -148,9 +145,6 @@ static void do_relocs(section *asec,taddr pc,atom *a)
       break;  /* all SPACE relocs are identical, one is enough */
     rl = rl->next;
   }
-
-  if (rcnt > max_relocs_per_atom)
-    max_relocs_per_atom = rcnt;
 }
 
 
@@ -216,69 +210,42 @@ static size_t xfile_symboltable(FILE *f,symbol *sym)
 }
 
 
-static int offscmp(const void *offs1,const void *offs2)
-{
-  return *(int *)offs1 - *(int *)offs2;
-}
-
-
 static size_t xfile_writerelocs(FILE *f,section *sec)
 {
-  int *sortoffs = mymalloc(max_relocs_per_atom*sizeof(int));
   size_t sz = 0;
 
   if (sec) {
-    utaddr pc = secoffs[sec->idx];
-    utaddr npc;
-    atom *a;
-    rlist *rl;
-
-    for (a=sec->first; a; a=a->next) {
-      int nrel = 0;
-
-      npc = pcalign(a,pc);
-
-      rl = get_relocs(a);
-      while (rl) {
-        if (std_reloc(rl)==REL_ABS && ((nreloc *)rl->reloc)->size==32)
-          sortoffs[nrel++] = ((nreloc *)rl->reloc)->byteoffset;
-        rl = rl->next;
-      }
-
-      if (nrel) {
-        int i;
-
-        /* first sort the atom's relocs */
-        if (nrel > 1)
-          qsort(sortoffs,nrel,sizeof(int),offscmp);
-
-        /* write distances in bytes between them */
-        for (i=0; i<nrel; i++) {
-          /* determine 16bit distance to next relocation */
-          utaddr newoffs = npc + sortoffs[i];
-          taddr diff = newoffs - lastoffs;
-
-          if (diff < 0) {
-            ierror(0);
-          }
-          else if (diff > 0xffff) {
-            /* write a large distance >= 64K */
-            fw16(f,1,1);
-            fw32(f,diff,1);
-            sz += 6;
-          }
-          else {
-            fw16(f,diff,1);
-            sz += 2;
-          }
-          lastoffs = newoffs;
+    secreloc *rel;
+    size_t nrel,i;
+
+    /* write distances in bytes between the relocs */
+    nrel = get_sec_relocs(sec,secoffs[sec->idx],&rel);
+    for (i=0; i<nrel; i++) {
+      if (std_reloc(rel[i].rl)==REL_ABS
+          && ((nreloc *)rel[i].rl->reloc)->size==32) {
+        /* determine 16bit distance to next relocation */
+        utaddr newoffs = rel[i].offset;
+        taddr diff = newoffs - lastoffs;
+
+        if (diff < 0) {
+          ierror(0);
+        }
+        else if (diff > 0xffff) {
+          /* write a large distance >= 64K */
+          fw16(f,1,1);
+          fw32(f,diff,1);
+          sz += 6;
         }
+        else {
+          fw16(f,diff,1);
+          sz += 2;
+        }
+        lastoffs = newoffs;
       }
-      pc = npc + atom_size(a,sec,npc);
     }
+    myfree(rel);
   }
 
-  myfree(sortoffs);
   return sz;
 }
 
@@ -288,7 +255,6 @@ static void write_output(FILE *f,section *sec,symbol *sym)
   size_t relocsz,syminfsz;
 
   xfile_initwrite(sec,sym);
-  max_relocs_per_atom = 1;
 
   xfile_header(f,secsize[S_TEXT],secsize[S_DATA],secsize[S_BSS]);
   xfile_writesection(f,sections[S_TEXT],SECT_ALIGN);
@@ -529,15 +529,11 @@ static size_t dirlist_minlen(struct namelen *list)
 /* add a skipped macro/repeat line to the listing */
 static void list_skipped_line(char *p)
 {
-  listing *new = new_listing(cur_src,cur_src->line);
   size_t len = p - cur_src->srcptr;
 
   if (len>0 && (*(p-1)=='\n' || *(p-1)=='\r'))
     len--;
-  if (len >= MAXLISTSRC)
-    len = MAXLISTSRC - 1;
-  memcpy(new->txt,cur_src->srcptr,len);
-  new->txt[len] = '\0';
+  new_listing(cur_src,cur_src->line,cur_src->srcptr,len);
 }
 
 
@@ -1356,7 +1352,7 @@ char *read_next_line(void)
     else if (nc == 0) {
       /* copy next character */
       if (*s == '\r') {
-        if ((s>cur_src->srcptr && *(s-1)=='\n') ||
+        if ((s>cur_src->text && *(s-1)=='\n') ||
             (s<(srcend-1) && *(s+1)=='\n')) {
           /* ignore \r in \r\n and \n\r combinations */
           s++;
@@ -1401,12 +1397,8 @@ char *read_next_line(void)
   cur_src->srcptr = s;
   s = cur_src->linebuf+1;
 
-  if (listena && !skip_listing) {
-    listing *new = new_listing(cur_src,cur_src->line);
-
-    strncpy(new->txt,s,MAXLISTSRC);
-    new->txt[MAXLISTSRC-1] = '\0';
-  }
+  if (listena && !skip_listing)
+    new_listing(cur_src,cur_src->line,s,strlen(s));
 
   /*
     At this point in the code, we will have a while loop that checks for the presence of functions in the line buffer (calls a function that returns true or false to do this).
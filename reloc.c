@@ -179,6 +179,67 @@ rlist *get_relocs(atom *a)
 }
 
 
+size_t get_sec_relocs(section *sec,utaddr pc,secreloc **list)
+/* Collects the relocations of all atoms in a section, which starts at pc,
+   into a new array sorted by address. Returns the number of relocations. */
+{
+  secreloc *r,*tmp,*swp;
+  size_t cnt[256];
+  size_t n,i,pos,c;
+  utaddr diff;
+  unsigned shift;
+  rlist *rl;
+  atom *a;
+
+  for (n=0,a=sec->first; a; a=a->next) {
+    for (rl=get_relocs(a); rl; rl=rl->next)
+      n++;
+  }
+  r = mymalloc((n?n:1)*sizeof(secreloc));
+
+  for (i=0,a=sec->first; a; a=a->next) {
+    pc = pcalign(a,pc);
+    for (rl=get_relocs(a); rl; rl=rl->next,i++) {
+      r[i].offset = pc + (is_nreloc(rl)?((nreloc *)rl->reloc)->byteoffset:0);
+      r[i].a = a;
+      r[i].rl = rl;
+    }
+    pc += atom_size(a,sec,pc);
+  }
+
+  /* Usually the atoms' relocs are in order already. Otherwise do a stable
+     LSD radix sort over all address bytes which are not identical. */
+  for (i=1; i<n && r[i-1].offset<=r[i].offset; i++);
+  if (i < n) {
+    tmp = mymalloc(n*sizeof(secreloc));
+    for (diff=0,i=1; i<n; i++)
+      diff |= r[i].offset ^ r[0].offset;
+    for (shift=0; shift<sizeof(utaddr)*CHAR_BIT && (diff>>shift)!=0;
+         shift+=8) {
+      if (((diff>>shift) & 0xff) == 0)
+        continue;
+      memset(cnt,0,sizeof(cnt));
+      for (i=0; i<n; i++)
+        cnt[(r[i].offset>>shift) & 0xff]++;
+      for (pos=0,i=0; i<256; i++) {
+        c = cnt[i];
+        cnt[i] = pos;
+        pos += c;
+      }
+      for (i=0; i<n; i++)
+        tmp[cnt[(r[i].offset>>shift) & 0xff]++] = r[i];
+      swp = r;
+      r = tmp;
+      tmp = swp;
+    }
+    myfree(tmp);
+  }
+
+  *list = r;
+  return n;
+}
+
+
 static void *get_nreloc_ptr(atom *a,nreloc *nrel)
 {
   if (a->type == DATA)
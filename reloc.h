@@ -60,6 +60,13 @@ struct rlist {
   int type;
 };
 
+/* relocation with its position in the section, see get_sec_relocs() */
+typedef struct secreloc {
+  utaddr offset;      /* address of the atom plus the reloc's byteoffset */
+  atom *a;
+  rlist *rl;
+} secreloc;
+
 #define DEFMASK (~(utaddr)0)
 #define MAKEMASK(x) (((x)>=sizeof(unsigned long long)*CHAR_BIT)?(~(unsigned long long)0):((((unsigned long long)1)<<(x))-1u))
 
@@ -87,6 +94,7 @@ void unsupp_reloc_error(atom *,rlist *);
 void print_nreloc(FILE *,nreloc *,int);
 void print_reloc(FILE *,rlist *);
 rlist *get_relocs(atom *);
+size_t get_sec_relocs(section *,utaddr,secreloc **);
 int patch_nreloc(atom *,rlist *,taddr,int);
 
 #endif
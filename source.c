@@ -4,6 +4,7 @@
 #include "vasm.h"
 #include "osdep.h"
 #include "dwarf.h"
+#include "compress.h"
 
 #ifdef _WIN32
 #define SRCREADINC 0x7000
@@ -174,6 +175,8 @@ static struct source_file *read_source_file(FILE *f)
     srcfile->incpath = NULL;
     srcfile->text = text;
     srcfile->size = size;
+    srcfile->lineoffs = NULL;
+    srcfile->numlines = 0;
     srcfile->index = ++srcfileidx;
   }
   else {
@@ -254,6 +257,91 @@ void end_source(source *s)
 }
 
 
+static void index_lines(struct source_file *sf)
+/* build the table of line offsets for a source file */
+{
+  char *text = sf->text;
+  char *end = text + sf->size;
+  size_t n = 0;
+  char *p;
+  int cr = memchr(text,'\r',sf->size) != NULL;
+
+  /* reserve an entry for every line terminator, plus one */
+  for (p=text; p<end && (p=memchr(p,'\n',end-p))!=NULL; p++)
+    n++;
+  if (cr) {
+    for (p=text; p<end && (p=memchr(p,'\r',end-p))!=NULL; p++)
+      n++;
+  }
+  sf->lineoffs = mymalloc((n+1) * sizeof(size_t));
+  sf->lineoffs[0] = 0;
+  n = 1;
+
+  if (!cr) {
+    /* the common case: just search for LF */
+    for (p=text; p<end && (p=memchr(p,'\n',end-p))!=NULL; )
+      sf->lineoffs[n++] = ++p - text;
+  }
+  else {
+    /* any combination of CR and LF terminates a line */
+    for (p=text; p<end; ) {
+      char c = *p++;
+
+      if (c=='\n' || c=='\r') {
+        if (p<end && *p==((c=='\n') ? '\r' : '\n'))
+          p++;
+        sf->lineoffs[n++] = p - text;
+      }
+    }
+  }
+  sf->numlines = (int)n - 1;  /* text is always terminated by a newline */
+}
+
+
+char *source_line(source *src,int l,size_t *len)
+/* Return a pointer to line l (starting with 1) of a source text and
+   set the length of that line, excluding the line terminator.
+   Returns NULL when the line doesn't exist. */
+{
+  struct source_file *sf = src->srcfile;
+  char *p,*q,*e;
+
+  if (l < 1)
+    return NULL;
+
+  if (sf!=NULL && src->text==sf->text) {
+    /* real source file: direct access through the line index */
+    if (sf->lineoffs == NULL)
+      index_lines(sf);
+    if (l > sf->numlines)
+      return NULL;
+    p = sf->text + sf->lineoffs[l-1];
+    q = sf->text + sf->lineoffs[l];
+    while (q>p && (*(q-1)=='\n' || *(q-1)=='\r'))
+      q--;
+    *len = q - p;
+    return p;
+  }
+
+  /* macros and repetitions are short, so just search the line */
+  p = src->text;
+  e = p + src->size;
+  while (--l > 0) {
+    while (p<e && *p!='\n' && *p!='\r')
+      p++;
+    if (p >= e)
+      return NULL;
+    if (++p<e && *p==((*(p-1)=='\n') ? '\r' : '\n'))
+      p++;
+  }
+  for (q=p; q<e && *q!='\n' && *q!='\r'; q++);
+  if (q >= e && p >= e)
+    return NULL;
+  *len = q - p;
+  return p;
+}
+
+
 source *stdin_source(void)
 {
   struct source_file *srcfile;
@@ -313,8 +401,9 @@ source *include_source(char *inc_name)
 }
 
 
-void include_binary_file(char *inname,size_t nbskip,size_t nbkeep)
-/* Locate a binary file and convert into a data atom. */
+void include_binary_file(char *inname,size_t nbskip,size_t nbkeep,int codec)
+/* Locate a binary file and convert into a data atom. The data may be
+   compressed with one of the codecs from compress.c. */
 {
   char *filename = convert_path(inname);
   FILE *f;
@@ -322,7 +411,8 @@ void include_binary_file(char *inname,size_t nbskip,size_t nbkeep)
   if (f = locate_file(filename,"rb",NULL,1)) {
     size_t size = filesize(f);
 
-    if (size > 0) {
+    /* an empty file still produces a compressed end-of-stream marker */
+    if (size>0 || codec!=CODEC_NONE) {
       if (nbskip <= size) {
         dblock *db = new_dblock();
 
@@ -331,39 +421,56 @@ void include_binary_file(char *inname,size_t nbskip,size_t nbkeep)
         else
           size = nbkeep;
 
-        db->size = (size + octetsperbyte - 1) / octetsperbyte;
-        db->data = mymalloc(OCTETS(db->size));
-
         if (nbskip > 0)
           fseek(f,nbskip,SEEK_SET);
 
-        if (octetsperbyte>1 && input_bytes_le) {
-          /* we have to swap all target-bytes to the internal BE format */
-          uint8_t *p;
-          size_t i;
-          int j,b;
-
-          for (i=0,p=db->data; i<db->size; i++,p+=octetsperbyte) {
-            for (j=octetsperbyte-1; j>=0; j--) {
-              b = fgetc(f);
-              if (b == EOF) {
-                if (feof(f))
-                  p[j] = 0;
+        if (codec != CODEC_NONE) {
+          /* compress the file contents, which are target-bytes in
+             internal format afterwards */
+          uint8_t *raw = mymalloc(size?size:1);
+
+          if (fread(raw,1,size,f) != size)
+            general_error(29,filename);  /* read error */
+          db->data = compress_data(codec,raw,size,&size);
+          myfree(raw);
+          db->size = (size + octetsperbyte - 1) / octetsperbyte;
+          if (OCTETS(db->size) > size) {
+            db->data = myrealloc(db->data,OCTETS(db->size));
+            memset(db->data+size,0,OCTETS(db->size)-size);
+          }
+        }
+        else {
+          db->size = (size + octetsperbyte - 1) / octetsperbyte;
+          db->data = mymalloc(OCTETS(db->size));
+
+          if (octetsperbyte>1 && input_bytes_le) {
+            /* we have to swap all target-bytes to the internal BE format */
+            uint8_t *p;
+            size_t i;
+            int j,b;
+
+            for (i=0,p=db->data; i<db->size; i++,p+=octetsperbyte) {
+              for (j=octetsperbyte-1; j>=0; j--) {
+                b = fgetc(f);
+                if (b == EOF) {
+                  if (feof(f))
+                    p[j] = 0;
+                  else
+                    general_error(29,filename);  /* read error */
+                }
                 else
-                  general_error(29,filename);  /* read error */
+                  p[j] = (uint8_t)b;
               }
-              else
-                p[j] = (uint8_t)b;
             }
           }
-        }
-        else {
-          if (fread(db->data,1,size,f) == size) {
-            if (OCTETS(db->size) > size)
-              memset(db->data+size,0,OCTETS(db->size)-size);
+          else {
+            if (fread(db->data,1,size,f) == size) {
+              if (OCTETS(db->size) > size)
+                memset(db->data+size,0,OCTETS(db->size)-size);
+            }
+            else
+              general_error(29,filename);  /* read error */
           }
-          else
-            general_error(29,filename);  /* read error */
         }
 
         add_atom(0,new_data_atom(db,1));
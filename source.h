@@ -19,6 +19,8 @@ struct source_file {
   char *name;
   char *text;
   size_t size;
+  size_t *lineoffs;  /* start of each line in text, built on demand */
+  int numlines;
 };
 
 /* source texts (main file, include files or macros) */
@@ -80,9 +82,10 @@ extern int ignore_multinc,relpath,nocompdir,depend,depend_all;
 void write_depends(FILE *);
 source *new_source(char *,struct source_file *,char *,size_t);
 void end_source(source *);
+char *source_line(source *,int,size_t *);
 source *stdin_source(void);
 source *include_source(char *);
-void include_binary_file(char *,size_t,size_t);
+void include_binary_file(char *,size_t,size_t,int);
 void source_debug_init(int,void *);
 struct include_path *new_include_path(char *);
 FILE *locate_file(char *,char *,struct include_path **,int);
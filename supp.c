@@ -686,6 +686,161 @@ char *get_str_arg(const char *s)
 }
 
 
+strpool *new_strpool(size_t hashsize,uint32_t base,int tailmerge)
+/* Create a string pool. String table offsets start at 'base'. Index 0 is
+   reserved for the empty string, which always has offset 0. */
+{
+  strpool *sp = mycalloc(sizeof(strpool));
+
+  sp->hashtab = mycalloc(hashsize*sizeof(struct strpoolent *));
+  sp->hashsize = hashsize;
+  sp->max = 64;
+  sp->ents = mymalloc(sp->max*sizeof(struct strpoolent));
+  sp->ents[0].hashchain = NULL;
+  sp->ents[0].str = emptystr;
+  sp->ents[0].len = 0;
+  sp->ents[0].offset = 0;
+  sp->ents[0].owner = 0;
+  sp->cnt = 1;
+  sp->base = base;
+  sp->tailmerge = tailmerge;
+  return sp;
+}
+
+
+unsigned strpool_add(strpool *sp,const char *s)
+/* add a string (once), return its index for strpool_offset() */
+{
+  struct strpoolent *e;
+  size_t h;
+
+  if (s==NULL || *s=='\0')
+    return 0;
+
+  h = hashcode(s) % sp->hashsize;
+  for (e=sp->hashtab[h]; e; e=e->hashchain) {
+    if (!strcmp(s,e->str))
+      return (unsigned)(e - sp->ents);
+  }
+
+  if (sp->cnt >= sp->max) {
+    struct strpoolent *old = sp->ents;
+    unsigned i;
+
+    sp->max <<= 1;
+    sp->ents = myrealloc(sp->ents,sp->max*sizeof(struct strpoolent));
+    if (sp->ents != old) {
+      /* rebuild the hash chains */
+      memset(sp->hashtab,0,sp->hashsize*sizeof(struct strpoolent *));
+      for (i=1; i<sp->cnt; i++) {
+        e = &sp->ents[i];
+        h = hashcode(e->str) % sp->hashsize;
+        e->hashchain = sp->hashtab[h];
+        sp->hashtab[h] = e;
+      }
+      h = hashcode(s) % sp->hashsize;
+    }
+  }
+  e = &sp->ents[sp->cnt];
+  e->str = s;
+  e->len = strlen(s);
+  e->offset = 0;
+  e->owner = sp->cnt;
+  e->hashchain = sp->hashtab[h];
+  sp->hashtab[h] = e;
+  return sp->cnt++;
+}
+
+
+static const struct strpoolent *revcmp_ents;
+
+static int revcmp(const void *a,const void *b)
+/* compare two pool strings backwards, a suffix sorts before the longer one */
+{
+  const struct strpoolent *e1 = &revcmp_ents[*(const unsigned *)a];
+  const struct strpoolent *e2 = &revcmp_ents[*(const unsigned *)b];
+  const unsigned char *p1 = (const unsigned char *)e1->str + e1->len;
+  const unsigned char *p2 = (const unsigned char *)e2->str + e2->len;
+
+  while (p1>(const unsigned char *)e1->str &&
+         p2>(const unsigned char *)e2->str) {
+    p1--; p2--;
+    if (*p1 != *p2)
+      return *p1<*p2 ? -1 : 1;
+  }
+  return (p1>(const unsigned char *)e1->str) -
+         (p2>(const unsigned char *)e2->str);
+}
+
+
+uint32_t strpool_finish(strpool *sp)
+/* Assign the final offsets and return the string table size, including
+   the base. With tail merging, a string which is the suffix of another one
+   points into the longer string. */
+{
+  struct strpoolent *e;
+  uint32_t off;
+  unsigned i;
+
+  if (sp->tailmerge && sp->cnt>2) {
+    unsigned *order = mymalloc((sp->cnt-1)*sizeof(unsigned));
+
+    for (i=1; i<sp->cnt; i++)
+      order[i-1] = i;
+    revcmp_ents = sp->ents;
+    qsort(order,sp->cnt-1,sizeof(unsigned),revcmp);
+
+    /* sorted by reversed string, a string can only be the tail of its
+       successor, which is already attached to the longest one of its chain */
+    for (i=sp->cnt-2; i>0; i--) {
+      struct strpoolent *s = &sp->ents[order[i-1]];
+      struct strpoolent *l = &sp->ents[order[i]];
+
+      if (s->len < l->len && !memcmp(s->str,l->str+(l->len-s->len),s->len))
+        s->owner = l->owner;
+    }
+    myfree(order);
+  }
+
+  /* strings keep the order in which they were added */
+  off = sp->base;
+  for (i=1,e=&sp->ents[1]; i<sp->cnt; i++,e++) {
+    if (e->owner == i) {
+      e->offset = off;
+      off += e->len + 1;
+    }
+  }
+  for (i=1,e=&sp->ents[1]; i<sp->cnt; i++,e++) {
+    if (e->owner != i) {
+      struct strpoolent *o = &sp->ents[e->owner];
+
+      e->offset = o->offset + (uint32_t)(o->len - e->len);
+    }
+  }
+  return sp->size = off;
+}
+
+
+uint32_t strpool_offset(strpool *sp,unsigned idx)
+{
+  return sp->ents[idx].offset;
+}
+
+
+void strpool_write(FILE *f,strpool *sp)
+/* write all strings after strpool_finish(), excluding the base */
+{
+  struct strpoolent *e;
+  unsigned i;
+
+  for (i=1,e=&sp->ents[1]; i<sp->cnt; i++,e++) {
+    if (e->owner == i)
+      fwdata(f,e->str,e->len+1);
+  }
+}
+
+
+
 taddr balign(taddr addr,taddr a)
 /* return number of bytes required to achieve alignment */
 {
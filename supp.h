@@ -79,6 +79,30 @@ int str_is_graph(const char *);
 const char *trim(const char *);
 char *get_str_arg(const char *);
 
+/* string pool for output string tables */
+typedef struct strpool {
+  struct strpoolent **hashtab;
+  struct strpoolent *ents;
+  size_t hashsize;
+  unsigned cnt,max;
+  uint32_t base,size;
+  int tailmerge;
+} strpool;
+
+struct strpoolent {
+  struct strpoolent *hashchain;
+  const char *str;
+  size_t len;
+  uint32_t offset;
+  unsigned owner;  /* entry whose tail we are, or our own index */
+};
+
+strpool *new_strpool(size_t,uint32_t,int);
+unsigned strpool_add(strpool *,const char *);
+uint32_t strpool_finish(strpool *);
+uint32_t strpool_offset(strpool *,unsigned);
+void strpool_write(FILE *,strpool *);
+
 taddr balign(taddr,taddr);
 taddr palign(taddr,int);
 taddr pcalign(atom *,taddr);
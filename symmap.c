@@ -0,0 +1,205 @@
+/* symmap.c - binary symbol map for address lookups */
+/* (c) in 2026 by agent@local */
+
+#include "vasm.h"
+#include "symmap.h"
+
+#define SMHTABSIZE 0x4000
+
+struct smline {
+  section *sec;
+  utaddr pc;
+  struct source_file *src;
+  int line;
+  size_t seq;
+};
+
+static struct smline *lines;
+static size_t nlines,maxlines;
+
+
+void symmap_line(section *sec,taddr pc,struct source_file *src,int line)
+/* record the address of an instruction's source line */
+{
+  struct smline *l;
+
+  if (nlines > 0) {
+    l = &lines[nlines-1];
+    if (l->sec==sec && l->src==src && l->line==line)
+      return;  /* same line continues */
+  }
+  if (nlines >= maxlines) {
+    maxlines = maxlines ? maxlines<<1 : 1024;
+    lines = myrealloc(lines,maxlines*sizeof(struct smline));
+  }
+  l = &lines[nlines];
+  l->sec = sec;
+  l->pc = (utaddr)pc;
+  l->src = src;
+  l->line = line;
+  l->seq = nlines++;
+}
+
+
+static void fw64(FILE *f,uint64_t v)
+{
+  fw32(f,(uint32_t)v,0);
+  fw32(f,(uint32_t)(v>>32),0);
+}
+
+
+static int symcmp(const void *p1,const void *p2)
+{
+  symbol *s1 = *(symbol **)p1;
+  symbol *s2 = *(symbol **)p2;
+
+  if ((utaddr)s1->pc != (utaddr)s2->pc)
+    return (utaddr)s1->pc < (utaddr)s2->pc ? -1 : 1;
+  if (s1->sec->idx != s2->sec->idx)
+    return s1->sec->idx < s2->sec->idx ? -1 : 1;
+  return strcmp(s1->name,s2->name);
+}
+
+
+static int linecmp(const void *p1,const void *p2)
+{
+  const struct smline *l1 = p1;
+  const struct smline *l2 = p2;
+
+  if (l1->pc != l2->pc)
+    return l1->pc < l2->pc ? -1 : 1;
+  if (l1->sec->idx != l2->sec->idx)
+    return l1->sec->idx < l2->sec->idx ? -1 : 1;
+  return l1->seq < l2->seq ? -1 : (l1->seq > l2->seq);
+}
+
+
+void write_symmap(const char *name,section *first_sec,symbol *first_sym)
+{
+  unsigned long *saveidx;
+  unsigned *secname,*symname,*filename,*fileid;
+  int maxfile = 0;
+  size_t nsecs,nsyms,nfiles,i;
+  uint32_t off;
+  symbol **syms,*sym;
+  strpool *sp;
+  section *sec;
+  FILE *f;
+
+  if (!(f = fopen(name,"wb"))) {
+    general_error(13,name);
+    return;
+  }
+  sp = new_strpool(SMHTABSIZE,1,1);
+
+  /* number the sections, the output module may use idx later */
+  for (nsecs=0,sec=first_sec; sec; sec=sec->next)
+    nsecs++;
+  saveidx = mymalloc((nsecs+1)*sizeof(unsigned long));
+  secname = mymalloc((nsecs+1)*sizeof(unsigned));
+  for (i=0,sec=first_sec; sec; sec=sec->next,i++) {
+    saveidx[i] = sec->idx;
+    sec->idx = i;
+    secname[i] = strpool_add(sp,sec->name);
+  }
+
+  /* collect labels, sorted by address */
+  for (nsyms=0,sym=first_sym; sym; sym=sym->next) {
+    if (sym->type==LABSYM && !(sym->flags&VASMINTERN) && *sym->name!=' ')
+      nsyms++;
+  }
+  syms = mymalloc((nsyms+1)*sizeof(symbol *));
+  for (i=0,sym=first_sym; sym; sym=sym->next) {
+    if (sym->type==LABSYM && !(sym->flags&VASMINTERN) && *sym->name!=' ')
+      syms[i++] = sym;
+  }
+  qsort(syms,nsyms,sizeof(symbol *),symcmp);
+  symname = mymalloc((nsyms+1)*sizeof(unsigned));
+  for (i=0; i<nsyms; i++)
+    symname[i] = strpool_add(sp,syms[i]->name);
+
+  /* source files referenced by the line table, in order of appearance */
+  for (i=0; i<nlines; i++) {
+    if (lines[i].src->index > maxfile)
+      maxfile = lines[i].src->index;
+  }
+  fileid = mymalloc((maxfile+1)*sizeof(unsigned));
+  filename = mymalloc((maxfile+1)*sizeof(unsigned));
+  memset(fileid,0xff,(maxfile+1)*sizeof(unsigned));
+  for (nfiles=0,i=0; i<nlines; i++) {
+    if (fileid[lines[i].src->index] == ~0U) {
+      fileid[lines[i].src->index] = (unsigned)nfiles;
+      filename[nfiles++] = strpool_add(sp,lines[i].src->name);
+    }
+  }
+  qsort(lines,nlines,sizeof(struct smline),linecmp);
+  strpool_finish(sp);
+
+  /* header */
+  fwdata(f,SYMMAP_MAGIC,4);
+  fw32(f,SYMMAP_VERSION,0);
+  fw32(f,bytespertaddr,0);
+  fw32(f,0,0);
+  off = sizeof(struct symmap_header);
+  fw32(f,off,0);
+  fw32(f,nsecs,0);
+  off += nsecs * sizeof(struct symmap_section);
+  fw32(f,off,0);
+  fw32(f,nsyms,0);
+  off += nsyms * sizeof(struct symmap_symbol);
+  fw32(f,off,0);
+  fw32(f,nfiles,0);
+  off += nfiles * sizeof(uint32_t);
+  off += balign(off,8);
+  fw32(f,off,0);
+  fw32(f,nlines,0);
+  off += nlines * sizeof(struct symmap_line);
+  fw32(f,off,0);
+  fw32(f,sp->size,0);
+  fw32(f,0,0);
+  fw32(f,0,0);
+
+  for (i=0,sec=first_sec; sec; sec=sec->next,i++) {
+    fw64(f,(utaddr)sec->org);
+    fw64(f,get_sec_size(sec));
+    fw32(f,strpool_offset(sp,secname[i]),0);
+    fw32(f,(sec->flags&ABSOLUTE)?SMSEC_ABSOLUTE:0,0);
+  }
+
+  for (i=0; i<nsyms; i++) {
+    sym = syms[i];
+    fw64(f,(utaddr)sym->pc);
+    fw64(f,(utaddr)get_sym_size(sym));
+    fw32(f,strpool_offset(sp,symname[i]),0);
+    fw16(f,(uint16_t)sym->sec->idx,0);
+    fw8(f,(sym->flags&WEAK) ? SMBIND_WEAK :
+          ((sym->flags&EXPORT) ? SMBIND_GLOBAL : SMBIND_LOCAL));
+    fw8(f,TYPE(sym));
+  }
+
+  for (i=0; i<nfiles; i++)
+    fw32(f,strpool_offset(sp,filename[i]),0);
+  fwalign(f,sizeof(struct symmap_header)+
+            nsecs*sizeof(struct symmap_section)+
+            nsyms*sizeof(struct symmap_symbol)+nfiles*sizeof(uint32_t),8);
+
+  for (i=0; i<nlines; i++) {
+    fw64(f,lines[i].pc);
+    fw32(f,lines[i].line,0);
+    fw16(f,(uint16_t)fileid[lines[i].src->index],0);
+    fw16(f,(uint16_t)lines[i].sec->idx,0);
+  }
+
+  fw8(f,0);  /* "" */
+  strpool_write(f,sp);
+  fclose(f);
+
+  for (i=0,sec=first_sec; sec; sec=sec->next,i++)
+    sec->idx = saveidx[i];
+  myfree(filename);
+  myfree(fileid);
+  myfree(symname);
+  myfree(syms);
+  myfree(secname);
+  myfree(saveidx);
+}
@@ -0,0 +1,59 @@
+/* symmap.h - binary symbol map for address lookups */
+/* (c) in 2026 by agent@local */
+
+#ifndef SYMMAP_H
+#define SYMMAP_H
+
+/* All fields are little-endian and naturally aligned, so the file can
+   be mapped into memory and accessed directly. Symbols and lines are
+   sorted by address. Names are offsets into the string table. */
+
+#define SYMMAP_MAGIC   "VSYM"
+#define SYMMAP_VERSION 1
+
+struct symmap_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t addrbytes;       /* bytes per target address */
+  uint32_t reserved;
+  uint32_t secoff,nsecs;    /* struct symmap_section */
+  uint32_t symoff,nsyms;    /* struct symmap_symbol */
+  uint32_t fileoff,nfiles;  /* uint32_t name */
+  uint32_t lineoff,nlines;  /* struct symmap_line */
+  uint32_t stroff,strsize;  /* NUL-terminated strings, "" at offset 0 */
+  uint32_t pad[2];
+};                          /* 64 bytes */
+
+struct symmap_section {
+  uint64_t start;
+  uint64_t size;
+  uint32_t name;
+  uint32_t flags;           /* SMSEC_xxx */
+};                          /* 24 bytes */
+
+#define SMSEC_ABSOLUTE 1    /* addresses are absolute, else offsets */
+
+struct symmap_symbol {
+  uint64_t addr;
+  uint64_t size;
+  uint32_t name;
+  uint16_t section;         /* index into the section table */
+  uint8_t bind;             /* SMBIND_xxx */
+  uint8_t type;             /* TYPE_xxx from symbol.h */
+};                          /* 24 bytes */
+
+#define SMBIND_LOCAL  0
+#define SMBIND_GLOBAL 1
+#define SMBIND_WEAK   2
+
+struct symmap_line {
+  uint64_t addr;            /* first address of the source line's code */
+  uint32_t line;
+  uint16_t file;            /* index into the file table */
+  uint16_t section;
+};                          /* 16 bytes */
+
+void symmap_line(section *,taddr,struct source_file *,int);
+void write_symmap(const char *,section *,symbol *);
+
+#endif
@@ -5,6 +5,7 @@
 #include <time.h>
 #include "vasm.h"
 #include "osdep.h"
+#include "compress.h"
 
 /* The syntax module parses the input (read_next_line), handles
    assembly-directives (section, data-storage etc.) and parses
@@ -865,9 +866,10 @@ static void handle_include(char *s)
 
 static void handle_incbin(char *s)
 {
-  strbuf *name;
+  strbuf *name,*cname;
   taddr offs = 0;
   taddr length = 0;
+  int codec = CODEC_NONE;
 
   if (name = parse_name(0,&s)) {
     s = skip(s);
@@ -880,10 +882,21 @@ static void handle_incbin(char *s)
         /* We have a length */
         s = skip(s + 1);
         length = parse_constexpr(&s);
+        s = skip(s);
+        if (*s == ',') {
+          /* We have a compression codec */
+          s = skip(s + 1);
+          if (cname = parse_identifier(0,&s)) {
+            if ((codec = find_codec(cname->str)) == CODEC_NONE)
+              general_error(95,cname->str);  /* unknown codec */
+          }
+          else
+            syntax_error(10);  /* identifier expected */
+        }
       }
     }
     eol(s);
-    include_binary_file(name->str,offs,length);
+    include_binary_file(name->str,offs,length,codec);
   }
 }
 
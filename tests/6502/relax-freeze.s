@@ -0,0 +1,6 @@
+; lda switches between zero page and absolute addressing in every pass,
+; the resolver has to keep the absolute addressing mode
+	org $fd
+	lda lab
+e:	rts
+lab	equ $1ff-e
@@ -0,0 +1,13 @@
+need vasm6502_psi-x
+for mode in default grow; do
+  asm 6502 -Fbin -relax=$mode -o $mode.bin "$srcdir/relax-freeze.s" \
+    >$mode.log 2>&1 || fail "-relax=$mode did not converge"
+  check_hex $mode.bin "ad ff 00 60"
+done
+# zero page is still selected for a stable address
+printf '\torg\t$200\n\tlda\tzp\n\tlda\tab\n\trts\nzp\tequ\t$80\nab\tequ\t$1234\n' >stable.s
+for mode in default grow; do
+  asm 6502 -Fbin -relax=$mode -o stable-$mode.bin stable.s ||
+    fail "stable -relax=$mode"
+  check_hex stable-$mode.bin "a5 80 ad 34 12 60"
+done
@@ -0,0 +1,16 @@
+; hot and warm (needed for (zp),y) go first, a1 and a2 share a byte,
+; cold has the lowest weight per byte and is spilled
+	zpalloc	$80,$83
+	zpspill	$0300
+cold	zpvar	2,1
+hot	zpvar	1,10
+warm	zpvar	2,5
+a1	zpvar	1,,s1
+a2	zpvar	1,,s2
+	org	$1000
+	lda	hot
+	lda	warm
+	lda	cold
+	lda	a1
+	sta	a2
+	lda	(warm),y
@@ -0,0 +1,8 @@
+need vasm6502_psi-x
+asm 6502 -Fbin -o zp.bin "$srcdir/zpvar.s" >zp.log 2>&1 ||
+  fail "assembling zpvar.s"
+check_hex zp.bin "a5 82 a5 80 ad 00 03 a5 83 85 83 b1 80"
+check_grep "4 of 5 variables in zero/direct-page, saving 5 bytes" zp.log
+printf '\tlda\t(v),y\nv\tzpvar\t1\n' >nofit.s
+check_fails asm 6502 -Fbin -o nofit.bin nofit.s >nofit.log 2>&1
+check_grep "zpvar <v> requires zero/direct-page addressing" nofit.log
@@ -0,0 +1,6 @@
+; ADR to a near label and an ADRL, which is created by -opt-adr
+	adr	r0,lab
+	adr	r1,far
+lab:	mov	r0,r0
+	dsb	4660
+far:	mov	r1,r1
@@ -0,0 +1,7 @@
+need vasmarm_psi-x
+for mode in default grow; do
+  asm arm -Fbin -opt-adr -relax=$mode -o $mode.bin "$srcdir/adr-grow.s" \
+    >$mode.log 2>&1 || fail "-relax=$mode"
+  dd if=$mode.bin bs=1 count=16 2>/dev/null >head.bin
+  check_hex head.bin "04 00 8f e2 12 1c 8f e2 38 10 81 e2 00 00 a0 e1"
+done
@@ -0,0 +1,10 @@
+; 600 ADRs, each growing to 8 bytes with -opt-adr, between an LDR and
+; its literal: the pool must be placed for the grown size
+	ldr	r0,=0x12345678
+	rept	600
+	adr	r1,far
+	endr
+	ldr	r2,=0x12345679
+	mov	r0,r0
+	dsb	0x1000
+far:	bx	lr
@@ -0,0 +1,11 @@
+; constants fitting MOV/MVN, a shared literal, a label and an equate
+	ldr	r0,=0x12345678
+	ldr	r1,=0xff000000
+	ldr	r2,=-2
+	ldr	r3,=0x12345678
+	ldr	r4,=lab
+	ldr	r5,=val
+	bx	lr
+	ltorg
+lab:	mov	r0,r0
+val	equ	$87654321
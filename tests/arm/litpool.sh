@@ -0,0 +1,17 @@
+need vasmarm_psi-x
+asm arm -Fbin -o lit.bin "$srcdir/litpool.s" >lit.log 2>&1 ||
+  fail "assembling litpool.s"
+check_hex lit.bin "14 00 9f e5 ff 14 a0 e3 01 20 e0 e3 08 30 9f e5 08 40 9f e5 08 50 9f e5 1e ff 2f e1 78 56 34 12 28 00 00 00 21 43 65 87 00 00 a0 e1"
+
+# the pool follows a B around it at 0xffc, exactly in range of the LDR
+asm arm -Fbin -opt-adr -o grow.bin "$srcdir/litpool-grow.s" >grow.log 2>&1 ||
+  fail "assembling litpool-grow.s"
+dd if=grow.bin bs=4 count=1 2>/dev/null >ldr.bin
+check_hex ldr.bin "f8 0f 9f e5"
+dd if=grow.bin bs=4 skip=1023 count=2 2>/dev/null >pool.bin
+check_hex pool.bin "00 00 00 ea 78 56 34 12"
+
+# no instruction to place the pool behind before the data
+printf '\tldr\tr0,=0x12345678\n\tdl\t0\n\tdsb\t0x2000\n' >far.s
+check_fails asm arm -Fbin -o far.bin far.s >far.log 2>&1
+check_grep "literal pool out of range" far.log
@@ -0,0 +1,7 @@
+	org	$1000
+start:
+	dc.b	"HDR!"
+sum:	dc.w	0
+crc:	dc.l	0
+data:	dc.b	1,2,3,4,5,6,7,8,9,10
+dend:
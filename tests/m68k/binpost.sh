@@ -0,0 +1,18 @@
+need vasmm68k_psi-x
+asm m68k -Fbin -pad-to=pow2 -fill=255 -sum16=data,dend,sum \
+  -crc32=start,sum,crc -o pow2.bin "$srcdir/binpost.s" || fail "pow2"
+check_hex pow2.bin "48 44 52 21 19 1e cc 93 a5 5a 01 02 03 04 05 06 07 08 09 0a ff ff ff ff ff ff ff ff ff ff ff ff"
+asm m68k -Fbin -crc32=start,sum,crc,le -pad-to=32 -o le.bin \
+  "$srcdir/binpost.s" || fail "little endian"
+check_hex le.bin "48 44 52 21 00 00 5a a5 93 cc 01 02 03 04 05 06 07 08 09 0a 00 00 00 00 00 00 00 00 00 00 00 00"
+check_fails asm m68k -Fbin -sum16=data,nosym,sum -o bad.bin \
+  "$srcdir/binpost.s" 2>/dev/null
+
+# -sum16 adds up words in the selected endianness, carries are dropped
+printf '\torg\t0\nsum:\tdc.w\t0\n\tdc.b\t0,$ff,0,$ff,$ff,$ff,$ff,$ff\nend:\n' >words.s
+asm m68k -Fbin -sum16=2,end,sum -o be.bin words.s || fail "words be"
+check_hex be.bin "01 fc 00 ff 00 ff ff ff ff ff"
+asm m68k -Fbin -sum16=2,end,sum,le -o le16.bin words.s || fail "words le"
+check_hex le16.bin "fe fd 00 ff 00 ff ff ff ff ff"
+check_fails asm m68k -Fbin -sum16=2,9,sum -o odd.bin words.s 2>odd.txt
+check_grep "has an odd number of bytes" odd.txt
@@ -0,0 +1,89 @@
+need vasmm68k_psi-x
+: >empty.bin
+# text with repetitions of all lengths, runs and some unique bytes
+awk 'BEGIN {
+  for (i=0; i<400; i++) {
+    printf "line %d: %s\n", i%37, substr("abcdefghijklmnopqrstuvwxyz", 1, i%26)
+    if (i%50 == 0) for (j=0; j<300; j++) printf "%c", 65+(i/50)
+  }
+}' >data.bin
+printf '\tincbin\t"empty.bin",0,0,kosinski\n\tincbin\t"empty.bin",0,0,packbits\n' >empty.s
+asm m68k -Fbin -o empty.out empty.s || fail "empty input"
+# Kosinski always has an end-of-stream marker, PackBits needs none
+check_hex empty.out "02 00 00 f0 00"
+for c in kosinski packbits; do
+  printf '\tincbin\t"data.bin",0,0,%s\n' $c >$c.s
+  asm m68k -Fbin -o $c.out $c.s || fail "$c"
+  printf '\tincbin\t"data.bin",100,1000,%s\n' $c >part$c.s
+  asm m68k -Fbin -o part$c.out part$c.s || fail "$c part"
+done
+[ `wc -c <kosinski.out` -lt `wc -c <data.bin` ] || fail "not compressed"
+dd if=data.bin of=part.bin bs=1 skip=100 count=1000 2>/dev/null
+
+command -v python3 >/dev/null 2>&1 || exit 0
+cat >unpack.py <<'PY'
+import sys
+
+def kosinski(d):
+    out = bytearray()
+    pos = [0]
+    def byte():
+        pos[0] += 1
+        return d[pos[0]-1]
+    st = {"desc": 0, "n": 0}
+    def reload():
+        st["desc"] = byte() | (byte() << 8)
+        st["n"] = 16
+    def bit():
+        b = st["desc"] & 1
+        st["desc"] >>= 1
+        st["n"] -= 1
+        if st["n"] == 0:
+            reload()
+        return b
+    reload()
+    while True:
+        if bit():
+            out.append(byte())
+            continue
+        if bit():
+            lo = byte(); hi = byte()
+            dist = 0x2000 - (((hi & 0xf8) << 5) | lo)
+            cnt = hi & 7
+            if cnt == 0:
+                cnt = byte()
+                if cnt == 0:
+                    break
+                if cnt == 1:
+                    continue
+                cnt += 1
+            else:
+                cnt += 2
+        else:
+            cnt = (bit() << 1 | bit()) + 2
+            dist = 0x100 - byte()
+        for i in range(cnt):
+            out.append(out[-dist])
+    return bytes(out), pos[0]
+
+def packbits(d):
+    out = bytearray()
+    i = 0
+    while i < len(d):
+        n = d[i]; i += 1
+        if n < 128:
+            out += d[i:i+n+1]; i += n+1
+        elif n > 128:
+            out += d[i:i+1] * (257-n); i += 1
+    return bytes(out), i
+
+codec, packed, orig = sys.argv[1:4]
+d = open(packed, "rb").read()
+out, used = globals()[codec](d)
+if out != open(orig, "rb").read() or used != len(d):
+    sys.exit("%s: %s does not unpack to %s" % (codec, packed, orig))
+PY
+for c in kosinski packbits; do
+  python3 unpack.py $c $c.out data.bin || fail "$c round trip"
+  python3 unpack.py $c part$c.out part.bin || fail "$c part round trip"
+done
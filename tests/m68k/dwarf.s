@@ -0,0 +1,9 @@
+	section	code
+start:
+	nop
+	moveq	#1,d0
+	rept	3
+	addq.w	#1,d0
+	endr
+	move.l	d0,d1
+	rts
@@ -0,0 +1,13 @@
+need vasmm68k_psi-x
+if ! command -v readelf >/dev/null 2>&1; then
+  echo "SKIP $test (readelf not found)"
+  exit 77
+fi
+cp "$srcdir/dwarf.s" d.s
+asm m68k -Felf -dwarf -o d.o d.s || fail "dwarf"
+readelf --debug-dump=decodedline d.o >lines.txt || fail "readelf"
+# one row per line change, the repeated line 6 only once
+tr -s ' ' <lines.txt | grep '^d\.s ' >rows.txt
+printf '%s\n' "d.s 3 0 x" "d.s 4 0x2 x" "d.s 6 0x4 x" "d.s 8 0xa x" \
+  "d.s 9 0xc x" "d.s - 0xe" >expect.txt
+cmp -s rows.txt expect.txt || fail "line table: `cat rows.txt`"
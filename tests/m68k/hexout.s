@@ -0,0 +1,7 @@
+	org	$1000
+	dc.b	"Hello, world!",0
+	dcb.b	40,$ff
+	ds.b	20
+	dc.w	$1234
+	org	$8ff8
+	dc.l	1,2,3,4
@@ -0,0 +1,11 @@
+need vasmm68k_psi-x
+# expected files were written by the per-byte writers before the fast path
+asm m68k -Fsrec -o s37.srec "$srcdir/hexout.s" || fail "srec"
+check_same s37.srec "$srcdir/hexout-s37.srec"
+asm m68k -Fsrec -s19 -crlf -o s19.srec "$srcdir/hexout.s" || fail "srec s19"
+check_same s19.srec "$srcdir/hexout-s19.srec"
+asm m68k -Fihex -o i.hex "$srcdir/hexout.s" || fail "ihex"
+check_same i.hex "$srcdir/hexout.hex"
+asm m68k -Fihex -i32hex -record-size=8 -o i32.hex "$srcdir/hexout.s" ||
+  fail "ihex i32hex"
+check_same i32.hex "$srcdir/hexout-i32.hex"
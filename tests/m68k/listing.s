@@ -0,0 +1,13 @@
+m	macro
+	move.l	#\1,d0
+	add.w	d1,d\2
+	endm
+	m	$12345678,2
+	rept	3
+	nop
+	endr
+	nolist
+	moveq	#1,d1
+	list
+	moveq	#2,d2	; a comment long enough to be longer than the old listing format would ever show in its source column
+	m	$abcd,3
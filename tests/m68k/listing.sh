@@ -0,0 +1,13 @@
+need vasmm68k_psi-x
+for f in wide old; do
+  asm m68k -Fbin -Lfmt=$f -L $f.lst -o $f.bin "$srcdir/listing.s" ||
+    fail "listing format $f"
+  check_grep "move.l	#\$12345678,d0" $f.lst
+  check_grep "add.w	d1,d3" $f.lst
+  check_grep "show in its source column" $f.lst
+done
+check_grep "^00:00000000 203C12345678    	     1M 	move.l	#\$12345678,d0" wide.lst
+check_grep "^00:00000018 D641            	     2M 	add.w	d1,d3" wide.lst
+check_grep "^F01:0002       	add.w	d1,d2" old.lst
+check_grep "S01:00000012:  20 3C 00 00 AB CD" old.lst
+check_nogrep "moveq	#1,d1" wide.lst
@@ -0,0 +1,12 @@
+; branch sizes in grow-only mode are the same as in the default mode,
+; including the removal of branches to the next instruction
+back:	nop
+	bra	near
+	bra	far
+	beq	next
+next:	bne	back
+	beq	near
+near:	nop
+	dcb.b	200,0
+far:	bsr	back
+	rts
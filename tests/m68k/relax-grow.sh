@@ -0,0 +1,9 @@
+need vasmm68k_psi-x
+asm m68k -Fbin -o default.bin "$srcdir/relax-grow.s" >default.log 2>&1 ||
+  fail "default mode"
+asm m68k -Fbin -relax=grow -o grow.bin "$srcdir/relax-grow.s" >grow.log 2>&1 ||
+  fail "grow mode"
+dd if=grow.bin bs=1 count=16 2>/dev/null >head.bin
+check_hex head.bin "4e 71 60 06 60 00 00 ce 66 f6 4e 71 00 00 00 00"
+check_same default.bin grow.bin
+check_nogrep "frozen" grow.log
@@ -0,0 +1,17 @@
+	section	code
+start:
+	lea	data,a0
+	move.l	#tab,d0
+	jmp	far
+	dc.l	start,data
+	dcb.b	300,0
+far:
+	dc.l	tab,start
+	rts
+	section	data
+data:
+	dc.l	start,far,tab
+	dc.l	data
+	section	bss
+tab:
+	ds.l	16
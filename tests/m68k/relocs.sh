@@ -0,0 +1,7 @@
+need vasmm68k_psi-x
+# expected files were written before the relocations were collected per
+# section; a gap of more than 254 bytes needs TOS skip bytes
+for f in tos dri xfile; do
+  asm m68k -F$f -o r.$f "$srcdir/relocs.s" || fail "$f"
+  check_same r.$f "$srcdir/relocs.$f"
+done
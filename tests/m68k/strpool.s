@@ -0,0 +1,11 @@
+	xdef	foo_bar
+	xdef	bar
+	xdef	other
+	xref	ext_bar
+foo_bar:
+	nop
+bar:
+	nop
+other:
+	dc.l	ext_bar
+	dc.l	bar
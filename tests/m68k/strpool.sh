@@ -0,0 +1,12 @@
+need vasmm68k_psi-x
+asm m68k -Faout -o s.aout "$srcdir/strpool.s" || fail "a.out output"
+# "bar" shares the tail of "foo_bar" and "ext_bar"
+tail -c 26 s.aout >strtab.bin
+check_hex strtab.bin "00 00 00 1a 6f 74 68 65 72 00 66 6f 6f 5f 62 61 72 00 65 78 74 5f 62 61 72 00"
+asm m68k -Felf -o s.o "$srcdir/strpool.s" || fail "ELF output"
+command -v readelf >/dev/null 2>&1 || exit 0
+readelf -s -p .strtab s.o >elf.txt || fail "readelf"
+for s in foo_bar bar other ext_bar; do
+  check_grep " $s\$" elf.txt
+done
+check_nogrep "\] *bar\$" elf.txt
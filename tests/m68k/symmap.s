@@ -0,0 +1,7 @@
+	xdef	start
+	org	$1000
+start:
+	nop
+loc:	moveq	#1,d0
+	bra	start
+data:	dc.w	1,2
@@ -0,0 +1,5 @@
+need vasmm68k_psi-x
+cp "$srcdir/symmap.s" s.s
+asm m68k -Fbin -symmap=s.map -o s.bin s.s || fail "symmap"
+# header, section, symbols start/loc/data, file s.s, lines 4-6, strings
+check_hex s.map "56 53 59 4d 01 00 00 00 04 00 00 00 00 00 00 00 40 00 00 00 01 00 00 00 58 00 00 00 03 00 00 00 a0 00 00 00 01 00 00 00 a8 00 00 00 03 00 00 00 d8 00 00 00 21 00 00 00 00 00 00 00 00 00 00 00 00 10 00 00 00 00 00 00 0a 00 00 00 00 00 00 00 01 00 00 00 01 00 00 00 00 10 00 00 00 00 00 00 00 00 00 00 00 00 00 00 0e 00 00 00 00 00 01 00 02 10 00 00 00 00 00 00 00 00 00 00 00 00 00 00 14 00 00 00 00 00 00 00 06 10 00 00 00 00 00 00 00 00 00 00 00 00 00 00 18 00 00 00 00 00 00 00 1d 00 00 00 00 00 00 00 00 10 00 00 00 00 00 00 04 00 00 00 00 00 00 00 02 10 00 00 00 00 00 00 05 00 00 00 00 00 00 00 04 10 00 00 00 00 00 00 06 00 00 00 00 00 00 00 00 6f 72 67 30 30 30 31 3a 31 30 30 30 00 73 74 61 72 74 00 6c 6f 63 00 64 61 74 61 00 73 2e 73 00"
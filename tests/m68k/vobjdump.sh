@@ -0,0 +1,25 @@
+need vasmm68k_psi-x vobjdump
+asm m68k -Fvobj -o r.o "$srcdir/relocs.s" || fail "vobj"
+# the full dump is unchanged by the index pass
+vobjdump r.o >all.txt || fail "vobjdump"
+check_same all.txt "$srcdir/vobjdump.txt"
+
+vobjdump -s DATA r.o >data.txt || fail "vobjdump -s"
+check_grep 'SECTION "DATA"' data.txt
+check_nogrep 'SECTION "CODE"' data.txt
+check_grep 'ABS      far+324' data.txt
+check_grep ' data$' data.txt
+check_nogrep ' start$' data.txt
+
+vobjdump -r -y tab r.o >tab.txt || fail "vobjdump -r -y"
+[ `grep -c 'ABS      tab+0' tab.txt` = 3 ] || fail "relocs to tab"
+check_nogrep 'start+0' tab.txt
+check_nogrep 'SYMBOL TABLE' tab.txt
+
+vobjdump -json r.o >r.json || fail "vobjdump -json"
+check_grep '"nsections":3,"nsymbols":7' r.json
+check_grep '"name":"DATA","attributes":"adrw","flags":1,"align":2,"size":16,"filesize":16,"nrelocs":4' r.json
+check_grep '"offset":324,"bitpos":0,"bitsize":32,"mask":4294967295,"symbol":"tab","addend":0' r.json
+if command -v python3 >/dev/null 2>&1; then
+  python3 -m json.tool r.json >/dev/null || fail "invalid JSON"
+fi
@@ -0,0 +1,109 @@
+#!/bin/sh
+# Regression tests for vasm, vobjdump and vlink.
+#
+# Usage: sh tests/run.sh [test ...]
+#
+# Every tests/<group>/<name>.sh is run in an empty scratch directory, with
+# the helper functions below. A test fails by exiting with a non-zero
+# status and is skipped (status 77) when a program it needs was not built,
+# so only the assemblers built by "make CPU=... SYNTAX=..." are tested.
+# Without arguments all tests are run, otherwise only those whose
+# <group>/<name> matches one of the arguments.
+
+top=`cd \`dirname "$0"\`/.. && pwd`
+SYNTAX=${SYNTAX:-psi-x}
+scratch=${TMPDIR:-/tmp}/vasmtest.$$
+
+# run vasm for a cpu, e.g.: asm z80 -Fbin -o x.bin x.s
+asm()
+{
+  cpu=$1; shift
+  "$top/vasm${cpu}_$SYNTAX" -quiet "$@"
+}
+
+vobjdump()
+{
+  "$top/vobjdump" "$@"
+}
+
+vlink()
+{
+  "$top/vlink/vlink" "$@"
+}
+
+# skip the test unless all the given programs (relative to the top
+# directory) were built
+need()
+{
+  for p in "$@"; do
+    if [ ! -x "$top/$p" ]; then
+      echo "SKIP $test ($p not built)"
+      exit 77
+    fi
+  done
+}
+
+fail()
+{
+  echo "FAIL $test: $*"
+  exit 1
+}
+
+# file contents as a line of hex bytes
+hexof()
+{
+  od -An -tx1 -v "$1" | tr -s ' \n' '  ' | sed 's/^ //;s/ $//'
+}
+
+# check_hex file "hex bytes"
+check_hex()
+{
+  got=`hexof "$1"`
+  [ "$got" = "$2" ] || fail "$1 is $got, expected $2"
+}
+
+# check_same file1 file2
+check_same()
+{
+  cmp -s "$1" "$2" || fail "$1 and $2 differ"
+}
+
+# check_grep pattern file, check_nogrep pattern file
+check_grep()
+{
+  grep -q -e "$1" "$2" || fail "'$1' not found in $2"
+}
+
+check_nogrep()
+{
+  if grep -q -e "$1" "$2"; then fail "unexpected '$1' in $2"; fi
+}
+
+# check_fails command...: command has to fail
+check_fails()
+{
+  if "$@"; then fail "'$*' succeeded"; fi
+}
+
+pass=0 failed=0 skipped=0
+for t in "$top"/tests/*/*.sh; do
+  test=`echo "$t" | sed 's,.*/tests/,,;s,\.sh$,,'`
+  if [ $# -gt 0 ]; then
+    sel=0
+    for a in "$@"; do
+      case "$test" in $a|$a/*) sel=1;; esac
+    done
+    [ $sel = 1 ] || continue
+  fi
+  srcdir=`dirname "$t"`
+  rm -rf "$scratch" && mkdir -p "$scratch" || exit 1
+  (cd "$scratch" && . "$t")
+  case $? in
+    0)  pass=`expr $pass + 1`;;
+    77) skipped=`expr $skipped + 1`;;
+    *)  failed=`expr $failed + 1`;;
+  esac
+done
+rm -rf "$scratch"
+echo "$pass passed, $failed failed, $skipped skipped"
+[ $failed = 0 ]
@@ -0,0 +1,34 @@
+need vlink/vlink vasmm68k_psi-x
+# t1 and t2 are identical functions in separate objects
+printf '\txdef\tt1\nt1:\tmoveq\t#1,d0\n\trts\n' >t1.s
+printf '\txdef\tt2\nt2:\tmoveq\t#1,d0\n\trts\n' >t2.s
+printf '\txref\tt1,t2\n\txdef\t_start\n_start:\tbsr\tt1\n\tbsr\tt2\n\trts\n' >br.s
+printf '\txref\tt1,t2\n\txdef\t_start\n_start:\tlea\tt1(pc),a0\n\tlea\tt2(pc),a1\n\trts\n' >lea.s
+# the brief extension word of (d8,pc,d6.w) looks like a Bcc.B opcode
+printf '\txref\tt1,t2\n\txdef\t_start\n_start:\tlea\tt1(pc,d6.w),a0\n\tlea\tt2(pc,d6.w),a1\n\trts\n' >idx.s
+for f in t1 t2 br lea idx; do
+  asm m68k -Felf -o $f.o $f.s || fail "elf $f"
+  asm m68k -Fvobj -o v$f.o $f.s || fail "vobj $f"
+done
+
+# branches don't take the address, so -icf folds t2 into t1
+vlink -brawbin1 -icf -o br.bin br.o t1.o t2.o || fail "bsr -icf"
+check_hex br.bin "61 00 00 08 61 00 00 04 4e 75 70 01 4e 75"
+vlink -brawbin1 -icf-all -o br-all.bin br.o t1.o t2.o || fail "bsr -icf-all"
+check_same br.bin br-all.bin
+
+# lea (d16,pc) takes the address, which only -icf-all ignores
+vlink -brawbin1 -icf -o lea.bin lea.o t1.o t2.o || fail "lea -icf"
+check_hex lea.bin "41 fa 00 08 43 fa 00 08 4e 75 70 01 4e 75 70 01 4e 75"
+vlink -brawbin1 -icf-all -o lea-all.bin lea.o t1.o t2.o || fail "lea -icf-all"
+check_hex lea-all.bin "41 fa 00 08 43 fa 00 04 4e 75 70 01 4e 75"
+
+vlink -brawbin1 -icf -o idx.bin idx.o t1.o t2.o || fail "lea idx -icf"
+check_hex idx.bin "41 fb 60 08 43 fb 60 08 4e 75 70 01 4e 75 70 01 4e 75"
+
+# VOBJ can't tell a branch from an address, so only -icf-all folds
+vlink -brawbin1 -icf -o vbr.bin vbr.o vt1.o vt2.o || fail "vobj bsr -icf"
+check_hex vbr.bin "61 00 00 08 61 00 00 08 4e 75 70 01 4e 75 70 01 4e 75"
+vlink -brawbin1 -icf-all -o vbr-all.bin vbr.o vt1.o vt2.o ||
+  fail "vobj bsr -icf-all"
+check_same br.bin vbr-all.bin
@@ -0,0 +1,8 @@
+	xdef	afunc,aval
+	nop
+afunc:
+	moveq	#1,d0
+	rts
+	section	data
+aval:
+	dc.l	$11111111
@@ -0,0 +1,6 @@
+	xref	afunc,aval
+	xdef	_start
+_start:
+	jsr	afunc
+	move.l	aval,d0
+	rts
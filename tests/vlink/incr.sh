@@ -0,0 +1,106 @@
+need vlink/vlink vasmm68k_psi-x
+asm m68k -Fvobj -o main.o "$srcdir/incr-main.s" || fail "main"
+
+# variant name sed-script: assemble a changed copy of incr-a.s to a.o
+variant()
+{
+  sed "$2" "$srcdir/incr-a.s" >$1.s
+  asm m68k -Fvobj -o a.o $1.s || fail "variant $1"
+}
+
+# link name [options]: incremental link of main.o and a.o to out.bin
+link()
+{
+  name=$1; shift
+  vlink -t -incremental -brawbin1 "$@" -o out.bin main.o a.o >$name.txt 2>&1
+}
+
+# start [options]: full link of the original a.o, which saves the state
+start()
+{
+  rm -f out.bin out.bin.vli
+  asm m68k -Fvobj -o a.o "$srcdir/incr-a.s" || fail "a"
+  link start "$@" || fail "first link $*"
+  [ -f out.bin.vli ] || fail "no state saved"
+}
+
+# check_full name: out.bin is the same as a full link with the same objects
+check_full()
+{
+  vlink -brawbin1 -o full.bin main.o a.o || fail "$1: full link"
+  check_same out.bin full.bin
+}
+
+# fallback name reason [options]: the relink warns and does a full link
+fallback()
+{
+  name=$1; reason=$2; shift; shift
+  link $name "$@" || fail "$name: relink"
+  check_grep "Warning 169: Incremental link of out.bin not possible ($reason), doing a full link\." $name.txt
+  check_nogrep "^Relinking" $name.txt
+  check_full $name
+  [ -f out.bin.vli ] || fail "$name: no state saved by the full link"
+}
+
+# a same-sized change is patched into the output file
+start
+check_hex out.bin "4e b9 00 00 00 10 20 39 00 00 00 14 4e 75 4e 71 70 01 4e 75 11 11 11 11"
+variant same 's/#1/#2/;s/\$11111111/$22222222/'
+link same || fail "same: relink"
+check_grep "^Relinking a.o" same.txt
+check_hex out.bin "4e b9 00 00 00 10 20 39 00 00 00 14 4e 75 4e 71 70 02 4e 75 22 22 22 22"
+check_full same
+# ... and the saved state is updated for the next relink
+variant same2 's/#1/#3/;s/\$11111111/$33333333/'
+link same2 || fail "same2: relink"
+check_grep "^Relinking a.o" same2.txt
+check_full same2
+link uptodate || fail "uptodate: relink"
+check_grep "^Output file out.bin is up to date" uptodate.txt
+
+# every reason for a full link
+start
+variant grown 's/rts/nop\n\trts/'
+fallback grown "section CODE of a.o doesn't fit into the previous layout"
+start
+variant moved 's/^\tnop//;s/rts/rts\n\tnop/'
+fallback moved "global symbol afunc of a.o changed"
+start
+variant newsym 's/^afunc:/afunc:\n\txdef\tbfunc\nbfunc:/'
+fallback newsym "global symbols of a.o changed"
+start
+variant newsec 's/^\tsection\tdata/\tsection\tbss\n\tds.l\t1\n&/'
+fallback newsec "a.o has a new section BSS"
+start
+variant lostsec '/section/d;/dc.l/d;s/^aval:/aval\tequ\t0/'
+fallback lostsec "a.o lost its section DATA"
+start
+variant newref 's/^\tnop/\txref\tnosuch\n\tdc.w\tnosuch/'
+link newref && fail "newref: undefined reference linked"
+check_grep "not possible (a.o has a new reference to nosuch)" newref.txt
+start
+printf 'X' | dd of=out.bin.vli bs=1 seek=0 conv=notrunc 2>/dev/null
+variant corrupt 's/#1/#2/'
+fallback corrupt "link state is corrupt"
+start
+variant cmdline 's/#1/#2/'
+fallback cmdline "command line changed" -Ttext 0
+start
+printf 'X' | dd of=out.bin bs=1 seek=0 conv=notrunc 2>/dev/null
+variant modified 's/#1/#2/'
+fallback modified "output file was modified"
+start
+rm out.bin
+fallback missing "output file is missing"
+printf 'SECTIONS { .text : { *(CODE) *(DATA) } }\n' >a.ld
+start -T a.ld
+printf 'SECTIONS { .text : { *(CODE) } .data : { *(DATA) } }\n' >a.ld
+fallback script "linker script changed" -T a.ld
+
+# no state is saved for links which can't be relinked
+rm -f out.bin.vli
+vlink -incremental -brawbin1 -M -o out.bin main.o a.o >map.txt 2>&1 ||
+  fail "map link"
+check_grep "Warning 170: No incremental link state saved for out.bin (map, symbol or line-offsets file)" map.txt
+[ -f out.bin.vli ] && fail "state saved for a link with map file"
+exit 0
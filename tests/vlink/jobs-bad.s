@@ -0,0 +1,2 @@
+	xdef	foo
+foo:	nop
@@ -0,0 +1,20 @@
+need vlink/vlink vasmm68k_psi-x
+# small data references without _SDA_BASE_ fail while relocating, with
+# an "In" line whenever the function changes
+asm m68k -Fvobj -o sd.o "$srcdir/jobs-sd.s" || fail "sd"
+asm m68k -Fvobj -o var.o "$srcdir/jobs-sdvar.s" || fail "var"
+objs=
+for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16; do
+  cp sd.o sd$i.o
+  objs="$objs sd$i.o"
+done
+vlink -brawbin1 -o seq.bin $objs var.o 2>seq.txt && fail "link succeeded"
+[ `grep -c '^sd[0-9]*\.o: In "g1":$' seq.txt` = 16 ] || fail "g1 headers"
+[ `grep -c '^sd[0-9]*\.o: In "g2":$' seq.txt` = 16 ] || fail "g2 headers"
+[ `grep -c '^Error 21: ' seq.txt` = 48 ] || fail "errors"
+# headers and errors stay together and in section order with -j
+for run in 1 2 3; do
+  vlink -j 8 -brawbin1 -o par.bin $objs var.o 2>par.txt &&
+    fail "link succeeded with -j"
+  check_same seq.txt par.txt
+done
@@ -0,0 +1,7 @@
+	near	a4
+	xref	v1
+g1:
+	move.l	v1(a4),d0
+	move.l	v1(a4),d1
+g2:
+	move.l	v1(a4),d0
@@ -0,0 +1,3 @@
+	xdef	v1
+	section	data
+v1:	dc.l	0
@@ -0,0 +1,39 @@
+need vlink/vlink vasmm68k_psi-x
+for f in main a b1; do
+  asm m68k -Fvobj -o $f.o "$srcdir/lib-$f.s" || fail "vobj $f"
+done
+# err.o: illegal symbol type (error), fat.o: bad section index (fatal)
+asm m68k -Fvobj -o bad.o "$srcdir/jobs-bad.s" || fail "vobj bad"
+cp bad.o err.o
+printf '\017' | dd of=err.o bs=1 seek=30 conv=notrunc 2>/dev/null
+cp bad.o fat.o
+printf '\011' | dd of=fat.o bs=1 seek=34 conv=notrunc 2>/dev/null
+objs=
+for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20; do
+  cp err.o err$i.o
+  objs="$objs err$i.o"
+done
+
+# diagnostics of worker threads appear in command line order
+vlink -brawbin1 -o seq.bin main.o a.o b1.o $objs 2>seq.txt
+[ `grep -c "^Error 54: err[0-9]*\.o: Illegal symbol type 7" seq.txt` = 20 ] ||
+  fail "expected 20 errors"
+for run in 1 2 3; do
+  vlink -j 8 -brawbin1 -o par.bin main.o a.o b1.o $objs 2>par.txt
+  check_same seq.txt par.txt
+done
+
+# a fatal error is reported after the errors of all files before it
+vlink -brawbin1 -o seq.bin main.o err1.o err2.o fat.o $objs 2>seq.txt &&
+  fail "fatal error ignored"
+check_grep "^Fatal error 53: fat.o" seq.txt
+for run in 1 2 3; do
+  vlink -j 8 -brawbin1 -o par.bin main.o err1.o err2.o fat.o $objs \
+    2>par.txt && fail "fatal error ignored with -j"
+  check_same seq.txt par.txt
+done
+
+# a link with -j writes the same output
+vlink -brawbin1 -o seq.bin main.o a.o b1.o || fail "sequential link"
+vlink -j 3 -brawbin1 -o par.bin main.o a.o b1.o || fail "parallel link"
+check_same seq.bin par.bin
@@ -0,0 +1,38 @@
+need vlink/vlink vasmm68k_psi-x
+printf '\txdef\tt1\nt1:\tmoveq\t#1,d0\n\trts\n' >t1.s
+printf '\txdef\tt2\nt2:\tmoveq\t#1,d0\n\trts\n' >t2.s
+printf '\txref\tt1,t2\n\txdef\t_start,absv\nabsv\tequ\t$1234\n_start:\tbsr\tt1\n\tbsr\tt2\n\tlea\tdat,a0\n\trts\n\tsection\tdata\ndat:\tdc.l\t$11223344\n' >j.s
+for f in t1 t2 j; do
+  asm m68k -Felf -o $f.o $f.s || fail "elf $f"
+done
+
+# the JSON map and the text map describe the same link
+vlink -brawbin1 -icf -M -mapjson j.json -o j.bin j.o t1.o t2.o >j.map ||
+  fail "link"
+check_grep "^  0x00000010 t2: global reloc, size 0" j.map
+check_grep "^  0x00001234 absv: global abs, size 0" j.map
+check_grep "^  t2.o(CODE) -> 00000010 t1.o(CODE)  (size 4)" j.map
+check_grep '^{"output":"j.bin","format":"rawbin","sections":\[' j.json
+check_grep '^{"name":".text","type":"code","address":0,"loadaddress":0,"size":20,"filesize":20,"listed":true,"relocs":1,"xrefs":0,"inputs":\[{"object":"j.o","section":"CODE","address":0,"size":16,"relocs":1,"xrefs":2},{"object":"t1.o","section":"CODE","address":16,"size":4,"relocs":0,"xrefs":0}\],"symbols":\[{"name":"_start","value":0,"size":0,"type":"reloc","info":"none","bind":"global","object":"j.o"},{"name":"t1","value":16,' j.json
+check_grep '"name":"t2","value":16,' j.json
+check_grep '{"name":"dat","value":20,"size":0,"type":"reloc","info":"none","bind":"local","object":"j.o"}' j.json
+check_grep '^,"absolute_symbols":\[.*{"name":"absv","value":4660,' j.json
+check_grep '^,"folded":\[{"object":"t2.o","section":"CODE","size":4,"into":{"object":"t1.o","section":"CODE","address":16}}\]}$' j.json
+
+# the maps are complete when the link fails after relocating
+printf '\txref\tdat\n\tdc.w\tdat\n' >r.s
+asm m68k -Felf -o r.o r.s || fail "r"
+printf '\txdef\tdat\n\tsection\tdata\ndat:\tdc.l\t0\n' >d.s
+asm m68k -Felf -o d.o d.s || fail "d"
+vlink -brawbin1 -Ttext 0x20000 -M -mapjson e.json -o e.bin r.o d.o >e.map \
+  2>err.txt && fail "relocation error ignored"
+check_grep "^Error 35:" err.txt
+check_grep "^  00020000 .text  (size 2)" e.map
+check_grep "^  0x00020002 dat: global reloc, size 0" e.map
+check_grep '"name":"dat","value":131074,' e.json
+
+if command -v python3 >/dev/null 2>&1; then
+  python3 -c 'import json,sys; [json.load(open(f)) for f in sys.argv[1:]]' \
+    j.json e.json || fail "invalid JSON"
+fi
+exit 0
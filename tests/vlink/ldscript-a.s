@@ -0,0 +1,10 @@
+	section	.text.a
+	dc.w	$a1
+	section	.text.b
+	dc.w	$a2
+	section	.rodata.x
+	dc.w	$a3
+	section	.roda
+	dc.w	$a4
+	section	.misc
+	dc.w	$a5
@@ -0,0 +1,18 @@
+need vlink/vlink vasmm68k_psi-x
+# literal names, prefix* and other globs, with and without file names
+asm m68k -Felf -o a.o "$srcdir/ldscript-a.s" || fail "a"
+sed 's/\$a/$b/' "$srcdir/ldscript-a.s" >b.s
+asm m68k -Felf -o b.o b.s || fail "b"
+cat >s.ld <<'END'
+SECTIONS {
+  .text : { *(.text.b) b.o(.text.a) a.o(.text.a) }
+  .rodata : { *(EXCLUDE_FILE(b.o) .rodata.*) *(.rod?) b.o(.rodata.*) }
+  .other : { *(SORT(.m*)) *(*) }
+}
+END
+vlink -brawbin1 -T s.ld -M -o out.bin a.o b.o >map.txt || fail "link"
+check_hex out.bin "00 a2 00 b2 00 b1 00 a1 00 a3 00 a4 00 b4 00 b3 00 a5 00 b5"
+check_grep "00000004 - 00000006 b.o(.text.a)" map.txt
+check_grep "00000008 - 0000000a a.o(.rodata.x)" map.txt
+check_grep "0000000e - 00000010 b.o(.rodata.x)" map.txt
+check_grep "00000012 - 00000014 b.o(.misc)" map.txt
@@ -0,0 +1,5 @@
+	xdef	afunc
+	xref	bval
+afunc:
+	move.l	#bval,d0
+	rts
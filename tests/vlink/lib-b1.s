@@ -0,0 +1,2 @@
+	xdef	bval
+bval	equ	$1111
@@ -0,0 +1,3 @@
+	xdef	cfunc
+cfunc:
+	dc.w	$cccc
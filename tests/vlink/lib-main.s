@@ -0,0 +1,5 @@
+	xref	afunc
+	xdef	_start
+_start:
+	jsr	afunc
+	rts
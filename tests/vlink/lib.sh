@@ -0,0 +1,31 @@
+need vlink/vlink vasmm68k_psi-x
+if ! command -v ar >/dev/null 2>&1; then
+  echo "SKIP $test (ar not found)"
+  exit 77
+fi
+# bval is defined by two members, the first one in the archive wins
+for f in main a b1 b2 c; do
+  asm m68k -Fvobj -o $f.o "$srcdir/lib-$f.s" || fail "vobj $f"
+  asm m68k -Felf -o e$f.o "$srcdir/lib-$f.s" || fail "elf $f"
+done
+cp a.o a_very_long_member_name.o
+ar rc lib.a a_very_long_member_name.o b1.o c.o b2.o || fail "ar vobj"
+ar rcs libe.a ea.o eb1.o ec.o eb2.o || fail "ar elf"
+
+# members without archive symbol table, GNU long member name
+vlink -brawbin1 -o lib.bin -M main.o lib.a >lib.map || fail "vobj link"
+check_hex lib.bin "4e b9 00 00 00 08 4e 75 20 3c 00 00 11 11 4e 75"
+check_grep "lib.a (a_very_long_member_name.o) needed due to afunc" lib.map
+check_grep "lib.a (b1.o) needed due to bval" lib.map
+check_nogrep "(c.o)" lib.map
+check_nogrep "(b2.o)" lib.map
+
+# members from the archive symbol table
+vlink -brawbin1 -o libe.bin -M emain.o libe.a >libe.map || fail "elf link"
+check_same lib.bin libe.bin
+check_grep "libe.a (eb1.o) needed due to bval" libe.map
+check_nogrep "(ec.o)" libe.map
+
+# a member is converted completely, even when loaded on demand
+vlink -brawbin1 -o all.bin main.o a.o b1.o || fail "objects"
+check_same lib.bin all.bin
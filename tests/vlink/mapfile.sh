@@ -0,0 +1,25 @@
+need vlink/vlink vasmm68k_psi-x
+for f in main a b1; do
+  asm m68k -Fvobj -o $f.o "$srcdir/lib-$f.s" || fail "vobj $f"
+done
+# Linker scripts are parsed up to a terminating 0-byte behind the mapped
+# file, which needs an extra page when the size is a multiple of it.
+printf 'SECTIONS {\n  . = 0x1000;\n  .text : { *(CODE) *(*) }\n}\n' >base.ld
+for sz in 4096 16384 65536; do
+  cp base.ld s$sz.ld
+  n=`expr $sz - \`wc -c <base.ld\``
+  awk -v n=$n 'BEGIN {
+    while (n > 0) {
+      l = n > 60 ? 60 : n
+      if (l < 5) { printf "%*s", l, ""; n -= l; continue }
+      s = "/*"
+      for (i=0; i<l-5; i++) s = s "x"
+      printf "%s*/\n", s
+      n -= l
+    }
+  }' >>s$sz.ld
+  [ `wc -c <s$sz.ld` -eq $sz ] || fail "s$sz.ld has wrong size"
+  vlink -brawbin1 -T s$sz.ld -o s$sz.bin main.o a.o b1.o 2>/dev/null ||
+    fail "script of $sz bytes"
+  check_hex s$sz.bin "4e b9 00 00 10 08 4e 75 20 3c 00 00 11 11 4e 75"
+done
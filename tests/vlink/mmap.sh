@@ -0,0 +1,27 @@
+need vlink/vlink vasmm68k_psi-x
+printf '\txdef\t_start,dat\n_start:\tlea\tdat,a0\n\trts\n\tsection\tdata\ndat:\tdc.l\t1,2,3\n' >a.s
+# a 16-bit reference, which doesn't fit above 64K
+printf '\txref\tdat\n\tdc.w\tdat\n' >r.s
+asm m68k -Felf -o a.o a.s || fail "a"
+asm m68k -Felf -o r.o r.s || fail "r"
+
+# the mapped output file is the same as a written one
+vlink -brawbin1 -o std.bin a.o || fail "stdio link"
+vlink -t -mmap-output -brawbin1 -o out.bin a.o >trace.txt 2>&1 ||
+  fail "mapped link"
+# only mapped where posix_fallocate() is known to exist
+if [ "`uname -s`" = Linux ]; then
+  check_grep "^Mapped output file out.bin (20 bytes)" trace.txt
+fi
+check_hex out.bin "41 f9 00 00 00 08 4e 75 00 00 00 01 00 00 00 02 00 00 00 03"
+check_same std.bin out.bin
+
+# a link error keeps the previous output file, and no temporary file
+vlink -mmap-output -brawbin1 -Ttext 0x20000 -o out.bin a.o r.o 2>err.txt &&
+  fail "relocation error ignored"
+check_grep "^Error 35: out.bin" err.txt
+check_same std.bin out.bin
+for f in out.bin.*; do
+  [ -f "$f" ] && fail "temporary file $f left"
+done
+exit 0
@@ -0,0 +1,24 @@
+need vlink/vlink vasmm68k_psi-x
+# enough global symbols to grow the table beyond its initial 64K slots
+awk 'BEGIN {
+  for (i=0; i<50000; i++)
+    printf "\txdef\ts%d\ns%d:\tdc.b\t%d\n", i, i, i%256
+}' >syms.s
+printf '\txref\ts0,s25000,s49999\n\txdef\t_start\n_start:\tdc.l\ts0,s25000,s49999\n' >ref.s
+asm m68k -Fvobj -o syms.o syms.s || fail "syms"
+asm m68k -Fvobj -o ref.o ref.s || fail "ref"
+vlink -t -brawbin1 -Ttext 0x1000 -o out.bin ref.o syms.o >trace.txt 2>&1 ||
+  fail "link"
+check_grep "^Global symbol table: 50004 names in 131072 slots .*grown 1 times" trace.txt
+dd if=out.bin of=head.bin bs=1 count=12 2>/dev/null
+# 0x100c + 25000 = 0x71b4, 0x100c + 49999 = 0xd35b
+check_hex head.bin "00 00 10 0c 00 00 71 b4 00 00 d3 5b"
+dd if=out.bin of=tail.bin bs=1 skip=50011 2>/dev/null
+check_hex tail.bin "4f"
+
+# a duplicate definition is still detected
+printf '\txdef\ts100\ns100:\tdc.b\t1\n' >dup.s
+asm m68k -Fvobj -o dup.o dup.s || fail "dup"
+vlink -brawbin1 -o dup.bin ref.o syms.o dup.o 2>dup.txt &&
+  fail "duplicate accepted"
+check_grep "Global symbol s100 from dup.o is already defined in syms.o" dup.txt
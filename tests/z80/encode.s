@@ -0,0 +1,23 @@
+; one instruction of each opcode mode, plus prefixes, index offsets
+; and immediates of every size
+	org	$100
+	add	a,c		; TYPE_ARITH8
+	inc	e		; TYPE_MISC8
+	ld	h,(hl)		; TYPE_LD8
+	ld	(ix+5),b	; TYPE_LD8, index offset
+	ld	iyl,a		; TYPE_LD8, index prefix
+	push	af		; TYPE_ARITH16
+	ld	de,$1234	; TYPE_ARITH16, 16-bit immediate
+	ld	iy,($4567)	; TYPE_ARITH16, prefix + immediate
+	add	ix,sp		; TYPE_ARITH16, prefix on both operands
+	ret	pe		; TYPE_FLAGS
+	jp	nc,$8000	; TYPE_FLAGS, immediate
+	jr	z,$+4		; TYPE_RELJUMP
+	bit	5,d		; TYPE_BIT
+	set	2,(iy-3)	; TYPE_BIT, CB prefix with index offset
+	rst	$28		; TYPE_RST
+	im	2		; TYPE_IM
+	neg			; TYPE_NONE, 2-byte opcode
+	ld	(ix+$7f),$55	; index offset and 8-bit immediate
+	out	(c),0		; TYPE_OUT_C_0
+	cp	-1		; 8-bit immediate
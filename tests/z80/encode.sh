@@ -0,0 +1,8 @@
+need vasmz80_psi-x
+asm z80 -Fbin -o z80.bin "$srcdir/encode.s" >z80.log 2>&1 ||
+  fail "assembling for the z80"
+check_hex z80.bin "81 1c 66 dd 70 05 fd 6f f5 11 34 12 fd 2a 67 45 dd 39 e8 d2 00 80 28 02 cb 6a fd cb fd d6 ef ed 5e ed 44 dd 36 7f 55 ed 71 fe ff"
+asm z80 -Fbin -swapixiy -o swap.bin "$srcdir/encode.s" >swap.log 2>&1 ||
+  fail "assembling with -swapixiy"
+# -swapixiy only applies to the first operand, so set 2,(iy-3) keeps fd
+check_hex swap.bin "81 1c 66 fd 70 05 dd 6f f5 11 34 12 dd 2a 67 45 fd 39 e8 d2 00 80 28 02 cb 6a fd cb fd d6 ef ed 5e ed 44 fd 36 7f 55 ed 71 fe ff"
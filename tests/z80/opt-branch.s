@@ -0,0 +1,13 @@
+; -opt-branch: jp to a near label becomes jr, an explicit jr and djnz stay
+; as written when in range and only grow with a warning when out of range
+	org 0
+start:	jr near
+	djnz near
+	jr far
+	djnz far
+	jp near
+	jp nz,near
+	jp far
+near:	nop
+	ds 200
+far:	nop
@@ -0,0 +1,11 @@
+need vasmz80_psi-x
+asm z80 -Fbin -o plain.bin "$srcdir/opt-branch.s" >plain.log 2>&1 &&
+  fail "out of range jr assembled without -opt-branch"
+asm z80 -Fbin -opt-branch -o opt.bin "$srcdir/opt-branch.s" >opt.log 2>&1 ||
+  fail "assembling with -opt-branch"
+dd if=opt.bin bs=1 count=21 2>/dev/null >head.bin
+check_hex head.bin "18 10 10 0e c3 db 00 05 c2 db 00 18 05 20 03 c3 db 00 00 00 00"
+check_grep "jr will be assembled as 'jp'" opt.log
+check_grep "djnz will be assembled as 'dec b ; jp nz'" opt.log
+[ `grep -c "will be assembled as" opt.log` = 2 ] ||
+  fail "expected exactly two warnings"
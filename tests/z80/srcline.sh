@@ -0,0 +1,20 @@
+# diagnostics quote the right source line, whatever the line terminators
+need vasmz80_psi-x
+for eol in lf crlf cr lfcr; do
+  case $eol in
+    lf) nl='\n' ;; crlf) nl='\r\n' ;; cr) nl='\r' ;; lfcr) nl='\n\r' ;;
+  esac
+  awk -v nl="$nl" 'BEGIN { gsub(/\\n/,"\n",nl); gsub(/\\r/,"\r",nl);
+    for (i = 1; i <= 2000; i++) printf "\tnop%s", nl;
+    printf "\tbogus1%s\tnop%s\tbogus2", nl, nl }' >$eol.s
+  check_fails asm z80 -Fbin -o $eol.bin $eol.s >$eol.log 2>&1
+  check_grep "error 2 in line 2001 of \"$eol.s\": unknown mnemonic <bogus1>" $eol.log
+  check_grep "^>	bogus1\$" $eol.log
+  check_grep "error 2 in line 2003 of \"$eol.s\"" $eol.log
+  check_grep "^>	bogus2\$" $eol.log
+done
+
+printf 'm\tmacro\n\tnop\n\tbogusm\n\tendm\n\tnop\n\tm\n' >mac.s
+check_fails asm z80 -Fbin -o mac.bin mac.s >mac.log 2>&1
+check_grep "in line 2 of \"m\" (line 3 of \"mac.s\")" mac.log
+check_grep "^>	bogusm\$" mac.log
@@ -9,6 +9,7 @@
 #include "osdep.h"
 #include "stabs.h"
 #include "dwarf.h"
+#include "symmap.h"
 
 #define _VER "vasm 2.0"
 const char *copyright = _VER " (c) in 2002-2024 Volker Barthelmann";
@@ -21,7 +22,12 @@ static const char *_ver = "$VER: " _VER " " __AMIGADATE__ "\r\n";
    which will hopefully never happen.
    During the first FASTOPTPHASE passes all instructions of a section are
    optimized at the same time. Thereafter the resolver enters a safe mode,
-   where only a single instruction is changed in every pass. */
+   where only a single instruction is changed in every pass.
+   With -relax=grow all instructions start with their minimum size
+   (RESOLVE_MINSIZE). After the first pass, which corrects the guesses made
+   for forward references, an instruction may shrink only once. Then it is
+   pinned to its long form by RESOLVE_WARN, so the resolver converges
+   without the need for a safe mode. */
 #define MAXPASSES 1500
 #define FASTOPTPHASE 200
 
@@ -45,7 +51,7 @@ char *filename,*debug_filename;
 source *cur_src;
 section *current_section,container_section;
 int num_secs;
-int debug,final_pass,exec_out,nostdout;
+int debug,final_pass,exec_out,nostdout,relax_grow;
 char *defsectname,*defsecttype;
 taddr defsectorg;
 
@@ -73,7 +79,7 @@ static section *secstack[SECSTACKSIZE];
 static int secstack_index;
 
 /* options */
-static char *listname,*dep_filename;
+static char *listname,*dep_filename,*symmap_name;
 static int add_uscore,dwarf,fail_on_warning;
 static int verbose=1,auto_import=1;
 static taddr sec_padding;
@@ -258,7 +264,7 @@ static void vasmdebug(const char *f,section *s,atom *a)
 static int resolve_section(section *sec)
 {
   taddr rorg_pc,org_pc;
-  int fastphase=FASTOPTPHASE;
+  int fastphase=relax_grow?maxpasses:FASTOPTPHASE;
   int pass=0;
   int done,extrapass,rorg;
   size_t size;
@@ -330,8 +336,16 @@ static int resolve_section(section *sec)
         size=atom_size(p,sec,sec->pc);
         sec->flags&=~RESOLVE_WARN;
       }
-      else
+      else{
         size=atom_size(p,sec,sec->pc);
+        if(relax_grow&&pass>1&&size<p->lastsize&&p->type==INSTRUCTION){
+          /* grow-only mode: shrink once, then ask for the long form */
+          if(debug)
+            printf("pinning atom type %d at line %d (%#lx)\n",
+                   p->type,p->line,(unsigned long)sec->pc);
+          p->changes=MAXSIZECHANGES+1;
+        }
+      }
       if(size!=p->lastsize){
         if(debug)
           printf("modify size of atom type %d at line %d (%#lx) from "
@@ -483,6 +497,13 @@ static void assemble(void)
           else
             dwarf_line(&dinfo,sec,cur_src->srcfile->index,cur_src->line);
         }
+        if(symmap_name){
+          if(cur_src->defsrc)
+            symmap_line(sec,sec->pc,cur_src->defsrc->srcfile,
+                        cur_src->defline+cur_src->line);
+          else
+            symmap_line(sec,sec->pc,cur_src->srcfile,cur_src->line);
+        }
         /*FIXME: sauber freigeben */
         myfree(p->content.inst);
         p->content.db=db;
@@ -1273,6 +1294,15 @@ int main(int argc,char **argv)
       sscanf(argv[i]+11,"%i",&maxpasses);
       continue;
     }
+    if(!strncmp("-relax=",argv[i],7)){
+      if(!strcmp(argv[i]+7,"grow"))
+        relax_grow=1;
+      else if(!strcmp(argv[i]+7,"default"))
+        relax_grow=0;
+      else
+        general_error(14,argv[i]);
+      continue;
+    }
     if(!strcmp("-nocase",argv[i])){
       nocase=1;
       continue;
@@ -1345,6 +1375,10 @@ int main(int argc,char **argv)
       inst_alignment=1;
       continue;
     }
+    if(!strncmp("-symmap=",argv[i],8)){
+      symmap_name=argv[i]+8;
+      continue;
+    }
     if(!strncmp("-dwarf",argv[i],6)){
       if(argv[i][6]=='=')
         sscanf(argv[i]+7,"%i",&dwarf);  /* get DWARF version */
@@ -1403,6 +1437,10 @@ int main(int argc,char **argv)
   parse();
   end_all_rorg();
   listena=0;
+#ifdef CPU_PRE_RESOLVE
+  if(errors==0)
+    CPU_PRE_RESOLVE(first_section);
+#endif
   if(errors==0||produce_listing)
     resolve();
   if(errors==0||produce_listing)
@@ -1410,6 +1448,10 @@ int main(int argc,char **argv)
   cur_src=NULL;
   if(errors==0)
     undef_syms();
+  if(errors==0&&symmap_name){
+    /* before absolute labels lose their section */
+    write_symmap(symmap_name,first_section,first_symbol);
+  }
   fix_labels();
   if(produce_listing){
     if(!listname)
@@ -100,6 +100,7 @@ typedef unsigned int bvtype;
 #define IN_RORG          (1<<6)       
 #define NEAR_ADDRESSING  (1<<7)
 #define FAR_ADDRESSING   (1<<8)
+#define RESOLVE_MINSIZE  (1<<9) /* select minimum size of relaxable instr. */
 #define SECRSRVD       (1L<<24) /* bits 24-31 are reserved for output modules */
 
 /* section description */
@@ -144,7 +145,7 @@ extern hashtable *mnemohash;
 extern char *filename,*debug_filename;
 extern source *cur_src;
 extern section *current_section,container_section;
-extern int num_secs,final_pass,exec_out,nostdout;
+extern int num_secs,final_pass,exec_out,nostdout,relax_grow;
 extern struct stabdef *first_nlist,*last_nlist;
 extern char emptystr[];
 extern char vasmsym_name[];
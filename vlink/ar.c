@@ -1,8 +1,8 @@
-/* $VER: vlink ar.c V0.13 (02.11.10)
+/* $VER: vlink ar.c V0.14 (18.10.26)
  *
  * This file is part of vlink, a portable linker for multiple
  * object formats.
- * Copyright (c) 1997-2010  Frank Wille
+ * Copyright (c) 1997-2026  Frank Wille
  */
 
 
@@ -10,6 +10,10 @@
 #include "vlink.h"
 
 
+/* member being converted by ar_lazyload(), see ar_init() */
+static struct ArMember *selmember;
+
+
 bool ar_init(struct ar_info *ai,char *p,unsigned long plen,const char *name)
 /* check for valid archive header and initialize ar_info, if successful */
 {
@@ -17,10 +21,17 @@ bool ar_init(struct ar_info *ai,char *p,unsigned long plen,const char *name)
   if (plen<SARMAG || strncmp(p,ARMAG,SARMAG))
     return FALSE;
 
-  memset(ai,0,sizeof(struct ar_hdr));
+  memset(ai,0,sizeof(struct ar_info));
   ai->arname = (char *)name;
   ai->next = (struct ar_hdr *)(p+SARMAG);
   ai->arlen = plen - SARMAG;
+
+  if (selmember!=NULL && (uint8_t *)p==selmember->lnkfile->data) {
+    /* lazy loading: extract only this member, in place */
+    ai->member = selmember;
+    ai->next = (struct ar_hdr *)(p+selmember->hdroffs);
+    ai->arlen = plen - selmember->hdroffs;
+  }
   return TRUE;
 }
 
@@ -46,8 +57,14 @@ bool ar_extract(struct ar_info *ai)
     sscanf(ah->ar_size,"%lu",&ai->size);  /* file size */
 
     if (!strncmp(ah->ar_name,"/ ",2) ||             /* GNU symbol table */
-        !strncmp(ah->ar_name,"__.SYMDEF ",10))      /* BSD symbol table */
+        !strncmp(ah->ar_name,"/SYM64/ ",8) ||       /* GNU 64-bit sym.tab. */
+        !strncmp(ah->ar_name,"__.SYMDEF ",10)) {    /* BSD symbol table */
+      ai->symdeftype = ah->ar_name[0]=='_' ? AR_SYMBSD :
+                       (ah->ar_name[1]==' ' ? AR_SYMGNU : AR_SYMGNU64);
+      ai->symdef = p;
+      ai->symdefsize = ai->size;
       cont = TRUE;
+    }
 
     if (!strncmp(ah->ar_name,"ARFILENAMES/",12) ||  /* GNU long names 1 */
         !strncmp(ah->ar_name,"// ",3)) {            /* GNU long names 2 */
@@ -107,5 +124,248 @@ bool ar_extract(struct ar_info *ai)
       error(37,ai->arname,ai->name);  /* Malformatted archive member */
   }
   while (cont);
+
+  if (ai->member) {
+    /* GNU long names are unknown here, so use the indexed name */
+    strcpy(ai->name,ai->member->name);
+    ai->next = NULL;
+  }
   return TRUE;
 }
+
+
+/* symbols of the archive being indexed, committed on success */
+static struct ArSymbol *newsyms;
+
+
+void ar_addsym(struct GlobalVars *gv,struct ArMember *m,const char *name)
+/* add a symbol defined by an archive member to the lazy index */
+{
+  struct ArSymbol *as = alloc(sizeof(struct ArSymbol));
+
+  as->name = name;
+  as->member = m;
+  as->next = newsyms;
+  newsyms = as;
+}
+
+
+static struct ArMember *find_member(struct ArMember *m,unsigned long n,
+                                    unsigned long hdroffs)
+/* binary search for the member with this header offset */
+{
+  unsigned long lo=0,hi=n,i;
+
+  while (lo < hi) {
+    i = (lo + hi) / 2;
+    if (m[i].hdroffs == hdroffs)
+      return &m[i];
+    if (m[i].hdroffs < hdroffs)
+      lo = i + 1;
+    else
+      hi = i;
+  }
+  return NULL;
+}
+
+
+static bool read_gnu_symdef(struct GlobalVars *gv,struct ar_info *ai,
+                            struct ArMember *m,unsigned long n)
+/* read the GNU symbol table: number of symbols, member header offsets
+   and the null-terminated symbol names, all big-endian */
+{
+  int w = ai->symdeftype==AR_SYMGNU64 ? 8 : 4;
+  uint8_t *p = ai->symdef;
+  char *s,*end = (char *)p + ai->symdefsize;
+  unsigned long i,cnt;
+  int pass;
+
+  if (ai->symdefsize < w)
+    return FALSE;
+  cnt = w==8 ? (unsigned long)read64be(p) : read32be(p);
+  if (cnt > ai->symdefsize/w - 1)
+    return FALSE;
+
+  /* verify the whole table first, then add its symbols */
+  for (pass=0; pass<2; pass++) {
+    s = (char *)p + (cnt+1)*w;
+    for (i=0; i<cnt; i++) {
+      uint8_t *o = p + (i+1)*w;
+      struct ArMember *mem;
+      char *name = s;
+
+      mem = find_member(m,n,w==8?(unsigned long)read64be(o):read32be(o));
+      if (mem == NULL || (s = memchr(s,0,end-s)) == NULL)
+        return FALSE;
+      s++;
+      if (pass) {
+        ar_addsym(gv,mem,name);
+        mem->indexed = TRUE;
+      }
+    }
+  }
+  return TRUE;
+}
+
+
+static bool read_bsd_symdef(struct GlobalVars *gv,struct ar_info *ai,
+                            struct ArMember *m,unsigned long n)
+/* read the BSD ranlib table, which is written in host byte order */
+{
+  uint8_t *p = ai->symdef;
+  unsigned long i,rsize,ssize;
+  int be,pass;
+
+  if (ai->symdefsize < 8)
+    return FALSE;
+
+  for (be=1; be>=0; be--) {
+    rsize = read32(be,p);
+    if ((rsize & 7) || rsize > ai->symdefsize-8)
+      continue;
+    ssize = read32(be,p+4+rsize);
+    if (ssize > ai->symdefsize-8-rsize)
+      continue;
+
+    for (pass=0; pass<2; pass++) {
+      char *strtab = (char *)p + 8 + rsize;
+
+      for (i=0; i<rsize; i+=8) {
+        unsigned long strx = read32(be,p+4+i);
+        struct ArMember *mem = find_member(m,n,read32(be,p+8+i));
+
+        if (mem==NULL || strx>=ssize || !memchr(strtab+strx,0,ssize-strx))
+          break;
+        if (pass) {
+          ar_addsym(gv,mem,strtab+strx);
+          mem->indexed = TRUE;
+        }
+      }
+      if (i < rsize)
+        break;  /* try the other byte order */
+    }
+    if (pass == 2)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+
+static bool scan_member(struct GlobalVars *gv,struct ArMember *m)
+/* index a member which is missing in the archive symbol table */
+{
+#if defined(ELF32) || defined(ELF64)
+  if (elf_arsyms(gv,m))
+    return TRUE;
+#endif
+#ifdef VOBJ
+  if (vobj_arsyms(gv,m))
+    return TRUE;
+#endif
+  return FALSE;
+}
+
+
+bool ar_lazyindex(struct GlobalVars *gv,struct LinkFile *lf)
+/* Read the archive's symbol table, or build one by scanning the members,
+   so that members are only converted when one of their symbols is
+   needed. Returns FALSE when the archive has to be loaded completely. */
+{
+  struct ar_info ai;
+  struct ArMember *m;
+  struct ArSymbol *as;
+  unsigned long i,n;
+  bool ok = TRUE;
+
+  if (!ar_init(&ai,(char *)lf->data,lf->length,lf->filename))
+    return FALSE;
+  for (n=0; ar_extract(&ai); n++);
+  if (n == 0)
+    return FALSE;
+  m = alloczero(n * sizeof(struct ArMember));
+
+  ar_init(&ai,(char *)lf->data,lf->length,lf->filename);
+  for (i=0; i<n && ar_extract(&ai); i++) {
+    m[i].lnkfile = lf;
+    m[i].name = allocstring(ai.name);
+    m[i].data = ai.data;
+    m[i].size = ai.size;
+    m[i].hdroffs = (uint8_t *)ai.header - lf->data;
+    m[i].order = gv->unit_order + i;
+  }
+
+  if (ai.symdeftype == AR_SYMBSD)
+    read_bsd_symdef(gv,&ai,m,n);
+  else if (ai.symdeftype)
+    read_gnu_symdef(gv,&ai,m,n);
+
+  for (i=0; i<n && ok; i++) {
+    if (!m[i].indexed)
+      ok = scan_member(gv,&m[i]);
+  }
+
+  if (!ok) {
+    /* unknown member format: discard the index and load everything */
+    while (as = newsyms) {
+      newsyms = as->next;
+      free(as);
+    }
+    for (i=0; i<n; i++)
+      free((void *)m[i].name);
+    free(m);
+    return FALSE;
+  }
+
+  if (gv->arsyms == NULL)
+    gv->arsyms = alloc_hashtable(SYMHTABSIZE);
+  while (as = newsyms) {
+    struct ArSymbol **chain = &gv->arsyms[elf_hash(as->name)%SYMHTABSIZE];
+
+    newsyms = as->next;
+    as->next = *chain;
+    *chain = as;
+  }
+  gv->unit_order += n;
+  return TRUE;
+}
+
+
+static void load_member(struct GlobalVars *gv,struct ArMember *m)
+/* Convert a single archive member. The target's readconv function sees
+   the whole archive, but ar_init() restricts it to this member. */
+{
+  unsigned long order = gv->unit_order;
+
+  m->loaded = TRUE;
+  selmember = m;
+  gv->unit_order = m->order;
+  fff[m->lnkfile->format]->readconv(gv,m->lnkfile);
+  gv->unit_order = order;
+  selmember = NULL;
+}
+
+
+void ar_lazyload(struct GlobalVars *gv,const char *name,unsigned long hash)
+/* convert all archive members defining this symbol, in link order */
+{
+  struct ArSymbol *as,**chain;
+  struct ArMember *m;
+
+  do {
+    m = NULL;
+    chain = &gv->arsyms[hash%SYMHTABSIZE];
+    while (as = *chain) {
+      if (as->member->loaded) {
+        *chain = as->next;  /* remove entries of converted members */
+        free(as);
+        continue;
+      }
+      if (!strcmp(as->name,name) && (m==NULL || as->member->order<m->order))
+        m = as->member;
+      chain = &as->next;
+    }
+    if (m)
+      load_member(gv,m);
+  }
+  while (m);
+}
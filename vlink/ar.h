@@ -1,8 +1,8 @@
-/* $VER: vlink ar.h V0.13 (02.11.10)
+/* $VER: vlink ar.h V0.14 (18.10.26)
  *
  * This file is part of vlink, a portable linker for multiple
  * object formats.
- * Copyright (c) 1997-2010  Frank Wille
+ * Copyright (c) 1997-2026  Frank Wille
  */
 
 
@@ -31,10 +31,46 @@ struct ar_info {
   struct ar_hdr *header;        /* current header */
   uint8_t *data;                 /* pointer to archive member */
   unsigned long size;           /*  and its size in bytes */
+  uint8_t *symdef;              /* archive symbol table, or NULL */
+  unsigned long symdefsize;     /*  its size in bytes */
+  int symdeftype;               /*  and its format */
+  struct ArMember *member;      /* only member to extract, or NULL */
+};
+
+#define AR_SYMGNU   1           /* GNU "/" symbol table */
+#define AR_SYMGNU64 2           /* GNU "/SYM64/" symbol table */
+#define AR_SYMBSD   3           /* BSD "__.SYMDEF" ranlib table */
+
+struct ArMember {               /* member of a lazily loaded archive */
+  struct LinkFile *lnkfile;
+  const char *name;
+  uint8_t *data;
+  unsigned long size;
+  unsigned long hdroffs;        /* file offset of the member header */
+  unsigned long order;          /* ObjectUnit order, when converted */
+  bool indexed;                 /* symbols found in archive symbol table */
+  bool loaded;                  /* member was converted */
+};
+
+struct ArSymbol {               /* lazy archive symbol index entry */
+  struct ArSymbol *next;
+  const char *name;
+  struct ArMember *member;
 };
 
 
 #ifndef AR_C
 extern bool ar_init(struct ar_info *,char *,unsigned long,const char *);
 extern bool ar_extract(struct ar_info *);
+extern void ar_addsym(struct GlobalVars *,struct ArMember *,const char *);
+extern bool ar_lazyindex(struct GlobalVars *,struct LinkFile *);
+extern void ar_lazyload(struct GlobalVars *,const char *,unsigned long);
+#endif
+
+/* members are scanned for symbols, when there is no symbol table */
+#if defined(ELF32) || defined(ELF64)
+bool elf_arsyms(struct GlobalVars *,struct ArMember *);
+#endif
+#ifdef VOBJ
+bool vobj_arsyms(struct GlobalVars *,struct ArMember *);
 #endif
@@ -189,6 +189,107 @@ void elf_check_offset(struct LinkFile *lf,char *tabname,void *data,lword size)
 }
 
 
+bool elf_arsyms(struct GlobalVars *gv,struct ArMember *m)
+/* add the global symbol definitions of an ELF archive member to the
+   lazy archive index, returns FALSE when it is no ELF relocatable */
+{
+  struct Elf_CommonHdr *hdr = (struct Elf_CommonHdr *)m->data;
+  uint64_t shoff,off,size,stroff,strsize,entsize,j;
+  unsigned shnum,shentsize,i,link;
+  bool be,c64;
+
+  if (m->size<sizeof(struct Elf64_Ehdr) || strncmp((char *)hdr->e_ident,ELFid,4))
+    return FALSE;
+  be = hdr->e_ident[EI_DATA] == ELFDATA2MSB;
+  c64 = hdr->e_ident[EI_CLASS] == ELFCLASS64;
+  if (read16(be,hdr->e_type) != ET_REL)
+    return FALSE;
+  if (c64) {
+    struct Elf64_Ehdr *eh = (struct Elf64_Ehdr *)m->data;
+
+    shoff = read64(be,eh->e_shoff);
+    shnum = read16(be,eh->e_shnum);
+    shentsize = read16(be,eh->e_shentsize);
+  }
+  else {
+    struct Elf32_Ehdr *eh = (struct Elf32_Ehdr *)m->data;
+
+    shoff = read32(be,eh->e_shoff);
+    shnum = read16(be,eh->e_shnum);
+    shentsize = read16(be,eh->e_shentsize);
+  }
+  if (shentsize < (c64 ? sizeof(struct Elf64_Shdr) : sizeof(struct Elf32_Shdr))
+      || shoff > m->size || shnum > (m->size - shoff) / shentsize)
+    return FALSE;
+
+  for (i=0; i<shnum; i++) {
+    uint8_t *sh = m->data + shoff + i*shentsize;
+    uint8_t *strsh;
+
+    if (read32(be,sh+4) != SHT_SYMTAB)  /* sh_type */
+      continue;
+    if (c64) {
+      struct Elf64_Shdr *s = (struct Elf64_Shdr *)sh;
+
+      off = read64(be,s->sh_offset);
+      size = read64(be,s->sh_size);
+      entsize = read64(be,s->sh_entsize);
+      link = read32(be,s->sh_link);
+    }
+    else {
+      struct Elf32_Shdr *s = (struct Elf32_Shdr *)sh;
+
+      off = read32(be,s->sh_offset);
+      size = read32(be,s->sh_size);
+      entsize = read32(be,s->sh_entsize);
+      link = read32(be,s->sh_link);
+    }
+    if (link >= shnum || entsize < (c64 ? sizeof(struct Elf64_Sym) :
+                                          sizeof(struct Elf32_Sym)) ||
+        off > m->size || size > m->size - off)
+      return FALSE;
+    strsh = m->data + shoff + link*shentsize;
+    if (c64) {
+      stroff = read64(be,((struct Elf64_Shdr *)strsh)->sh_offset);
+      strsize = read64(be,((struct Elf64_Shdr *)strsh)->sh_size);
+    }
+    else {
+      stroff = read32(be,((struct Elf32_Shdr *)strsh)->sh_offset);
+      strsize = read32(be,((struct Elf32_Shdr *)strsh)->sh_size);
+    }
+    if (stroff > m->size || strsize > m->size - stroff)
+      return FALSE;
+
+    for (j=entsize; j+entsize<=size; j+=entsize) {
+      uint8_t *sym = m->data + off + j;
+      uint32_t name;
+      uint8_t info;
+      uint16_t shndx;
+
+      if (c64) {
+        name = read32(be,((struct Elf64_Sym *)sym)->st_name);
+        info = ((struct Elf64_Sym *)sym)->st_info[0];
+        shndx = read16(be,((struct Elf64_Sym *)sym)->st_shndx);
+      }
+      else {
+        name = read32(be,((struct Elf32_Sym *)sym)->st_name);
+        info = ((struct Elf32_Sym *)sym)->st_info[0];
+        shndx = read16(be,((struct Elf32_Sym *)sym)->st_shndx);
+      }
+      if ((ELF32_ST_BIND(info)==STB_GLOBAL || ELF32_ST_BIND(info)==STB_WEAK)
+          && ELF32_ST_TYPE(info)!=STT_SECTION && shndx!=SHN_UNDEF) {
+        char *s = (char *)m->data + stroff + name;
+
+        if (name >= strsize || !memchr(s,0,strsize-name))
+          return FALSE;
+        ar_addsym(gv,m,s);
+      }
+    }
+  }
+  return TRUE;
+}
+
+
 struct Section *elf_add_section(struct GlobalVars *gv,struct ObjectUnit *ou,
                                 char *name,uint8_t *data,lword size,
                                 uint32_t shtype,uint64_t shflags,uint8_t align)
@@ -9,6 +9,16 @@
 #define ERRORS_C
 #include "vlink.h"
 
+#ifdef PTHREADS
+#include <pthread.h>
+static pthread_mutex_t errlock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_ERRORS pthread_mutex_lock(&errlock)
+#define UNLOCK_ERRORS pthread_mutex_unlock(&errlock)
+#else
+#define LOCK_ERRORS
+#define UNLOCK_ERRORS
+#endif
+
 
 /* error flags */
 #define EF_NONE 0
@@ -233,6 +243,8 @@ static struct {
     "%s=%#llx%c%#llx (value to write: %s%#llx) doesn't fit into %d bits",EF_ERROR,
   "%s line %d: Maximum of %d sorting levels exceeded",EF_ERROR,
   "%s line %d: Multiple EXCLUDE_%s commands in one pattern",EF_ERROR,
+  "Incremental link of %s not possible (%s), doing a full link",EF_WARNING,
+  "No incremental link state saved for %s (%s)",EF_WARNING,         /* 170 */
 };
 
 
@@ -249,33 +261,93 @@ void disable_warning(int errn)
 }
 
 
-void ierror(char *errtxt,...)
-/* display internal error and quit */
+/* A worker thread with an ErrorBuffer records its diagnostics, which
+   are printed by flush_errors() in the main thread, in link order. */
+struct ErrorRecord {
+  struct ErrorRecord *next;
+  int errn;                     /* ERR_INTERNAL, ERR_CONTEXT or error */
+  const void *key;              /* context of ERR_CONTEXT */
+  char txt[];
+};
+#define ERR_INTERNAL (-1)
+#define ERR_CONTEXT (-2)
+
+static THREADLOCAL struct ErrorBuffer *errbuf;
+static const void *last_context;  /* key of the last context printed */
+
+
+void buffer_errors(struct ErrorBuffer *eb)
+/* record the calling thread's diagnostics in eb, NULL prints them again */
 {
-  struct GlobalVars *gv = &gvars;
-  va_list vl;
+  errbuf = eb;
+}
 
+
+static bool record_error(int errn,const void *key,const char *fmt,
+                         va_list vl)
+/* Append a diagnostic to the thread's ErrorBuffer, or return FALSE
+   when there is no memory to do so. A fatal error returns to the
+   worker, which has to stop. */
+{
+  struct ErrorRecord *er;
+  va_list vl2;
+  int len;
+
+  va_copy(vl2,vl);
+  len = vsnprintf(NULL,0,fmt,vl2);
+  va_end(vl2);
+  if (len<0 || (er = malloc(sizeof(struct ErrorRecord)+len+1)) == NULL)
+    return FALSE;
+  vsnprintf(er->txt,len+1,fmt,vl);
+  er->errn = errn;
+  er->key = key;
+  er->next = NULL;
+  if (errbuf->last)
+    errbuf->last->next = er;
+  else
+    errbuf->first = er;
+  errbuf->last = er;
+
+  if (errn==ERR_INTERNAL ||
+      (errn>=0 && (errors[errn].flags & EF_TYPEMASK)==EF_FATAL)) {
+    errbuf->fatal = TRUE;
+    longjmp(errbuf->abort,1);
+  }
+  return TRUE;
+}
+
+
+static void print_ierror(struct GlobalVars *gv,const char *errtxt,va_list vl)
+{
   fprintf(stderr,"\nINTERNAL ERROR: ");
-  va_start(vl,errtxt);
   vfprintf(stderr,errtxt,vl);
-  va_end(vl);
   fprintf(stderr,".\nAborting.\n");
   gv->returncode = EXIT_FAILURE;
   cleanup(gv);
 }
 
 
-void error(int errn,...)
-/* prints errors and warnings */
+void ierror(char *errtxt,...)
+/* display internal error and quit */
 {
   struct GlobalVars *gv = &gvars;
   va_list vl;
+
+  va_start(vl,errtxt);
+  if (errbuf==NULL || !record_error(ERR_INTERNAL,NULL,errtxt,vl))
+    print_ierror(gv,errtxt,vl);
+  va_end(vl);
+}
+
+
+static void print_error(struct GlobalVars *gv,int errn,const char *fmt,
+                        va_list vl)
+/* prints errors and warnings */
+{
   char *errtype;
   int flags = errors[errn].flags & EF_TYPEMASK;
 
-  if ((flags == EF_WARNING) &&
-      (gv->dontwarn || (errors[errn].flags & EF_DISABLED)))
-    return;
+  LOCK_ERRORS;  /* worker threads may report errors, too */
   switch(flags) {
     case EF_WARNING:
       ++gv->warncnt;
@@ -298,9 +370,7 @@ void error(int errn,...)
 
   /* print error message */
   fprintf(stderr,"%s %d: ",errtype,errn);
-  va_start(vl,errn);
-  vfprintf(stderr,errors[errn].txt,vl);
-  va_end(vl);
+  vfprintf(stderr,fmt,vl);
   fprintf(stderr,".\n");
 
   switch(flags) {
@@ -310,15 +380,91 @@ void error(int errn,...)
         gv->errcnt = 0;
         fprintf(stdout,"Do you want to continue (y/n) ? ");
         fflush(stdin);
-        if (toupper((unsigned char)getchar()) == 'N')
+        if (toupper((unsigned char)getchar()) == 'N') {
+          UNLOCK_ERRORS;
           cleanup(gv);
+        }
       }
       /* avoid writing of output file in error case */
       gv->errflag = TRUE;
       break;
     case EF_FATAL:
       fprintf(stderr,"Aborting.\n");  /* fatal error aborts the linker */
+      UNLOCK_ERRORS;
       cleanup(gv);
       break;
   }
+  UNLOCK_ERRORS;
+}
+
+
+static void print_context(const void *key,const char *fmt,va_list vl)
+{
+  LOCK_ERRORS;
+  if (key != last_context) {
+    last_context = key;
+    vfprintf(stderr,fmt,vl);
+  }
+  UNLOCK_ERRORS;
+}
+
+
+void error_context(const void *key,const char *fmt,...)
+/* Print a line about the context of the following diagnostics, like the
+   function they occur in, unless the last context printed had the same
+   key. A worker thread records it, so it is checked in link order. */
+{
+  va_list vl;
+
+  va_start(vl,fmt);
+  if (errbuf==NULL || !record_error(ERR_CONTEXT,key,fmt,vl))
+    print_context(key,fmt,vl);
+  va_end(vl);
+}
+
+
+static void replay_error(struct GlobalVars *gv,struct ErrorRecord *er,
+                         const char *fmt,...)
+{
+  va_list vl;
+
+  va_start(vl,fmt);
+  if (er->errn == ERR_INTERNAL)
+    print_ierror(gv,fmt,vl);
+  else if (er->errn == ERR_CONTEXT)
+    print_context(er->key,fmt,vl);
+  else
+    print_error(gv,er->errn,fmt,vl);
+  va_end(vl);
+}
+
+
+void flush_errors(struct ErrorBuffer *eb)
+/* print the diagnostics recorded in eb and free them */
+{
+  struct GlobalVars *gv = &gvars;
+  struct ErrorRecord *er;
+
+  while (er = eb->first) {
+    eb->first = er->next;
+    replay_error(gv,er,"%s",er->txt);
+    free(er);
+  }
+  eb->last = NULL;
+}
+
+
+void error(int errn,...)
+/* prints errors and warnings, or records them in a worker thread */
+{
+  struct GlobalVars *gv = &gvars;
+  va_list vl;
+
+  if (((errors[errn].flags & EF_TYPEMASK) == EF_WARNING) &&
+      (gv->dontwarn || (errors[errn].flags & EF_DISABLED)))
+    return;
+  va_start(vl,errn);
+  if (errbuf==NULL || !record_error(errn,NULL,errors[errn].txt,vl))
+    print_error(gv,errn,errors[errn].txt,vl);
+  va_end(vl);
 }
@@ -0,0 +1,1395 @@
+/* incr.c  incremental linking for vlink */
+/* (c) in 2026 by agent@local */
+
+
+#define INCR_C
+#include "vlink.h"
+
+/* Incremental linking.
+   A full link with -incremental saves its state beside the output file:
+   the output sections, the resolved global symbols, and the placement and
+   exported symbols of each object file's sections. The next link with the
+   same options compares all input files with this state. When only object
+   files have changed, their sections still fit into the space they had in
+   the previous layout, and their global symbols and references can be
+   resolved by the saved symbols, then just these sections are copied and
+   relocated into the existing output file. Everything else causes a
+   full link. */
+
+#define STATE_EXT ".vli"
+#define STATE_MAGIC "VLIS"
+#define STATE_VERSION 1
+
+#define NOSEC (-1)              /* absolute symbol */
+#define AMBIGUOUS (-2)          /* symbol has more than one definition */
+
+#define FNV_INIT 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+struct IncrSection {            /* output section */
+  const char *name;
+  lword base;
+  unsigned long size;
+  long filepos;                 /* file offset of its contents or -1 */
+  lword memid;
+  uint16_t ld_flags;
+  uint8_t flags;
+  struct LinkedSection *ls;     /* while saving */
+};
+
+struct IncrSymbol {             /* resolved global symbol */
+  const char *name;
+  int32_t sec;                  /* output section, NOSEC or AMBIGUOUS */
+  lword value;
+};
+
+struct IncrInput {              /* linked section of an object file */
+  const char *name;
+  int32_t sec;                  /* output section */
+  unsigned long offset;         /* offset in output section */
+  unsigned long size;
+  unsigned long slot;           /* space until the next input section */
+  uint16_t gapfill;             /* pattern to fill the rest of the slot */
+  uint8_t type;
+  uint8_t flags;
+  uint8_t hasdata;
+  struct Section *s;            /* while saving */
+};
+
+struct IncrExport {             /* global symbol defined by an object file */
+  const char *name;
+  int32_t sec;                  /* input section index or NOSEC */
+  lword value;                  /* offset in input section or abs. value */
+  uint8_t type;
+  uint8_t bind;
+};
+
+struct IncrFile {
+  const char *path;
+  uint8_t type;                 /* ID_OBJECT, ID_LIBARCH, ... */
+  uint64_t size;
+  uint64_t hash;
+  const char *nopatch;          /* why it can't be relinked, or NULL */
+  uint32_t nsecs;
+  struct IncrInput *secs;
+  uint32_t nexps;
+  struct IncrExport *exps;      /* sorted by name */
+};
+
+struct IncrState {
+  uint32_t nargs;
+  const char **args;            /* command line */
+  uint32_t ninputs;
+  const char **inputs;          /* input files and -l libraries */
+  int8_t endianness;
+  uint8_t bits_per_taddr;
+  uint8_t bits_per_tbyte;
+  uint64_t scripthash;
+  uint64_t outsize;
+  uint64_t outhash;
+  uint32_t nsecs;
+  struct IncrSection *secs;
+  uint32_t nsyms;
+  struct IncrSymbol *syms;      /* sorted by name */
+  uint32_t nfiles;
+  struct IncrFile *files;
+};
+
+struct IncrUnit {               /* changed object file to relink */
+  struct IncrFile *file;
+  struct ObjectUnit *ou;
+  struct Section **secs;        /* new section for each IncrInput */
+  uint64_t size;
+  uint64_t hash;
+};
+
+struct StateBuf {
+  uint8_t *data;
+  size_t len;
+  size_t size;
+  bool bad;                     /* read beyond the end */
+};
+
+static struct IncrState state;  /* collected during a full link */
+static const char *unsupported; /* reason why the state is not saved */
+static char reasonbuf[FNAMEBUFSIZE+128];
+
+
+static uint64_t fnv1a(uint64_t h,const uint8_t *p,size_t n)
+{
+  while (n--)
+    h = (h ^ *p++) * FNV_PRIME;
+  return h;
+}
+
+
+static bool hashfile(const char *name,uint64_t *size,uint64_t *hash)
+/* determine size and content hash of a file */
+{
+  uint8_t buf[0x4000];
+  uint64_t s=0,h=FNV_INIT;
+  size_t n;
+  FILE *f;
+
+  if (!(f = fopen(name,"rb")))
+    return FALSE;
+  while ((n = fread(buf,1,sizeof(buf),f)) > 0) {
+    h = fnv1a(h,buf,n);
+    s += n;
+  }
+  fclose(f);
+  *size = s;
+  *hash = h;
+  return TRUE;
+}
+
+
+static char *statename(struct GlobalVars *gv)
+{
+  static char *name;
+
+  if (name == NULL) {
+    name = alloc(strlen(gv->dest_name)+sizeof(STATE_EXT));
+    sprintf(name,"%s%s",gv->dest_name,STATE_EXT);
+  }
+  return name;
+}
+
+
+static const char *why(const char *fmt,const char *s1,const char *s2)
+/* format a reason for falling back to a full link */
+{
+  snprintf(reasonbuf,sizeof(reasonbuf),fmt,s1,s2);
+  return reasonbuf;
+}
+
+
+static int symname_cmp(const void *a,const void *b)
+{
+  return strcmp(((struct IncrSymbol *)a)->name,((struct IncrSymbol *)b)->name);
+}
+
+
+static int export_cmp(const void *a,const void *b)
+{
+  return strcmp(((struct IncrExport *)a)->name,((struct IncrExport *)b)->name);
+}
+
+
+static struct IncrSymbol *find_incrsym(struct IncrState *st,const char *name)
+{
+  struct IncrSymbol key;
+
+  key.name = name;
+  return bsearch(&key,st->syms,st->nsyms,sizeof(struct IncrSymbol),
+                 symname_cmp);
+}
+
+
+/* state file encoding, all numbers are big-endian */
+
+static void put(struct StateBuf *b,const void *p,size_t n)
+{
+  if (b->len+n > b->size) {
+    b->size = (b->len+n) * 2;
+    b->data = re_alloc(b->data,b->size);
+  }
+  memcpy(b->data+b->len,p,n);
+  b->len += n;
+}
+
+
+static void put8(struct StateBuf *b,uint8_t v)
+{
+  put(b,&v,1);
+}
+
+
+static void put16(struct StateBuf *b,uint16_t v)
+{
+  uint8_t d[2];
+
+  write16be(d,v);
+  put(b,d,2);
+}
+
+
+static void put32(struct StateBuf *b,uint32_t v)
+{
+  uint8_t d[4];
+
+  write32be(d,v);
+  put(b,d,4);
+}
+
+
+static void put64(struct StateBuf *b,uint64_t v)
+{
+  uint8_t d[8];
+
+  write64be(d,v);
+  put(b,d,8);
+}
+
+
+static void putstr(struct StateBuf *b,const char *s)
+{
+  size_t n = strlen(s);
+
+  put32(b,(uint32_t)n);
+  put(b,s,n);
+}
+
+
+static uint8_t *get(struct StateBuf *b,size_t n)
+{
+  uint8_t *p;
+
+  if (b->bad || n > b->size-b->len) {
+    b->bad = TRUE;
+    return NULL;
+  }
+  p = b->data + b->len;
+  b->len += n;
+  return p;
+}
+
+
+static uint8_t get8(struct StateBuf *b)
+{
+  uint8_t *p = get(b,1);
+
+  return p ? *p : 0;
+}
+
+
+static uint16_t get16(struct StateBuf *b)
+{
+  uint8_t *p = get(b,2);
+
+  return p ? read16be(p) : 0;
+}
+
+
+static uint32_t get32(struct StateBuf *b)
+{
+  uint8_t *p = get(b,4);
+
+  return p ? read32be(p) : 0;
+}
+
+
+static uint64_t get64(struct StateBuf *b)
+{
+  uint8_t *p = get(b,8);
+
+  return p ? read64be(p) : 0;
+}
+
+
+static const char *getstr(struct StateBuf *b)
+{
+  uint32_t n = get32(b);
+  uint8_t *p = get(b,n);
+  char *s;
+
+  if (p == NULL)
+    return "";
+  s = alloc(n+1);
+  memcpy(s,p,n);
+  s[n] = '\0';
+  return s;
+}
+
+
+static void *getarray(struct StateBuf *b,uint32_t *n,size_t elsize)
+/* read an array size, which can't be larger than the remaining data */
+{
+  *n = get32(b);
+  if (b->bad || *n > b->size-b->len) {
+    b->bad = TRUE;
+    *n = 0;
+  }
+  return alloczero((*n+1)*elsize);
+}
+
+
+static void write_state(struct GlobalVars *gv,struct IncrState *st)
+{
+  struct StateBuf b;
+  const char *name = statename(gv);
+  uint32_t i,j;
+  FILE *f;
+
+  memset(&b,0,sizeof(b));
+  put(&b,STATE_MAGIC,4);
+  put32(&b,STATE_VERSION);
+  put8(&b,(uint8_t)st->endianness);
+  put8(&b,st->bits_per_taddr);
+  put8(&b,st->bits_per_tbyte);
+  put8(&b,0);
+  put64(&b,st->scripthash);
+  put64(&b,st->outsize);
+  put64(&b,st->outhash);
+
+  put32(&b,st->nargs);
+  for (i=0; i<st->nargs; i++)
+    putstr(&b,st->args[i]);
+  put32(&b,st->ninputs);
+  for (i=0; i<st->ninputs; i++)
+    putstr(&b,st->inputs[i]);
+
+  put32(&b,st->nsecs);
+  for (i=0; i<st->nsecs; i++) {
+    struct IncrSection *is = &st->secs[i];
+
+    putstr(&b,is->name);
+    put64(&b,(uint64_t)is->base);
+    put64(&b,is->size);
+    put64(&b,(uint64_t)(int64_t)is->filepos);
+    put64(&b,(uint64_t)is->memid);
+    put16(&b,is->ld_flags);
+    put8(&b,is->flags);
+    put8(&b,0);
+  }
+
+  put32(&b,st->nsyms);
+  for (i=0; i<st->nsyms; i++) {
+    putstr(&b,st->syms[i].name);
+    put32(&b,(uint32_t)st->syms[i].sec);
+    put64(&b,(uint64_t)st->syms[i].value);
+  }
+
+  put32(&b,st->nfiles);
+  for (i=0; i<st->nfiles; i++) {
+    struct IncrFile *f = &st->files[i];
+
+    putstr(&b,f->path);
+    put8(&b,f->type);
+    put8(&b,f->nopatch!=NULL);
+    put16(&b,0);
+    put64(&b,f->size);
+    put64(&b,f->hash);
+    if (f->nopatch)
+      putstr(&b,f->nopatch);
+    put32(&b,f->nsecs);
+    for (j=0; j<f->nsecs; j++) {
+      struct IncrInput *in = &f->secs[j];
+
+      putstr(&b,in->name);
+      put32(&b,(uint32_t)in->sec);
+      put64(&b,in->offset);
+      put64(&b,in->size);
+      put64(&b,in->slot);
+      put16(&b,in->gapfill);
+      put8(&b,in->type);
+      put8(&b,in->flags);
+      put8(&b,in->hasdata);
+      put8(&b,0);
+    }
+    put32(&b,f->nexps);
+    for (j=0; j<f->nexps; j++) {
+      struct IncrExport *ex = &f->exps[j];
+
+      putstr(&b,ex->name);
+      put32(&b,(uint32_t)ex->sec);
+      put64(&b,(uint64_t)ex->value);
+      put8(&b,ex->type);
+      put8(&b,ex->bind);
+    }
+  }
+
+  if (f = fopen(name,"wb")) {
+    if (fwrite(b.data,1,b.len,f) != b.len) {
+      fclose(f);
+      remove(name);
+      error(170,gv->dest_name,"write error");
+    }
+    else
+      fclose(f);
+  }
+  else
+    error(170,gv->dest_name,"cannot create state file");
+  free(b.data);
+}
+
+
+static bool read_state(struct StateBuf *b,struct IncrState *st)
+{
+  uint32_t i,j;
+  uint8_t *p;
+
+  memset(st,0,sizeof(struct IncrState));
+  if (!(p = get(b,4)) || memcmp(p,STATE_MAGIC,4) ||
+      get32(b) != STATE_VERSION)
+    return FALSE;
+  st->endianness = (int8_t)get8(b);
+  st->bits_per_taddr = get8(b);
+  st->bits_per_tbyte = get8(b);
+  get8(b);
+  st->scripthash = get64(b);
+  st->outsize = get64(b);
+  st->outhash = get64(b);
+
+  st->args = getarray(b,&st->nargs,sizeof(char *));
+  for (i=0; i<st->nargs; i++)
+    st->args[i] = getstr(b);
+  st->inputs = getarray(b,&st->ninputs,sizeof(char *));
+  for (i=0; i<st->ninputs; i++)
+    st->inputs[i] = getstr(b);
+
+  st->secs = getarray(b,&st->nsecs,sizeof(struct IncrSection));
+  for (i=0; i<st->nsecs; i++) {
+    struct IncrSection *is = &st->secs[i];
+
+    is->name = getstr(b);
+    is->base = (lword)get64(b);
+    is->size = (unsigned long)get64(b);
+    is->filepos = (long)(int64_t)get64(b);
+    is->memid = (lword)get64(b);
+    is->ld_flags = get16(b);
+    is->flags = get8(b);
+    get8(b);
+  }
+
+  st->syms = getarray(b,&st->nsyms,sizeof(struct IncrSymbol));
+  for (i=0; i<st->nsyms; i++) {
+    st->syms[i].name = getstr(b);
+    st->syms[i].sec = (int32_t)get32(b);
+    st->syms[i].value = (lword)get64(b);
+    if (st->syms[i].sec >= (int32_t)st->nsecs)
+      b->bad = TRUE;
+  }
+
+  st->files = getarray(b,&st->nfiles,sizeof(struct IncrFile));
+  for (i=0; i<st->nfiles; i++) {
+    struct IncrFile *f = &st->files[i];
+    bool nopatch;
+
+    f->path = getstr(b);
+    f->type = get8(b);
+    nopatch = get8(b) != 0;
+    get16(b);
+    f->size = get64(b);
+    f->hash = get64(b);
+    if (nopatch)
+      f->nopatch = getstr(b);
+    f->secs = getarray(b,&f->nsecs,sizeof(struct IncrInput));
+    for (j=0; j<f->nsecs; j++) {
+      struct IncrInput *in = &f->secs[j];
+
+      in->name = getstr(b);
+      in->sec = (int32_t)get32(b);
+      in->offset = (unsigned long)get64(b);
+      in->size = (unsigned long)get64(b);
+      in->slot = (unsigned long)get64(b);
+      in->gapfill = get16(b);
+      in->type = get8(b);
+      in->flags = get8(b);
+      in->hasdata = get8(b);
+      get8(b);
+      if (in->sec<0 || in->sec>=(int32_t)st->nsecs ||
+          in->offset+in->slot > st->secs[in->sec].size)
+        b->bad = TRUE;
+    }
+    f->exps = getarray(b,&f->nexps,sizeof(struct IncrExport));
+    for (j=0; j<f->nexps; j++) {
+      struct IncrExport *ex = &f->exps[j];
+
+      ex->name = getstr(b);
+      ex->sec = (int32_t)get32(b);
+      ex->value = (lword)get64(b);
+      ex->type = get8(b);
+      ex->bind = get8(b);
+    }
+  }
+  return !b->bad && b->len==b->size;
+}
+
+
+static const char **cmdline(struct GlobalVars *gv,int argc,const char *argv[],
+                            uint32_t *n)
+/* the command line options, target options were already removed */
+{
+  const char **args = alloc((argc+1)*sizeof(char *));
+  int i;
+
+  args[0] = fff[gv->dest_format]->tname;
+  for (i=1; i<argc; i++)
+    args[i] = argv[i] ? argv[i] : "";
+  *n = argc;
+  return args;
+}
+
+
+static const char *check_options(struct GlobalVars *gv)
+/* return why the output of this link can't be relinked incrementally */
+{
+  if (gv->dest_object || gv->dest_sharedobj)
+    return "relocatable or shared output";
+  if (gv->dynamic)
+    return "dynamic linking";
+  if (gv->output_sections)
+    return "output file per section";
+  if (gv->gc_sects != GCS_NONE)
+    return "section garbage collection";
+  if (gv->icf != ICF_NONE)
+    return "identical section folding";
+  if (gv->map_file || gv->jsonmap_file || gv->sym_file || gv->lineoffsfile)
+    return "map, symbol or line-offsets file";
+  if (gv->keep_relocs && (fff[gv->dest_format]->flags & FFF_KEEPRELOCS))
+    return "relocations in output file";
+  if (gv->masked_symbols || fff[gv->dest_format]->fndsymbol)
+    return "target-specific symbol lookup";
+  if (gv->octets_per_tbyte != 1)
+    return "target bytes with more than 8 bits";
+  return NULL;
+}
+
+
+static int32_t secindex(struct LinkedSection *ls)
+{
+  uint32_t i;
+
+  for (i=0; i<state.nsecs; i++) {
+    if (state.secs[i].ls == ls)
+      return (int32_t)i;
+  }
+  return NOSEC;
+}
+
+
+static void collect_symbols(struct GlobalVars *gv)
+/* Save the definition of each global symbol, which was used by the link.
+   Names with more than one definition are only marked as ambiguous. */
+{
+  struct GlobSymTab *t = &gv->symbols;
+  struct Symbol *sym,*def;
+  uint32_t i;
+  int n;
+
+  state.syms = alloc((t->nent+1)*sizeof(struct IncrSymbol));
+  for (i=0; i<t->nent; i++) {
+    struct IncrSymbol *is;
+
+    for (def=NULL,n=0,sym=t->ent[i].chain; sym; sym=sym->glob_chain) {
+      if (sym->relsect!=NULL && sym->relsect->obj!=NULL &&
+          !(sym->relsect->obj->flags & OUF_LINKED))
+        continue;  /* from a library member which was not linked */
+      if (sym->type==SYM_RELOC &&
+          (sym->relsect==NULL || sym->relsect->lnksec==NULL))
+        continue;
+      if (sym->type!=SYM_ABS && sym->type!=SYM_RELOC)
+        n++;  /* common or indirect symbols are never resolved by us */
+      def = sym;
+      n++;
+    }
+    if (n == 0)
+      continue;
+
+    is = &state.syms[state.nsyms++];
+    is->name = t->ent[i].name;
+    is->sec = AMBIGUOUS;
+    is->value = 0;
+    if (n == 1) {
+      if (def->type == SYM_ABS) {
+        is->sec = NOSEC;
+        is->value = def->value;
+      }
+      else if ((is->sec = secindex(def->relsect->lnksec)) >= 0)
+        is->value = def->value;
+      else
+        is->sec = AMBIGUOUS;
+    }
+  }
+  qsort(state.syms,state.nsyms,sizeof(struct IncrSymbol),symname_cmp);
+}
+
+
+struct FileRef {
+  struct LinkFile *lf;
+  uint32_t idx;
+};
+
+static int fileref_cmp(const void *a,const void *b)
+{
+  uintptr_t x = (uintptr_t)((struct FileRef *)a)->lf;
+  uintptr_t y = (uintptr_t)((struct FileRef *)b)->lf;
+
+  return x<y ? -1 : (x>y);
+}
+
+
+static struct IncrFile *find_file(struct FileRef *refs,uint32_t n,
+                                  struct LinkFile *lf)
+{
+  struct FileRef key,*r;
+
+  key.lf = lf;
+  r = bsearch(&key,refs,n,sizeof(struct FileRef),fileref_cmp);
+  return r ? &state.files[r->idx] : NULL;
+}
+
+
+static void collect_exports(struct IncrFile *f,struct ObjectUnit *ou)
+{
+  struct Symbol *sym;
+  uint32_t j;
+  int i;
+
+  for (f->nexps=0,i=0; i<OBJSYMHTABSIZE; i++) {
+    for (sym=ou->objsyms[i]; sym; sym=sym->obj_chain) {
+      if (sym->bind >= SYMB_GLOBAL)
+        f->nexps++;
+    }
+  }
+  f->exps = alloc((f->nexps+1)*sizeof(struct IncrExport));
+
+  for (f->nexps=0,i=0; i<OBJSYMHTABSIZE; i++) {
+    for (sym=ou->objsyms[i]; sym; sym=sym->obj_chain) {
+      struct IncrExport *ex;
+
+      if (sym->bind < SYMB_GLOBAL)
+        continue;
+      ex = &f->exps[f->nexps++];
+      ex->name = sym->name;
+      ex->sec = NOSEC;
+      ex->value = sym->value;
+      ex->type = sym->type;
+      ex->bind = sym->bind;
+
+      if (sym->type == SYM_RELOC) {
+        if (sym->relsect==ou->common || sym->relsect==ou->scommon) {
+          f->nopatch = "defines common symbols";
+          continue;
+        }
+        for (j=0; j<f->nsecs; j++) {
+          if (f->secs[j].s == sym->relsect)
+            break;
+        }
+        if (j >= f->nsecs) {
+          f->nopatch = "defines symbols in discarded sections";
+          continue;
+        }
+        ex->sec = (int32_t)j;
+        ex->value = sym->value - sym->relsect->va;
+      }
+      else if (sym->type != SYM_ABS)
+        f->nopatch = "defines common or indirect symbols";
+    }
+  }
+  qsort(f->exps,f->nexps,sizeof(struct IncrExport),export_cmp);
+}
+
+
+static void collect_files(struct GlobalVars *gv)
+/* Save size and hash of all input files. For object files with a single
+   unit the placement of their sections and their global symbols, too. */
+{
+  struct LinkFile *lf;
+  struct ObjectUnit *ou,**units;
+  struct LinkedSection *ls;
+  struct Section *sec,*nx;
+  struct FileRef *refs;
+  struct IncrFile *f;
+  uint32_t i,j,k;
+
+  for (state.nfiles=0,lf=(struct LinkFile *)gv->linkfiles.first;
+       lf->n.next!=NULL; lf=(struct LinkFile *)lf->n.next)
+    state.nfiles++;
+  state.files = alloczero((state.nfiles+1)*sizeof(struct IncrFile));
+  refs = alloc((state.nfiles+1)*sizeof(struct FileRef));
+  units = alloczero((state.nfiles+1)*sizeof(struct ObjectUnit *));
+
+  for (i=0,lf=(struct LinkFile *)gv->linkfiles.first;
+       lf->n.next!=NULL; i++,lf=(struct LinkFile *)lf->n.next) {
+    f = &state.files[i];
+    f->path = lf->pathname;
+    f->type = lf->type;
+    if (!hashfile(lf->pathname,&f->size,&f->hash))
+      f->nopatch = "cannot be read";
+    else if (lf->type != ID_OBJECT)
+      f->nopatch = "is not an object file";
+    refs[i].lf = lf;
+    refs[i].idx = i;
+  }
+  qsort(refs,state.nfiles,sizeof(struct FileRef),fileref_cmp);
+
+  /* find the single object unit of each object file */
+  for (ou=(struct ObjectUnit *)gv->selobjects.first;
+       ou->n.next!=NULL; ou=(struct ObjectUnit *)ou->n.next) {
+    if (f = find_file(refs,state.nfiles,ou->lnkfile)) {
+      if (units[f-state.files] != NULL)
+        f->nopatch = "has more than one object unit";
+      units[f-state.files] = ou;
+    }
+  }
+
+  /* count, then record the linked sections of these units */
+  for (ls=(struct LinkedSection *)gv->lnksec.first;
+       ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next) {
+    for (sec=(struct Section *)ls->sections.first;
+         sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
+      if (sec->obj && (f = find_file(refs,state.nfiles,sec->obj->lnkfile)))
+        f->nsecs++;
+    }
+  }
+  for (i=0; i<state.nfiles; i++) {
+    state.files[i].secs = alloczero((state.files[i].nsecs+1)*
+                                    sizeof(struct IncrInput));
+    state.files[i].nsecs = 0;
+  }
+  for (ls=(struct LinkedSection *)gv->lnksec.first;
+       ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next) {
+    for (sec=(struct Section *)ls->sections.first;
+         sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
+      struct IncrInput *in;
+
+      if (!sec->obj || !(f = find_file(refs,state.nfiles,sec->obj->lnkfile)))
+        continue;
+      in = &f->secs[f->nsecs++];
+      in->name = sec->name;
+      in->sec = secindex(ls);
+      in->offset = sec->offset;
+      in->size = sec->size;
+      nx = (struct Section *)sec->n.next;
+      in->slot = (nx->n.next ? nx->offset : ls->size) - sec->offset;
+      /* linker_copy() fills the gap with the next initialized section's
+         fill pattern */
+      for (; nx->n.next!=NULL; nx=(struct Section *)nx->n.next) {
+        if (nx->data) {
+          in->gapfill = nx->filldata;
+          break;
+        }
+      }
+      in->type = sec->type;
+      in->flags = sec->flags;
+      in->hasdata = sec->data != NULL;
+      in->s = sec;
+    }
+  }
+
+  for (i=0; i<state.nfiles; i++) {
+    f = &state.files[i];
+    if (f->nopatch || units[i]==NULL)
+      continue;
+    for (j=0; j<f->nsecs; j++) {
+      for (k=j+1; k<f->nsecs; k++) {
+        if (!strcmp(f->secs[j].name,f->secs[k].name))
+          f->nopatch = "has several sections with the same name";
+      }
+    }
+    collect_exports(f,units[i]);
+  }
+  free(units);
+  free(refs);
+}
+
+
+void incr_collect(struct GlobalVars *gv,int argc,const char *argv[])
+/* collect the link state, before the output file is written */
+{
+  struct LinkedSection *ls;
+  struct InputFile *ifn;
+  uint32_t i;
+
+  memset(&state,0,sizeof(state));
+  if (unsupported = check_options(gv))
+    return;
+
+  state.args = cmdline(gv,argc,argv,&state.nargs);
+  for (ifn=(struct InputFile *)gv->inputlist.first;
+       ifn->n.next!=NULL; ifn=(struct InputFile *)ifn->n.next)
+    state.ninputs++;
+  state.inputs = alloc((state.ninputs+1)*sizeof(char *));
+  for (i=0,ifn=(struct InputFile *)gv->inputlist.first;
+       ifn->n.next!=NULL; ifn=(struct InputFile *)ifn->n.next) {
+    if (ifn->lib) {
+      char *s = alloc(strlen(ifn->name)+3);
+
+      sprintf(s,"-l%s",ifn->name);
+      state.inputs[i++] = s;
+    }
+    else
+      state.inputs[i++] = ifn->name;
+  }
+
+  state.endianness = gv->endianness;
+  state.bits_per_taddr = gv->bits_per_taddr;
+  state.bits_per_tbyte = gv->bits_per_tbyte;
+  state.scripthash = gv->ldscript ? fnv1a(FNV_INIT,
+                                          (const uint8_t *)gv->ldscript,
+                                          strlen(gv->ldscript)) : 0;
+
+  for (ls=(struct LinkedSection *)gv->lnksec.first;
+       ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next)
+    state.nsecs++;
+  state.secs = alloczero((state.nsecs+1)*sizeof(struct IncrSection));
+  for (i=0,ls=(struct LinkedSection *)gv->lnksec.first;
+       ls->n.next!=NULL; i++,ls=(struct LinkedSection *)ls->n.next) {
+    struct IncrSection *is = &state.secs[i];
+
+    is->name = ls->name;
+    is->base = ls->base;
+    is->size = ls->size;
+    is->memid = ls->relocmem ? ls->relocmem->id : MEM_NOID;
+    is->ld_flags = ls->ld_flags;
+    is->flags = ls->flags;
+    is->ls = ls;
+  }
+
+  collect_symbols(gv);
+  collect_files(gv);
+}
+
+
+void incr_savestate(struct GlobalVars *gv)
+/* save the collected link state, after the output file was written */
+{
+  uint32_t i;
+
+  if (gv->errflag || gv->discardOutput)
+    return;
+
+  if (!unsupported) {
+    for (i=0; i<state.nsecs; i++) {
+      struct IncrSection *is = &state.secs[i];
+
+      is->filepos = is->ls->filepos;
+      if (is->filepos<0 && is->size>0 && (is->flags & SF_ALLOC) &&
+          !(is->ld_flags & LSF_NOLOAD)) {
+        unsupported = "output format";
+        break;
+      }
+    }
+  }
+  if (!unsupported) {
+    if (!hashfile(gv->dest_name,&state.outsize,&state.outhash))
+      unsupported = "cannot read output file";
+    for (i=0; i<state.nsecs && !unsupported; i++) {
+      if (state.secs[i].filepos >= 0 &&
+          (uint64_t)state.secs[i].filepos+state.secs[i].size > state.outsize)
+        unsupported = "output format";
+    }
+  }
+
+  if (unsupported)
+    error(170,gv->dest_name,unsupported);
+  else
+    write_state(gv,&state);
+}
+
+
+static const char *check_state(struct GlobalVars *gv,struct IncrState *st,
+                               int argc,const char *argv[],
+                               struct IncrUnit *units,uint32_t *nunits)
+/* compare the state with the current link, find the changed objects */
+{
+  struct InputFile *ifn;
+  const char **args;
+  uint64_t size,hash;
+  uint32_t i,n;
+
+  args = cmdline(gv,argc,argv,&n);
+  for (i=0; i<n; i++) {
+    if (n!=st->nargs || strcmp(st->args[i],args[i])) {
+      free(args);
+      return "command line changed";
+    }
+  }
+  free(args);
+  for (i=0,ifn=(struct InputFile *)gv->inputlist.first;
+       ifn->n.next!=NULL; i++,ifn=(struct InputFile *)ifn->n.next) {
+    if (i >= st->ninputs ||
+        (ifn->lib && strncmp(st->inputs[i],"-l",2)) ||
+        strcmp(st->inputs[i]+(ifn->lib?2:0),ifn->name))
+      return "list of input files changed";
+  }
+  if (i != st->ninputs)
+    return "list of input files changed";
+  if (st->scripthash != (gv->ldscript ? fnv1a(FNV_INIT,
+                                              (const uint8_t *)gv->ldscript,
+                                              strlen(gv->ldscript)) : 0))
+    return "linker script changed";
+
+  if (!hashfile(gv->dest_name,&size,&hash))
+    return "output file is missing";
+  if (size!=st->outsize || hash!=st->outhash)
+    return "output file was modified";
+
+  for (*nunits=0,i=0; i<st->nfiles; i++) {
+    struct IncrFile *f = &st->files[i];
+
+    if (!hashfile(f->path,&size,&hash))
+      return why("%s is missing",f->path,NULL);
+    if (size==f->size && hash==f->hash)
+      continue;
+    if (f->nopatch)
+      return why("%s changed and %s",f->path,f->nopatch);
+    units[*nunits].file = f;
+    units[*nunits].size = size;
+    units[*nunits].hash = hash;
+    (*nunits)++;
+  }
+  return NULL;
+}
+
+
+static struct LinkedSection *stubls;  /* output sections from the state */
+static struct Section *stubsec;       /* one dummy section for each */
+static struct Symbol *stubsyms;       /* global symbols from the state */
+
+
+static void make_stubs(struct IncrState *st)
+/* create dummy output sections and symbols, as used by relocate_section() */
+{
+  struct MemoryDescr *mem;
+  uint32_t i;
+
+  stubls = alloczero((st->nsecs+1)*sizeof(struct LinkedSection));
+  stubsec = alloczero((st->nsecs+1)*sizeof(struct Section));
+  mem = alloczero((st->nsecs+1)*sizeof(struct MemoryDescr));
+  for (i=0; i<st->nsecs; i++) {
+    struct IncrSection *is = &st->secs[i];
+    struct LinkedSection *ls = &stubls[i];
+
+    ls->index = (int)i;
+    ls->name = is->name;
+    ls->flags = is->flags;
+    ls->ld_flags = is->ld_flags;
+    ls->base = ls->copybase = is->base;
+    ls->size = ls->filesize = is->size;
+    ls->filepos = is->filepos;
+    if (is->memid != MEM_NOID) {
+      mem[i].name = is->name;
+      mem[i].id = is->memid;
+      ls->relocmem = ls->destmem = &mem[i];
+    }
+    initlist(&ls->sections);
+    initlist(&ls->relocs);
+    initlist(&ls->xrefs);
+    initlist(&ls->symbols);
+    stubsec[i].name = is->name;
+    stubsec[i].lnksec = ls;
+    stubsec[i].va = is->base;
+  }
+
+  stubsyms = alloczero((st->nsyms+1)*sizeof(struct Symbol));
+  for (i=0; i<st->nsyms; i++) {
+    struct Symbol *sym = &stubsyms[i];
+
+    sym->name = st->syms[i].name;
+    sym->value = st->syms[i].value;
+    sym->bind = SYMB_GLOBAL;
+    if (st->syms[i].sec >= 0) {
+      sym->type = SYM_RELOC;
+      sym->relsect = &stubsec[st->syms[i].sec];
+    }
+    else
+      sym->type = SYM_ABS;
+  }
+}
+
+
+static struct Symbol *stub_symbol(struct IncrState *st,const char *name)
+{
+  struct IncrSymbol *is = find_incrsym(st,name);
+
+  return (is && is->sec!=AMBIGUOUS) ? &stubsyms[is-st->syms] : NULL;
+}
+
+
+static const char *load_unit(struct GlobalVars *igv,struct IncrUnit *u)
+/* convert a changed object file */
+{
+  struct InputFile *ifn;
+  struct ObjectUnit *ou;
+  struct LinkFile *lf;
+  uint8_t *data;
+  const char *path = u->file->path;
+  unsigned long len;
+  int i,ff;
+
+  for (ifn=(struct InputFile *)igv->inputlist.first;
+       ifn->n.next!=NULL; ifn=(struct InputFile *)ifn->n.next) {
+    if (!ifn->lib && !strcmp(ifn->name,path))
+      break;
+  }
+  if (ifn->n.next==NULL || !(data = (uint8_t *)mapfile(path)))
+    return why("%s changed and is no input file",path,NULL);
+  len = *(size_t *)(data - sizeof(size_t));
+
+  for (i=0,ff=ID_UNKNOWN; fff[i]; i++) {
+    if ((ff = (fff[i]->identify)(igv,(char *)base_name(path),data,len,FALSE))
+        != ID_UNKNOWN)
+      break;
+  }
+  if (ff != ID_OBJECT)
+    return why("%s changed and is not an object file",path,NULL);
+  if (fff[i]->endianness>=0 && fff[i]->endianness!=igv->endianness)
+    return why("%s changed its endianness",path,NULL);
+
+  lf = (struct LinkFile *)alloc(sizeof(struct LinkFile));
+  lf->pathname = path;
+  lf->filename = base_name(path);
+  lf->data = data;
+  lf->length = len;
+  lf->format = (uint8_t)i;
+  lf->type = (uint8_t)ff;
+  lf->flags = ifn->flags;
+  lf->renames = ifn->renames;
+  lf->loaded = NULL;
+  addtail(&igv->linkfiles,&lf->n);
+  fff[i]->readconv(igv,lf);
+
+  for (u->ou=NULL,ou=(struct ObjectUnit *)igv->selobjects.first;
+       ou->n.next!=NULL; ou=(struct ObjectUnit *)ou->n.next) {
+    if (ou->lnkfile == lf) {
+      if (u->ou != NULL)
+        return why("%s has more than one object unit",path,NULL);
+      u->ou = ou;
+    }
+  }
+  if (u->ou == NULL)
+    return why("%s has no object unit",path,NULL);
+  return NULL;
+}
+
+
+static const char *check_unit(struct IncrState *st,struct IncrUnit *u)
+/* Assign the sections of the changed object to their previous places
+   and make sure that its global symbols and references are unchanged. */
+{
+  struct IncrFile *f = u->file;
+  struct ObjectUnit *ou = u->ou;
+  struct IncrExport *exps;
+  struct Section *sec;
+  struct Symbol *sym;
+  struct Reloc *r;
+  uint32_t i,n;
+
+  u->secs = alloczero((f->nsecs+1)*sizeof(struct Section *));
+  for (sec=(struct Section *)ou->sections.first;
+       sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
+    struct IncrInput *in;
+
+    for (i=0; i<f->nsecs; i++) {
+      if (!strcmp(f->secs[i].name,sec->name))
+        break;
+    }
+    if (i >= f->nsecs) {
+      if (sec->size==0 && listempty(&sec->relocs) && listempty(&sec->xrefs))
+        continue;  /* empty sections are deleted by the linker anyway */
+      return why("%s has a new section %s",f->path,sec->name);
+    }
+    in = &f->secs[i];
+    if (u->secs[i])
+      return why("%s has several sections %s",f->path,sec->name);
+    if (sec->type!=in->type || (sec->data!=NULL)!=in->hasdata ||
+        ((sec->flags^in->flags) & (SF_ALLOC|SF_UNINITIALIZED)))
+      return why("section %s of %s changed its type",sec->name,f->path);
+    if ((stubls[in->sec].base+in->offset) & makemask(sec->alignment))
+      return why("section %s of %s needs a higher alignment",
+                 sec->name,f->path);
+    if (sec->size > in->slot)
+      return why("section %s of %s doesn't fit into the previous layout",
+                 sec->name,f->path);
+    sec->lnksec = &stubls[in->sec];
+    sec->offset = in->offset;
+    sec->va = stubls[in->sec].base + in->offset;
+    u->secs[i] = sec;
+  }
+  for (i=0; i<f->nsecs; i++) {
+    if (u->secs[i]==NULL && f->secs[i].size>0)
+      return why("%s lost its section %s",f->path,f->secs[i].name);
+  }
+
+  /* compare the global symbol definitions */
+  for (n=0,i=0; i<OBJSYMHTABSIZE; i++) {
+    for (sym=ou->objsyms[i]; sym; sym=sym->obj_chain) {
+      if (sym->bind >= SYMB_GLOBAL)
+        n++;
+    }
+  }
+  if (n != f->nexps)
+    return why("global symbols of %s changed",f->path,NULL);
+  exps = alloc((n+1)*sizeof(struct IncrExport));
+  for (n=0,i=0; i<OBJSYMHTABSIZE; i++) {
+    for (sym=ou->objsyms[i]; sym; sym=sym->obj_chain) {
+      struct IncrExport *ex;
+
+      if (sym->bind < SYMB_GLOBAL)
+        continue;
+      ex = &exps[n++];
+      ex->name = sym->name;
+      ex->sec = NOSEC;
+      ex->value = sym->value;
+      ex->type = sym->type;
+      ex->bind = sym->bind;
+      if (sym->type == SYM_RELOC) {
+        for (ex->sec=0; ex->sec<(int32_t)f->nsecs; ex->sec++) {
+          if (u->secs[ex->sec] == sym->relsect)
+            break;
+        }
+      }
+    }
+  }
+  qsort(exps,n,sizeof(struct IncrExport),export_cmp);
+  for (i=0; i<n; i++) {
+    struct IncrExport *ex = &f->exps[i];
+
+    if (strcmp(exps[i].name,ex->name) || exps[i].sec!=ex->sec ||
+        exps[i].value!=ex->value || exps[i].type!=ex->type ||
+        exps[i].bind!=ex->bind) {
+      free(exps);
+      return why("global symbol %s of %s changed",ex->name,f->path);
+    }
+  }
+  free(exps);
+
+  /* all references must be resolvable by the previous layout */
+  for (i=0; i<f->nsecs; i++) {
+    if ((sec = u->secs[i]) == NULL)
+      continue;
+    for (r=(struct Reloc *)sec->relocs.first;
+         r->n.next!=NULL; r=(struct Reloc *)r->n.next) {
+      if (r->relocsect.ptr==NULL || r->relocsect.ptr->lnksec==NULL)
+        return why("%s references a discarded section %s",f->path,
+                   r->relocsect.ptr ? r->relocsect.ptr->name : noname);
+    }
+    for (r=(struct Reloc *)sec->xrefs.first;
+         r->n.next!=NULL; r=(struct Reloc *)r->n.next) {
+      struct IncrSymbol *is;
+
+      switch (r->rtype) {
+        case R_LOADREL:
+        case R_GOT:
+        case R_GOTPC:
+        case R_GOTOFF:
+        case R_PLT:
+        case R_PLTPC:
+        case R_PLTOFF:
+        case R_GLOBDAT:
+        case R_JMPSLOT:
+        case R_COPY:
+          return why("%s has a %s reference",f->path,reloc_name[r->rtype]);
+      }
+      if (!(is = find_incrsym(st,r->xrefname)))
+        return why("%s has a new reference to %s",f->path,r->xrefname);
+      if (is->sec == AMBIGUOUS)
+        return why("%s references %s, which has several definitions",
+                   f->path,r->xrefname);
+      if (r->rtype == R_LOCALPC) {
+        struct IncrExport key;
+
+        key.name = r->xrefname;
+        if (!bsearch(&key,f->exps,f->nexps,sizeof(struct IncrExport),
+                     export_cmp))
+          return why("%s has a new reference to %s",f->path,r->xrefname);
+        r->rtype = R_PC;
+      }
+      r->relocsect.symbol = &stubsyms[is-st->syms];
+    }
+  }
+  return NULL;
+}
+
+
+static bool seek_output(FILE *f,long pos,unsigned long offs)
+/* seek to offs bytes behind the file position pos, which came from ftell() */
+{
+  if (fseek(f,pos,SEEK_SET) < 0)
+    return FALSE;
+  while (offs > LONG_MAX) {
+    if (fseek(f,LONG_MAX,SEEK_CUR) < 0)
+      return FALSE;
+    offs -= LONG_MAX;
+  }
+  return fseek(f,offs,SEEK_CUR) >= 0;
+}
+
+
+static const char *patch_output(struct GlobalVars *gv,struct GlobalVars *igv,
+                                struct IncrState *st,
+                                struct IncrUnit *units,uint32_t nunits)
+/* Copy and relocate the changed sections into the output file.
+   Returns NULL, or the reason why the output file couldn't be patched. */
+{
+  struct RelocBases rb;
+  struct Section *sec;
+  uint32_t i,j;
+  FILE *f;
+
+  if (!(f = fopen(gv->dest_name,"r+b")))
+    return "can't open the output file";
+
+  /* read the contents of the affected output sections */
+  for (i=0; i<nunits; i++) {
+    for (j=0; j<units[i].file->nsecs; j++) {
+      struct LinkedSection *ls;
+
+      if ((sec = units[i].secs[j]) == NULL)
+        continue;
+      ls = sec->lnksec;
+      if (ls->data == NULL) {
+        ls->data = alloczero(tbytes(igv,ls->size));
+        if (ls->filepos>=0 && ls->size>0) {
+          if (!seek_output(f,ls->filepos,0) ||
+              fread(ls->data,1,ls->size,f)!=ls->size) {
+            fclose(f);
+            return "can't read the output file";
+          }
+        }
+      }
+      addtail(&ls->sections,remnode(&sec->n));
+      if (sec->data) {
+        section_copy(igv,ls->data,sec->offset,sec->data,sec->size);
+        section_fill(igv,ls->data,sec->offset+sec->size,
+                     units[i].file->secs[j].gapfill,
+                     units[i].file->secs[j].slot-sec->size);
+      }
+    }
+  }
+
+  /* relocate them like linker_relocate() and the output functions */
+  rb.sdabase = stub_symbol(st,sdabase_name);
+  rb.sda2base = stub_symbol(st,sda2base_name);
+  rb.gotbase = stub_symbol(st,igv->got_base_name);
+  rb.pltbase = stub_symbol(st,igv->plt_base_name);
+  rb.r13init = stub_symbol(st,r13init_name);
+  for (i=0; i<nunits; i++) {
+    if (igv->trace_file)
+      fprintf(igv->trace_file,"Relinking %s\n",units[i].file->path);
+    for (j=0; j<units[i].file->nsecs; j++) {
+      if (sec = units[i].secs[j])
+        relocate_section(igv,sec->lnksec,sec,&rb,
+                         &sec->lnksec->relocs,&sec->lnksec->xrefs);
+    }
+  }
+  for (i=0; i<st->nsecs; i++) {
+    if (stubls[i].data) {
+      calc_relocs(igv,&stubls[i]);
+      if (!listempty(&stubls[i].xrefs))
+        ierror("incr_relink(): unresolved references in %s",stubls[i].name);
+    }
+  }
+  if (gv->errflag) {
+    fclose(f);
+    return NULL;  /* the errors were reported, a full link won't help */
+  }
+
+  /* write the changed sections back */
+  for (i=0; i<nunits; i++) {
+    struct IncrFile *fl = units[i].file;
+
+    for (j=0; j<fl->nsecs; j++) {
+      struct LinkedSection *ls;
+
+      if ((sec = units[i].secs[j]) == NULL)
+        continue;
+      ls = sec->lnksec;
+      if (sec->data && ls->filepos>=0 && fl->secs[j].slot>0) {
+        if (!seek_output(f,ls->filepos,sec->offset) ||
+            fwrite(ls->data+sec->offset,1,fl->secs[j].slot,f)
+            != fl->secs[j].slot) {
+          fclose(f);
+          return "can't write the output file";
+        }
+      }
+      fl->secs[j].size = sec->size;
+    }
+    fl->size = units[i].size;
+    fl->hash = units[i].hash;
+  }
+  if (fclose(f))
+    return "can't write the output file";
+  return NULL;
+}
+
+
+bool incr_relink(struct GlobalVars *gv,int argc,const char *argv[])
+/* Try to relink the output file incrementally, using the saved state.
+   Returns TRUE when the output file is up to date afterwards. */
+{
+  struct GlobalVars igv;
+  struct IncrState st;
+  struct IncrUnit *units = NULL;
+  struct StateBuf b;
+  const char *reason = NULL;
+  const char *name = statename(gv);
+  uint32_t i,nunits=0;
+
+  if (!(b.data = (uint8_t *)mapfile(name))) {
+    if (gv->trace_file)
+      fprintf(gv->trace_file,"No incremental link state %s.\n",name);
+    return FALSE;
+  }
+  b.size = *(size_t *)(b.data - sizeof(size_t));
+  b.len = 0;
+  b.bad = FALSE;
+
+  if (!read_state(&b,&st))
+    reason = "link state is corrupt";
+  else {
+    units = alloczero((st.nfiles+1)*sizeof(struct IncrUnit));
+    if (!(reason = check_state(gv,&st,argc,argv,units,&nunits)) &&
+        nunits == 0) {
+      if (gv->trace_file)
+        fprintf(gv->trace_file,"Output file %s is up to date.\n",
+                gv->dest_name);
+      return TRUE;
+    }
+  }
+
+  if (reason == NULL) {
+    /* convert the changed objects with a private copy of the globals */
+    igv = *gv;
+    initlist(&igv.linkfiles);
+    initlist(&igv.selobjects);
+    initlist(&igv.libobjects);
+    initlist(&igv.sharedobjects);
+    initlist(&igv.pripointers);
+    initlist(&igv.scriptsymbols);
+    initlist(&igv.lnksec);
+    memset(&igv.symbols,0,sizeof(igv.symbols));
+    igv.lnksyms = NULL;
+    igv.arsyms = NULL;
+    igv.endianness = st.endianness;
+    igv.bits_per_taddr = st.bits_per_taddr;
+    igv.bits_per_tbyte = st.bits_per_tbyte;
+    igv.octets_per_tbyte = (st.bits_per_tbyte + 7) / 8;
+    igv.tbytes_per_taddr = st.bits_per_taddr / st.bits_per_tbyte;
+    igv.common_sec_name = fff[gv->dest_format]->bssname ?
+                          fff[gv->dest_format]->bssname : "COMMON";
+    igv.scommon_sec_name = fff[gv->dest_format]->sbssname ?
+                           fff[gv->dest_format]->sbssname : ".scommon";
+    igv.common_sec_hash = elf_hash(igv.common_sec_name);
+    igv.scommon_sec_hash = elf_hash(igv.scommon_sec_name);
+    make_stubs(&st);
+
+    for (i=0; i<nunits && reason==NULL; i++) {
+      if (!(reason = load_unit(&igv,&units[i])))
+        reason = check_unit(&st,&units[i]);
+    }
+  }
+
+  if (reason != NULL) {
+    error(169,gv->dest_name,reason);
+    remove(name);
+    return FALSE;
+  }
+
+  if (gv->trace_file)
+    fprintf(gv->trace_file,"\nIncremental link of %s:\n",gv->dest_name);
+  if (reason = patch_output(gv,&igv,&st,units,nunits)) {
+    /* the full link rewrites the partially patched output file */
+    error(169,gv->dest_name,reason);
+    remove(name);
+    return FALSE;
+  }
+  if (!gv->errflag && hashfile(gv->dest_name,&st.outsize,&st.outhash))
+    write_state(gv,&st);
+  else
+    remove(name);
+  return TRUE;
+}
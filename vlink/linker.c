@@ -9,10 +9,13 @@
 #define LINKER_C
 #include "vlink.h"
 #include "cpurelocs.h"
+#ifdef PTHREADS
+#include <pthread.h>
+#endif
 
 
-static char namebuf[FNAMEBUFSIZE];
-static char namebuf2[FNAMEBUFSIZE];
+static THREADLOCAL char namebuf[FNAMEBUFSIZE];
+static THREADLOCAL char namebuf2[FNAMEBUFSIZE];
 
 static const char *filetypes[] = {
   "unknown",
@@ -49,7 +52,7 @@ const char *getobjname(struct ObjectUnit *obj)
   const char *fn = obj->lnkfile->filename;
 
   if (obj->lnkfile->type == ID_LIBARCH) {
-    static char *buf;
+    static THREADLOCAL char *buf;
     const char *on = obj->objname;
 
     if (strlen(fn)+strlen(on)+2 < FNAMEBUFSIZE) {
@@ -72,7 +75,6 @@ void print_function_name(struct Section *sec,unsigned long offs)
 /* from the last one printed, make an output to stderr. */
 {
   static const char *infoname[] = { "", "object ", "function " };
-  static struct Symbol *last_func;
   struct Symbol *sym,*func=NULL;
   int i;
 
@@ -107,11 +109,9 @@ void print_function_name(struct Section *sec,unsigned long offs)
   }
 
   /* print function name */
-  if (func && func!=last_func) {
-    last_func = func;
-    fprintf(stderr,"%s: In %s\"%s\":\n",getobjname(sec->obj),
-            infoname[func->info],func->name);
-  }
+  if (func)
+    error_context(func,"%s: In %s\"%s\":\n",getobjname(sec->obj),
+                  infoname[func->info],func->name);
 }
 
 
@@ -550,11 +550,12 @@ static unsigned long allocate_common(struct GlobalVars *gv,bool really,
    Only returns total bytes without symbol allocation with 'really' = FALSE. */
 {
   unsigned long abytes,alloc=0;
+  uint32_t *order = globsym_order(gv);
   struct Symbol *sym;
-  int i;
+  uint32_t i;
 
-  for (i=0; i<SYMHTABSIZE; i++) {
-    for (sym=gv->symbols[i]; sym; sym=sym->glob_chain) {
+  for (i=0; i<gv->symbols.nent; i++) {
+    for (sym=gv->symbols.ent[order[i]].chain; sym; sym=sym->glob_chain) {
       /* common symbol from this section name? */
       if (sym->relsect==sec && sym->type==SYM_COMMON) {
 
@@ -1051,9 +1052,9 @@ void linker_init(struct GlobalVars *gv)
   initlist(&gv->selobjects);
   initlist(&gv->libobjects);
   initlist(&gv->sharedobjects);
-  gv->symbols = alloc_hashtable(SYMHTABSIZE);
   initlist(&gv->pripointers);
   initlist(&gv->scriptsymbols);
+  initlist(&gv->foldedsecs);
   gv->got_base_name = gotbase_name;
   gv->plt_base_name = pltbase_name;
   gv->ptr_alignment = fff[gv->dest_format]->ptr_alignment;
@@ -1073,6 +1074,87 @@ void linker_init(struct GlobalVars *gv)
 }
 
 
+#ifdef PTHREADS
+struct LoadQueue {
+  pthread_mutex_t lock;
+  struct GlobalVars *gv;
+  struct LinkFile *next;        /* next file to check for conversion */
+  bool stop;                    /* a fatal error occurred */
+};
+
+
+static bool parallel_readconv(struct GlobalVars *gv,struct LinkFile *lf)
+/* object files, which can be converted by a worker thread */
+{
+  return lf->type==ID_OBJECT && (fff[lf->format]->flags & FFF_THREADSAFE);
+}
+
+
+static void *load_worker(void *arg)
+/* Convert the next object file from the queue, until none is left.
+   Diagnostics are recorded per file and printed by linker_load(), in
+   command line order. After a fatal error no more files are taken. */
+{
+  struct LoadQueue *q = (struct LoadQueue *)arg;
+  struct LinkFile *lf;
+  bool stop;
+
+  for (;;) {
+    pthread_mutex_lock(&q->lock);
+    for (lf=q->next; lf->n.next!=NULL; lf=(struct LinkFile *)lf->n.next) {
+      if (parallel_readconv(q->gv,lf))
+        break;
+    }
+    q->next = lf->n.next!=NULL ? (struct LinkFile *)lf->n.next : lf;
+    stop = q->stop;
+    pthread_mutex_unlock(&q->lock);
+    if (lf->n.next==NULL || stop)
+      break;
+
+    lf->diag = alloczero(sizeof(struct ErrorBuffer));
+    buffer_errors(lf->diag);
+    if (setjmp(lf->diag->abort) == 0)
+      fff[lf->format]->readconv(q->gv,lf);
+    buffer_errors(NULL);
+    if (lf->diag->fatal) {
+      pthread_mutex_lock(&q->lock);
+      q->stop = TRUE;
+      pthread_mutex_unlock(&q->lock);
+    }
+  }
+  return NULL;
+}
+
+
+static void parallel_load(struct GlobalVars *gv)
+/* Convert all object files of a thread-safe format with gv->jobs
+   threads. Their global symbols are added by add_loaded_objunit(). */
+{
+  struct LoadQueue q;
+  pthread_t *tid = alloc(gv->jobs * sizeof(pthread_t));
+  int i,n;
+
+  pthread_mutex_init(&q.lock,NULL);
+  q.gv = gv;
+  q.next = (struct LinkFile *)gv->linkfiles.first;
+  q.stop = FALSE;
+  gv->parallel_load = TRUE;
+
+  for (n=1; n<gv->jobs; n++) {
+    if (pthread_create(&tid[n],NULL,load_worker,&q) != 0)
+      break;  /* continue with the threads we got */
+  }
+  load_worker(&q);  /* the main thread helps */
+  for (i=1; i<n; i++)
+    pthread_join(tid[i],NULL);
+
+  gv->parallel_load = FALSE;
+  pthread_mutex_destroy(&q.lock);
+  free(tid);
+}
+#endif
+
+
 void linker_load(struct GlobalVars *gv)
 /* load all objects and libraries into memory, identify their */
 /* format, then read all symbols and convert into internal format */
@@ -1083,6 +1165,7 @@ void linker_load(struct GlobalVars *gv)
   const char *objname;
   unsigned long objlen;
   int i,ff;
+  bool lazy;
 
   init_ld_script(gv);       /* pre-parse linker script, when available */
   if (listempty(&gv->inputlist))
@@ -1151,6 +1234,7 @@ void linker_load(struct GlobalVars *gv)
       lf->type = (uint8_t)ff;
       lf->flags = ifn->flags;
       lf->renames = ifn->renames;
+      lf->loaded = NULL;
       if (gv->trace_file)
         fprintf(gv->trace_file,"%s (%s %s)\n",namebuf,fff[i]->tname,
                                               filetypes[ff]);
@@ -1188,10 +1272,35 @@ void linker_load(struct GlobalVars *gv)
   if (gv->tbytes_per_taddr == 0)
     gv->tbytes_per_taddr = gv->bits_per_taddr / gv->bits_per_tbyte;
 
-  /* read all files and convert them into internal format */
+  /* Read all files and convert them into internal format. Archive
+     members are only converted when resolvesymbol() needs them, unless
+     all members are required, symbol names are modified or the target
+     has its own symbol lookup. */
+  lazy = !gv->whole_archive && !gv->masked_symbols &&
+         fff[gv->dest_format]->fndsymbol==NULL &&
+         gv->collect_ctors_type!=CCDT_VBCC &&
+         gv->collect_ctors_type!=CCDT_VBCC_ELF &&
+         gv->collect_ctors_type!=CCDT_SASC;
+#ifdef PTHREADS
+  /* feature masks need the global symbols while reading relocations */
+  if (gv->jobs>1 && !gv->masked_symbols)
+    parallel_load(gv);
+#endif
   for (lf=(struct LinkFile *)gv->linkfiles.first;
-       lf->n.next!=NULL; lf=(struct LinkFile *)lf->n.next)
+       lf->n.next!=NULL; lf=(struct LinkFile *)lf->n.next) {
+    if (lf->diag) {
+      /* converted by a worker thread, fatal errors abort here */
+      flush_errors(lf->diag);
+      if (lf->loaded)
+        add_loaded_objunit(gv,lf->loaded);
+      continue;
+    }
+    if (lazy && lf->type==ID_LIBARCH &&
+        !(lf->flags & (IFF_DELUNDERSCORE|IFF_ADDUNDERSCORE)) &&
+        ar_lazyindex(gv,lf))
+      continue;
     fff[lf->format]->readconv(gv,lf);
+  }
 
   collect_constructors(gv); /* scan them for con-/destructor functions */
   add_undef_syms(gv);       /* put syms. marked as undef. into 1st sec. */
@@ -1269,7 +1378,7 @@ void linker_resolve(struct GlobalVars *gv)
         }
 
         /* find a global symbol with this name in any object or library */
-        xdef = findsymbol(gv,sec,xref->xrefname,cmask);
+        xdef = resolvesymbol(gv,sec,xref->xrefname,cmask);
 
         if (xdef!=NULL && xref->rtype==R_LOCALPC) {
           /* R_LOCALPC only accepts symbols which are defined in the
@@ -1443,6 +1552,9 @@ void linker_resolve(struct GlobalVars *gv)
     obj = (struct ObjectUnit *)obj->n.next;
   }
   while (obj->n.next);
+
+  if (gv->trace_file)
+    print_globsym_stats(gv,gv->trace_file);
 }
 
 
@@ -1564,11 +1676,12 @@ void linker_dynprep(struct GlobalVars *gv)
 
   /* export all global symbols when creating a shared library */
   if (gv->dest_sharedobj || gv->dyn_exp_all) {
-    int i;
+    uint32_t *order = globsym_order(gv);
+    uint32_t i;
 
-    for (i=0; i<SYMHTABSIZE; i++) {
+    for (i=0; i<gv->symbols.nent; i++) {
       struct Symbol *sym;
-      struct Symbol **chain = &gv->symbols[i];
+      struct Symbol **chain = &gv->symbols.ent[order[i]].chain;
 
       while (sym = *chain) {
         if (sym->bind>=SYMB_GLOBAL && !(sym->flags & SYMF_SHLIB) &&
@@ -1639,6 +1752,350 @@ void linker_gcsects(struct GlobalVars *gv)
 }
 
 
+struct FoldCand {
+  struct Section *sec;
+  unsigned long hash;
+  unsigned long seq;            /* keeps the link order within a hash group */
+};
+
+static char fold_self;          /* target of self-references */
+
+
+static unsigned long fold_hash(unsigned long h,const void *p,size_t n)
+/* FNV-1a */
+{
+  const uint8_t *d = p;
+
+  while (n--)
+    h = ((h ^ *d++) * 16777619UL) & 0xffffffffUL;
+  return h;
+}
+
+
+static void *reloc_target(struct Section *sec,struct Reloc *r,bool xref,
+                          lword *val)
+/* Return an identifier for the target of a relocation, which is equal for
+   identical sections: the target section, the symbol, or &fold_self for
+   a reference to the relocated section itself. */
+{
+  struct Symbol *sym;
+
+  *val = 0;
+  if (!xref)
+    return r->relocsect.ptr!=sec ? (void *)r->relocsect.ptr : &fold_self;
+  if ((sym = r->relocsect.symbol) == NULL)
+    return (void *)r->xrefname;
+  if (sym->type==SYM_RELOC && sym->relsect!=NULL) {
+    *val = sym->value;
+    return sym->relsect!=sec ? (void *)sym->relsect : &fold_self;
+  }
+  return sym;
+}
+
+
+static unsigned long hash_relocs(unsigned long h,struct Section *sec,
+                                 struct list *rl,bool xref)
+{
+  struct Reloc *r;
+  struct RelocInsert *ri;
+  void *tgt;
+  lword val;
+
+  for (r=(struct Reloc *)rl->first;
+       r->n.next!=NULL; r=(struct Reloc *)r->n.next) {
+    if (xref && r->relocsect.symbol==NULL)
+      h = fold_hash(h,r->xrefname,strlen(r->xrefname));
+    else {
+      tgt = reloc_target(sec,r,xref,&val);
+      h = fold_hash(h,&tgt,sizeof(void *));
+      h = fold_hash(h,&val,sizeof(lword));
+    }
+    h = fold_hash(h,&r->offset,sizeof(unsigned long));
+    h = fold_hash(h,&r->addend,sizeof(lword));
+    h = fold_hash(h,&r->rtype,sizeof(int));
+    for (ri=r->insert; ri!=NULL; ri=ri->next) {
+      h = fold_hash(h,&ri->bpos,sizeof(uint16_t));
+      h = fold_hash(h,&ri->bsiz,sizeof(uint16_t));
+    }
+  }
+  return h;
+}
+
+
+static bool same_relocs(struct Section *s1,struct list *l1,
+                        struct Section *s2,struct list *l2,bool xref)
+{
+  struct Reloc *r1,*r2;
+  struct RelocInsert *ri1,*ri2;
+  lword v1,v2;
+
+  for (r1=(struct Reloc *)l1->first,r2=(struct Reloc *)l2->first;
+       r1->n.next!=NULL && r2->n.next!=NULL;
+       r1=(struct Reloc *)r1->n.next,r2=(struct Reloc *)r2->n.next) {
+    if (r1->offset!=r2->offset || r1->addend!=r2->addend ||
+        r1->rtype!=r2->rtype || r1->flags!=r2->flags)
+      return FALSE;
+    if (xref && (r1->relocsect.symbol==NULL || r2->relocsect.symbol==NULL)) {
+      if (r1->relocsect.symbol!=r2->relocsect.symbol ||
+          strcmp(r1->xrefname,r2->xrefname))
+        return FALSE;
+    }
+    else if (reloc_target(s1,r1,xref,&v1)!=reloc_target(s2,r2,xref,&v2) ||
+             v1!=v2)
+      return FALSE;
+    for (ri1=r1->insert,ri2=r2->insert; ri1!=NULL && ri2!=NULL;
+         ri1=ri1->next,ri2=ri2->next) {
+      if (ri1->bpos!=ri2->bpos || ri1->bsiz!=ri2->bsiz || ri1->mask!=ri2->mask)
+        return FALSE;
+    }
+    if (ri1!=NULL || ri2!=NULL)
+      return FALSE;
+  }
+  return r1->n.next==NULL && r2->n.next==NULL;
+}
+
+
+static bool identical_sections(struct GlobalVars *gv,
+                               struct Section *s1,struct Section *s2)
+/* compare attributes, contents and relocations of two sections */
+{
+  return s1->type==s2->type &&
+         ((s1->flags ^ s2->flags) & ~SF_REFERENCED) == 0 &&
+         s1->protection==s2->protection && s1->alignment==s2->alignment &&
+         s1->memattr==s2->memattr && s1->size==s2->size &&
+         s1->hash==s2->hash && !strcmp(s1->name,s2->name) &&
+         !memcmp(s1->data,s2->data,tbytes(gv,s1->size)) &&
+         same_relocs(s1,&s1->relocs,s2,&s2->relocs,FALSE) &&
+         same_relocs(s1,&s1->xrefs,s2,&s2->xrefs,TRUE);
+}
+
+
+static int foldcand_cmp(const void *left,const void *right)
+/* qsort: sort candidates by hash code, then by link order */
+{
+  const struct FoldCand *l = left;
+  const struct FoldCand *r = right;
+
+  if (l->hash != r->hash)
+    return l->hash<r->hash ? -1 : 1;
+  return l->seq<r->seq ? -1 : (l->seq>r->seq);
+}
+
+
+static bool fold_candidate(struct GlobalVars *gv,struct Section *sec)
+/* initialized read-only code or data, which may be replaced */
+{
+  if (gv->gc_sects==GCS_ALL && !(sec->flags & SF_REFERENCED))
+    return FALSE;  /* removed by garbage collection anyway */
+  return (sec->type==ST_CODE || sec->type==ST_DATA) &&
+         (sec->flags & (SF_ALLOC|SF_UNINITIALIZED|SF_LINKONCE)) == SF_ALLOC &&
+         !(sec->protection & SP_WRITE) &&
+         !(sec->internal_flags & ILF_NOFOLD) &&
+         sec->size>0 && sec->data!=NULL && !is_common_sec(gv,sec);
+}
+
+
+static bool is_branch(struct GlobalVars *gv,struct Section *sec,
+                      struct Section *tgt,struct Reloc *r)
+/* A pc-relative branch from code into code doesn't take the target's
+   address. Only the target of the input file can tell a branch from a
+   pc-relative address calculation, otherwise assume the latter. */
+{
+  struct FFFuncs *ff = fff[sec->obj->lnkfile->format];
+
+  if (sec->type!=ST_CODE || tgt->type!=ST_CODE || ff->isbranch==NULL ||
+      (r->rtype!=R_PC && r->rtype!=R_PLTPC && r->rtype!=R_LOCALPC))
+    return FALSE;
+  return ff->isbranch(gv,sec,r);
+}
+
+
+static void nofold_sections(struct GlobalVars *gv)
+/* Mark sections with protected or dynamically linked symbols. With -icf
+   also sections whose address is taken, which means they are referenced
+   by anything else than a pc-relative branch from code. */
+{
+  struct ObjectUnit *obj;
+  struct Section *sec,*tgt;
+  struct Symbol *sym;
+  struct Reloc *r;
+  int i;
+
+  for (obj=(struct ObjectUnit *)gv->selobjects.first;
+       obj->n.next!=NULL; obj=(struct ObjectUnit *)obj->n.next) {
+    for (i=0; i<OBJSYMHTABSIZE; i++) {
+      for (sym=obj->objsyms[i]; sym; sym=sym->obj_chain) {
+        if (sym->relsect!=NULL &&
+            ((sym->flags & (SYMF_PROTECTED|SYMF_DYNLINK)) ||
+             check_protection(gv,sym->name)))
+          sym->relsect->internal_flags |= ILF_NOFOLD;
+      }
+    }
+    if (gv->icf != ICF_SAFE)
+      continue;
+
+    for (sec=(struct Section *)obj->sections.first;
+         sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
+      if (!(sec->flags & SF_ALLOC))
+        continue;  /* ignore references from debugging information */
+      for (r=(struct Reloc *)sec->relocs.first;
+           r->n.next!=NULL; r=(struct Reloc *)r->n.next) {
+        if ((tgt = r->relocsect.ptr)!=NULL && tgt!=sec &&
+            !is_branch(gv,sec,tgt,r))
+          tgt->internal_flags |= ILF_NOFOLD;
+      }
+      for (r=(struct Reloc *)sec->xrefs.first;
+           r->n.next!=NULL; r=(struct Reloc *)r->n.next) {
+        if ((sym = r->relocsect.symbol)!=NULL && sym->type==SYM_RELOC &&
+            (tgt = sym->relsect)!=NULL && tgt!=sec &&
+            !is_branch(gv,sec,tgt,r))
+          tgt->internal_flags |= ILF_NOFOLD;
+      }
+    }
+  }
+}
+
+
+static void fold_section(struct GlobalVars *gv,struct Section *dup,
+                         struct Section *keep)
+/* remove dup from the link and move its symbols to the identical section */
+{
+  struct Symbol *sym,**chain;
+  int i;
+
+  for (i=0; i<OBJSYMHTABSIZE; i++) {
+    chain = &dup->obj->objsyms[i];
+    while (sym = *chain) {
+      if (sym->relsect == dup) {
+        *chain = sym->obj_chain;
+        sym->relsect = keep;
+        sym->obj_chain = keep->obj->objsyms[i];
+        keep->obj->objsyms[i] = sym;
+      }
+      else
+        chain = &sym->obj_chain;
+    }
+  }
+  keep->flags |= dup->flags & SF_REFERENCED;
+  dup->folded = keep;
+  addtail(&gv->foldedsecs,remnode(&dup->n));
+  if (gv->trace_file)
+    fprintf(gv->trace_file,"  %s(%s) folded into %s(%s)\n",
+            getobjname(dup->obj),dup->name,getobjname(keep->obj),keep->name);
+}
+
+
+struct Section *fold_target(struct Section *sec)
+/* return the section which replaces a folded section */
+{
+  while (sec->folded != NULL)
+    sec = sec->folded;
+  return sec;
+}
+
+
+static void redirect_relocs(struct GlobalVars *gv)
+/* let all references to folded sections point to their replacement */
+{
+  struct ObjectUnit *obj;
+  struct Section *sec;
+  struct Reloc *r;
+  struct RelRef *rr;
+
+  for (obj=(struct ObjectUnit *)gv->selobjects.first;
+       obj->n.next!=NULL; obj=(struct ObjectUnit *)obj->n.next) {
+    for (sec=(struct Section *)obj->sections.first;
+         sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
+      for (r=(struct Reloc *)sec->relocs.first;
+           r->n.next!=NULL; r=(struct Reloc *)r->n.next) {
+        if (r->relocsect.ptr != NULL)
+          r->relocsect.ptr = fold_target(r->relocsect.ptr);
+      }
+      for (rr=sec->relrefs; rr!=NULL; rr=rr->next)
+        rr->refsec = fold_target(rr->refsec);
+    }
+  }
+}
+
+
+void linker_foldsects(struct GlobalVars *gv)
+/* Identical section folding: replace read-only sections, which equal
+   another section in name, attributes, contents and relocations, by the
+   first of them. Repeat until nothing changes, because sections referring
+   to folded sections may become identical as well. */
+{
+  struct FoldCand *cand = NULL;
+  struct ObjectUnit *obj;
+  struct Section *sec;
+  unsigned long seq,n,maxcand=0,i,j,k;
+  bool folded;
+
+  if (gv->icf == ICF_NONE)
+    return;
+  if (gv->dest_object || gv->dest_sharedobj) {
+    gv->icf = ICF_NONE;
+    return;
+  }
+
+  if (gv->trace_file)
+    fprintf(gv->trace_file,"Folding identical sections:\n");
+  nofold_sections(gv);
+
+  do {
+    folded = FALSE;
+
+    /* collect candidates and their hash codes */
+    for (n=0,seq=0,obj=(struct ObjectUnit *)gv->selobjects.first;
+         obj->n.next!=NULL; obj=(struct ObjectUnit *)obj->n.next) {
+      if (obj->lnkfile->type==ID_SHAREDOBJ || is_ld_script(obj))
+        continue;
+      for (sec=(struct Section *)obj->sections.first;
+           sec->n.next!=NULL; sec=(struct Section *)sec->n.next,seq++) {
+        if (fold_candidate(gv,sec)) {
+          unsigned long h = 2166136261UL;
+
+          h = fold_hash(h,sec->name,strlen(sec->name));
+          h = fold_hash(h,&sec->size,sizeof(unsigned long));
+          h = fold_hash(h,sec->data,tbytes(gv,sec->size));
+          h = hash_relocs(h,sec,&sec->relocs,FALSE);
+          h = hash_relocs(h,sec,&sec->xrefs,TRUE);
+          if (n >= maxcand) {
+            maxcand = maxcand ? maxcand<<1 : 256;
+            cand = re_alloc(cand,maxcand*sizeof(struct FoldCand));
+          }
+          cand[n].sec = sec;
+          cand[n].hash = h;
+          cand[n++].seq = seq;
+        }
+      }
+    }
+    qsort(cand,n,sizeof(struct FoldCand),foldcand_cmp);
+
+    /* compare sections within each group of equal hash codes */
+    for (i=0; i<n; i=k) {
+      for (k=i+1; k<n && cand[k].hash==cand[i].hash; k++);
+      for (; i<k; i++) {
+        if (cand[i].sec->folded != NULL)
+          continue;
+        for (j=i+1; j<k; j++) {
+          if (cand[j].sec->folded==NULL &&
+              identical_sections(gv,cand[i].sec,cand[j].sec)) {
+            fold_section(gv,cand[j].sec,cand[i].sec);
+            folded = TRUE;
+          }
+        }
+      }
+    }
+
+    if (folded)
+      redirect_relocs(gv);
+  }
+  while (folded);
+
+  free(cand);
+}
+
+
 static bool garbage_collected(struct GlobalVars *gv,struct Patterns *pat,
                               struct Section *sec)
 {
@@ -1838,6 +2295,187 @@ static void sort_and_merge_sections(struct GlobalVars *gv,
 }
 
 
+struct SecNames {               /* unmerged input sections with same name */
+  struct SecNames *next;        /* hash chain */
+  const char *name;
+  unsigned long hash;
+  unsigned long *idx;           /* indexes into SecIndex.secs */
+  unsigned long nidx,maxidx;
+};
+
+struct SecIndex {               /* input sections for linker script patterns */
+  struct Section **secs;        /* link order, NULL when garbage-collected */
+  unsigned long nsecs;
+  struct SecNames **htab;       /* names hash table, size is a power of 2 */
+  unsigned long htabsize;
+  struct SecNames **names;      /* sorted by name, for prefix patterns */
+  unsigned long nnames;
+  unsigned long *match;         /* sections found for the current patterns */
+  unsigned long nmatch;
+  unsigned long *stamp;         /* last pattern list, which found a section */
+  unsigned long patno;
+};
+
+
+static int secnames_cmp(const void *left,const void *right)
+/* qsort: sort section names alphabetically */
+{
+  return strcmp((*(struct SecNames **)left)->name,
+                (*(struct SecNames **)right)->name);
+}
+
+
+static int secidx_cmp(const void *left,const void *right)
+/* qsort: sort section indexes into link order */
+{
+  unsigned long l = *(unsigned long *)left;
+  unsigned long r = *(unsigned long *)right;
+
+  return l<r ? -1 : (l>r);
+}
+
+
+static void build_secindex(struct GlobalVars *gv,struct SecIndex *si)
+/* Index all input sections by name, so a pattern only needs to look at
+   the distinct section names instead of every input section. */
+{
+  struct ObjectUnit *obj;
+  struct Section *sec;
+  struct SecNames *sn;
+  unsigned long n,h;
+
+  memset(si,0,sizeof(struct SecIndex));
+  for (n=0,obj=(struct ObjectUnit *)gv->selobjects.first;
+       obj->n.next!=NULL; obj=(struct ObjectUnit *)obj->n.next) {
+    if (obj->lnkfile->type != ID_SHAREDOBJ) {
+      for (sec=(struct Section *)obj->sections.first;
+           sec->n.next!=NULL; sec=(struct Section *)sec->n.next)
+        n++;
+    }
+  }
+  si->secs = alloc((n+1)*sizeof(struct Section *));
+  si->match = alloc((n+1)*sizeof(unsigned long));
+  si->stamp = alloczero((n+1)*sizeof(unsigned long));
+  for (si->htabsize=16; si->htabsize<n; si->htabsize<<=1);
+  si->htab = alloczero(si->htabsize*sizeof(struct SecNames *));
+
+  for (obj=(struct ObjectUnit *)gv->selobjects.first;
+       obj->n.next!=NULL; obj=(struct ObjectUnit *)obj->n.next) {
+    if (obj->lnkfile->type == ID_SHAREDOBJ)
+      continue;
+    for (sec=(struct Section *)obj->sections.first;
+         sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
+      h = elf_hash(sec->name);
+      for (sn=si->htab[h&(si->htabsize-1)]; sn; sn=sn->next) {
+        if (sn->hash==h && !strcmp(sn->name,sec->name))
+          break;
+      }
+      if (sn == NULL) {
+        sn = alloczero(sizeof(struct SecNames));
+        sn->name = sec->name;
+        sn->hash = h;
+        sn->next = si->htab[h&(si->htabsize-1)];
+        si->htab[h&(si->htabsize-1)] = sn;
+        si->nnames++;
+      }
+      if (sn->nidx >= sn->maxidx) {
+        sn->maxidx = sn->maxidx ? sn->maxidx<<1 : 4;
+        sn->idx = re_alloc(sn->idx,sn->maxidx*sizeof(unsigned long));
+      }
+      sn->idx[sn->nidx++] = si->nsecs;
+      si->secs[si->nsecs++] = sec;
+    }
+  }
+
+  si->names = alloc((si->nnames+1)*sizeof(struct SecNames *));
+  for (n=0,h=0; h<si->htabsize; h++) {
+    for (sn=si->htab[h]; sn; sn=sn->next)
+      si->names[n++] = sn;
+  }
+  qsort(si->names,si->nnames,sizeof(struct SecNames *),secnames_cmp);
+}
+
+
+static void free_secindex(struct SecIndex *si)
+{
+  unsigned long i;
+
+  for (i=0; i<si->nnames; i++) {
+    free(si->names[i]->idx);
+    free(si->names[i]);
+  }
+  free(si->names);
+  free(si->htab);
+  free(si->stamp);
+  free(si->match);
+  free(si->secs);
+}
+
+
+static void add_matches(struct SecIndex *si,struct SecNames *sn)
+{
+  unsigned long i,j;
+
+  for (i=0; i<sn->nidx; i++) {
+    j = sn->idx[i];
+    if (si->secs[j]!=NULL && si->stamp[j]!=si->patno) {
+      si->stamp[j] = si->patno;
+      si->match[si->nmatch++] = j;
+    }
+  }
+}
+
+
+static void match_sections(struct SecIndex *si,char **patlist)
+/* Find all sections matching a list of section name patterns and
+   return their indexes in link order. Literal names are looked up in
+   the hash table, a prefix with a trailing '*' in the sorted name table,
+   and only the remaining patterns are matched against all names. */
+{
+  struct SecNames *sn;
+  unsigned long h,l,r,m;
+  size_t plen;
+  char *pat;
+
+  si->nmatch = 0;
+  si->patno++;
+  for (; patlist && (pat = *patlist); patlist++) {
+    switch (pattern_type(pat,&plen)) {
+      case PAT_LITERAL:
+        h = elf_hash(pat);
+        for (sn=si->htab[h&(si->htabsize-1)]; sn; sn=sn->next) {
+          if (sn->hash==h && !strcmp(sn->name,pat)) {
+            add_matches(si,sn);
+            break;
+          }
+        }
+        break;
+
+      case PAT_PREFIX:
+        /* binary search for the first name starting with the prefix */
+        for (l=0,r=si->nnames; l<r; ) {
+          m = (l + r) / 2;
+          if (strncmp(si->names[m]->name,pat,plen) < 0)
+            l = m + 1;
+          else
+            r = m;
+        }
+        for (; l<si->nnames && !strncmp(si->names[l]->name,pat,plen); l++)
+          add_matches(si,si->names[l]);
+        break;
+
+      default:
+        for (l=0; l<si->nnames; l++) {
+          if (pattern_match(pat,si->names[l]->name))
+            add_matches(si,si->names[l]);
+        }
+        break;
+    }
+  }
+  qsort(si->match,si->nmatch,sizeof(unsigned long),secidx_cmp);
+}
+
+
 void linker_merge(struct GlobalVars *gv)
 /* Merge the sections with same name and type, or as defined by a
    linker script. Calculate their virtual address and size. */
@@ -1859,9 +2497,11 @@ void linker_merge(struct GlobalVars *gv)
     /* are predefined LinkedSection structures which can be used. */
     struct LinkedSection *maxls=NULL;
     struct Patterns pat;
+    struct SecIndex si;
     unsigned long maxsize = 0;
 
     memset(&pat,0,sizeof(struct Patterns));
+    build_secindex(gv,&si);
     init_secdef_parse(gv);
     /* Handle one section definition after the other from the
        linker script's SECTIONS block. The script parser cares
@@ -1891,27 +2531,28 @@ void linker_merge(struct GlobalVars *gv)
         if (sec == VALIDPAT) {
           struct Section **msecs = NULL;
           int mcnt = 0;       /* number of matches for these patterns */
-
-          for (obj=(struct ObjectUnit *)gv->selobjects.first;
-               obj->n.next!=NULL; obj=(struct ObjectUnit *)obj->n.next) {
-
-            if (obj->lnkfile->type != ID_SHAREDOBJ &&
-                pattern_match(pat.fmatch,obj->lnkfile->filename) &&
-                !patternlist_match(pat.fexclude,obj->lnkfile->filename)) {
-              /* object's file name matches, walk through its sections */
-
-              sec = (struct Section *)obj->sections.first;
-              while (nextsec = (struct Section *)sec->n.next) {
-                if (sec->lnksec==NULL &&
-                    patternlist_match(pat.smatch,sec->name) &&
-                    !patternlist_match(pat.sexclude,sec->name) &&
-                    !garbage_collected(gv,&pat,sec) &&
-                    !(ls->flags&sec->flags&SF_LINKONCE)) {
-                  /* section name matches as well and section must not be
-                     ignored, so add to merge list */
-                  msecs = store_msect(mcnt++,sec);
-                }
-                sec = nextsec;
+          struct ObjectUnit *lastobj = NULL;
+          bool objmatch = FALSE;
+          unsigned long i;
+
+          /* find sections by name, then check their object's file name */
+          match_sections(&si,pat.smatch);
+          for (i=0; i<si.nmatch; i++) {
+            sec = si.secs[si.match[i]];
+            if ((obj = sec->obj) != lastobj) {
+              lastobj = obj;
+              objmatch = pattern_match(pat.fmatch,obj->lnkfile->filename) &&
+                         !patternlist_match(pat.fexclude,
+                                            obj->lnkfile->filename);
+            }
+            if (objmatch && sec->lnksec==NULL &&
+                !patternlist_match(pat.sexclude,sec->name)) {
+              if (garbage_collected(gv,&pat,sec))
+                si.secs[si.match[i]] = NULL;
+              else if (!(ls->flags&sec->flags&SF_LINKONCE)) {
+                /* section name matches as well and section must not be
+                   ignored, so add to merge list */
+                msecs = store_msect(mcnt++,sec);
               }
             }
           }
@@ -1940,6 +2581,8 @@ void linker_merge(struct GlobalVars *gv)
       }
     }
 
+    free_secindex(&si);
+
     /* Check if there are any sections left, which were not recognized */
     /* by the linker script rules */
     for (obj=(struct ObjectUnit *)gv->selobjects.first;
@@ -2159,80 +2802,6 @@ void linker_delunused(struct GlobalVars *gv)
 }
 
 
-void linker_mapfile(struct GlobalVars *gv)
-/* print section mapping, when desired */
-{
-  if (gv->map_file) {
-    struct ObjectUnit *obj;
-    struct Section *sec;
-    struct LinkedSection *ls;
-
-    /* print file names and the new addresses of their sections */
-    fprintf(gv->map_file,"\nFiles:\n");
-
-    for (obj=(struct ObjectUnit *)gv->selobjects.first;
-         obj->n.next!=NULL; obj=(struct ObjectUnit *)obj->n.next) {
-      struct LinkFile *lfile = obj->lnkfile;
-      char sep = ' ';
-
-      if (!(obj->flags & OUF_SCRIPT)) {
-        if (lfile->type == ID_LIBARCH)
-          fprintf(gv->map_file,"  %s (%s):",lfile->pathname,obj->objname);
-        else
-          fprintf(gv->map_file,"  %s:",obj->objname);
-
-        if (lfile->type != ID_SHAREDOBJ) {
-          for (ls=(struct LinkedSection *)gv->lnksec.first;
-               ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next) {
-            for (sec=(struct Section *)ls->sections.first;
-                 sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
-              if (sec->obj == obj) {  /* section came from this object? */
-                if (!is_common_sec(gv,sec)) {
-                  fprintf(gv->map_file,"%c %s %llx(%lx)",sep,sec->name,
-                          (unsigned long long)sec->va,sec->size);
-                  sep = ',';
-                }
-              }
-            }
-          }
-        }
-
-        if (sep == ',')  /* any sections listed? */
-          fprintf(gv->map_file," hex\n");
-        else
-          fprintf(gv->map_file,"  symbols only\n"); /* empty or shared obj. */
-      }
-    }
-
-    /* print section mappings */
-    fprintf(gv->map_file,"\n\nSection mapping (numbers in hex):\n");
-
-    for (ls=(struct LinkedSection *)gv->lnksec.first;
-         ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next) {
-      if (!(ls->size==0 && listempty(&ls->relocs) &&
-            listempty(&ls->symbols) && !(ls->ld_flags & LSF_PRESERVE))) {
-        fprintf(gv->map_file,"------------------------------\n"
-                "  %08llx %s  (size %lx",  /* @@@ FIXME */
-                (unsigned long long)ls->copybase,ls->name,ls->size);
-        if (ls->filesize < ls->size)
-          fprintf(gv->map_file,", allocated %lx",ls->filesize);
-        fprintf(gv->map_file,")\n");
-  
-        for (sec=(struct Section *)ls->sections.first;
-             sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
-          if (sec->obj!=NULL && !is_ld_script(sec->obj)) {
-            fprintf(gv->map_file,"           %08llx - %08llx %s(%s)\n",
-                    (unsigned long long)sec->va,
-                    (unsigned long long)sec->va+sec->size,
-                    sec->obj->objname,sec->name);
-          }
-        }
-      }
-    }
-  }
-}
-
-
 void linker_copy(struct GlobalVars *gv)
 /* Merge contents of linked sections, fix symbol offsets and
    allocate common symbol data. */
@@ -2247,8 +2816,10 @@ void linker_copy(struct GlobalVars *gv)
 
   if (gv->trace_file)
     fprintf(gv->trace_file,"\n");
-  if (gv->map_file)
-    fprintf(gv->map_file,"\n");
+
+  /* target may place section contents directly into the output file */
+  if (fff[gv->dest_format]->init != NULL)
+    fff[gv->dest_format]->init(gv,FFINI_COPY);
 
   for (ls=(struct LinkedSection *)gv->lnksec.first;
        ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next) {
@@ -2263,7 +2834,8 @@ void linker_copy(struct GlobalVars *gv)
       maxls = ls;
     }
     /* allocate memory for section, even for uninitialized ones */
-    ls->data = alloczero(tbytes(gv,ls->size));
+    if (ls->data == NULL)
+      ls->data = alloczero(tbytes(gv,ls->size));
 
     for (sec=(struct Section *)ls->sections.first;
          sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
@@ -2301,8 +2873,8 @@ void linker_copy(struct GlobalVars *gv)
       }
     }
 
-    if (gv->map_file!=NULL || gv->sym_file!=NULL) {
-      /* print section's symbols to map file, sorted by address */
+    if (gv->linkmap!=NULL || gv->sym_file!=NULL) {
+      /* sort section's symbols by address for map and symbol file */
       struct Symbol **sym_ptr_array;
       int cnt,acnt;
 
@@ -2336,12 +2908,6 @@ void linker_copy(struct GlobalVars *gv)
         }
         if (cnt > 1)
           qsort(sym_ptr_array,cnt,sizeof(void *),sym_addr_cmp);
-
-        if (gv->map_file) {
-          fprintf(gv->map_file,"\nSymbols of %s:\n",ls->name);
-          for (p=sym_ptr_array,i=0; i<cnt; p++,i++)
-            print_symbol(gv,gv->map_file,*p);
-        }
         
         if (gv->sym_file) {
           /* output symbol mapping in given format */
@@ -2361,22 +2927,21 @@ void linker_copy(struct GlobalVars *gv)
             }
           }
         }
-        free(sym_ptr_array);
+        if (gv->linkmap)
+          linkmap_symbols(gv,ls,sym_ptr_array,cnt);
+        else
+          free(sym_ptr_array);
       }
     }
   }
 
-  if (gv->map_file && abs_cnt) {
-    fprintf(gv->map_file,"\nAbsolute symbols:\n");
+  if (gv->linkmap) {
     if (abs_cnt > 1)
       qsort(abs_ptr_array,abs_cnt,sizeof(void *),sym_addr_cmp);
-    for (p=abs_ptr_array,i=0; i<abs_cnt; p++,i++)
-      print_symbol(gv,gv->map_file,*p);
-    free(abs_ptr_array);
+    linkmap_abssymbols(gv,abs_ptr_array,abs_cnt);
   }
-
-  if (gv->map_file)
-    fprintf(gv->map_file,"\nLinker symbols:\n");
+  else
+    free(abs_ptr_array);
 
   if (gv->use_ldscript && maxls!=NULL) {
     /* put remaining absolute linker script symbols into the
@@ -2386,8 +2951,8 @@ void linker_copy(struct GlobalVars *gv)
             == SYMF_PROVIDED)) {
         sym->relsect = (struct Section *)maxls->sections.first;
         addtail(&maxls->symbols,&sym->n);
-        if (gv->map_file)
-          print_symbol(gv,gv->map_file,sym);
+        if (gv->linkmap)
+          linkmap_lnksymbol(gv,sym);
       }
     }
   }
@@ -2403,489 +2968,614 @@ void linker_copy(struct GlobalVars *gv)
 }
 
 
-void linker_relocate(struct GlobalVars *gv)
-/* Fix relocations, resolve x-references and create more relocations, */
-/* if required. */
+void relocate_section(struct GlobalVars *gv,struct LinkedSection *ls,
+                      struct Section *sec,struct RelocBases *rb,
+                      struct list *relocs,struct list *xrefs)
+/* Fix the relocations and resolve the x-references of an input section
+   in the linked section ls. Relocations and references which remain in
+   the output file are appended to relocs and xrefs. */
 {
-  const char *fn = "linker_relocate(): ";
-  struct Symbol *sdabase,*sda2base,*gotbase,*pltbase,*r13init;
-  struct LinkedSection *ls;
-  struct Section *sec;
+  const char *fn = "relocate_section(): ";
+  struct Reloc *rel,*xref;
 
-  /* get symbols needed for reloc calculation */
-  sdabase = find_any_symbol(gv,NULL,sdabase_name);
-  sda2base = find_any_symbol(gv,NULL,sda2base_name);
-  gotbase = find_any_symbol(gv,NULL,gv->got_base_name);
-  pltbase = find_any_symbol(gv,NULL,gv->plt_base_name);
-  r13init = find_any_symbol(gv,NULL,r13init_name);
+  /*--------------------------*/
+  /* copy and fix relocations */
+  /*--------------------------*/
+  while (rel = (struct Reloc *)remhead(&sec->relocs)) {
+    bool keep = TRUE;
+    lword a = 0;
 
-  for (ls=(struct LinkedSection *)gv->lnksec.first;
-       ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next) {
+    rel->offset += sec->offset;
+    if (rel->rtype != R_MEMID)
+      rel->addend += rel->relocsect.ptr->offset;
+    rel->relocsect.lnk = rel->relocsect.ptr->lnksec;
 
-    /* dyn.relocs appear in uninitialized sections as well, so...*/
-    if (/*!(ls->flags&SF_UNINITIALIZED) &&*/ ls->size>0) {
-      if (gv->trace_file)
-        fprintf(gv->trace_file,"Relocating %s:\n",ls->name);
+    switch (rel->rtype) {
 
-      for (sec=(struct Section *)ls->sections.first;
-           sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
-        struct Reloc *rel,*xref;
+      case R_PLTPC:
+      case R_GOTPC:
+        if (gv->dest_object)
+          break;
+        rel->rtype = R_PC;
+        /* fall through */
+
+      case R_PC:          /* Normal, PC-relative reference */
+      case R_LOCALPC:
+        /* resolve relative relocs from the same section */
+        if (rel->relocsect.lnk == ls) {
+          a = (rel->relocsect.lnk->base + rel->addend) -
+              (ls->base + rel->offset);
+          a = writesection(gv,ls->data,rel->offset,rel,a);
+          keep = FALSE;
+        }
+        break;
+
+      case R_SECOFF:      /* symbol's section-offset */
+        if (!gv->dest_object) {
+          a = rel->addend;
+          a = writesection(gv,ls->data,rel->offset,rel,a);
+          keep = FALSE;
+        }
+        break;
+
+      case R_MEMID:       /* destination's memory id (bank) */
+        if (!gv->dest_object) {
+          lword id = rel->relocsect.lnk->relocmem ?
+                     rel->relocsect.lnk->relocmem->id:MEM_NOID;
+          if (id == MEM_NOID) {
+            error(165,getobjname(sec->obj),sec->name,
+                  rel->offset-sec->offset,rel->relocsect.lnk->name,
+                  rel->relocsect.lnk->name);
+            id = 0;
+          }
+          a = id + rel->addend;
+          a = writesection(gv,ls->data,rel->offset,rel,a);
+          keep = FALSE;
+        }
+        break;
+
+      case R_GOT:         /* GOT offset */
+      case R_GOTOFF:
+        if (!gv->dest_object) {
+          if (rb->gotbase) {
+            a = rel->relocsect.lnk->base + rel->addend - rb->gotbase->value;
+            a = writesection(gv,ls->data,rel->offset,rel,a);
+            keep = FALSE;
+          }
+          else
+            undef_sym_error(sec,rel,gv->got_base_name);
+        }
+        break;
+
+      case R_SD:          /* _SDA_BASE_ relative reference */
+        if (!gv->dest_object) {
+          /* resolve base-relative relocation for executable file */
+          if (rb->sdabase) {
+            a = rel->relocsect.lnk->base +  rel->addend - rb->sdabase->value;
+            a = writesection(gv,ls->data,rel->offset,rel,a);
+            keep = FALSE;
+          }
+          else
+            undef_sym_error(sec,rel,sdabase_name);
+        }
+        break;
+
+      case RPPC_SD2:       /* _SDA2_BASE_ relative reference */
+        if (!gv->dest_object) {
+          /* resolve base-relative relocation for executable file */
+          if (rb->sda2base) {
+            a = rel->relocsect.lnk->base + rel->addend - rb->sda2base->value;
+            a = writesection(gv,ls->data,rel->offset,rel,a);
+            keep = FALSE;
+          }
+          else
+            undef_sym_error(sec,rel,sda2base_name);
+        }
+        break;
+
+      case RPPC_SD21:        /* PPC-EABI base rel. reference */
+        if (!gv->dest_object) {
+          /* resolve base-relative relocation for executable file */
+          const char *secname = rel->relocsect.lnk->name;
+
+          *(ls->data+rel->offset+1) &= 0xe0;
+          if (!strcmp(secname,sdata_name) ||
+              !strcmp(secname,sbss_name)) {
+            if (rb->sdabase) {
+              a = rel->relocsect.lnk->base + rel->addend - rb->sdabase->value;
+              *(ls->data+rel->offset+1) |= 13;
+              a = writesection(gv,ls->data,rel->offset,rel,a);
+              keep = FALSE;
+            }
+            else
+              undef_sym_error(sec,rel,sdabase_name);
+          }
+          else if (!strcmp(secname,sdata2_name) ||
+                   !strcmp(secname,sbss2_name)) {
+            if (rb->sda2base) {
+              a = rel->relocsect.lnk->base + rel->addend - rb->sda2base->value;
+              *(ls->data+rel->offset+1) |= 2;
+              a = writesection(gv,ls->data,rel->offset,rel,a);
+              keep = FALSE;
+            }
+            else
+              undef_sym_error(sec,rel,sda2base_name);
+          }
+          else if (!strcmp(secname,".PPC.EMB.sdata0") ||
+                   !strcmp(secname,".PPC.EMB.sbss0")) {
+            a = rel->relocsect.lnk->base + rel->addend;
+            a = writesection(gv,ls->data,rel->offset,rel,a);
+            keep = FALSE;
+          }
+          else {
+            print_function_name(sec,rel->offset);
+            error(117,getobjname(sec->obj),sec->name,
+                  rel->offset-sec->offset,reloc_name[rel->rtype],
+                  secname,secname);
+          }
+        }
+        break;
+
+      case RPPC_MOSDREL:     /* __r13_init rel. reference */
+        if (!gv->dest_object) {
+          /* resolve base-relative relocation for executable file */
+          if (rb->r13init) {
+            a = rel->relocsect.lnk->base + rel->addend - rb->r13init->value;
+            a = writesection(gv,ls->data,rel->offset,rel,a);
+            keep = FALSE;
+          }
+          else
+            undef_sym_error(sec,rel,r13init_name);
+        }
+        break;
+
+      case RPPC_AOSBREL:     /* .data rel. reference */
+        if (!gv->dest_object) {
+          /* resolve base-relative relocation for executable file */
+          struct LinkedSection *datals;
+
+          if (datals = find_lnksec(gv,data_name,0,0,0,0)) {
+            a = rel->relocsect.lnk->base + rel->addend - datals->base;
+            a = writesection(gv,ls->data,rel->offset,rel,a);
+            keep = FALSE;
+          }
+          else {
+            print_function_name(sec,rel->offset);
+            error(120,getobjname(sec->obj),sec->name,
+                  rel->offset-sec->offset,data_name);
+          }
+        }
+        break;
+
+      case R_NONE:
+      case R_ABS:
+        break;
+
+      default:
+        ierror("%sReloc type %d (%s) is not yet supported",
+               fn,(int)rel->rtype,reloc_name[rel->rtype]);
+        break;
+    }
+
+    if (keep) {
+      /* keep relocations which cannot be resolved in output file */
+/*@@@ writesection(gv,ls->data,rel->offset,rel,rel->addend); */
+      addtail(relocs,&rel->n);
+      a = 0;
+    }
+
+    if (a) {  /* relocation out of range! */
+      print_function_name(sec,rel->offset);
+      error(25,getobjname(sec->obj),sec->name,rel->offset-sec->offset,
+            (int)rel->insert->bsiz,reloc_name[rel->rtype],
+            rel->relocsect.lnk->name,sgnchar(rel->addend),
+            abstaddr(rel->addend),optsgnstr(a),abstaddr(a));
+    }
+  }
+
+
+  /*------------------------------------*/
+  /* resolve, fix and copy x-references */
+  /*------------------------------------*/
+  while (xref = (struct Reloc *)remhead(&sec->xrefs)) {
+    struct LinkedSection *refls = NULL;
+    struct Symbol *xdef;
+    int err_no = 0;
+    lword a = 0;
+    bool make_reloc = FALSE;
+
+    xref->offset += sec->offset;
+    xdef = xref->relocsect.symbol;
+
+    if (xdef != NULL &&
+      /* dynamic relocations must be left alone */
+        !(xref->flags & RELF_DYNLINK) &&
+      /* common symbols have to be resolved in the final executable
+         only, or when option -dc (allocate commons) is given */
+        !(xref->relocsect.symbol->type==SYM_COMMON &&
+          (gv->dest_object && !gv->alloc_common))) {
+
+      /* Relative/absolute reference to absolute symbol */
+      if (xdef->type == SYM_ABS) {
+        a = xdef->value + xref->addend;
+        err_no = 26;
+      }
 
-        /*--------------------------*/
-        /* copy and fix relocations */
-        /*--------------------------*/
-        while (rel = (struct Reloc *)remhead(&sec->relocs)) {
-          bool keep = TRUE;
-          lword a = 0;
+      else if (xdef->type == SYM_RELOC) {
+        if ((refls = xdef->relsect->lnksec) == NULL) {
+          /* Cannot resolve reference to <sym-name>, because section
+             <name> was not recognized by the linker script */
+          error(112,getobjname(sec->obj),sec->name,
+                xref->offset-sec->offset,xref->xrefname,
+                xdef->relsect->name);
+        }
+        else {
+          lword symoffset;
+
+          if (refls!=ls &&
+              (refls->ld_flags & ls->ld_flags & LSF_NOXREFS)) {
+            /* reference between overlayed sections (NOCROSSREFS) */
+            print_function_name(sec,xref->offset);
+            error(159,getobjname(sec->obj),sec->name,
+                  xref->offset-sec->offset,ls->name,refls->name,
+                  xdef->name);
+          }
 
-          rel->offset += sec->offset;
-          if (rel->rtype != R_MEMID)
-            rel->addend += rel->relocsect.ptr->offset;
-          rel->relocsect.lnk = rel->relocsect.ptr->lnksec;
+          symoffset = xdef->value - refls->base;
+          a = symoffset + xref->addend;
 
-          switch (rel->rtype) {
+          switch (xref->rtype) {
 
             case R_PLTPC:
             case R_GOTPC:
+              /* PC-relative PLT/GOT reference */
               if (gv->dest_object)
                 break;
-              rel->rtype = R_PC;
+              xref->rtype = R_PC;
               /* fall through */
 
-            case R_PC:          /* Normal, PC-relative reference */
-            case R_LOCALPC:
-              /* resolve relative relocs from the same section */
-              if (rel->relocsect.lnk == ls) {
-                a = (rel->relocsect.lnk->base + rel->addend) -
-                    (ls->base + rel->offset);
-                a = writesection(gv,ls->data,rel->offset,rel,a);
-                keep = FALSE;
+            case R_PC:
+              /* PC relative reference to relocatable symbol */
+              if (refls != ls) {
+                make_reloc = TRUE;
+              }
+              else {
+                a = (xdef->value + xref->addend) -
+                    (sec->lnksec->base + xref->offset);
+                err_no = 28;
               }
               break;
 
-            case R_SECOFF:      /* symbol's section-offset */
-              if (!gv->dest_object) {
-                a = rel->addend;
-                a = writesection(gv,ls->data,rel->offset,rel,a);
-                keep = FALSE;
-              }
+            case R_SECOFF:
+              /* reference to symbol's section offset */
+              err_no = 36;
+              if (gv->dest_object)
+                make_reloc = TRUE;
               break;
 
-            case R_MEMID:       /* destination's memory id (bank) */
+            case R_MEMID:
+              /* reference to symbol's destination memory id (bank) */
+              err_no = 166;
               if (!gv->dest_object) {
-                lword id = rel->relocsect.lnk->relocmem ?
-                           rel->relocsect.lnk->relocmem->id:MEM_NOID;
+                lword id = refls->relocmem?refls->relocmem->id:MEM_NOID;
+
                 if (id == MEM_NOID) {
                   error(165,getobjname(sec->obj),sec->name,
-                        rel->offset-sec->offset,rel->relocsect.lnk->name,
-                        rel->relocsect.lnk->name);
+                        xref->offset-sec->offset,refls->name,
+                        xdef->name);
                   id = 0;
                 }
-                a = id + rel->addend;
-                a = writesection(gv,ls->data,rel->offset,rel,a);
-                keep = FALSE;
+                a = id + xref->addend;
               }
+              else  /* keep as reference - do not turn into reloc */
+                addtail(xrefs,&xref->n);
               break;
 
-            case R_GOT:         /* GOT offset */
+            case R_GOT:
+              /* _GLOBAL_OFFSET_TABLE_ relative reference to an
+                 object's pointer slot in .got */
             case R_GOTOFF:
+              /* symbol's offset to _GLOBAL_OFFSET_TABLE_ */
+              err_no = 36;
               if (!gv->dest_object) {
-                if (gotbase) {
-                  a = rel->relocsect.lnk->base + rel->addend - gotbase->value;
-                  a = writesection(gv,ls->data,rel->offset,rel,a);
-                  keep = FALSE;
+                if (rb->gotbase) {
+                  a = xdef->value + xref->addend - rb->gotbase->value;
                 }
                 else
-                  undef_sym_error(sec,rel,gv->got_base_name);
+                  undef_sym_error(sec,xref,gv->got_base_name);
               }
+              else
+                make_reloc = TRUE;
               break;
 
-            case R_SD:          /* _SDA_BASE_ relative reference */
+            case R_SD:
+              /* _SDA_BASE_ relative reference to relocatable symbol */
+              err_no = 36;
               if (!gv->dest_object) {
-                /* resolve base-relative relocation for executable file */
-                if (sdabase) {
-                  a = rel->relocsect.lnk->base +  rel->addend - sdabase->value;
-                  a = writesection(gv,ls->data,rel->offset,rel,a);
-                  keep = FALSE;
+                if (rb->sdabase) {
+                  a = xdef->value + xref->addend - rb->sdabase->value;
                 }
                 else
-                  undef_sym_error(sec,rel,sdabase_name);
+                  undef_sym_error(sec,xref,sdabase_name);
               }
+              else
+                make_reloc = TRUE;
               break;
-              
-            case RPPC_SD2:       /* _SDA2_BASE_ relative reference */
+
+            case RPPC_SD2:
+              /* _SDA2_BASE_ relative reference to relocatable symbol */
+              err_no = 36;
               if (!gv->dest_object) {
-                /* resolve base-relative relocation for executable file */
-                if (sda2base) {
-                  a = rel->relocsect.lnk->base + rel->addend - sda2base->value;
-                  a = writesection(gv,ls->data,rel->offset,rel,a);
-                  keep = FALSE;
+                if (rb->sda2base) {
+                  a = xdef->value + xref->addend - rb->sda2base->value;
                 }
                 else
-                  undef_sym_error(sec,rel,sda2base_name);
+                  undef_sym_error(sec,xref,sda2base_name);
               }
+              else
+                make_reloc = TRUE;
               break;
 
-            case RPPC_SD21:        /* PPC-EABI base rel. reference */
+            case RPPC_SD21:
+              /* PPC-EABI: base relative reference via base-reg 0,2 or 13 */
+              err_no = 36;
               if (!gv->dest_object) {
-                /* resolve base-relative relocation for executable file */
-                const char *secname = rel->relocsect.lnk->name;
+                const char *secname = refls->name;
 
-                *(ls->data+rel->offset+1) &= 0xe0;
+                *(ls->data+xref->offset+1) &= 0xe0;
                 if (!strcmp(secname,sdata_name) ||
                     !strcmp(secname,sbss_name)) {
-                  if (sdabase) {
-                    a = rel->relocsect.lnk->base + rel->addend - sdabase->value;
-                    *(ls->data+rel->offset+1) |= 13;
-                    a = writesection(gv,ls->data,rel->offset,rel,a);
-                    keep = FALSE;
+                  if (rb->sdabase) {
+                    a = xdef->value + xref->addend - rb->sdabase->value;
+                    *(ls->data+xref->offset+1) |= 13;
                   }
                   else
-                    undef_sym_error(sec,rel,sdabase_name);
+                    undef_sym_error(sec,xref,sdabase_name);
                 }
                 else if (!strcmp(secname,sdata2_name) ||
                          !strcmp(secname,sbss2_name)) {
-                  if (sda2base) {
-                    a = rel->relocsect.lnk->base + rel->addend - sda2base->value;
-                    *(ls->data+rel->offset+1) |= 2;
-                    a = writesection(gv,ls->data,rel->offset,rel,a);
-                    keep = FALSE;
+                  if (rb->sda2base) {
+                    a = xdef->value + xref->addend - rb->sda2base->value;
+                    *(ls->data+xref->offset+1) |= 2;
                   }
                   else
-                    undef_sym_error(sec,rel,sda2base_name);
+                    undef_sym_error(sec,xref,sda2base_name);
                 }
                 else if (!strcmp(secname,".PPC.EMB.sdata0") ||
                          !strcmp(secname,".PPC.EMB.sbss0")) {
-                  a = rel->relocsect.lnk->base + rel->addend;
-                  a = writesection(gv,ls->data,rel->offset,rel,a);
-                  keep = FALSE;
+                  a = xdef->value + xref->addend;
                 }
                 else {
-                  print_function_name(sec,rel->offset);
+                  print_function_name(sec,xref->offset);
                   error(117,getobjname(sec->obj),sec->name,
-                        rel->offset-sec->offset,reloc_name[rel->rtype],
-                        secname,secname);
+                        xref->offset-sec->offset,reloc_name[xref->rtype],
+                        xdef->name,secname);
                 }
               }
+              else
+                make_reloc = TRUE;
               break;
 
-            case RPPC_MOSDREL:     /* __r13_init rel. reference */
+            case RPPC_MOSDREL:
+              err_no = 36;
               if (!gv->dest_object) {
-                /* resolve base-relative relocation for executable file */
-                if (r13init) {
-                  a = rel->relocsect.lnk->base + rel->addend - r13init->value;
-                  a = writesection(gv,ls->data,rel->offset,rel,a);
-                  keep = FALSE;
+                if (rb->r13init) {
+                  a = xdef->value + xref->addend - rb->r13init->value;
                 }
                 else
-                  undef_sym_error(sec,rel,r13init_name);
+                  undef_sym_error(sec,xref,r13init_name);
               }
+              else
+                make_reloc = TRUE;
               break;
 
-            case RPPC_AOSBREL:     /* .data rel. reference */
+            case RPPC_AOSBREL:
+              err_no = 36;
               if (!gv->dest_object) {
-                /* resolve base-relative relocation for executable file */
                 struct LinkedSection *datals;
 
                 if (datals = find_lnksec(gv,data_name,0,0,0,0)) {
-                  a = rel->relocsect.lnk->base + rel->addend - datals->base;
-                  a = writesection(gv,ls->data,rel->offset,rel,a);
-                  keep = FALSE;
+                  a = xdef->value + xref->addend - datals->base;
                 }
                 else {
-                  print_function_name(sec,rel->offset);
+                  print_function_name(sec,xref->offset);
                   error(120,getobjname(sec->obj),sec->name,
                         rel->offset-sec->offset,data_name);
                 }
               }
+              else
+                make_reloc = TRUE;
               break;
-            
-            case R_NONE:
+
             case R_ABS:
-              break;
+              /* Absolute reference to relocatable symbol */
+              make_reloc = TRUE;
+              /* fall through */
 
-            default:
-              ierror("%sReloc type %d (%s) is not yet supported",
-                     fn,(int)rel->rtype,reloc_name[rel->rtype]);
+            case R_NONE:
               break;
-          }
 
-          if (keep) {
-            /* keep relocations which cannot be resolved in output file */
-/*@@@       writesection(gv,ls->data,rel->offset,rel,rel->addend); */
-            addtail(&ls->relocs,&rel->n);
-            a = 0;
-          }
-
-          if (a) {  /* relocation out of range! */
-            print_function_name(sec,rel->offset);
-            error(25,getobjname(sec->obj),sec->name,rel->offset-sec->offset,
-                  (int)rel->insert->bsiz,reloc_name[rel->rtype],
-                  rel->relocsect.lnk->name,sgnchar(rel->addend),
-                  abstaddr(rel->addend),optsgnstr(a),abstaddr(a));
+            default:
+              ierror("%sXRef reloc type %d (%s) is not yet supported",
+                     fn,(int)xref->rtype,reloc_name[xref->rtype]);
           }
         }
+      }
+      else
+        ierror("%sReferenced symbol has type %d",fn,(int)xdef->type);
+
+      if (make_reloc) {
+        /* turn into a relocation */
+        if (refls == NULL)
+          ierror("%sReferenced output section for %s does not exist",
+                 fn,xdef->name);
+        xref->addend = a;
+        xref->xrefname = NULL;
+        xref->relocsect.lnk = refls;
+        addtail(relocs,&xref->n);
+      }
+      else {
+        if (a = writesection(gv,ls->data,xref->offset,xref,a)) {
+          /* value of referenced symbol is out of range! */
+          print_function_name(sec,xref->offset);
+          error(err_no,getobjname(sec->obj),sec->name,
+                xref->offset-sec->offset,
+                xdef->name,mtaddr(gv,xdef->value),
+                sgnchar(xref->addend),abstaddr(xref->addend),
+                optsgnstr(a),abstaddr(a),(int)xref->insert->bsiz);
+        }
+      }
+    }
 
+    else /*@@@if (xref->rtype != R_NONE)*/ {
+      /* xref remains in output file untouched */
+      addtail(xrefs,&xref->n);
+    }
+  }
+}
 
-        /*------------------------------------*/
-        /* resolve, fix and copy x-references */
-        /*------------------------------------*/
-        while (xref = (struct Reloc *)remhead(&sec->xrefs)) {
-          struct LinkedSection *refls = NULL;
-          struct Symbol *xdef;
-          int err_no = 0;
-          lword a = 0;
-          bool make_reloc = FALSE;
-
-          xref->offset += sec->offset;
-          xdef = xref->relocsect.symbol;
-
-          if (xdef != NULL &&
-            /* dynamic relocations must be left alone */
-              !(xref->flags & RELF_DYNLINK) &&
-            /* common symbols have to be resolved in the final executable
-               only, or when option -dc (allocate commons) is given */
-              !(xref->relocsect.symbol->type==SYM_COMMON &&
-                (gv->dest_object && !gv->alloc_common))) {
-
-            /* Relative/absolute reference to absolute symbol */
-            if (xdef->type == SYM_ABS) {
-              a = xdef->value + xref->addend;
-              err_no = 26;
-            }
-
-            else if (xdef->type == SYM_RELOC) {
-              if ((refls = xdef->relsect->lnksec) == NULL) {
-                /* Cannot resolve reference to <sym-name>, because section
-                   <name> was not recognized by the linker script */
-                error(112,getobjname(sec->obj),sec->name,
-                      xref->offset-sec->offset,xref->xrefname,
-                      xdef->relsect->name);
-              }
-              else {
-                lword symoffset;
-
-                if (refls!=ls &&
-                    (refls->ld_flags & ls->ld_flags & LSF_NOXREFS)) {
-                  /* reference between overlayed sections (NOCROSSREFS) */
-                  print_function_name(sec,xref->offset);
-                  error(159,getobjname(sec->obj),sec->name,
-                        xref->offset-sec->offset,ls->name,refls->name,
-                        xdef->name);
-                }
-
-                symoffset = xdef->value - refls->base;
-                a = symoffset + xref->addend;
-
-                switch (xref->rtype) {
-
-                  case R_PLTPC:
-                  case R_GOTPC:
-                    /* PC-relative PLT/GOT reference */
-                    if (gv->dest_object)
-                      break;
-                    xref->rtype = R_PC;
-                    /* fall through */
+#ifdef PTHREADS
+struct RelocQueue {
+  pthread_mutex_t lock;
+  struct GlobalVars *gv;
+  struct RelocBases *rb;
+  struct Section **secs;        /* input sections of all linked sections */
+  struct ErrorBuffer *diag;     /*  and their diagnostics */
+  size_t nsecs;
+  size_t next;                  /* next section to relocate */
+};
 
-                  case R_PC:
-                    /* PC relative reference to relocatable symbol */
-                    if (refls != ls) {
-                      make_reloc = TRUE;
-                    }
-                    else {
-                      a = (xdef->value + xref->addend) -
-                          (sec->lnksec->base + xref->offset);
-                      err_no = 28;
-                    }
-                    break;
 
-                  case R_SECOFF:
-                    /* reference to symbol's section offset */
-                    err_no = 36;
-                    if (gv->dest_object)
-                      make_reloc = TRUE;
-                    break;
+static void *reloc_worker(void *arg)
+/* Relocate the next input section from the queue, until none is left.
+   Diagnostics are recorded per section and printed in section order by
+   parallel_relocate(). After a fatal error no more sections are taken. */
+{
+  struct RelocQueue *q = (struct RelocQueue *)arg;
+  struct list relocs,xrefs;
+  struct Section *sec;
+  size_t i;
+
+  initlist(&relocs);
+  initlist(&xrefs);
+  for (;;) {
+    pthread_mutex_lock(&q->lock);
+    i = q->next < q->nsecs ? q->next++ : q->nsecs;
+    pthread_mutex_unlock(&q->lock);
+    if (i >= q->nsecs)
+      break;
+    sec = q->secs[i];
+    buffer_errors(&q->diag[i]);
+    if (setjmp(q->diag[i].abort) == 0)
+      relocate_section(q->gv,sec->lnksec,sec,q->rb,&relocs,&xrefs);
+    buffer_errors(NULL);
+    if (q->diag[i].fatal) {
+      pthread_mutex_lock(&q->lock);
+      q->next = q->nsecs;
+      pthread_mutex_unlock(&q->lock);
+      break;
+    }
+    /* keep the results in the emptied section lists */
+    appendlist(&sec->relocs,&relocs);
+    appendlist(&sec->xrefs,&xrefs);
+  }
+  return NULL;
+}
 
-                  case R_MEMID:
-                    /* reference to symbol's destination memory id (bank) */
-                    err_no = 166;
-                    if (!gv->dest_object) {
-                      lword id = refls->relocmem?refls->relocmem->id:MEM_NOID;
-
-                      if (id == MEM_NOID) {
-                        error(165,getobjname(sec->obj),sec->name,
-                              xref->offset-sec->offset,refls->name,
-                              xdef->name);
-                        id = 0;
-                      }
-                      a = id + xref->addend;
-                    }
-                    else  /* keep as reference - do not turn into reloc */
-                      addtail(&ls->xrefs,&xref->n);
-                    break;
 
-                  case R_GOT:
-                    /* _GLOBAL_OFFSET_TABLE_ relative reference to an
-                       object's pointer slot in .got */
-                  case R_GOTOFF:
-                    /* symbol's offset to _GLOBAL_OFFSET_TABLE_ */
-                    err_no = 36;
-                    if (!gv->dest_object) {
-                      if (gotbase) {
-                        a = xdef->value + xref->addend - gotbase->value;
-                      }
-                      else
-                        undef_sym_error(sec,xref,gv->got_base_name);
-                    }
-                    else
-                      make_reloc = TRUE;
-                    break;
+static void parallel_relocate(struct GlobalVars *gv,struct RelocBases *rb)
+/* Relocate all input sections with gv->jobs threads. They only write
+   into their own part of a linked section's data. The remaining
+   relocations and references are collected in section order, so the
+   output is the same as with a single thread. */
+{
+  struct RelocQueue q;
+  struct LinkedSection *ls;
+  struct Section *sec;
+  pthread_t *tid = alloc(gv->jobs * sizeof(pthread_t));
+  size_t i;
+  int n;
 
-                  case R_SD:
-                    /* _SDA_BASE_ relative reference to relocatable symbol */
-                    err_no = 36;
-                    if (!gv->dest_object) {
-                      if (sdabase) {
-                        a = xdef->value + xref->addend - sdabase->value;
-                      }
-                      else
-                        undef_sym_error(sec,xref,sdabase_name);
-                    }
-                    else
-                      make_reloc = TRUE;
-                    break;
+  for (q.nsecs=0,ls=(struct LinkedSection *)gv->lnksec.first;
+       ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next) {
+    if (ls->size > 0) {
+      if (gv->trace_file)
+        fprintf(gv->trace_file,"Relocating %s:\n",ls->name);
+      for (sec=(struct Section *)ls->sections.first;
+           sec->n.next!=NULL; sec=(struct Section *)sec->n.next)
+        q.nsecs++;
+    }
+  }
+  q.secs = alloc((q.nsecs+1) * sizeof(struct Section *));
+  q.diag = alloczero((q.nsecs+1) * sizeof(struct ErrorBuffer));
+  for (i=0,ls=(struct LinkedSection *)gv->lnksec.first;
+       ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next) {
+    if (ls->size > 0) {
+      for (sec=(struct Section *)ls->sections.first;
+           sec->n.next!=NULL; sec=(struct Section *)sec->n.next)
+        q.secs[i++] = sec;
+    }
+  }
 
-                  case RPPC_SD2:
-                    /* _SDA2_BASE_ relative reference to relocatable symbol */
-                    err_no = 36;
-                    if (!gv->dest_object) {
-                      if (sda2base) {
-                        a = xdef->value + xref->addend - sda2base->value;
-                      }
-                      else
-                        undef_sym_error(sec,xref,sda2base_name);
-                    }
-                    else
-                      make_reloc = TRUE;
-                    break;
+  pthread_mutex_init(&q.lock,NULL);
+  q.gv = gv;
+  q.rb = rb;
+  q.next = 0;
+  for (n=1; n<gv->jobs && n<q.nsecs; n++) {
+    if (pthread_create(&tid[n],NULL,reloc_worker,&q) != 0)
+      break;  /* continue with the threads we got */
+  }
+  reloc_worker(&q);  /* the main thread helps */
+  while (--n > 0)
+    pthread_join(tid[n],NULL);
+  pthread_mutex_destroy(&q.lock);
 
-                  case RPPC_SD21:
-                    /* PPC-EABI: base relative reference via base-reg 0,2 or 13 */
-                    err_no = 36;
-                    if (!gv->dest_object) {
-                      const char *secname = refls->name;
-
-                      *(ls->data+xref->offset+1) &= 0xe0;
-                      if (!strcmp(secname,sdata_name) ||
-                          !strcmp(secname,sbss_name)) {
-                        if (sdabase) {
-                          a = xdef->value + xref->addend - sdabase->value;
-                          *(ls->data+xref->offset+1) |= 13;
-                        }
-                        else
-                          undef_sym_error(sec,xref,sdabase_name);
-                      }
-                      else if (!strcmp(secname,sdata2_name) ||
-                               !strcmp(secname,sbss2_name)) {
-                        if (sda2base) {
-                          a = xdef->value + xref->addend - sda2base->value;
-                          *(ls->data+xref->offset+1) |= 2;
-                        }
-                        else
-                          undef_sym_error(sec,xref,sda2base_name);
-                      }
-                      else if (!strcmp(secname,".PPC.EMB.sdata0") ||
-                               !strcmp(secname,".PPC.EMB.sbss0")) {
-                        a = xdef->value + xref->addend;
-                      }
-                      else {
-                        print_function_name(sec,xref->offset);
-                        error(117,getobjname(sec->obj),sec->name,
-                              xref->offset-sec->offset,reloc_name[xref->rtype],
-                              xdef->name,secname);
-                      }
-                    }
-                    else
-                      make_reloc = TRUE;
-                    break;
+  for (i=0; i<q.nsecs; i++) {
+    flush_errors(&q.diag[i]);  /* fatal errors abort here */
+    sec = q.secs[i];
+    appendlist(&sec->lnksec->relocs,&sec->relocs);
+    appendlist(&sec->lnksec->xrefs,&sec->xrefs);
+  }
+  free(q.diag);
+  free(q.secs);
+  free(tid);
+}
+#endif
 
-                  case RPPC_MOSDREL:
-                    err_no = 36;
-                    if (!gv->dest_object) {
-                      if (r13init) {
-                        a = xdef->value + xref->addend - r13init->value;
-                      }
-                      else
-                        undef_sym_error(sec,xref,r13init_name);
-                    }
-                    else
-                      make_reloc = TRUE;
-                    break;
 
-                  case RPPC_AOSBREL:
-                    err_no = 36;
-                    if (!gv->dest_object) {
-                      struct LinkedSection *datals;
-
-                      if (datals = find_lnksec(gv,data_name,0,0,0,0)) {
-                        a = xdef->value + xref->addend - datals->base;
-                      }
-                      else {
-                        print_function_name(sec,xref->offset);
-                        error(120,getobjname(sec->obj),sec->name,
-                              rel->offset-sec->offset,data_name);
-                      }
-                    }
-                    else
-                      make_reloc = TRUE;
-                    break;
+void linker_relocate(struct GlobalVars *gv)
+/* Fix relocations, resolve x-references and create more relocations, */
+/* if required. */
+{
+  struct RelocBases rb;
+  struct LinkedSection *ls;
+  struct Section *sec;
 
-                  case R_ABS:
-                    /* Absolute reference to relocatable symbol */
-                    make_reloc = TRUE;
-                    /* fall through */
+  /* get symbols needed for reloc calculation */
+  rb.sdabase = find_any_symbol(gv,NULL,sdabase_name);
+  rb.sda2base = find_any_symbol(gv,NULL,sda2base_name);
+  rb.gotbase = find_any_symbol(gv,NULL,gv->got_base_name);
+  rb.pltbase = find_any_symbol(gv,NULL,gv->plt_base_name);
+  rb.r13init = find_any_symbol(gv,NULL,r13init_name);
+
+#ifdef PTHREADS
+  if (gv->jobs > 1) {
+    parallel_relocate(gv,&rb);
+    return;
+  }
+#endif
 
-                  case R_NONE:
-                    break;
+  for (ls=(struct LinkedSection *)gv->lnksec.first;
+       ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next) {
 
-                  default:
-                    ierror("%sXRef reloc type %d (%s) is not yet supported",
-                           fn,(int)xref->rtype,reloc_name[xref->rtype]);
-                }
-              }
-            }
-            else
-              ierror("%sReferenced symbol has type %d",fn,(int)xdef->type);
-
-            if (make_reloc) {
-              /* turn into a relocation */
-              if (refls == NULL)
-                ierror("%sReferenced output section for %s does not exist",
-                       fn,xdef->name);
-              xref->addend = a;
-              xref->xrefname = NULL;
-              xref->relocsect.lnk = refls;
-              addtail(&ls->relocs,&xref->n);
-            }
-            else {
-              if (a = writesection(gv,ls->data,xref->offset,xref,a)) {
-                /* value of referenced symbol is out of range! */
-                print_function_name(sec,xref->offset);
-                error(err_no,getobjname(sec->obj),sec->name,
-                      xref->offset-sec->offset,
-                      xdef->name,mtaddr(gv,xdef->value),
-                      sgnchar(xref->addend),abstaddr(xref->addend),
-                      optsgnstr(a),abstaddr(a),(int)xref->insert->bsiz);
-              }
-            }
-          }
+    /* dyn.relocs appear in uninitialized sections as well, so...*/
+    if (/*!(ls->flags&SF_UNINITIALIZED) &&*/ ls->size>0) {
+      if (gv->trace_file)
+        fprintf(gv->trace_file,"Relocating %s:\n",ls->name);
 
-          else /*@@@if (xref->rtype != R_NONE)*/ {
-            /* xref remains in output file untouched */
-            addtail(&ls->xrefs,&xref->n);
-          }
-        }
-      }      
+      for (sec=(struct Section *)ls->sections.first;
+           sec->n.next!=NULL; sec=(struct Section *)sec->n.next)
+        relocate_section(gv,ls,sec,&rb,&ls->relocs,&ls->xrefs);
     }
   }
 }
@@ -3039,6 +3729,7 @@ static void write_line_offsets(struct GlobalVars *gv,const char **nametab)
 
 void linker_write(struct GlobalVars *gv)
 {
+  bool mapped = gv->outmap != NULL;
   FILE *f;
 
   if (!gv->errflag && !gv->discardOutput) {  /* no error? */
@@ -3072,7 +3763,11 @@ void linker_write(struct GlobalVars *gv)
     }
 
     /* create output file */
-    if (!gv->output_sections && !(fff[gv->dest_format]->flags&FFF_NOFILE)) {
+    if (mapped) {
+      f = NULL;  /* sections were already placed into the mapped file */
+    }
+    else if (!gv->output_sections &&
+             !(fff[gv->dest_format]->flags&FFF_NOFILE)) {
       if ((f = fopen(gv->dest_name,"wb")) == NULL) {
         error(29,gv->dest_name);  /* Can't create output file */
         return;
@@ -3094,7 +3789,18 @@ void linker_write(struct GlobalVars *gv)
     else
       fff[gv->dest_format]->writeexec(gv,f);
 
-    if (f != NULL) {
+    if (mapped) {
+      /* replace the previous output file only when there were no errors */
+      if (gv->outmap != NULL) {
+        if (!unmapoutfile(gv->outmap,gv->outmapsize,
+                          gv->errflag ? NULL : gv->dest_name))
+          error(29,gv->dest_name);  /* Can't create output file */
+        gv->outmap = NULL;
+      }
+      if (!gv->errflag)
+        set_exec(gv->dest_name);
+    }
+    else if (f != NULL) {
       fclose(f);
       if (!gv->dest_sharedobj && !gv->dest_object)
         set_exec(gv->dest_name);  /* set executable flag */
@@ -0,0 +1,495 @@
+/* linkmap.c  link map and map files for vlink */
+/* (c) in 2026 by agent@local */
+
+
+#define LINKMAP_C
+#include "vlink.h"
+
+/* Link map.
+   The map is collected from the linker's own data structures while
+   linking: files and section mapping after merging, the symbols of each
+   section sorted by address while copying, and the relocations left in
+   the output sections after relocating. The text map file (-M) is
+   written while the data is collected, so an aborted link still leaves
+   everything up to that point in it. The JSON map (-mapjson) is written
+   from the collected data at the end. */
+
+struct MapInput {               /* input section */
+  struct Section *sec;
+  unsigned long nrelocs;        /* relocations before relocating */
+  unsigned long nxrefs;         /* external references before relocating */
+};
+
+struct MapSection {             /* output section */
+  struct LinkedSection *ls;
+  struct MapInput *inputs;
+  unsigned long ninputs;
+  struct Symbol **syms;         /* section's symbols, sorted by address */
+  unsigned long nsyms;
+  bool listed;                  /* was not empty when merged */
+};
+
+struct MapObject {              /* object unit and its input sections */
+  struct ObjectUnit *obj;
+  struct MapInput **inputs;
+  unsigned long ninputs;
+};
+
+struct MapFold {                /* section removed by -icf */
+  struct Section *sec;
+  struct Section *keep;
+};
+
+struct LinkMap {
+  struct MapObject *objs;
+  unsigned long nobjs;
+  struct MapSection *secs;
+  unsigned long nsecs;
+  unsigned long cursec;         /* next section for linkmap_symbols() */
+  struct MapFold *folds;
+  unsigned long nfolds;
+  struct Symbol **abssyms;      /* absolute symbols, sorted by address */
+  unsigned long nabssyms;
+  struct Symbol **lnksyms;      /* linker symbols, in definition order */
+  unsigned long nlnksyms;
+  unsigned long maxlnksyms;
+  bool written;
+};
+
+static const char *ls_type[] = { "undefined","code","data","bss","tmp" };
+static const char *json_info[] = {
+  "none","object","function","section","file"
+};
+static const char *json_bind[] = { "none","local","global","weak" };
+
+
+
+static unsigned long list_length(struct list *l)
+{
+  struct node *n;
+  unsigned long cnt = 0;
+
+  for (n=l->first; n->next!=NULL; n=n->next)
+    cnt++;
+  return cnt;
+}
+
+
+static int mapobj_cmp(const void *a,const void *b)
+/* qsort: compare MapObject pointers by their ObjectUnit address */
+{
+  uintptr_t x = (uintptr_t)(*(struct MapObject **)a)->obj;
+  uintptr_t y = (uintptr_t)(*(struct MapObject **)b)->obj;
+
+  return x<y ? -1 : (x>y);
+}
+
+
+static struct MapObject *find_mapobj(struct MapObject **tab,unsigned long n,
+                                     struct ObjectUnit *obj)
+/* binary search in an array sorted by mapobj_cmp() */
+{
+  unsigned long lo=0,hi=n;
+
+  while (lo < hi) {
+    unsigned long mid = (lo + hi) / 2;
+
+    if ((uintptr_t)tab[mid]->obj < (uintptr_t)obj)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo<n && tab[lo]->obj==obj ? tab[lo] : NULL;
+}
+
+
+static void collect_objects(struct LinkMap *map,struct GlobalVars *gv)
+/* assign all input sections to their object units, in output order */
+{
+  struct ObjectUnit *obj;
+  struct MapObject *mo,**tab;
+  unsigned long i,j,n;
+
+  n = list_length(&gv->selobjects);
+  map->objs = alloczero((n ? n : 1) * sizeof(struct MapObject));
+  tab = alloc((n ? n : 1) * sizeof(struct MapObject *));
+  for (i=0,obj=(struct ObjectUnit *)gv->selobjects.first;
+       obj->n.next!=NULL; obj=(struct ObjectUnit *)obj->n.next,i++) {
+    map->objs[i].obj = obj;
+    tab[i] = &map->objs[i];
+  }
+  map->nobjs = n;
+  qsort(tab,n,sizeof(struct MapObject *),mapobj_cmp);
+
+  /* count the sections of each object, then fill the arrays */
+  for (i=0; i<map->nsecs; i++) {
+    for (j=0; j<map->secs[i].ninputs; j++) {
+      if (mo = find_mapobj(tab,n,map->secs[i].inputs[j].sec->obj))
+        mo->ninputs++;
+    }
+  }
+  for (i=0; i<n; i++) {
+    mo = &map->objs[i];
+    if (mo->ninputs)
+      mo->inputs = alloc(mo->ninputs * sizeof(struct MapInput *));
+    mo->ninputs = 0;
+  }
+  for (i=0; i<map->nsecs; i++) {
+    for (j=0; j<map->secs[i].ninputs; j++) {
+      struct MapInput *mi = &map->secs[i].inputs[j];
+
+      if (mo = find_mapobj(tab,n,mi->sec->obj))
+        mo->inputs[mo->ninputs++] = mi;
+    }
+  }
+  free(tab);
+}
+
+
+static void write_textmap(struct GlobalVars *gv,struct LinkMap *map,FILE *f)
+/* files, section mapping and folded sections */
+{
+  struct Section *sec;
+  struct LinkedSection *ls;
+  unsigned long i,j;
+
+  /* file names and the new addresses of their sections */
+  fprintf(f,"\nFiles:\n");
+
+  for (i=0; i<map->nobjs; i++) {
+    struct MapObject *mo = &map->objs[i];
+    struct LinkFile *lfile = mo->obj->lnkfile;
+    char sep = ' ';
+
+    if (!(mo->obj->flags & OUF_SCRIPT)) {
+      if (lfile->type == ID_LIBARCH)
+        fprintf(f,"  %s (%s):",lfile->pathname,mo->obj->objname);
+      else
+        fprintf(f,"  %s:",mo->obj->objname);
+
+      if (lfile->type != ID_SHAREDOBJ) {
+        for (j=0; j<mo->ninputs; j++) {
+          sec = mo->inputs[j]->sec;
+          if (!is_common_sec(gv,sec)) {
+            fprintf(f,"%c %s %llx(%lx)",sep,sec->name,
+                    (unsigned long long)sec->va,sec->size);
+            sep = ',';
+          }
+        }
+      }
+
+      if (sep == ',')  /* any sections listed? */
+        fprintf(f," hex\n");
+      else
+        fprintf(f,"  symbols only\n"); /* empty or shared obj. */
+    }
+  }
+
+  /* section mappings */
+  fprintf(f,"\n\nSection mapping (numbers in hex):\n");
+
+  for (i=0; i<map->nsecs; i++) {
+    struct MapSection *ms = &map->secs[i];
+
+    if (ms->listed) {
+      ls = ms->ls;
+      fprintf(f,"------------------------------\n"
+              "  %08llx %s  (size %lx",  /* @@@ FIXME */
+              (unsigned long long)ls->copybase,ls->name,ls->size);
+      if (ls->filesize < ls->size)
+        fprintf(f,", allocated %lx",ls->filesize);
+      fprintf(f,")\n");
+
+      for (j=0; j<ms->ninputs; j++) {
+        sec = ms->inputs[j].sec;
+        if (!is_ld_script(sec->obj)) {
+          fprintf(f,"           %08llx - %08llx %s(%s)\n",
+                  (unsigned long long)sec->va,
+                  (unsigned long long)sec->va+sec->size,
+                  sec->obj->objname,sec->name);
+        }
+      }
+    }
+  }
+
+  if (map->nfolds) {
+    /* sections removed by identical section folding */
+    unsigned long saved = 0;
+
+    fprintf(f,"\n\nFolded identical sections (numbers in hex):\n");
+    for (i=0; i<map->nfolds; i++) {
+      struct Section *keep = map->folds[i].keep;
+
+      sec = map->folds[i].sec;
+      fprintf(f,"  %s(%s) -> %08llx %s(%s)  (size %lx)\n",
+              sec->obj->objname,sec->name,(unsigned long long)keep->va,
+              keep->obj->objname,keep->name,sec->size);
+      saved += sec->size;
+    }
+    fprintf(f,"  %lu sections folded, %lx bytes saved\n",map->nfolds,saved);
+  }
+
+  fprintf(f,"\n");
+}
+
+
+void linker_mapfile(struct GlobalVars *gv)
+/* collect files and section mapping, when a map is desired */
+{
+  struct LinkMap *map;
+  struct LinkedSection *ls;
+  struct Section *sec;
+  unsigned long i,j,n;
+
+  if (gv->map_file==NULL && gv->jsonmap_file==NULL)
+    return;
+  gv->linkmap = map = alloczero(sizeof(struct LinkMap));
+
+  n = list_length(&gv->lnksec);
+  map->secs = alloczero((n ? n : 1) * sizeof(struct MapSection));
+  map->nsecs = n;
+  for (i=0,ls=(struct LinkedSection *)gv->lnksec.first;
+       ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next,i++) {
+    struct MapSection *ms = &map->secs[i];
+
+    ms->ls = ls;
+    ms->listed = !(ls->size==0 && listempty(&ls->relocs) &&
+                   listempty(&ls->symbols) &&
+                   !(ls->ld_flags & LSF_PRESERVE));
+    for (n=0,sec=(struct Section *)ls->sections.first;
+         sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
+      if (sec->obj != NULL)
+        n++;
+    }
+    if (n)
+      ms->inputs = alloc(n * sizeof(struct MapInput));
+    for (j=0,sec=(struct Section *)ls->sections.first;
+         sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
+      if (sec->obj != NULL) {
+        ms->inputs[j].sec = sec;
+        ms->inputs[j].nrelocs = list_length(&sec->relocs);
+        ms->inputs[j].nxrefs = list_length(&sec->xrefs);
+        j++;
+      }
+    }
+    ms->ninputs = j;
+  }
+
+  collect_objects(map,gv);
+
+  if (n = list_length(&gv->foldedsecs)) {
+    map->folds = alloc(n * sizeof(struct MapFold));
+    for (sec=(struct Section *)gv->foldedsecs.first;
+         sec->n.next!=NULL; sec=(struct Section *)sec->n.next) {
+      map->folds[map->nfolds].sec = sec;
+      map->folds[map->nfolds++].keep = fold_target(sec);
+    }
+  }
+
+  if (gv->map_file) {
+    write_textmap(gv,map,gv->map_file);
+    fflush(gv->map_file);
+  }
+}
+
+
+void linkmap_symbols(struct GlobalVars *gv,struct LinkedSection *ls,
+                     struct Symbol **syms,unsigned long cnt)
+/* print and take over the address-sorted symbol array of a section */
+{
+  struct LinkMap *map = gv->linkmap;
+  unsigned long i;
+
+  if (gv->map_file) {
+    fprintf(gv->map_file,"\nSymbols of %s:\n",ls->name);
+    for (i=0; i<cnt; i++)
+      print_symbol(gv,gv->map_file,syms[i]);
+  }
+  if (gv->jsonmap_file == NULL) {
+    free(syms);
+    return;
+  }
+
+  for (i=0; i<map->nsecs; i++) {
+    unsigned long idx = (map->cursec + i) % map->nsecs;
+
+    if (map->secs[idx].ls == ls) {
+      free(map->secs[idx].syms);
+      map->secs[idx].syms = syms;
+      map->secs[idx].nsyms = cnt;
+      map->cursec = idx + 1;
+      return;
+    }
+  }
+  free(syms);  /* section was created after merging */
+}
+
+
+void linkmap_abssymbols(struct GlobalVars *gv,struct Symbol **syms,
+                        unsigned long cnt)
+/* print and take over the address-sorted array of absolute symbols,
+   which are followed by the linker symbols */
+{
+  struct LinkMap *map = gv->linkmap;
+  unsigned long i;
+
+  if (gv->map_file) {
+    if (cnt) {
+      fprintf(gv->map_file,"\nAbsolute symbols:\n");
+      for (i=0; i<cnt; i++)
+        print_symbol(gv,gv->map_file,syms[i]);
+    }
+    fprintf(gv->map_file,"\nLinker symbols:\n");
+  }
+  free(map->abssyms);
+  map->abssyms = syms;
+  map->nabssyms = cnt;
+}
+
+
+void linkmap_lnksymbol(struct GlobalVars *gv,struct Symbol *sym)
+/* print and add a linker-defined symbol */
+{
+  struct LinkMap *map = gv->linkmap;
+
+  if (gv->map_file)
+    print_symbol(gv,gv->map_file,sym);
+  if (gv->jsonmap_file == NULL)
+    return;
+
+  if (map->nlnksyms >= map->maxlnksyms) {
+    map->maxlnksyms = map->maxlnksyms ? map->maxlnksyms*2 : 16;
+    map->lnksyms = re_alloc(map->lnksyms,
+                            map->maxlnksyms * sizeof(struct Symbol *));
+  }
+  map->lnksyms[map->nlnksyms++] = sym;
+}
+
+
+static void json_string(FILE *f,const char *s)
+{
+  if (s == NULL) {
+    fprintf(f,"null");
+    return;
+  }
+  fputc('"',f);
+  for (; *s; s++) {
+    if (*s=='"' || *s=='\\')
+      fprintf(f,"\\%c",*s);
+    else if ((unsigned char)*s < 0x20)
+      fprintf(f,"\\u%04x",(unsigned)(unsigned char)*s);
+    else
+      fputc(*s,f);
+  }
+  fputc('"',f);
+}
+
+
+static const char *json_objname(struct ObjectUnit *obj)
+{
+  if (obj==NULL || obj->lnkfile==NULL || is_ld_script(obj))
+    return NULL;
+  return getobjname(obj);
+}
+
+
+static void json_symbols(FILE *f,const char *key,struct Symbol **syms,
+                         unsigned long cnt)
+{
+  unsigned long i;
+
+  fprintf(f,",\"%s\":[",key);
+  for (i=0; i<cnt; i++) {
+    struct Symbol *sym = syms[i];
+
+    fprintf(f,"%s{\"name\":",i?",":"");
+    json_string(f,sym->name);
+    fprintf(f,",\"value\":%llu,\"size\":%lu,\"type\":\"%s\",\"info\":\"%s\","
+            "\"bind\":\"%s\",\"object\":",
+            (unsigned long long)sym->value,(unsigned long)sym->size,
+            sym_type[sym->type],json_info[sym->info],json_bind[sym->bind]);
+    json_string(f,json_objname(sym->relsect?sym->relsect->obj:NULL));
+    fputc('}',f);
+  }
+  fputc(']',f);
+}
+
+
+static void write_jsonmap(struct GlobalVars *gv,struct LinkMap *map,FILE *f)
+{
+  unsigned long i,j,n;
+
+  fprintf(f,"{\"output\":");
+  json_string(f,gv->dest_name);
+  fprintf(f,",\"format\":");
+  json_string(f,fff[gv->dest_format]->tname);
+  fprintf(f,",\"sections\":[");
+
+  for (i=0; i<map->nsecs; i++) {
+    struct MapSection *ms = &map->secs[i];
+    struct LinkedSection *ls = ms->ls;
+
+    fprintf(f,"%s\n{\"name\":",i?",":"");
+    json_string(f,ls->name);
+    fprintf(f,",\"type\":\"%s\",\"address\":%llu,\"loadaddress\":%llu,"
+            "\"size\":%lu,\"filesize\":%lu,\"listed\":%s,"
+            "\"relocs\":%lu,\"xrefs\":%lu,\"inputs\":[",
+            ls->type<=ST_TMP?ls_type[ls->type]:"unknown",
+            (unsigned long long)ls->base,(unsigned long long)ls->copybase,
+            ls->size,ls->filesize,ms->listed?"true":"false",
+            list_length(&ls->relocs),list_length(&ls->xrefs));
+    for (n=0,j=0; j<ms->ninputs; j++) {
+      struct MapInput *mi = &ms->inputs[j];
+
+      if (is_ld_script(mi->sec->obj))
+        continue;
+      fprintf(f,"%s{\"object\":",n++?",":"");
+      json_string(f,json_objname(mi->sec->obj));
+      fprintf(f,",\"section\":");
+      json_string(f,mi->sec->name);
+      fprintf(f,",\"address\":%llu,\"size\":%lu,\"relocs\":%lu,"
+              "\"xrefs\":%lu}",
+              (unsigned long long)mi->sec->va,mi->sec->size,
+              mi->nrelocs,mi->nxrefs);
+    }
+    fputc(']',f);
+    json_symbols(f,"symbols",ms->syms,ms->nsyms);
+    fputc('}',f);
+  }
+  fprintf(f,"]\n");
+
+  json_symbols(f,"absolute_symbols",map->abssyms,map->nabssyms);
+  fputc('\n',f);
+  json_symbols(f,"linker_symbols",map->lnksyms,map->nlnksyms);
+  fputc('\n',f);
+
+  fprintf(f,",\"folded\":[");
+  for (i=0; i<map->nfolds; i++) {
+    struct MapFold *mf = &map->folds[i];
+
+    fprintf(f,"%s{\"object\":",i?",":"");
+    json_string(f,json_objname(mf->sec->obj));
+    fprintf(f,",\"section\":");
+    json_string(f,mf->sec->name);
+    fprintf(f,",\"size\":%lu,\"into\":{\"object\":",mf->sec->size);
+    json_string(f,json_objname(mf->keep->obj));
+    fprintf(f,",\"section\":");
+    json_string(f,mf->keep->name);
+    fprintf(f,",\"address\":%llu}}",(unsigned long long)mf->keep->va);
+  }
+  fprintf(f,"]}\n");
+}
+
+
+void linker_writemap(struct GlobalVars *gv)
+/* write the JSON map from the collected data */
+{
+  struct LinkMap *map = gv->linkmap;
+
+  if (map==NULL || map->written)
+    return;
+  map->written = TRUE;
+
+  if (gv->jsonmap_file)
+    write_jsonmap(gv,map,gv->jsonmap_file);
+}
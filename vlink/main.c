@@ -188,6 +188,13 @@ static unsigned parse_symfile_format(struct GlobalVars *gv,const char *fmt)
 
 void cleanup(struct GlobalVars *gv)
 {
+  linker_writemap(gv);  /* when not yet done, write what was collected */
+  if (gv->outmap != NULL) {
+    /* remove an incomplete output file, which was mapped for writing,
+       the previous output file remains */
+    unmapoutfile(gv->outmap,gv->outmapsize,NULL);
+    gv->outmap = NULL;
+  }
   if (gv->fail_on_warning && gv->warncnt)
     error(152);  /* warnings treated as errors */
   exit(gv->returncode);
@@ -239,6 +246,7 @@ int main(int argc,const char *argv[])
   initlist(&gv->lnksec);
   gv->dest_name = "a.out";
   gv->maxerrors = DEF_MAXERRORS;
+  gv->jobs = 1;
   gv->reloctab_format = RTAB_UNDEF;
   gv->osec_base_name = NULL;
 
@@ -377,9 +385,24 @@ int main(int argc,const char *argv[])
         case 'i':
           if (!strcmp(&argv[i][2],"nterp"))
             gv->interp_path = get_arg(argc,argv,&i);
+          else if (!strcmp(&argv[i][2],"ncremental"))
+            gv->incremental = TRUE;
+          else if (!strcmp(&argv[i][2],"cf"))
+            gv->icf = ICF_SAFE;
+          else if (!strcmp(&argv[i][2],"cf-all"))
+            gv->icf = ICF_ALL;
           else goto unknown;
           break;
 
+        case 'j':
+          if (buf = get_option_arg(argc,argv,&i)) {
+            long n;  /* number of threads for loading objects */
+
+            if (sscanf(buf,"%li",&n)==1 && n>0)
+              gv->jobs = (int)n;
+          }
+          break;
+
         case 'k':
           if (argv[i][2]) goto unknown;
           gv->keep_sect_order = TRUE;
@@ -425,6 +448,14 @@ int main(int argc,const char *argv[])
             gv->merge_all = TRUE;
           else if (!strcmp(&argv[i][2],"ultibase"))
             gv->multibase = TRUE;
+          else if (!strcmp(&argv[i][2],"map-output"))
+            gv->mmap_output = TRUE;
+          else if (!strcmp(&argv[i][2],"apjson") &&
+                   (buf = get_arg(argc,argv,&i)) != NULL) {
+            /* -mapjson <filename> */
+            if ((gv->jsonmap_file = fopen(buf,"w")) == NULL)
+              error(29,buf);
+          }
           else goto unknown;
           break;
 
@@ -770,18 +801,26 @@ int main(int argc,const char *argv[])
 
   /* link them... */
   linker_init(gv);
+  if (gv->incremental && incr_relink(gv,argc,argv))
+    cleanup(gv);       /* output was patched in place or is up to date */
   linker_load(gv);     /* load all objects and libraries and their symbols */
   linker_resolve(gv);  /* resolve symbol references */
   linker_relrefs(gv);  /* find all relative references between sections */
   linker_dynprep(gv);  /* prepare for dynamic linking */
   linker_sectrefs(gv); /* find all referenced sections from the start */
   linker_gcsects(gv);  /* section garbage collection (gc_sects) */
+  linker_foldsects(gv);/* identical section folding (icf) */
   linker_merge(gv);    /* merge sections by linker script or by name/type */
-  linker_mapfile(gv);  /* mapfile output */
+  linker_mapfile(gv);  /* collect section mapping for the map files */
   linker_copy(gv);     /* copy section contents and fix symbol offsets */
   linker_delunused(gv);/* delete empty/unused sects. without relocs/symbols */
   linker_relocate(gv); /* relocate addresses in merged output sections */
+  linker_writemap(gv); /* write map file and JSON map */
+  if (gv->incremental)
+    incr_collect(gv,argc,argv);
   linker_write(gv);    /* write output file in selected target format */
+  if (gv->incremental)
+    incr_savestate(gv);/* save link state for the next incremental link */
   linker_cleanup(gv);
 
   cleanup(gv);
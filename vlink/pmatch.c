@@ -152,3 +152,20 @@ bool patternlist_match(char **patlist,const char *str)
   }
   return (FALSE);
 }
+
+
+int pattern_type(const char *pat,size_t *prefixlen)
+/* Classify a pattern for faster matching. PAT_LITERAL contains no
+   special characters for any host, PAT_PREFIX is a literal followed by
+   a single '*', everything else is a PAT_GLOB. */
+{
+  static const char special[] = "*?[]\\#()|~%'";
+  size_t n = strcspn(pat,special);
+
+  *prefixlen = n;
+  if (pat[n] == '\0')
+    return PAT_LITERAL;
+  if (pat[n]=='*' && pat[n+1]=='\0')
+    return PAT_PREFIX;
+  return PAT_GLOB;
+}
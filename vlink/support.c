@@ -6,9 +6,27 @@
  */
 
 
+#if !defined(AMIGAOS) && !defined(ATARI) && !defined(_WIN32)
+#if defined(__linux__) && !defined(HAVE_POSIX_FALLOCATE)
+#define HAVE_POSIX_FALLOCATE  /* glibc, musl */
+#endif
+#ifdef HAVE_POSIX_FALLOCATE
+#define _POSIX_C_SOURCE 200112L  /* posix_fallocate() with -std=c99 */
+#endif
+#endif
+
 #define SUPPORT_C
 #include "vlink.h"
 
+#if !defined(AMIGAOS) && !defined(ATARI) && !defined(_WIN32)
+#define MMAP_INPUT  /* UNIX */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #define GAPBUFSIZE 1024  /* for fwritegap() */
 
 const char *endian_name[2] = { "little", "big" };
@@ -143,6 +161,22 @@ struct node *remhead(struct list *l)
 }
 
 
+void appendlist(struct list *dst,struct list *src)
+/* move all nodes of src to the end of dst, src is empty afterwards */
+{
+  struct node *fn = src->first;
+  struct node *ln = dst->last;
+
+  if (fn->next) {
+    src->last->next = ln->next;
+    fn->pred = ln;
+    ln->next = fn;
+    dst->last = src->last;
+    initlist(src);
+  }
+}
+
+
 struct node *remnode(struct node *n)
 /* remove a node from a list */
 {
@@ -179,6 +213,52 @@ static size_t filesize(FILE *fp,const char *name)
 }
 
 
+#ifdef MMAP_INPUT
+static char *mmapfile(const char *name)
+/* Map a regular file with mmap(), preceded by one page to store the
+   file size, and followed by a 0-byte. Both are written to private
+   copies of the file's first page. Returns NULL when not possible. */
+{
+  size_t psize,fsiz,rsiz;
+  struct stat st;
+  char *base,*p;
+  int fd;
+
+  if ((fd = open(name,O_RDONLY)) < 0)
+    return NULL;
+  if (fstat(fd,&st)<0 || !S_ISREG(st.st_mode) || st.st_size==0 ||
+      (off_t)(size_t)st.st_size != st.st_size) {
+    close(fd);
+    return NULL;
+  }
+  psize = (size_t)sysconf(_SC_PAGESIZE);
+  fsiz = (size_t)st.st_size;
+  rsiz = (fsiz + psize) & ~(psize - 1);  /* room for the 0-byte */
+
+  base = mmap(NULL,psize+rsiz,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return NULL;
+  }
+  p = base + psize;
+  if (mmap(p,fsiz,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_FIXED,fd,0)
+      == MAP_FAILED ||
+      ((fsiz & (psize-1))==0 &&
+       mmap(p+fsiz,psize,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_FIXED,fd,0)
+       == MAP_FAILED)) {
+    munmap(base,psize+rsiz);
+    close(fd);
+    return NULL;
+  }
+  close(fd);
+
+  *(size_t *)(p - sizeof(size_t)) = fsiz;
+  *(p+fsiz) = 0;
+  return p;
+}
+#endif
+
+
 char *mapfile(const char *name)
 /* Map a complete file into memory and return its address. */
 /* The file's length is returned in *(p-sizeof(size_t)). */
@@ -189,6 +269,10 @@ char *mapfile(const char *name)
   char *p=NULL;
   size_t fsiz;
 
+#ifdef MMAP_INPUT
+  if (p = mmapfile(name))
+    return p;
+#endif
   if (fp = fopen(name,"rb")) {
     fsiz = filesize(fp,name);
     p = alloc(fsiz+sizeof(size_t)+1);
@@ -205,6 +289,67 @@ char *mapfile(const char *name)
 }
 
 
+#ifdef MMAP_INPUT
+static char *outmaptmp;  /* temporary file name of the mapped output file */
+#endif
+
+
+uint8_t *mapoutfile(const char *name,size_t size)
+/* Create a temporary file of the given size beside the output file and */
+/* map it for writing. Returns NULL when not possible, so the file has */
+/* to be written with stdio instead. Requires posix_fallocate(), because */
+/* writing to a sparse file on a full disk would raise SIGBUS. */
+{
+#if defined(MMAP_INPUT) && defined(HAVE_POSIX_FALLOCATE)
+  void *p;
+  int fd;
+
+  if (size==0 || (off_t)size<0)
+    return NULL;
+  outmaptmp = alloc(strlen(name)+24);
+  sprintf(outmaptmp,"%s.%ld.tmp",name,(long)getpid());
+  if ((fd = open(outmaptmp,O_RDWR|O_CREAT|O_EXCL,0666)) < 0) {
+    free(outmaptmp);
+    outmaptmp = NULL;
+    return NULL;
+  }
+  /* allocate all blocks now, so a full disk can't raise SIGBUS later */
+  if (posix_fallocate(fd,0,(off_t)size) == 0) {
+    p = mmap(NULL,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+    close(fd);
+    if (p != MAP_FAILED)
+      return (uint8_t *)p;
+  }
+  else
+    close(fd);
+  remove(outmaptmp);
+  free(outmaptmp);
+  outmaptmp = NULL;
+#endif
+  return NULL;
+}
+
+
+bool unmapoutfile(uint8_t *p,size_t size,const char *name)
+/* Release a file mapped by mapoutfile(). Its contents replace the output */
+/* file name, or it is removed when name is NULL. Returns FALSE when the */
+/* output file couldn't be replaced. */
+{
+  bool ok = TRUE;
+
+#ifdef MMAP_INPUT
+  munmap(p,size);
+  if (name==NULL || rename(outmaptmp,name)!=0) {
+    remove(outmaptmp);
+    ok = name==NULL;
+  }
+  free(outmaptmp);
+  outmaptmp = NULL;
+#endif
+  return ok;
+}
+
+
 const char *base_name(const char *s)
 /* returns last part of a path - the file name itself */
 {
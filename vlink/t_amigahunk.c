@@ -54,6 +54,7 @@ struct FFFuncs fff_amigahunk = {
   ehf_findsymbol,
   ados_lnksym,
   ados_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   ados_writeobject,
   writeshared,
@@ -84,6 +85,7 @@ struct FFFuncs fff_ehf = {
   ehf_findsymbol,
   ehf_lnksym,
   ehf_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   ehf_writeobject,
   writeshared,
@@ -1456,6 +1458,7 @@ static void ados_setlnksym(struct GlobalVars *gv,struct Symbol *xdef)
 static struct Symbol *ehf_findsymbol(struct GlobalVars *gv,struct Section *sec,
                                      const char *name,uint32_t mask)
 {
+  struct GlobSym *gs;
   struct Symbol *sym,*found;
   uint32_t minmask = ~0;
   uint16_t ofl;
@@ -1465,57 +1468,55 @@ static struct Symbol *ehf_findsymbol(struct GlobalVars *gv,struct Section *sec,
   else
     ofl = ~0;
 
-  for (sym=gv->symbols[elf_hash(name)%SYMHTABSIZE],found=NULL; sym!=NULL;
-       sym=sym->glob_chain) {
-    if (!strcmp(name,sym->name)) {
-      if (mask) {
-        /* find a symbol with the best-matching (minimal) feature-mask */
-        uint32_t fmask;
-
-        if (fmask = sym->fmask) {
-          if ((mask & fmask) != mask)
-            continue;
-          if (fmask <= minmask)
-            minmask = 0/*fmask*/;
-          else
-            continue;
-        }
-        else if (minmask != ~0)
+  gs = find_globsym(gv,name,elf_hash(name));
+  for (sym=gs?gs->chain:NULL,found=NULL; sym!=NULL; sym=sym->glob_chain) {
+    if (mask) {
+      /* find a symbol with the best-matching (minimal) feature-mask */
+      uint32_t fmask;
+
+      if (fmask = sym->fmask) {
+        if ((mask & fmask) != mask)
+          continue;
+        if (fmask <= minmask)
+          minmask = 0/*fmask*/;
+        else
           continue;
       }
-      else if (sym->fmask)
+      else if (minmask != ~0)
         continue;
+    }
+    else if (sym->fmask)
+      continue;
 
-      if (sec && sym->relsect && sym->relsect->obj==sec->obj) {
-        /* a symbol from the referers object unit is always the best match */
-        found = sym;
-        break;
-      }
-
-      if (found) {
-        if (sym->relsect) {
-          if (sec) {
-            /* we prefer symbols from an object which has the same CPU-flags
-               as the referer's object */
-            if (sym->type==SYM_RELOC && found->relsect &&
-                (found->relsect->obj->flags & OUF_EHFPPC) != ofl &&
-                (sym->relsect->obj->flags & OUF_EHFPPC) == ofl)
-              found = sym;
-          }
+    if (sec && sym->relsect && sym->relsect->obj==sec->obj) {
+      /* a symbol from the referers object unit is always the best match */
+      found = sym;
+      break;
+    }
 
-          /* prefer symbols from already linked object units */
-          if ((sym->relsect->obj->flags & OUF_LINKED) &&
-              found->relsect && !(found->relsect->obj->flags & OUF_LINKED))
+    if (found) {
+      if (sym->relsect) {
+        if (sec) {
+          /* we prefer symbols from an object which has the same CPU-flags
+             as the referer's object */
+          if (sym->type==SYM_RELOC && found->relsect &&
+              (found->relsect->obj->flags & OUF_EHFPPC) != ofl &&
+              (sym->relsect->obj->flags & OUF_EHFPPC) == ofl)
             found = sym;
         }
+
+        /* prefer symbols from already linked object units */
+        if ((sym->relsect->obj->flags & OUF_LINKED) &&
+            found->relsect && !(found->relsect->obj->flags & OUF_LINKED))
+          found = sym;
       }
-      else
-        found = sym;
     }
+    else
+      found = sym;
   }
 
   if (found!=NULL && found->type==SYM_INDIR)
-    return ehf_findsymbol(gv,sec,found->indir_name,mask);
+    return findsymbol(gv,sec,found->indir_name,mask);
   return found;
 }
 
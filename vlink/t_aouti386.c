@@ -71,6 +71,7 @@ struct FFFuncs fff_aoutbsdi386 = {
   NULL,
   aout_lnksym,
   aout_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   aoutstd_writeobject,
   aoutstd_writeshared,
@@ -106,6 +107,7 @@ struct FFFuncs fff_aoutpc386 = {
   NULL,
   aout_lnksym,
   aout_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   aoutstd_writeobject,
   aoutstd_writeshared, /* @@@ ? */
@@ -111,6 +111,7 @@ struct FFFuncs fff_aoutbsd68k = {
   NULL,
   aout_lnksym,
   aout_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   aoutstd_writeobject,
   aoutstd_writeshared,
@@ -146,6 +147,7 @@ struct FFFuncs fff_aoutbsd68k4k = {
   NULL,
   aout_lnksym,
   aout_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   aoutstd_writeobject,
   aoutstd_writeshared,
@@ -181,6 +183,7 @@ struct FFFuncs fff_aoutsun010 = {
   NULL,
   aout_lnksym,
   aout_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   aoutstd_writeobject,
   aoutstd_writeshared,
@@ -216,6 +219,7 @@ struct FFFuncs fff_aoutsun020 = {
   NULL,
   aout_lnksym,
   aout_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   aoutstd_writeobject,
   aoutstd_writeshared,
@@ -281,6 +285,7 @@ struct FFFuncs fff_aoutjaguar = {
   NULL,
   aout_lnksym,
   aout_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   aoutstd_writeobject,
   aoutstd_writeshared,
@@ -66,6 +66,7 @@ struct FFFuncs fff_aoutmint = {
   NULL,
   aout_lnksym,
   aout_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   aoutmint_writeobject,
   aoutmint_writeshared,
@@ -67,6 +67,7 @@ struct FFFuncs fff_aoutnull = {
   NULL,
   aout_lnksym,
   aout_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   aoutstd_writeobject,
   aoutstd_writeshared,
@@ -43,6 +43,7 @@ struct FFFuncs fff_appleomf = {
   NULL,
   omf_lnksym,
   omf_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   writeobject,
   writeshared,
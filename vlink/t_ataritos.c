@@ -37,6 +37,7 @@ struct FFFuncs fff_ataritos = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   writeobject,
   writeshared,
@@ -36,6 +36,7 @@ struct FFFuncs fff_elf32armle = {
   NULL,
   elf_lnksym,
   elf_setlnksym,
+  NULL,
   elf32_initdynlink,
   NULL,
   armle_dyncreate,
@@ -49,7 +50,8 @@ struct FFFuncs fff_elf32armle = {
   0,
   RTAB_STANDARD,RTAB_STANDARD|RTAB_ADDEND,
   _LITTLE_ENDIAN_,
-  32,2
+  32,2,
+  FFF_THREADSAFE
 };
 
 
@@ -40,6 +40,7 @@ struct FFFuncs fff_elf32i386 = {
   NULL,
   elf_lnksym,
   elf_setlnksym,
+  NULL,
   elf32_initdynlink,
   i386_dynentry,
   i386_dyncreate,
@@ -53,7 +54,8 @@ struct FFFuncs fff_elf32i386 = {
   0,
   RTAB_STANDARD,RTAB_STANDARD|RTAB_ADDEND,
   _LITTLE_ENDIAN_,
-  32,0
+  32,0,
+  FFF_THREADSAFE
 };
 #endif  /* ELF32_386 */
 
@@ -83,6 +85,7 @@ struct FFFuncs fff_elf32aros = {
   NULL,
   aros_lnksym,
   aros_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   aros_writeobject,
   aros_writeshared,
@@ -94,7 +97,8 @@ struct FFFuncs fff_elf32aros = {
   0,
   RTAB_STANDARD,RTAB_STANDARD|RTAB_ADDEND,
   _LITTLE_ENDIAN_,
-  32,0
+  32,0,
+  FFF_THREADSAFE
 };
 
 
@@ -35,6 +35,7 @@ struct FFFuncs fff_elf32jag = {
   NULL,
   elf_lnksym,
   elf_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   jag_writeobject,
   jag_writeshared,
@@ -46,7 +47,8 @@ struct FFFuncs fff_elf32jag = {
   0,
   RTAB_ADDEND,RTAB_STANDARD|RTAB_ADDEND,
   _BIG_ENDIAN_,
-  32,1
+  32,1,
+  FFF_THREADSAFE
 };
 
 
@@ -17,6 +17,8 @@
 static int m68k_identify(struct GlobalVars *gv,char *,uint8_t *,
                          unsigned long,bool);
 static void m68k_readconv(struct GlobalVars *,struct LinkFile *);
+static bool m68k_isbranch(struct GlobalVars *,struct Section *,
+                          struct Reloc *);
 static struct Symbol *m68k_dynentry(struct GlobalVars *,DynArg,int);
 static void m68k_dyncreate(struct GlobalVars *);
 static void m68k_writeobject(struct GlobalVars *,FILE *);
@@ -38,6 +40,7 @@ struct FFFuncs fff_elf32m68k = {
   NULL,
   elf_lnksym,
   elf_setlnksym,
+  m68k_isbranch,
   elf32_initdynlink,
   m68k_dynentry,
   m68k_dyncreate,
@@ -51,7 +54,8 @@ struct FFFuncs fff_elf32m68k = {
   0,
   RTAB_ADDEND,RTAB_STANDARD|RTAB_ADDEND,
   _BIG_ENDIAN_,
-  32,2
+  32,2,
+  FFF_THREADSAFE
 };
 
 
@@ -139,6 +143,34 @@ static void m68k_readconv(struct GlobalVars *gv,struct LinkFile *lf)
 }
 
 
+static bool m68k_isbranch(struct GlobalVars *gv,struct Section *sec,
+                          struct Reloc *r)
+/* Check whether a pc-relative reloc is the displacement of a branch
+   (Bcc, BSR, DBcc, FBcc, JMP/JSR (d16,PC)), and not of an address
+   calculation, like LEA (d16,PC). An 8-bit displacement is never taken
+   for a branch, because the low byte of a Bcc.B opcode can't be told
+   from that of a brief extension word, as in LEA (d8,PC,D6.W). */
+{
+  unsigned long n;
+  uint8_t *p;
+  unsigned op;
+
+  if (sec->data==NULL || r->insert==NULL || r->insert->bpos!=0)
+    return FALSE;
+  n = r->insert->bsiz / 8;
+  if (n<2 || r->offset<2 || r->offset+n>sec->size)
+    return FALSE;
+  p = sec->data + r->offset;
+  op = (p[-2] << 8) | p[-1];
+  if (n == 2)
+    return (op & 0xf0ff)==0x6000 || (op & 0xf0f8)==0x50c8 ||
+           (op & 0xffc0)==0xf280 || op==0x4eba || op==0x4efa;
+  if (n == 4)
+    return (op & 0xf0ff)==0x60ff || (op & 0xffc0)==0xf2c0;
+  return FALSE;
+}
+
+
 static struct Symbol *m68k_dynentry(struct GlobalVars *gv,DynArg a,int etype)
 {
   ierror("m68k_dynentry(): needs to be written");
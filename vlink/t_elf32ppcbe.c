@@ -41,6 +41,7 @@ struct FFFuncs fff_elf32ppcbe = {
   NULL,
   elf_lnksym,
   elf_setlnksym,
+  NULL,
   elf32_initdynlink,
   ppc32be_dynentry,
   ppc32be_dyncreate,
@@ -54,7 +55,8 @@ struct FFFuncs fff_elf32ppcbe = {
   0,
   RTAB_ADDEND,RTAB_ADDEND,
   _BIG_ENDIAN_,
-  32,2
+  32,2,
+  FFF_THREADSAFE
 };
 #endif
 
@@ -84,6 +86,7 @@ struct FFFuncs fff_elf32powerup = {
   NULL,
   amiga_lnksym,
   amiga_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   amiga_writeobject,
   amiga_writeshared,
@@ -96,7 +99,7 @@ struct FFFuncs fff_elf32powerup = {
   RTAB_ADDEND,RTAB_ADDEND,
   _BIG_ENDIAN_,
   32,2,
-  FFF_RELOCATABLE|FFF_PSEUDO_DYNLINK
+  FFF_RELOCATABLE|FFF_PSEUDO_DYNLINK|FFF_THREADSAFE
 };
 
 struct FFFuncs fff_elf32morphos = {
@@ -114,6 +117,7 @@ struct FFFuncs fff_elf32morphos = {
   NULL,
   amiga_lnksym,
   amiga_setlnksym,
+  NULL,
   NULL,NULL,NULL,
   amiga_writeobject,
   amiga_writeshared,
@@ -126,7 +130,7 @@ struct FFFuncs fff_elf32morphos = {
   RTAB_ADDEND,RTAB_ADDEND,
   _BIG_ENDIAN_,
   32,2,
-  FFF_RELOCATABLE
+  FFF_RELOCATABLE|FFF_THREADSAFE
 };
 
 struct FFFuncs fff_elf32amigaos = {
@@ -144,6 +148,7 @@ struct FFFuncs fff_elf32amigaos = {
   NULL,
   elf_lnksym,
   elf_setlnksym,
+  NULL,
   elf32_initdynlink,
   ppc32be_dynentry,
   ppc32be_dyncreate,
@@ -158,7 +163,7 @@ struct FFFuncs fff_elf32amigaos = {
   RTAB_ADDEND,RTAB_ADDEND,
   _BIG_ENDIAN_,
   32,2,
-  FFF_DYN_RESOLVE_ALL
+  FFF_DYN_RESOLVE_ALL|FFF_THREADSAFE
 };
 
 
@@ -37,6 +37,7 @@ struct FFFuncs fff_elf64x86 = {
   NULL,
   elf_lnksym,
   elf_setlnksym,
+  NULL,
   elf64_initdynlink,
   x86_64_dynentry,
   x86_64_dyncreate,
@@ -50,7 +51,8 @@ struct FFFuncs fff_elf64x86 = {
   0,
   RTAB_ADDEND,RTAB_STANDARD|RTAB_ADDEND,
   _LITTLE_ENDIAN_,
-  64,0
+  64,0,
+  FFF_THREADSAFE
 };
 
 
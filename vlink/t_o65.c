@@ -45,6 +45,7 @@ struct FFFuncs fff_o6502 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   writeobject_02,
   writeshared,
@@ -75,6 +76,7 @@ struct FFFuncs fff_o65816 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   writeobject_816,
   writeshared,
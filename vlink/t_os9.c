@@ -40,6 +40,7 @@ struct FFFuncs fff_os9_6809 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   writeobject,
   writeshared,
@@ -58,6 +58,7 @@ static void rawbin_writeobject(struct GlobalVars *,FILE *);
 static void rawbin_writeshared(struct GlobalVars *,FILE *);
 static void rawbin_out(struct GlobalVars *,FILE *,int);
 #ifdef RAWBIN
+static void rawbin_init(struct GlobalVars *,int);
 static int rawbin_options(struct GlobalVars *,int,const char **,int *);
 static void rawbin_printhelp(void);
 static void rawbin_write(struct GlobalVars *,FILE *);
@@ -162,7 +163,7 @@ struct FFFuncs fff_rawbin = {
   "rawbin",
   defaultscript,
   NULL,
-  NULL,
+  rawbin_init,
   rawbin_options,
   rawbin_printhelp,
   rawbin_headersize,
@@ -173,6 +174,7 @@ struct FFFuncs fff_rawbin = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -222,6 +224,7 @@ struct FFFuncs fff_amsdos = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -254,6 +257,7 @@ struct FFFuncs fff_applebin = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -286,6 +290,7 @@ struct FFFuncs fff_ataricom = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -318,6 +323,7 @@ struct FFFuncs fff_bbc = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -347,6 +353,7 @@ struct FFFuncs fff_bbc2 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -379,6 +386,7 @@ struct FFFuncs fff_cbmprg = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -408,6 +416,7 @@ struct FFFuncs fff_cbmreu = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -440,6 +449,7 @@ struct FFFuncs fff_cocoml = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -472,6 +482,7 @@ struct FFFuncs fff_dragonbin = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -504,6 +515,7 @@ struct FFFuncs fff_pgxc02 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -534,6 +546,7 @@ struct FFFuncs fff_pgx816 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -564,6 +577,7 @@ struct FFFuncs fff_pgz24 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -593,6 +607,7 @@ struct FFFuncs fff_pgz32 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -643,6 +658,7 @@ struct FFFuncs fff_jagsrv = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -675,6 +691,7 @@ struct FFFuncs fff_oricmc = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -707,6 +724,7 @@ struct FFFuncs fff_sincql = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -738,6 +756,7 @@ struct FFFuncs fff_srec19 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -771,6 +790,7 @@ struct FFFuncs fff_srec28 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -804,6 +824,7 @@ struct FFFuncs fff_srec37 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -837,6 +858,7 @@ struct FFFuncs fff_ihex = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -870,6 +892,7 @@ struct FFFuncs fff_shex1 = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawbin_writeobject,
   rawbin_writeshared,
@@ -911,6 +934,136 @@ static void rawbin_printhelp(void)
   printf("-coalesced        output all memory segments without gaps\n"
          "-multifile        start a new file for a gap between memory segments\n");
 }
+
+
+static struct LinkedSection **rawbin_sortsections(struct GlobalVars *gv,
+                                                   int *cnt)
+/* return an array of all sections, in the order of load_next_section() */
+{
+  struct LinkedSection *ls,**lsa,*tmp;
+  int i,j,n;
+
+  for (n=0,ls=(struct LinkedSection *)gv->lnksec.first;
+       ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next)
+    n++;
+  lsa = alloc((n ? n : 1) * sizeof(struct LinkedSection *));
+  for (i=0,ls=(struct LinkedSection *)gv->lnksec.first;
+       ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next)
+    lsa[i++] = ls;
+
+  /* lowest LMA first, keep list order for identical LMAs */
+  for (i=1; i<n; i++) {
+    tmp = lsa[i];
+    for (j=i; j>0 && lsa[j-1]->copybase>tmp->copybase; j--)
+      lsa[j] = lsa[j-1];
+    lsa[j] = tmp;
+  }
+  *cnt = n;
+  return lsa;
+}
+
+
+static size_t rawbin_layout(struct GlobalVars *gv,struct LinkedSection **lsa,
+                            int cnt,uint8_t *map,bool skipempty)
+/* Determine the file offsets of all sections, in the same way as
+   rawbin_out() would write them without a header. Returns the size of
+   the output file, or 0 when rawbin_out() has to decide. With skipempty,
+   empty sections are ignored, as linker_delunused() will most likely
+   delete them. When map is given, it will receive the section contents
+   and the gaps are filled. */
+{
+  struct LinkedSection *ls;
+  bool firstsec = TRUE;
+  lword addr = 0;
+  size_t pos = 0;
+  int i;
+
+  for (i=0; i<cnt; i++) {
+    ls = lsa[i];
+    if ((ls->ld_flags & LSF_NOLOAD) || (skipempty && ls->size==0))
+      continue;
+
+    if (firstsec)
+      firstsec = FALSE;
+    else if (ls->copybase > addr) {
+      if (multifile && ls->copybase-addr>=MAXGAP)
+        return 0;  /* would start a new file */
+      if (!coalesced) {
+        if (map)
+          memset(map+pos,(uint8_t)fillval,ls->copybase-addr);
+        pos += ls->copybase - addr;
+      }
+    }
+    else if (ls->copybase < addr)
+      return 0;  /* overlapping sections, rawbin_out() reports it */
+
+    addr = ls->copybase;
+    if (ls->flags & SF_ALLOC) {
+      if (map && ls->size) {
+        ls->data = map + pos;
+        ls->filepos = (long)pos;
+      }
+      pos += ls->size;
+      addr += ls->size;
+    }
+  }
+  return pos;
+}
+
+
+static void rawbin_mapsections(struct GlobalVars *gv)
+/* Create a pre-sized output file and map it into memory, so linker_copy()
+   copies the section contents directly into their place in the file and
+   relocations are resolved in place. Without a predictable layout the
+   file is written by rawbin_out(), as usual. */
+{
+  struct LinkedSection **lsa;
+  size_t size;
+  int cnt;
+
+  if (gv->errflag || gv->discardOutput || gv->dest_object ||
+      gv->dest_sharedobj || gv->output_sections || gv->keep_relocs ||
+      gv->bits_per_tbyte!=8)
+    return;
+
+  lsa = rawbin_sortsections(gv,&cnt);
+  if (size = rawbin_layout(gv,lsa,cnt,NULL,TRUE)) {
+    if (gv->outmap = mapoutfile(gv->dest_name,size)) {
+      gv->outmapsize = size;
+      rawbin_layout(gv,lsa,cnt,gv->outmap,TRUE);
+      if (gv->trace_file)
+        fprintf(gv->trace_file,"Mapped output file %s (%lu bytes).\n",
+                gv->dest_name,(unsigned long)size);
+    }
+  }
+  free(lsa);
+}
+
+
+static void rawbin_unmapsections(struct GlobalVars *gv)
+/* move section contents from the mapped output file back into memory */
+{
+  struct LinkedSection *ls;
+  uint8_t *p;
+
+  for (ls=(struct LinkedSection *)gv->lnksec.first;
+       ls->n.next!=NULL; ls=(struct LinkedSection *)ls->n.next) {
+    if (ls->data>=gv->outmap && ls->data<gv->outmap+gv->outmapsize) {
+      p = alloc(ls->size);
+      memcpy(p,ls->data,ls->size);
+      ls->data = p;
+    }
+  }
+  unmapoutfile(gv->outmap,gv->outmapsize,NULL);
+  gv->outmap = NULL;
+}
+
+
+static void rawbin_init(struct GlobalVars *gv,int mode)
+{
+  if (mode==FFINI_COPY && gv->mmap_output)
+    rawbin_mapsections(gv);
+}
 #endif
 
 #ifdef ORICMC
@@ -1527,7 +1680,8 @@ static void rawbin_out(struct GlobalVars *gv,FILE *f,int header)
       /* resolve all (remaining) relocations */
       calc_relocs(gv,ls);
 
-      /* write section contents */
+      /* write section contents, remember their position in the file */
+      ls->filepos = f==firstfile ? ftell(f) : -1;
       fwritefullsect(gv,f,ls);
       addr += ls->size;
     }
@@ -1593,7 +1747,43 @@ static void rawbin_write(struct GlobalVars *gv,FILE *f)
    multiple files, coalesced to the previous segment or written with a gap
    filled by zero-bytes */
 {
-  rawbin_out(gv,f,HDR_NONE);
+  struct LinkedSection *ls,**lsa;
+  bool firstsec = TRUE;
+  size_t size;
+  int cnt;
+
+  if (gv->outmap == NULL) {
+    rawbin_out(gv,f,HDR_NONE);
+    return;
+  }
+
+  /* check whether the remaining sections still fit the mapped layout */
+  lsa = rawbin_sortsections(gv,&cnt);
+  size = rawbin_layout(gv,lsa,cnt,NULL,FALSE);
+  free(lsa);
+  if (size != gv->outmapsize) {
+    rawbin_unmapsections(gv);
+    if ((f = fopen(gv->dest_name,"wb")) == NULL) {
+      error(29,gv->dest_name);
+      return;
+    }
+    rawbin_out(gv,f,HDR_NONE);
+    fclose(f);
+    return;
+  }
+
+  /* contents are already in the mapped file, only resolve relocations */
+  execaddr = entry_address(gv);
+  while (ls = load_next_section(gv)) {
+    if (ls->ld_flags & LSF_NOLOAD)
+      continue;
+    if (firstsec) {
+      trace_baseaddr(gv,ls);
+      firstsec = FALSE;
+    }
+    if (ls->flags & SF_ALLOC)
+      calc_relocs(gv,ls);
+  }
 }
 #endif
 
@@ -58,6 +58,7 @@ struct FFFuncs fff_rawseg = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   rawseg_writeobject,
   rawseg_writeshared,
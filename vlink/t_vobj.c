@@ -97,6 +97,7 @@ struct FFFuncs fff_vobj_le = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   vobj_writeobject,
   vobj_writeshared,
@@ -110,7 +111,7 @@ struct FFFuncs fff_vobj_le = {
   _LITTLE_ENDIAN_,
   0,  /* defined by VOBJ bytespertaddr*bitsperbyte */
   0,  /* ptr alignment is unknown */
-  FFF_OUTWORDADDR
+  FFF_OUTWORDADDR|FFF_THREADSAFE
 };
 
 struct FFFuncs fff_vobj_be = {
@@ -128,6 +129,7 @@ struct FFFuncs fff_vobj_be = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   vobj_writeobject,
   vobj_writeshared,
@@ -141,12 +143,12 @@ struct FFFuncs fff_vobj_be = {
   _BIG_ENDIAN_,
   0,  /* defined by VOBJ bytespertaddr*bitsperbyte */
   0,  /* ptr alignment is unknown */
-  FFF_OUTWORDADDR
+  FFF_OUTWORDADDR|FFF_THREADSAFE
 };
 
 
-static uint8_t *p;
-static int bitspertaddr;
+static THREADLOCAL uint8_t *p;
+static THREADLOCAL int bitspertaddr;
 static const char *vobjcpu;
 static int vobjcpuid,vobjver;
 
@@ -592,6 +594,38 @@ static void vobj_read(struct GlobalVars *gv,struct LinkFile *lf,uint8_t *data)
 }
 
 
+bool vobj_arsyms(struct GlobalVars *gv,struct ArMember *m)
+/* add the global symbol definitions of a VOBJ archive member to the
+   lazy archive index, returns FALSE when it is no VOBJ */
+{
+  struct vobj_symbol vs;
+  int nsyms;
+
+  p = m->data;
+  if (m->size<=8 || p[0]!=0x56 || p[1]!=0x4f || p[2]!=0x42 || p[3]!=0x4a ||
+      (p[4]&3)==0 || (p[4]&3)==3 || (p[4]>>2)+1>VOBJ_MAX_VERSION)
+    return FALSE;
+  p += 5;
+  bitspertaddr = gv->bits_per_taddr;
+
+  /* skip bits per byte, bytes per address, cpu-string, number of sections */
+  read_number(0);
+  read_number(0);
+  skip_string();
+  read_number(0);
+
+  for (nsyms=(int)read_number(0); nsyms>0; nsyms--) {
+    if (p >= m->data+m->size)
+      return FALSE;
+    read_symbol(&vs);
+    if ((vs.flags & (WEAK|EXPORT|COMMON)) && vs.type!=IMPORT &&
+        TYPE(&vs)!=TYPE_SECTION)
+      ar_addsym(gv,m,vs.name);
+  }
+  return TRUE;
+}
+
+
 static void vobj_readconv(struct GlobalVars *gv,struct LinkFile *lf)
 {
   struct ar_info ai;
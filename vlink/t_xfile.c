@@ -39,6 +39,7 @@ struct FFFuncs fff_xfile = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   writeobject,
   writeshared,
@@ -24,6 +24,7 @@ struct FFFuncs fff_discard = {
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL,NULL,NULL,
   NULL,
   NULL,
@@ -267,60 +268,207 @@ void section_copy(struct GlobalVars *gv,uint8_t *dest,size_t offset,
 }
 
 
+static uint32_t globsym_slot(uint32_t hash,uint32_t size)
+/* first slot to probe for a hash, elf_hash() alone is too clustered */
+{
+  hash *= 0x9e3779b1;
+  return (hash ^ (hash >> 16)) & (size - 1);
+}
+
+
+static void grow_globsyms(struct GlobSymTab *t)
+/* double the number of slots and reinsert all entries */
+{
+  uint32_t newsize = t->size ? t->size << 1 : GSYMMINSIZE;
+  uint32_t *idx = alloczero(newsize * sizeof(uint32_t));
+  uint32_t i,j;
+
+  for (i=0; i<t->nent; i++) {
+    for (j=globsym_slot(t->ent[i].hash,newsize); idx[j]; j=(j+1)&(newsize-1));
+    idx[j] = i + 1;
+  }
+  free(t->idx);
+  t->idx = idx;
+  t->size = newsize;
+  t->ent = realloc(t->ent,(newsize-newsize/4) * sizeof(struct GlobSym));
+  if (t->ent == NULL)
+    error(1);  /* out of memory */
+  if (t->nent)
+    t->grows++;
+}
+
+
+static struct GlobSym *lookup_globsym(struct GlobalVars *gv,const char *name,
+                                      uint32_t hash,bool create)
+/* Return the global symbol table entry for name. Create a new entry
+   when it doesn't exist and create is TRUE, otherwise return NULL.
+   Entry pointers are only valid until the next entry is created! */
+{
+  struct GlobSymTab *t = &gv->symbols;
+  struct GlobSym *gs;
+  uint32_t i,mask;
+
+  if (create && t->nent>=t->size-t->size/4)
+    grow_globsyms(t);
+  t->lookups++;
+  if (t->size == 0)
+    return NULL;
+
+  mask = t->size - 1;
+  for (i=globsym_slot(hash,t->size); t->idx[i]; i=(i+1)&mask) {
+    gs = &t->ent[t->idx[i]-1];
+    t->probes++;
+    if (gs->hash==hash && (gs->name==name || !strcmp(gs->name,name)))
+      return gs;
+  }
+
+  if (create) {
+    t->idx[i] = ++t->nent;
+    gs = &t->ent[t->nent-1];
+    gs->name = name;
+    gs->hash = hash;
+    gs->chain = NULL;
+    return gs;
+  }
+  return NULL;
+}
+
+
+struct GlobSym *find_globsym(struct GlobalVars *gv,const char *name,
+                             uint32_t hash)
+/* return the global symbol table entry for name and its elf_hash() */
+{
+  return lookup_globsym(gv,name,hash,FALSE);
+}
+
+
+uint32_t *globsym_order(struct GlobalVars *gv)
+/* Return the indices of all global symbol table entries, sorted like
+   the chains of a SYMHTABSIZE hash table, as in former vlink versions.
+   This defines the allocation order of common symbols, so layouts
+   don't change. */
+{
+  struct GlobSymTab *t = &gv->symbols;
+
+  if (t->norder != t->nent) {
+    uint32_t *cnt = alloczero((SYMHTABSIZE+1) * sizeof(uint32_t));
+    uint32_t i;
+
+    free(t->order);
+    t->order = alloc(t->nent * sizeof(uint32_t));
+    for (i=0; i<t->nent; i++)
+      cnt[(t->ent[i].hash%SYMHTABSIZE)+1]++;
+    for (i=1; i<SYMHTABSIZE; i++)
+      cnt[i] += cnt[i-1];
+    for (i=0; i<t->nent; i++)
+      t->order[cnt[t->ent[i].hash%SYMHTABSIZE]++] = i;
+    free(cnt);
+    t->norder = t->nent;
+  }
+  return t->order;
+}
+
+
+void print_globsym_stats(struct GlobalVars *gv,FILE *f)
+{
+  struct GlobSymTab *t = &gv->symbols;
+
+  fprintf(f,"\nGlobal symbol table: %lu names in %lu slots (%lu%% used), "
+          "grown %u times.\n%lu lookups with %lu probes (%.2f per lookup).\n",
+          (unsigned long)t->nent,(unsigned long)t->size,
+          t->size ? (unsigned long)t->nent*100/t->size : 0UL,t->grows,
+          t->lookups,t->probes,
+          t->lookups ? (double)t->probes/(double)t->lookups : 0.0);
+}
+
+
+static struct Symbol *lookup_symbol(struct GlobalVars *gv,struct Section *sec,
+                                    const char *name,uint32_t mask)
+/* Find the best match for name in the global symbol table, without
+   following indirect symbols. */
+{
+  struct GlobSym *gs;
+  struct Symbol *sym,*found;
+  uint32_t minmask;
+
+  found = NULL;
+  minmask = ~0;
+  gs = find_globsym(gv,name,(uint32_t)elf_hash(name));
+
+  for (sym=gs?gs->chain:NULL; sym!=NULL; sym=sym->glob_chain) {
+    if (mask) {
+      /* find a symbol with the best-matching (minimal) feature-mask */
+      uint32_t fmask;
+
+      if (fmask = sym->fmask) {
+        if ((mask & fmask) != mask)
+          continue;
+        if (fmask <= minmask)
+          minmask = 0/*fmask*/;
+        else
+          continue;
+      }
+      else if (minmask != ~0)
+        continue;
+    }
+    else if (sym->fmask)
+      continue;
+
+    if (sec && sym->relsect && sym->relsect->obj==sec->obj) {
+      /* a symbol from the referers object unit is always the best match */
+      found = sym;
+      break;
+    }
+
+    if (found) {
+      /* prefer symbols from already linked object units */
+      if (sym->relsect && (sym->relsect->obj->flags & OUF_LINKED) &&
+          (found->relsect && !(found->relsect->obj->flags & OUF_LINKED)))
+        found =sym;
+    }
+    else
+      found = sym;
+  }
+
+  return found;
+}
+
+
 struct Symbol *findsymbol(struct GlobalVars *gv,struct Section *sec,
                           const char *name,uint32_t mask)
 /* Return pointer to Symbol, otherwise return NULL.
    Make sure to prefer symbols from sec's ObjectUnit. */
 {
-  if (fff[gv->dest_format]->fndsymbol) {
+  struct Symbol *sym;
+
+  if (fff[gv->dest_format]->fndsymbol)
     return fff[gv->dest_format]->fndsymbol(gv,sec,name,mask);
-  }
-  else {
-    struct Symbol *sym,*found;
-    uint32_t minmask = ~0;
-
-    for (sym=gv->symbols[elf_hash(name)%SYMHTABSIZE],found=NULL; sym!=NULL;
-         sym=sym->glob_chain) {
-      if (!strcmp(name,sym->name)) {
-        if (mask) {
-          /* find a symbol with the best-matching (minimal) feature-mask */
-          uint32_t fmask;
-
-          if (fmask = sym->fmask) {
-            if ((mask & fmask) != mask)
-              continue;
-            if (fmask <= minmask)
-              minmask = 0/*fmask*/;
-            else
-              continue;
-          }
-          else if (minmask != ~0)
-            continue;
-        }
-        else if (sym->fmask)
-          continue;
 
-        if (sec && sym->relsect && sym->relsect->obj==sec->obj) {
-          /* a symbol from the referers object unit is always the best match */
-          found = sym;
-          break;
-        }
+  while ((sym = lookup_symbol(gv,sec,name,mask)) != NULL &&
+         sym->type == SYM_INDIR)
+    name = sym->indir_name;  /* look up the indirect symbol's target */
+  return sym;
+}
 
-        if (found) {
-          /* prefer symbols from already linked object units */
-          if (sym->relsect && (sym->relsect->obj->flags & OUF_LINKED) &&
-              (found->relsect && !(found->relsect->obj->flags & OUF_LINKED)))
-            found =sym;
-        }
-        else
-          found = sym;
-      }
-    }
-    if (found!=NULL && found->type==SYM_INDIR)
-      return findsymbol(gv,sec,found->indir_name,mask);
-    return found;
+
+struct Symbol *resolvesymbol(struct GlobalVars *gv,struct Section *sec,
+                             const char *name,uint32_t mask)
+/* Like findsymbol(), but used when resolving references: archive members
+   defining name, or the target of an indirect symbol, are converted
+   first, so their symbols may be pulled. */
+{
+  struct Symbol *sym;
+
+  if (gv->arsyms == NULL)
+    return findsymbol(gv,sec,name,mask);
+
+  for (;;) {
+    ar_lazyload(gv,name,elf_hash(name));
+    if ((sym = lookup_symbol(gv,sec,name,mask)) == NULL ||
+        sym->type != SYM_INDIR)
+      return sym;
+    name = sym->indir_name;
   }
-  return NULL;
 }
 
 
@@ -375,76 +523,87 @@ static void remove_obj_symbol(struct Symbol *delsym)
 
 
 bool addglobsym(struct GlobalVars *gv,struct Symbol *newsym)
-/* insert symbol into global symbol hash table */
+/* insert symbol into global symbol table */
 {
-  struct Symbol **chain = &gv->symbols[elf_hash(newsym->name)%SYMHTABSIZE];
+  struct GlobSym *gs = lookup_globsym(gv,newsym->name,
+                                      (uint32_t)elf_hash(newsym->name),TRUE);
+  struct Symbol **chain = &gs->chain;
+  struct Symbol **ins = NULL;
   struct Symbol *sym;
   struct ObjectUnit *newou = newsym->relsect ? newsym->relsect->obj : NULL;
 
-  while (sym = *chain) {
-    if (!strcmp(newsym->name,sym->name)) {
-
-      if (newsym->type==SYM_ABS && sym->type==SYM_ABS &&
-          newsym->value == sym->value)
-        return FALSE;  /* absolute symbols with same value are ignored */
+  newsym->name = gs->name;  /* share the interned name */
 
-      if (newsym->relsect == NULL || sym->relsect == NULL) {
-        /* redefined linker script symbol */
-        if (newou!=NULL && newou->lnkfile->type<ID_LIBBASE) {
-          static const char *objname = "ldscript";
-
-          error(19,newou ? newou->lnkfile->pathname : objname,
-                newsym->name, newou ? getobjname(newou) : objname,
-                sym->relsect ? getobjname(sym->relsect->obj) : objname);
-        }
-        /* redefinitions in libraries are silently ignored */
-        return FALSE;
+  while (sym = *chain) {
+    if (newsym->type==SYM_ABS && sym->type==SYM_ABS &&
+        newsym->value == sym->value)
+      return FALSE;  /* absolute symbols with same value are ignored */
+
+    if (newsym->relsect == NULL || sym->relsect == NULL) {
+      /* redefined linker script symbol */
+      if (newou!=NULL && newou->lnkfile->type<ID_LIBBASE) {
+        static const char *objname = "ldscript";
+
+        error(19,newou ? newou->lnkfile->pathname : objname,
+              newsym->name, newou ? getobjname(newou) : objname,
+              sym->relsect ? getobjname(sym->relsect->obj) : objname);
       }
+      /* redefinitions in libraries are silently ignored */
+      return FALSE;
+    }
 
-      if (sym->bind == SYMB_GLOBAL) {
-        /* symbol already defined with global binding */
-
-        if (newsym->bind == SYMB_GLOBAL) {
-          if (newou->lnkfile->type < ID_LIBBASE) {
-            if (newsym->type==SYM_COMMON || sym->type==SYM_COMMON) {
-              if (newsym->type!=SYM_COMMON || (newsym->type==sym->type &&
-                  ((newsym->size>sym->size && newsym->value>=sym->value) ||
-                   (newsym->size>=sym->size && newsym->value>sym->value)))) {
-                /* replace by common symbol with bigger size or alignment */
-                newsym->glob_chain = sym->glob_chain;
-                remove_obj_symbol(sym);  /* delete old symbol in object unit */
-                break;
-              }
-            }
-            else {
-              /* Global symbol "x" is already defined in... */
-              error(19,newou->lnkfile->pathname,newsym->name,
-                    getobjname(newou),getobjname(sym->relsect->obj));
+    if (sym->bind == SYMB_GLOBAL) {
+      /* symbol already defined with global binding */
+
+      if (newsym->bind == SYMB_GLOBAL) {
+        if (newou->lnkfile->type < ID_LIBBASE) {
+          if (newsym->type==SYM_COMMON || sym->type==SYM_COMMON) {
+            if (newsym->type!=SYM_COMMON || (newsym->type==sym->type &&
+                ((newsym->size>sym->size && newsym->value>=sym->value) ||
+                 (newsym->size>=sym->size && newsym->value>sym->value)))) {
+              /* replace by common symbol with bigger size or alignment */
+              newsym->glob_chain = sym->glob_chain;
+              remove_obj_symbol(sym);  /* delete old symbol in object unit */
+              break;
             }
-            return FALSE;  /* ignore this symbol */
           }
-          /* else: add global library symbol with same name to the chain -
-             some targets may want to choose between them! */
+          else {
+            /* Global symbol "x" is already defined in... */
+            error(19,newou->lnkfile->pathname,newsym->name,
+                  getobjname(newou),getobjname(sym->relsect->obj));
+          }
+          return FALSE;  /* ignore this symbol */
         }
-        else
-          return FALSE;  /* don't replace global by nonglobal symbols */
+        /* else: add global library symbol with same name to the chain -
+           some targets may want to choose between them! */
       }
+      else
+        return FALSE;  /* don't replace global by nonglobal symbols */
+    }
 
-      else {
-        if (newsym->bind == SYMB_WEAK)
-          return FALSE;  /* don't replace weak by weak */
+    else {
+      if (newsym->bind == SYMB_WEAK)
+        return FALSE;  /* don't replace weak by weak */
 
-        /* replace weak symbol by a global one */
-        newsym->glob_chain = sym->glob_chain;
-        remove_obj_symbol(sym);  /* delete old symbol in object unit */
-        break;
-      }
+      /* replace weak symbol by a global one */
+      newsym->glob_chain = sym->glob_chain;
+      remove_obj_symbol(sym);  /* delete old symbol in object unit */
+      break;
     }
 
+    if (ins==NULL && newou!=NULL && sym->relsect!=NULL &&
+        sym->relsect->obj!=NULL && sym->relsect->obj->order>newou->order)
+      ins = chain;
     chain = &sym->glob_chain;
   }
 
-  *chain = newsym;
+  if (sym==NULL && ins!=NULL) {
+    /* keep link order for members of lazily loaded archives */
+    newsym->glob_chain = *ins;
+    *ins = newsym;
+  }
+  else
+    *chain = newsym;
   if (newou) {
     if (trace_sym_access(gv,newsym->name))
       fprintf(stderr,"Symbol %s defined in section %s in %s\n",
@@ -459,10 +618,11 @@ void unlink_globsymbol(struct GlobalVars *gv,struct Symbol *sym)
 /* remove a symbol from the global symbol list */
 {
   static const char *fn = "unlink_globsymbol(): ";
+  struct GlobSym *gs = find_globsym(gv,sym->name,elf_hash(sym->name));
 
-  if (gv->symbols) {
+  if (gs) {
     struct Symbol *cptr;
-    struct Symbol **chain = &gv->symbols[elf_hash(sym->name)%SYMHTABSIZE];
+    struct Symbol **chain = &gs->chain;
 
     while (cptr = *chain) {
       if (cptr == sym)
@@ -478,7 +638,7 @@ void unlink_globsymbol(struct GlobalVars *gv,struct Symbol *sym)
       ierror("%s%s could not be found in global symbols list",fn,sym->name);
   }
   else
-    ierror("%ssymbols==NULL",fn);
+    ierror("%s%s has no global symbol table entry",fn,sym->name);
 }
 #endif
 
@@ -487,11 +647,11 @@ void hide_shlib_symbols(struct GlobalVars *gv)
 /* scan for all unreferenced SYMF_SHLIB symbols in the global symbol list
    and remove them - they have to be invisible for the file we create */
 {
-  int i;
+  uint32_t i;
 
-  for (i=0; i<SYMHTABSIZE; i++) {
+  for (i=0; i<gv->symbols.nent; i++) {
     struct Symbol *sym;
-    struct Symbol **chain = &gv->symbols[i];
+    struct Symbol **chain = &gv->symbols.ent[i].chain;
 
     while (sym = *chain) {
       if ((sym->flags & SYMF_SHLIB) && !(sym->flags & SYMF_REFERENCED)) {
@@ -612,7 +772,13 @@ struct Symbol *addsymbol(struct GlobalVars *gv,struct Section *s,
       sym->name = new_name;
     }
 
-    if (!addglobsym(gv,sym)) {
+    if (gv->parallel_load) {
+      /* a worker thread must not touch the global symbol table, so
+         add_loaded_objunit() will do it later */
+      sym->glob_chain = ou->pendsyms;
+      ou->pendsyms = sym;
+    }
+    else if (!addglobsym(gv,sym)) {
       free(sym);
       return NULL;
     }
@@ -750,8 +916,8 @@ void fixlnksymbols(struct GlobalVars *gv,struct LinkedSection *def_ls)
               addglobsym(gv,sym);  /* make it globally visible */
             /* add to final output section */
             addtail(&sym->relsect->lnksec->symbols,&sym->n);
-            if (gv->map_file)
-              print_symbol(gv,gv->map_file,sym);
+            if (gv->linkmap)
+              linkmap_lnksymbol(gv,sym);
           }
         }
       }
@@ -855,16 +1021,17 @@ void pull_objunit(struct GlobalVars *gv,struct ObjectUnit *ou)
     struct Symbol *sym;
 
     while (sym = *chain) {
-      if (sym->bind==SYMB_GLOBAL) {
-        struct Symbol **gchain = &gv->symbols[elf_hash(sym->name)%SYMHTABSIZE];
+      struct GlobSym *gs;
+
+      if (sym->bind==SYMB_GLOBAL &&
+          (gs = find_globsym(gv,sym->name,elf_hash(sym->name)))!=NULL) {
+        struct Symbol **gchain = &gs->chain;
         struct Symbol *gsym;
 
         while (gsym = *gchain) {
-          if (!strcmp(sym->name,gsym->name)) {
-            if (check_global_objsym(ou,gchain,gsym,sym)) {
-              *chain = sym->obj_chain;  /* discard this object symbol */
-              break;
-            }
+          if (check_global_objsym(ou,gchain,gsym,sym)) {
+            *chain = sym->obj_chain;  /* discard this object symbol */
+            break;
           }
           gchain = &(*gchain)->glob_chain;
         }
@@ -1214,8 +1381,29 @@ lword writesection(struct GlobalVars *gv,uint8_t *dest,size_t secoffs,
   else
     sign = 0;
 
-  /* Reset all relocation fields to zero. */
   dest += tbytes(gv,secoffs);
+  ri = r->insert;
+
+  if (ri!=NULL && ri->next==NULL && ri->bpos==0 && ri->mask==-1 &&
+      (ri->bsiz==32 || ri->bsiz==16) && gv->octets_per_tbyte==1 &&
+      gv->bits_per_tbyte==8) {
+    /* fast path for a single, byte-aligned 16 or 32 bit field */
+    bool be = gv->endianness != _LITTLE_ENDIAN_;
+
+    if (sign!=2 && ri->bsiz<(int)gv->bits_per_taddr)
+      v = sign_extend(v,gv->bits_per_taddr);
+    if (!checkrange(v,sign,ri->bsiz)) {
+      memset(dest,0,ri->bsiz>>3);
+      return v;
+    }
+    if (ri->bsiz == 32)
+      write32(be,dest,(uint32_t)v);
+    else
+      write16(be,dest,(uint16_t)v);
+    return 0;
+  }
+
+  /* Reset all relocation fields to zero. */
   for (ri=r->insert; ri!=NULL; ri=ri->next)
     writereloc(gv,dest,ri->bpos,ri->bsiz,0);
 
@@ -1704,6 +1892,9 @@ struct ObjectUnit *create_objunit(struct GlobalVars *gv,
   initlist(&ou->pripointers);  /* empty PriPointer list */
   ou->flags = 0;
   ou->min_alignment = gv->min_alignment;
+  if (!gv->parallel_load)
+    ou->order = gv->unit_order++;  /* otherwise set by add_loaded_objunit() */
+  ou->pendsyms = NULL;
   return ou;
 }
 
@@ -1723,31 +1914,45 @@ struct ObjectUnit *art_objunit(struct GlobalVars *gv,const char *n,
 }
 
 
+static void enqueue_objunit(struct GlobalVars *gv,struct ObjectUnit *ou)
+{
+  uint8_t t = ou->lnkfile->type;
+
+  if (t==ID_LIBARCH && gv->whole_archive)
+    t = ID_OBJECT;  /* force linking of a whole archive */
+
+  switch (t) {
+    case ID_OBJECT:
+    case ID_EXECUTABLE:
+      ou->flags |= OUF_LINKED;  /* objects are always linked */
+      addtail(&gv->selobjects,&ou->n);
+      break;
+    case ID_LIBARCH:
+      addtail(&gv->libobjects,&ou->n);
+      break;
+    case ID_SHAREDOBJ:
+      addtail(&gv->sharedobjects,&ou->n);
+      break;
+    default:
+      ierror("add_objunit(): Link File type = %d",
+             (int)ou->lnkfile->type);
+  }
+}
+
+
 void add_objunit(struct GlobalVars *gv,struct ObjectUnit *ou,bool fixrelocs)
 /* adds an ObjectUnit to the appropriate list */
 {
   if (ou) {
-    uint8_t t = ou->lnkfile->type;
-
-    if (t==ID_LIBARCH && gv->whole_archive)
-      t = ID_OBJECT;  /* force linking of a whole archive */
-
-    switch (t) {
-      case ID_OBJECT:
-      case ID_EXECUTABLE:
-        ou->flags |= OUF_LINKED;  /* objects are always linked */
-        addtail(&gv->selobjects,&ou->n);
-        break;
-      case ID_LIBARCH:
-        addtail(&gv->libobjects,&ou->n);
-        break;
-      case ID_SHAREDOBJ:
-        addtail(&gv->sharedobjects,&ou->n);
-        break;
-      default:
-        ierror("add_objunit(): Link File type = %d",
-               (int)ou->lnkfile->type);
+    if (gv->parallel_load) {
+      /* converted by a worker thread, keep it for add_loaded_objunit() */
+      if (ou->lnkfile->loaded != NULL)
+        ierror("add_objunit(): %s has more than one unit",
+               ou->lnkfile->pathname);
+      ou->lnkfile->loaded = ou;
     }
+    else
+      enqueue_objunit(gv,ou);
 
     if (fixrelocs) {  /* convert section index into address */
       struct Section *sec;
@@ -1770,6 +1975,32 @@ void add_objunit(struct GlobalVars *gv,struct ObjectUnit *ou,bool fixrelocs)
 }
 
 
+void add_loaded_objunit(struct GlobalVars *gv,struct ObjectUnit *ou)
+/* Add an ObjectUnit, which was converted by a worker thread, and its
+   global symbols in command line order, as if it was loaded just now. */
+{
+  struct Symbol *sym,*next,*pend;
+
+  ou->order = gv->unit_order++;
+
+  /* symbols were pushed in reverse order */
+  for (pend=NULL,sym=ou->pendsyms; sym!=NULL; sym=next) {
+    next = sym->glob_chain;
+    sym->glob_chain = pend;
+    pend = sym;
+  }
+  ou->pendsyms = NULL;
+
+  for (sym=pend; sym!=NULL; sym=next) {
+    next = sym->glob_chain;
+    sym->glob_chain = NULL;
+    if (!addglobsym(gv,sym))
+      remove_obj_symbol(sym);
+  }
+  enqueue_objunit(gv,ou);
+}
+
+
 struct SecAttrOvr *addsecattrovr(struct GlobalVars *gv,char *name,
                                  uint32_t flags)
 /* Create a new SecAttrOvr node and append it to the list. When a node
@@ -1917,7 +2148,7 @@ struct Section *create_section(struct ObjectUnit *ou,const char *name,
                                uint8_t *data,unsigned long size)
 /* creates and initializes a Section node */
 {
-  static uint32_t idcnt;
+  static THREADLOCAL uint32_t idcnt;
   struct Section *s = alloczero(sizeof(struct Section));
 
   s->name = do_rename(ou->lnkfile->renames,name);
@@ -2063,6 +2294,7 @@ struct LinkedSection *create_lnksect(struct GlobalVars *gv,const char *name,
   initlist(&ls->relocs);
   initlist(&ls->xrefs);
   initlist(&ls->symbols);
+  ls->filepos = -1;
   addtail(&gv->lnksec,&ls->n);
   return ls;
 }
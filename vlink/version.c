@@ -39,7 +39,9 @@ void show_usage(struct GlobalVars *gv,int verbose)
          "[-da] [-dc] [-dp] [-EB] [-EL] [-e entrypoint] [-export-dynamic] "
          "[-f flavour] [-fixunnamed] [-F filename] "
          "[-gc-all] [-gc-empty] "
-         "[-hunkattr secname=value] [-interp path] [-minalign value] "
+         "[-hunkattr secname=value] [-icf] [-icf-all] [-incremental] "
+         "[-interp path] [-mapjson filename] [-minalign value] "
+         "[-mmap-output] "
          "[-mrel] [-mtype] [-mall] [-multibase] [-nostdlib] "
          "[-N old new] [-o filename] [-osec] [-Rstd/add/short] "
          "[-os9-mem/name/rev] [-P symbol] "
@@ -63,9 +65,12 @@ void show_usage(struct GlobalVars *gv,int verbose)
            "-f<flavour>       add a library flavour\n"
            "-rpath <path>     add search path for dynamic linker\n"
            "-e<entrypoint>    address of program's entry point\n"
+           "-incremental      relink only changed objects, when possible\n"
            "-interp <path>    set interpreter path (dynamic linker for ELF)\n"
            "-gc-all           garbage-collect all unreferenced sections\n"
            "-gc-empty         garbage-collect empty unreferenced sections\n"
+           "-icf              fold identical sections, unless address is taken\n"
+           "-icf-all          fold all identical sections\n"
            "-y<symbol>        trace symbol accesses by the linker\n"
            "-P<symbol>        protect symbol from stripping\n"
 #if 0 /* not implemented */
@@ -85,6 +90,7 @@ void show_usage(struct GlobalVars *gv,int verbose)
            "-fixunnamed       unnamed sections are named according to their type\n"
            "-nostdlib         don't use default search path\n"
            "-multibase        don't auto-merge base-relative accessed sections\n"
+           "-mmap-output      write sections directly into the mapped output file\n"
            "-textbaserel      allow base-relative access on code sections\n"
            "-vicelabels       generate label mapping for the VICE debugger\n"
            "-shared           generate shared object\n"
@@ -104,6 +110,8 @@ void show_usage(struct GlobalVars *gv,int verbose)
            "-mall             merge all sections to a single output section\n"
            "-m                enable feature-mask in symbol names\n"
            "-M                print segment mappings and symbol values\n"
+           "-mapjson <file>   write section mappings and symbols as JSON\n"
+           "-j<n>             load and relocate with n threads\n"
            "-k                keep original section order\n"
            "-n                no page alignment\n"
            "-q                keep relocations in the final executable\n"
@@ -12,6 +12,7 @@
 #include <stddef.h>
 #include <ctype.h>
 #include <limits.h>
+#include <setjmp.h>
 #include "config.h"
 
 /* program's name */
@@ -57,6 +58,16 @@ typedef int64_t lword;
 /* boolean values */
 typedef int bool;
 
+/* static variables used while converting objects in worker threads */
+#ifdef PTHREADS
+#if defined(AMIGAOS) || defined(ATARI)
+#error "PTHREADS requires a host with POSIX threads"
+#endif
+#define THREADLOCAL __thread
+#else
+#define THREADLOCAL
+#endif
+
 /* program constants */
 #ifndef TRUE
 #define TRUE 1
@@ -128,6 +139,14 @@ struct InputFile {              /* inputlist nodes */
 #define IFF_ADDUNDERSCORE 2     /* add preceding underscore to symbols */
 
 
+struct ErrorBuffer {            /* diagnostics of a worker thread */
+  struct ErrorRecord *first;    /*  replayed with flush_errors() */
+  struct ErrorRecord *last;
+  bool fatal;                   /* stopped by a fatal or internal error */
+  jmp_buf abort;                /* return to the worker after it */
+};
+
+
 struct LinkFile {
   struct node n;
   const char *pathname;         /* full path: /usr/lib/libm.a */
@@ -139,6 +158,8 @@ struct LinkFile {
   uint8_t format;               /* file format - index into targets table */
   uint8_t type;                 /* ID_OBJECT/SHAREDOBJ/LIBARCH */
   uint16_t flags;               /* flags from InputFile */
+  struct ObjectUnit *loaded;    /* converted by a worker thread (-j) */
+  struct ErrorBuffer *diag;     /*  and its diagnostics */
 };
 
 
@@ -169,6 +190,8 @@ struct ObjectUnit {
   uint16_t flags;
   uint8_t  min_alignment;       /* minimal alignment for all sections */
   uint8_t  extra;               /* multi-purpose field */
+  unsigned long order;          /* link order, for global symbol chains */
+  struct Symbol *pendsyms;      /* global symbols waiting for addglobsym() */
 };
 
 #define OUF_LINKED 0x0001       /* object unit is marked as linked */
@@ -225,6 +248,7 @@ struct Section {
   int link;                     /* link to other section (e.g. ELF-strtab) */
   uint16_t filldata;            /* used to fill gaps */
   unsigned internal_flags;      /* internal linker flags - see below */
+  struct Section *folded;       /* identical section which replaces this one */
 };
 
 /* section types */
@@ -256,6 +280,7 @@ struct Section {
 /* internal flags */
 #define ILF_BADADDRINVA    (1<<0)  /* address out of range, saved in va */
 #define ILF_BANKALIGN      (1<<1)  /* must be aligned to next bank in output */
+#define ILF_NOFOLD         (1<<2)  /* never fold with an identical section */
 
 
 struct SymbolMask {
@@ -335,7 +360,7 @@ struct Reloc {                  /* relocation information */
 
 struct Symbol {
   struct node n;
-  struct Symbol *glob_chain;    /* next symbol in global hash chain */
+  struct Symbol *glob_chain;    /* next global symbol with same name */
   struct Symbol *obj_chain;     /* next symbol in object hash chain */
   const char *name;             /* symbol's name */
   const char *indir_name;       /* indirect symbol name (SYM_INDIR) */
@@ -386,6 +411,31 @@ struct Symbol {
 #define SYMX_SPECIAL 0x80000000 /* Bit 31 = target-specific lnk. symbol */
 
 
+/* The global symbol table has an entry for each symbol name, in the order
+   the names were defined. The entry's chain holds all global symbols
+   with this name. The entries are found by open addressing through
+   a power-of-2 sized index array, which grows when it is 3/4 full. */
+struct GlobSym {
+  const char *name;             /* interned name of all symbols in chain */
+  uint32_t hash;                /* elf_hash(name) */
+  struct Symbol *chain;         /* symbols linked by glob_chain */
+};
+
+struct GlobSymTab {
+  struct GlobSym *ent;          /* entries in order of definition */
+  uint32_t *idx;                /* entry index + 1 per slot, 0 is free */
+  uint32_t nent;                /* number of entries */
+  uint32_t size;                /* number of slots in idx */
+  uint32_t *order;              /* entries in traditional hash order */
+  uint32_t norder;              /* number of entries in order */
+  unsigned long lookups;        /* statistics for the trace output */
+  unsigned long probes;
+  unsigned grows;
+};
+
+#define GSYMMINSIZE 0x10000     /* initial slots, as the former fixed table */
+
+
 struct SymNames {
   struct SymNames *next;        /* next symbol name in hash chain */
   const char *name;             /* symbol's name */
@@ -459,6 +509,7 @@ struct LinkedSection {          /* linked sections of same type and name */
   struct list relocs;           /* relocations for this section */
   struct list xrefs;            /* external references to unknown symbols */
   struct list symbols;          /* the section's symbol definitions */
+  long filepos;                 /* contents' offset in output file or -1 */
 };
 
 /* linking flags (ld_flags) */
@@ -535,10 +586,12 @@ struct GlobalVars {
   bool merge_same_attr;         /* merge all sections with same attributes */
   bool merge_all;               /* merge everything into a single section */
   uint8_t gc_sects;             /* garbage-collect unreferenced sections */
+  uint8_t icf;                  /* fold identical sections */
   bool keep_trailing_zeros;     /* keep trailing zero-bytes at end of sect. */
   bool keep_sect_order;         /* keep order of section as found in objs */
   char masked_symbols;          /* symbols may use a feature-mask */
   bool fail_on_warning;         /* return with error code from warnings */
+  int jobs;                     /* number of threads to load objects */
   uint8_t bits_per_tbyte;       /* bits per target byte (word) */
   char reserved[3];
   size_t octets_per_tbyte;      /* host-bytes (8-bit) per target byte */
@@ -547,6 +600,7 @@ struct GlobalVars {
   uint8_t min_alignment;        /* minimal section alignment (default 0) */
   uint8_t ptr_alignment;        /* minimum alignment for pointers */
   FILE *map_file;               /* map file */
+  FILE *jsonmap_file;           /* map in JSON format */
   FILE *trace_file;             /* linker trace output */
   FILE *sym_file;               /* sym/val file following a given format */
   char *sym_file_format;        /* format string for symbol files */
@@ -566,6 +620,8 @@ struct GlobalVars {
   struct list rpaths;           /* library paths for dynamic linker (ELF) */
   const char *lineoffsfile;     /* optional source line/offsets output */
   bool discardOutput;           /* if true, don't create output file */
+  bool incremental;             /* relink changed objects into the output */
+  bool mmap_output;             /* lay out sections in mapped output file */
 
   /* errors */
   bool dontwarn;                /* suppress warnings */
@@ -580,12 +636,19 @@ struct GlobalVars {
   struct list selobjects;       /* list of included object units */
   struct list libobjects;       /* list of non-included library-objects */
   struct list sharedobjects;    /* list of shared objects */
-  struct Symbol **symbols;      /* global symbol hash table */
+  struct ArSymbol **arsyms;     /* lazy archive symbol index */
+  unsigned long unit_order;     /* order of the next ObjectUnit */
+  bool parallel_load;           /* worker threads are converting objects */
+  struct GlobSymTab symbols;    /* global symbol table */
   struct Symbol **lnksyms;      /* target-specific linker symbols hash tab */
   struct SymbolMask **symmasks; /* hash table of ORed symbol masks */
   struct list scriptsymbols;    /* symbols defined by linker script */
   struct list pripointers;      /* list of PriPointer nodes */
   struct list lnksec;           /* list of linked sections */
+  struct list foldedsecs;       /* sections replaced by an identical one */
+  struct LinkMap *linkmap;      /* collected for map file and JSON map */
+  uint8_t *outmap;              /* memory-mapped output file or NULL */
+  size_t outmapsize;            /* size of the mapped output file */
   int nsecs;                    /* total number of sections in lnksec */
   struct ObjectUnit *dynobj;    /* artif. object for dynamic sections */
   struct LinkedSection *firstSD;/* first small data section */
@@ -610,7 +673,7 @@ struct GlobalVars {
                                 /*  generated by a linker-script */
 };
 
-#define SYMHTABSIZE 0x10000     /* number of entries in symbol hash table */
+#define SYMHTABSIZE 0x10000     /* default size for symbol hash tables */
 #define TRSYMHTABSIZE 0x40
 #define DEFAULT_INTERP_PATH "/usr/lib/ld.so.1"
 
@@ -623,6 +686,11 @@ struct GlobalVars {
 #define GCS_EMPTY       1       /* delete empty unreferenced sections */
 #define GCS_ALL         2       /* delete all unreferenced sections */
 
+/* icf */
+#define ICF_NONE        0       /* no identical section folding */
+#define ICF_SAFE        1       /* don't fold sections with address taken */
+#define ICF_ALL         2       /* fold all identical sections */
+
 /* reloctab_format */
 #define RTAB_UNDEF      0x00    /* format not preset by user */
 #define RTAB_STANDARD   0x01    /* standard, addends in code */
@@ -669,6 +737,11 @@ struct Patterns {
 /* flags */
 #define PFL_KEEP        1       /* keep these sections in output */
 
+/* pattern types, returned by pattern_type() */
+#define PAT_LITERAL     0       /* no wildcards, compare the whole name */
+#define PAT_PREFIX      1       /* literal prefix followed by '*' */
+#define PAT_GLOB        2       /* needs pattern_match() */
+
 
 typedef union {                 /* argument type for dynentry() */
   const char *name;
@@ -702,6 +775,8 @@ struct FFFuncs {                /* file format specific functions and data */
     (*lnksymbol)(struct GlobalVars *,struct Section *,struct Reloc *);
   void                          /* init sym structure during resolve_xref() */
     (*setlnksym)(struct GlobalVars *,struct Symbol *);
+  bool                          /* optional: pc-rel. reloc from a branch? */
+    (*isbranch)(struct GlobalVars *,struct Section *,struct Reloc *);
   void                          /* prepare dynamic linking structures */
     (*dyninit)(struct GlobalVars *);
   struct Symbol *               /* make entry into a dynamic linking section */
@@ -733,6 +808,7 @@ struct FFFuncs {                /* file format specific functions and data */
 #define FFINI_DESTFMT 1         /* init dest.target in linker_init() only */
 #define FFINI_RESOLVE 2         /* dest.target at the end of linker_resolve() */
 #define FFINI_MERGE 3           /* dest.target before merging sections */
+#define FFINI_COPY 4            /* dest.target before copying section data */
 /* Return codes from identify() */
 #define ID_IGNORE (-1)          /* ignore file - e.g. an empty archive */
 #define ID_UNKNOWN 0            /* unknown file format */
@@ -776,6 +852,7 @@ struct FFFuncs {                /* file format specific functions and data */
 #define FFF_NOFILE 0x20         /* Target creates output files itself */
 #define FFF_KEEPRELOCS 0x40     /* Binary target allows reloc table appended */
 #define FFF_OUTWORDADDR 0x80    /* Output supports bits_per_tbyte != 8 */
+#define FFF_THREADSAFE 0x100    /* readconv() of objects may run in parallel */
 
 
 /* List of artificially generated pointers or long words, which are */
@@ -823,9 +900,12 @@ void insertbehind(struct node *,struct node *);
 void addhead(struct list *,struct node *);
 void addtail(struct list *,struct node *);
 struct node *remhead(struct list *);
+void appendlist(struct list *,struct list *);
 struct node *remnode(struct node *);
 int stricmp(const char *,const char *);
 char *mapfile(const char *);
+uint8_t *mapoutfile(const char *,size_t);
+bool unmapoutfile(uint8_t *,size_t,const char *);
 const char *base_name(const char *);
 char *check_name(char *);
 bool checkrange(lword,int,int);
@@ -893,6 +973,9 @@ void add_symnames(struct SymNames **,const char *,lword);
 void disable_warning(int);
 void error(int,...);
 void ierror(char *,...);
+void error_context(const void *,const char *,...);
+void buffer_errors(struct ErrorBuffer *);
+void flush_errors(struct ErrorBuffer *);
 
 /* linker.c */
 void linker_init(struct GlobalVars *);
@@ -902,17 +985,32 @@ void linker_relrefs(struct GlobalVars *);
 void linker_dynprep(struct GlobalVars *);
 void linker_sectrefs(struct GlobalVars *);
 void linker_gcsects(struct GlobalVars *);
+void linker_foldsects(struct GlobalVars *);
 void linker_merge(struct GlobalVars *);
 void linker_delunused(struct GlobalVars *);
-void linker_mapfile(struct GlobalVars *);
 void linker_copy(struct GlobalVars *);
 void linker_relocate(struct GlobalVars *);
 void linker_write(struct GlobalVars *);
 void linker_cleanup(struct GlobalVars *);
+struct RelocBases {
+  struct Symbol *sdabase,*sda2base,*gotbase,*pltbase,*r13init;
+};
+void relocate_section(struct GlobalVars *,struct LinkedSection *,
+                      struct Section *,struct RelocBases *,
+                      struct list *,struct list *);
 const char *getobjname(struct ObjectUnit *);
 void print_function_name(struct Section *,unsigned long);
 void print_symbol(struct GlobalVars *,FILE *,struct Symbol *);
 bool trace_sym_access(struct GlobalVars *,const char *);
+struct Section *fold_target(struct Section *);
+
+/* linkmap.c */
+void linker_mapfile(struct GlobalVars *);
+void linkmap_symbols(struct GlobalVars *,struct LinkedSection *,
+                     struct Symbol **,unsigned long);
+void linkmap_abssymbols(struct GlobalVars *,struct Symbol **,unsigned long);
+void linkmap_lnksymbol(struct GlobalVars *,struct Symbol *);
+void linker_writemap(struct GlobalVars *);
 
 /* targets.c */
 #ifndef TARGETS_C
@@ -947,7 +1045,12 @@ void section_copy(struct GlobalVars *,uint8_t *,size_t,uint8_t *,size_t);
 bool check_protection(struct GlobalVars *,const char *);
 struct Symbol *findsymbol(struct GlobalVars *,struct Section *,
                           const char *,uint32_t);
+struct Symbol *resolvesymbol(struct GlobalVars *,struct Section *,
+                             const char *,uint32_t);
 void hide_shlib_symbols(struct GlobalVars *);
+struct GlobSym *find_globsym(struct GlobalVars *,const char *,uint32_t);
+uint32_t *globsym_order(struct GlobalVars *);
+void print_globsym_stats(struct GlobalVars *,FILE *);
 struct Symbol *newsymbol(const char *,lword,uint8_t,uint8_t,uint8_t,uint8_t,
                          uint32_t);
 struct Symbol *addsymbol(struct GlobalVars *,struct Section *,
@@ -1007,6 +1110,7 @@ struct LinkedSection *find_lnksec(struct GlobalVars *,const char *,
                                   uint8_t,uint8_t,uint8_t,uint8_t);
 struct LinkedSection *smalldata_section(struct GlobalVars *);
 void add_objunit(struct GlobalVars *,struct ObjectUnit *,bool);
+void add_loaded_objunit(struct GlobalVars *,struct ObjectUnit *);
 struct ObjectUnit *create_objunit(struct GlobalVars *,
                                   struct LinkFile *,const char *);
 struct ObjectUnit *art_objunit(struct GlobalVars *,const char *,
@@ -1029,6 +1133,11 @@ void trim_sections(struct GlobalVars *);
 void untrim_sections(struct GlobalVars *,int);
 struct LinkedSection *load_next_section(struct GlobalVars *);
 
+/* incr.c */
+bool incr_relink(struct GlobalVars *,int,const char **);
+void incr_collect(struct GlobalVars *,int,const char **);
+void incr_savestate(struct GlobalVars *);
+
 /* dir.c */
 char *path_append(char *,const char *,const char *,size_t);
 char *open_dir(const char *);
@@ -1051,6 +1160,7 @@ void init_ld_script(struct GlobalVars *);
 /* pmatch.c */
 bool pattern_match(const char *,const char *);
 bool patternlist_match(char **,const char *);
+int pattern_type(const char *,size_t *);
 
 /* expr.c */
 void skip(void);
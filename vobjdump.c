@@ -91,6 +91,11 @@ static size_t opb;    /* octets (host-bytes) per target-byte */
 static taddr bptmask; /* mask LSB to fit bytes per taddr */
 static const char *cpu_name;
 
+static int json;            /* -json: machine-readable output */
+static int relocs_only;     /* -r: no symbol table */
+static const char **secfilter,**symfilter;  /* -s and -y names */
+static int nsecfilter,nsymfilter;
+
 #define BPTMASK(x) (unsigned long long)((x)&bptmask)
 
 
@@ -150,30 +155,73 @@ static void print_sep(void)
 }
 
 
-static int print_nreloc(const char *relname,struct vobj_section *vsect,
-                        struct vobj_symbol *vsym,int nsyms,
-                        taddr offs,int bpos,int bsiz,taddr mask,
-                        taddr addend,int sym)
+static void print_json_string(const char *s)
+{
+  putchar('"');
+  for (; *s; s++) {
+    if (*s=='"' || *s=='\\')
+      printf("\\%c",*s);
+    else if ((unsigned char)*s < 0x20)
+      printf("\\u%04x",(unsigned)(unsigned char)*s);
+    else
+      putchar(*s);
+  }
+  putchar('"');
+}
+
+
+static int name_in(const char *name,const char **list,int n)
+{
+  while (n--) {
+    if (!strcmp(name,list[n]))
+      return 1;
+  }
+  return 0;
+}
+
+
+static const char *check_nreloc(struct vobj_section *vsect,int nsyms,
+                                taddr offs,int bpos,int bsiz,int sym)
 {
-  const char *basesym;
+  static char buf[128];
 
   if (offs<0 || offs+((bpos+bsiz-1)/bpb)>=vsect->dsize) {
-    printf("offset %#llx is outside of section!\n",
+    sprintf(buf,"offset %#llx is outside of section!",
             BPTMASK(offs+(bpos+bsiz-1)/bpb));
-    return 0;
+    return buf;
   }
   if (sym<0 || sym>=nsyms) {
-    printf("symbol index %d is illegal!\n",sym+1);
-    return 0;
+    sprintf(buf,"symbol index %d is illegal!",sym+1);
+    return buf;
   }
   if (bsiz<0 || bsiz>bitspertaddr) {
-    printf("size of %d bits is illegal!\n",bsiz);
-    return 0;
+    sprintf(buf,"size of %d bits is illegal!",bsiz);
+    return buf;
   }
   if (bpos<0 || bpos+bsiz>bitspertaddr) {
-    printf("bit field start=%d, size=%d doesn't fit into target address "
-           "type (%d bits)!\n",bpos,bsiz,bitspertaddr);
-    return 0;
+    sprintf(buf,"bit field start=%d, size=%d doesn't fit into target address "
+            "type (%d bits)!",bpos,bsiz,bitspertaddr);
+    return buf;
+  }
+  return NULL;
+}
+
+
+static void print_nreloc(const char *relname,struct vobj_section *vsect,
+                         struct vobj_symbol *vsym,int nsyms,
+                         taddr offs,int bpos,int bsiz,taddr mask,
+                         taddr addend,int sym)
+{
+  const char *basesym,*err;
+
+  if (err = check_nreloc(vsect,nsyms,offs,bpos,bsiz,sym)) {
+    if (json) {
+      printf("\"error\":");
+      print_json_string(err);
+    }
+    else
+      printf("%s\n",err);
+    return;
   }
 
   basesym = vsym[sym].name;
@@ -182,9 +230,16 @@ static int print_nreloc(const char *relname,struct vobj_section *vsect,
     /*addend += offs;*/
   }
 
-  printf("%08llx  %02d %02d %8llx %-8s %s%+" PRId64 "\n",
-         BPTMASK(offs),bpos,bsiz,BPTMASK(mask),relname,basesym,addend);
-  return 1;
+  if (json) {
+    printf("\"type\":\"%s\",\"offset\":%llu,\"bitpos\":%d,\"bitsize\":%d,"
+           "\"mask\":%llu,\"symbol\":",
+           relname,BPTMASK(offs),bpos,bsiz,BPTMASK(mask));
+    print_json_string(basesym);
+    printf(",\"addend\":%" PRId64,addend);
+  }
+  else
+    printf("%08llx  %02d %02d %8llx %-8s %s%+" PRId64 "\n",
+           BPTMASK(offs),bpos,bsiz,BPTMASK(mask),relname,basesym,addend);
 }
 
 
@@ -239,45 +294,93 @@ static void read_symbol(struct vobj_symbol *vsym)
 }
 
 
-static void read_section(struct vobj_section *vsect,
-                         struct vobj_symbol *vsym,int nsyms)
+static void index_section(struct vobj_section *vsect)
+/* read the section header, skip contents and relocations */
 {
-  const char *attr;
-  unsigned long flags;
-  int align,nrelocs,i;
+  int i,j;
 
   vsect->offs = p - vobj;
   vsect->name = (char *)p;
   skip_string();
-  attr = (char *)p;
+  vsect->attr = (char *)p;
   skip_string();
-  flags = (unsigned long)read_number(0);
-  align = (int)read_number(0);
+  vsect->flags = (unsigned long)read_number(0);
+  vsect->align = (int)read_number(0);
   vsect->dsize = read_number(0);
-  nrelocs = (int)read_number(0);
+  vsect->nrelocs = (int)read_number(0);
   vsect->fsize = read_number(0);
-
-  print_sep();
-  printf("%08llx: SECTION \"%s\" (attributes=\"%s\")\n"
-         "Flags: %-8lx  Alignment: %-6d "
-         "Total size: %-9" PRId64 " File size: %-9" PRId64 "\n",
-         BPTMASK(vsect->offs),vsect->name,attr,flags,align,
-         vsect->dsize,vsect->fsize);
-  if (nrelocs)
-    printf("%d Relocation%s present.\n",nrelocs,nrelocs==1?emptystr:sstr);
+  vsect->selected = !nsecfilter || name_in(vsect->name,secfilter,nsecfilter);
 
   p += vsect->fsize * opb;  /* skip section contents */
+  vsect->roffs = p - vobj;
 
-  /* read and print relocations for this section */
-  for (i=0; i<nrelocs; i++) {
+  for (i=0; i<vsect->nrelocs; i++) {
     int type;
     size_t len;
 
-    if (i == 0) {
-      /* print header */
-      printf("\nfile offs sectoffs pos sz mask     type     symbol+addend\n");
+    type = read_number(0);
+    if (type >= FIRST_CPU_RELOC)
+      len = read_number(0);  /* length of spec. reloc entry in octets */
+    else
+      len = 0;
+
+    if (type<FIRST_CPU_RELOC || len==0) {
+      if (type<FIRST_CPU_RELOC && STD_REL_TYPE(type)>=num_std_relocs) {
+        fprintf(stderr,"Illegal standard reloc type: %d\n",type);
+        exit(1);
+      }
+      /* offset, bit position, bit size, mask, addend, symbol index */
+      for (j=0; j<6; j++)
+        read_number(0);
+    }
+    else {
+      p += len;
+      if (p<vobj || p>vobj+vlen)
+        break;
     }
-    printf("%08llx: ",BPTMASK(p-vobj));
+  }
+
+  if (p<vobj || p>vobj+vlen) {
+    fprintf(stderr,"\nSection \"%s\" is corrupt! Aborting.\n",vsect->name);
+    exit(1);
+  }
+}
+
+
+static void print_section(struct vobj_section *vsect,
+                          struct vobj_symbol *vsym,int nsyms)
+{
+  int i,n;
+
+  if (json) {
+    printf("{\"offset\":%llu,\"name\":",BPTMASK(vsect->offs));
+    print_json_string(vsect->name);
+    printf(",\"attributes\":");
+    print_json_string(vsect->attr);
+    printf(",\"flags\":%lu,\"align\":%d,\"size\":%" PRId64 ","
+           "\"filesize\":%" PRId64 ",\"nrelocs\":%d,\"relocs\":[",
+           vsect->flags,vsect->align,vsect->dsize,vsect->fsize,
+           vsect->nrelocs);
+  }
+  else {
+    print_sep();
+    printf("%08llx: SECTION \"%s\" (attributes=\"%s\")\n"
+           "Flags: %-8lx  Alignment: %-6d "
+           "Total size: %-9" PRId64 " File size: %-9" PRId64 "\n",
+           BPTMASK(vsect->offs),vsect->name,vsect->attr,vsect->flags,
+           vsect->align,vsect->dsize,vsect->fsize);
+    if (vsect->nrelocs)
+      printf("%d Relocation%s present.\n",vsect->nrelocs,
+             vsect->nrelocs==1?emptystr:sstr);
+  }
+
+  /* decode and print relocations for this section, the index pass
+     has verified them already */
+  p = vobj + vsect->roffs;
+  for (i=n=0; i<vsect->nrelocs; i++) {
+    size_t roffs = p - vobj;
+    int type;
+    size_t len;
 
     type = read_number(0);
     if (type >= FIRST_CPU_RELOC)
@@ -290,38 +393,55 @@ static void read_section(struct vobj_section *vsect,
       taddr offs,mask,addend;
       int bpos,bsiz,sym;
 
-      if (type<FIRST_CPU_RELOC && STD_REL_TYPE(type)>=num_std_relocs) {
-        fprintf(stderr,"Illegal standard reloc type: %d\n",type);
-        exit(1);
-      }
       offs = read_number(0);
       bpos = (int)read_number(0);
       bsiz = (int)read_number(0);
       mask = read_number(1);
       addend = read_number(1);
       sym = (int)read_number(0) - 1;  /* symbol index */
+      if (nsymfilter && (sym<0 || sym>=nsyms ||
+                         !name_in(vsym[sym].name,symfilter,nsymfilter)))
+        continue;
+
+      if (json)
+        printf("%s{\"file_offset\":%llu,",n?",":"",BPTMASK(roffs));
+      else {
+        if (n == 0)  /* print header */
+          printf("\nfile offs sectoffs pos sz mask     type     symbol+addend\n");
+        printf("%08llx: ",BPTMASK(roffs));
+      }
       print_nreloc(type >= FIRST_CPU_RELOC ?
                    cpu_reloc_name(type) : standard_reloc_name(type),
                    vsect,vsym,nsyms,offs,bpos,bsiz,mask,addend,sym);
+      if (json)
+        putchar('}');
+      n++;
     }
     else {
       /* special relocation in cpu-specific format */
-      if (!print_cpureloc(type,p)) {
-        char sname[32];
-
-        sprintf(sname,"%.10s special reloc",cpu_name);
-        printf("%-24s %d with a size of %u octets\n",sname,type,(unsigned)len);
+      if (!nsymfilter) {
+        if (json)
+          printf("%s{\"file_offset\":%llu,\"type\":%d,\"special\":%u}",
+                 n?",":"",BPTMASK(roffs),type,(unsigned)len);
+        else {
+          if (n == 0)  /* print header */
+            printf("\nfile offs sectoffs pos sz mask     type     symbol+addend\n");
+          printf("%08llx: ",BPTMASK(roffs));
+          if (!print_cpureloc(type,p)) {
+            char sname[32];
+
+            sprintf(sname,"%.10s special reloc",cpu_name);
+            printf("%-24s %d with a size of %u octets\n",sname,type,(unsigned)len);
+          }
+        }
+        n++;
       }
       p += len;
-      if (p<vobj || p>vobj+vlen)
-        break;
     }
   }
 
-  if (p<vobj || p>vobj+vlen) {
-    fprintf(stderr,"\nSection \"%s\" is corrupt! Aborting.\n",vsect->name);
-    exit(1);
-  }
+  if (json)
+    printf("]}");
 }
 
 
@@ -353,12 +473,45 @@ static const char *def_name(struct vobj_symbol *vs,
 }
 
 
+static void print_symbol(struct vobj_symbol *vs,int first,
+                         struct vobj_section *vsect,int nsecs)
+{
+  if (json) {
+    printf("%s{\"offset\":%llu,\"name\":",first?"":",",BPTMASK(vs->offs));
+    print_json_string(vs->name);
+    printf(",\"bind\":\"%s\",\"size\":%u,\"type\":\"%s\",\"section\":",
+           bind_name(vs->flags),(unsigned)vs->size,type_name[TYPE(vs)]);
+    print_json_string(def_name(vs,vsect,nsecs));
+    printf(",\"value\":%llu}",BPTMASK(vs->val));
+  }
+  else
+    printf("%08llx: %-4s %08x %-4s %8.8s %8llx %s\n",
+           BPTMASK(vs->offs),bind_name(vs->flags),(unsigned)vs->size,
+           type_name[TYPE(vs)],def_name(vs,vsect,nsecs),
+           BPTMASK(vs->val),vs->name);
+}
+
+
+static int symbol_selected(struct vobj_symbol *vs,
+                           struct vobj_section *vsect,int nsecs)
+{
+  if (!strncmp(vs->name," *current pc",12))
+    return 0;
+  if (nsymfilter && !name_in(vs->name,symfilter,nsymfilter))
+    return 0;
+  if (nsecfilter && (vs->type!=LABSYM || vs->sec<1 || vs->sec>nsecs ||
+                     !vsect[vs->sec-1].selected))
+    return 0;
+  return 1;
+}
+
+
 static int vobjdump(void)
 {
   p = vobj;
 
   if (vlen>4 && p[0]==0x56 && p[1]==0x4f && p[2]==0x42 && p[3]==0x4a) {
-    int endian,ver,nsecs,nsyms,i;
+    int endian,ver,nsecs,nsyms,i,n;
     struct vobj_symbol *vsymbols = NULL;
     struct vobj_section *vsect = NULL;
 
@@ -397,14 +550,7 @@ static int vobjdump(void)
     nsecs = (int)read_number(0);  /* number of sections */
     nsyms = (int)read_number(0);  /* number of symbols */
 
-    /* print header */
-    print_sep();
-    printf("VOBJ v%d %s (%s endian), %d bits per byte, %d byte%s per address.\n"
-           "%d symbol%s.\n%d section%s.\n",
-           ver,cpu_name,endian_name[endian-1],bpb,bpt,bpt==1?emptystr:sstr,
-           nsyms,nsyms==1?emptystr:sstr,nsecs,nsecs==1?emptystr:sstr);
-
-    /* read symbols */
+    /* index symbols and sections in a single pass over the file */
     if (nsyms) {
       if (vsymbols = malloc(nsyms * sizeof(struct vobj_symbol))) {
         for (i=0; i<nsyms; i++)
@@ -416,11 +562,9 @@ static int vobjdump(void)
         return 1;
       }
     }
-
-    /* read and print sections */
-    if (vsect = malloc(nsecs * sizeof(struct vobj_section))) {
+    if (vsect = malloc((nsecs?nsecs:1) * sizeof(struct vobj_section))) {
       for (i=0; i<nsecs; i++)
-        read_section(&vsect[i],vsymbols,nsyms);
+        index_section(&vsect[i]);
     }
     else {
       fprintf(stderr,"Cannot allocate %ld bytes for sections!\n",
@@ -428,23 +572,59 @@ static int vobjdump(void)
       return 1;
     }
 
-    /* print symbols */
-    for (i=0; i<nsyms; i++) {
-      struct vobj_symbol *vs = &vsymbols[i];
+    /* print header */
+    if (json) {
+      printf("{\"version\":%d,\"cpu\":",ver);
+      print_json_string(cpu_name);
+      printf(",\"endian\":\"%s\",\"bitsperbyte\":%d,\"bytespertaddr\":%d,"
+             "\"nsections\":%d,\"nsymbols\":%d",
+             endian_name[endian-1],bpb,bpt,nsecs,nsyms);
+    }
+    else {
+      print_sep();
+      printf("VOBJ v%d %s (%s endian), %d bits per byte, %d byte%s per address.\n"
+             "%d symbol%s.\n%d section%s.\n",
+             ver,cpu_name,endian_name[endian-1],bpb,bpt,bpt==1?emptystr:sstr,
+             nsyms,nsyms==1?emptystr:sstr,nsecs,nsecs==1?emptystr:sstr);
+    }
+
+    /* print sections, unless only symbols were requested with -y */
+    if (relocs_only || !nsymfilter) {
+      if (json)
+        printf(",\"sections\":[");
+      for (i=n=0; i<nsecs; i++) {
+        if (vsect[i].selected) {
+          if (json && n++)
+            putchar(',');
+          print_section(&vsect[i],vsymbols,nsyms);
+        }
+      }
+      if (json)
+        putchar(']');
+    }
 
-      if (i == 0) {
+    /* print symbols */
+    if (!relocs_only) {
+      if (json)
+        printf(",\"symbols\":[");
+      else if (nsyms) {
         printf("\n");
         print_sep();
         printf("SYMBOL TABLE\n"
                "file offs bind size     type def      value    name\n");
       }
-      if (!strncmp(vs->name," *current pc",12))
-        continue;
-      printf("%08llx: %-4s %08x %-4s %8.8s %8llx %s\n",
-             BPTMASK(vs->offs),bind_name(vs->flags),(unsigned)vs->size,
-             type_name[TYPE(vs)],def_name(vs,vsect,nsecs),
-             BPTMASK(vs->val),vs->name);
+      for (i=n=0; i<nsyms; i++) {
+        if (symbol_selected(&vsymbols[i],vsect,nsecs))
+          print_symbol(&vsymbols[i],n++==0,vsect,nsecs);
+      }
+      if (json)
+        putchar(']');
     }
+
+    if (json)
+      printf("}\n");
+    free(vsect);
+    free(vsymbols);
   }
   else {
     fprintf(stderr,"Not a VOBJ file!\n");
@@ -455,6 +635,37 @@ static int vobjdump(void)
 }
 
 
+#if defined(UNIX)
+
+static int dumpfile(const char *name)
+/* map the file into memory and dump it */
+{
+  struct stat st;
+  int fd,rc = 1;
+
+  if ((fd = open(name,O_RDONLY)) >= 0) {
+    if (fstat(fd,&st)==0 && st.st_size>0) {
+      vlen = (size_t)st.st_size;
+      vobj = mmap(NULL,vlen,PROT_READ,MAP_PRIVATE,fd,0);
+      if (vobj != MAP_FAILED) {
+        rc = vobjdump();
+        munmap(vobj,vlen);
+      }
+      else
+        fprintf(stderr,"Cannot map file \"%s\"!\n",name);
+    }
+    else
+      fprintf(stderr,"Cannot determine size of file \"%s\"!\n",name);
+    close(fd);
+  }
+  else
+    fprintf(stderr,"Cannot open \"%s\" for reading!\n",name);
+
+  return rc;
+}
+
+#else
+
 static size_t filesize(FILE *fp,const char *name)
 {
   long size;
@@ -469,34 +680,73 @@ static size_t filesize(FILE *fp,const char *name)
 }
 
 
-int main(int argc,char *argv[])
+static int dumpfile(const char *name)
+/* read the whole file into a buffer and dump it */
 {
+  FILE *f;
   int rc = 1;
 
-  if (argc == 2) {
-    FILE *f;
-
-    if (f = fopen(argv[1],"rb")) {
-      if (vlen = filesize(f,argv[1])) {
-        if (vobj = malloc(vlen)) {
-          if (fread(vobj,1,vlen,f) == vlen)
-            rc = vobjdump();
-          else
-            fprintf(stderr,"Read error on \"%s\"!\n",argv[1]);
-          free(vobj);
-        }
+  if (f = fopen(name,"rb")) {
+    if (vlen = filesize(f,name)) {
+      if (vobj = malloc(vlen)) {
+        if (fread(vobj,1,vlen,f) == vlen)
+          rc = vobjdump();
         else
-          fprintf(stderr,"Unable to allocate %lu bytes "
-                  "to buffer file \"%s\"!\n",vlen,argv[1]);
+          fprintf(stderr,"Read error on \"%s\"!\n",name);
+        free(vobj);
       }
-      fclose(f);
-    }    
-    else
-      fprintf(stderr,"Cannot open \"%s\" for reading!\n",argv[1]);
+      else
+        fprintf(stderr,"Unable to allocate %lu bytes "
+                "to buffer file \"%s\"!\n",vlen,name);
+    }
+    fclose(f);
   }
   else
-    fprintf(stderr,"vobjdump V0.7\nWritten by Frank Wille\n"
-            "Usage: %s <file name>\n",argv[0]);
+    fprintf(stderr,"Cannot open \"%s\" for reading!\n",name);
 
   return rc;
 }
+
+#endif
+
+
+int main(int argc,char *argv[])
+{
+  const char *name = NULL;
+  int i;
+
+  secfilter = malloc(argc * sizeof(char *));
+  symfilter = malloc(argc * sizeof(char *));
+  if (secfilter==NULL || symfilter==NULL)
+    return 1;
+
+  for (i=1; i<argc; i++) {
+    if (!strcmp(argv[i],"-s") && i+1<argc)
+      secfilter[nsecfilter++] = argv[++i];
+    else if (!strcmp(argv[i],"-y") && i+1<argc)
+      symfilter[nsymfilter++] = argv[++i];
+    else if (!strcmp(argv[i],"-r"))
+      relocs_only = 1;
+    else if (!strcmp(argv[i],"-json"))
+      json = 1;
+    else if (argv[i][0]!='-' && name==NULL)
+      name = argv[i];
+    else {
+      name = NULL;
+      break;
+    }
+  }
+
+  if (name)
+    return dumpfile(name);
+
+  fprintf(stderr,"vobjdump V0.8\nWritten by Frank Wille\n"
+          "Usage: %s [options] <file name>\n"
+          "  -s <section>  dump only this section and its symbols\n"
+          "  -y <symbol>   dump only this symbol, or with -r the\n"
+          "                relocations referring to it\n"
+          "  -r            dump only the sections with their relocations\n"
+          "  -json         write JSON instead of text\n"
+          "-s and -y may be given multiple times.\n",argv[0]);
+  return 1;
+}
@@ -4,12 +4,22 @@
  * Written by Frank Wille <frank@phoenix.owl.de>.
  */
 
+#if defined(UNIX)
+#define _POSIX_C_SOURCE 200112L
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <inttypes.h>
 #include <limits.h>
+#if defined(UNIX)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 /* maximum VOBJ version to support */
 #define VOBJ_MAX_VERSION 2
@@ -45,8 +55,12 @@ struct vobj_symbol {
 
 struct vobj_section {
   size_t offs;
-  const char *name;
+  const char *name,*attr;
+  unsigned long flags;
+  int align,nrelocs;
   taddr dsize,fsize;
+  size_t roffs;       /* file offset of the first relocation */
+  int selected;
 };
 
 #define STD_REL_TYPE(t) ((t)&0x1f)